@@ -0,0 +1,304 @@
+#pragma once
+
+#include <ozo/asio.h>
+#include <ozo/connection.h>
+#include <ozo/connector.h>
+#include <ozo/core/thread_safety.h>
+#include <ozo/detail/bind.h>
+
+#include <boost/asio/post.hpp>
+
+#include <memory>
+#include <mutex>
+
+namespace ozo {
+
+/**
+ * @brief Configuration of the `ozo::circuit_breaker`
+ * @ingroup group-connection-types
+ */
+struct circuit_breaker_config {
+    std::size_t failure_threshold = 5; //!< number of consecutive connection failures which open the circuit
+    time_traits::duration open_duration = std::chrono::seconds(5); //!< time the circuit stays open before the host is probed
+    std::size_t half_open_probes = 1; //!< maximum number of concurrent probe connection attempts while the circuit is half-open
+};
+
+/**
+ * @brief State of the `ozo::circuit_breaker`
+ * @ingroup group-connection-types
+ */
+enum class circuit_state {
+    closed, //!< connection attempts are passed to the host
+    open, //!< connection attempts are rejected with `ozo::error::circuit_breaker_open`
+    half_open, //!< a limited number of probe connection attempts are passed to the host, the rest are rejected
+};
+
+namespace detail {
+
+/**
+ * State shared by copies of a `circuit_breaker`. The circuit is opened by a number of consecutive
+ * connection failures. After the open duration the circuit becomes half-open and passes probe
+ * attempts: a successful probe closes the circuit, a failed one opens it again. Errors which are
+ * not connection errors, e.g. a pool queue overflow, and cancelled attempts say nothing about
+ * the host and are ignored.
+ */
+template <typename ThreadSafety>
+class circuit_breaker_state {
+public:
+    enum class admission { allowed, probe, rejected };
+
+    explicit circuit_breaker_state(const circuit_breaker_config& config) : config_(config) {}
+
+    admission admit() {
+        const auto now = time_traits::now();
+        const std::lock_guard lock(mutex_);
+        if (state_ == circuit_state::open && now >= open_until_) {
+            state_ = circuit_state::half_open;
+        }
+        switch (state_) {
+            case circuit_state::closed:
+                return admission::allowed;
+            case circuit_state::half_open:
+                if (probes_ < std::max<std::size_t>(config_.half_open_probes, 1)) {
+                    ++probes_;
+                    return admission::probe;
+                }
+                break;
+            case circuit_state::open:
+                break;
+        }
+        ++rejected_;
+        return admission::rejected;
+    }
+
+    void complete(const error_code& ec, admission a) {
+        const std::lock_guard lock(mutex_);
+        if (a == admission::probe) {
+            --probes_;
+        }
+        if (!ec) {
+            failures_ = 0;
+            if (a == admission::probe) {
+                state_ = circuit_state::closed;
+            }
+        } else if (is_host_failure(ec)) {
+            if (a == admission::probe) {
+                open();
+            } else if (state_ == circuit_state::closed && ++failures_ >= config_.failure_threshold) {
+                open();
+            }
+        }
+    }
+
+    bool is_open() const {
+        const auto now = time_traits::now();
+        const std::lock_guard lock(mutex_);
+        switch (state_) {
+            case circuit_state::closed:
+                return false;
+            case circuit_state::open:
+                return now < open_until_;
+            case circuit_state::half_open:
+                return probes_ >= std::max<std::size_t>(config_.half_open_probes, 1);
+        }
+        return false;
+    }
+
+    circuit_state state() const {
+        const std::lock_guard lock(mutex_);
+        return state_;
+    }
+
+    std::size_t rejected() const {
+        const std::lock_guard lock(mutex_);
+        return rejected_;
+    }
+
+private:
+    // A cancelled attempt, e.g. a losing hedged try, an io_context shutdown or a pool abort,
+    // and a rejection by a nested circuit breaker say nothing about the host.
+    static bool is_host_failure(const error_code& ec) {
+        return ec == errc::connection_error && ec != asio::error::operation_aborted
+            && ec != error::circuit_breaker_open;
+    }
+
+    void open() {
+        state_ = circuit_state::open;
+        open_until_ = time_traits::now() + config_.open_duration;
+        failures_ = 0;
+    }
+
+    circuit_breaker_config config_;
+    mutable get_connection_pool_mutex_t<ThreadSafety> mutex_;
+    circuit_state state_ = circuit_state::closed;
+    time_traits::time_point open_until_ {};
+    std::size_t failures_ = 0;
+    std::size_t probes_ = 0;
+    std::size_t rejected_ = 0;
+};
+
+/**
+ * Records the result of the connection attempt to the circuit breaker and then invokes the handler.
+ */
+template <typename Handler, typename ThreadSafety>
+struct circuit_breaker_handler {
+    using state_type = circuit_breaker_state<ThreadSafety>;
+
+    std::shared_ptr<state_type> state_;
+    typename state_type::admission admission_;
+    Handler handler_;
+
+    template <typename Connection>
+    void operator ()(error_code ec, Connection&& conn) {
+        state_->complete(ec, admission_);
+        handler_(std::move(ec), std::forward<Connection>(conn));
+    }
+
+    using executor_type = asio::associated_executor_t<Handler>;
+
+    executor_type get_executor() const noexcept {
+        return asio::get_associated_executor(handler_);
+    }
+
+    using allocator_type = asio::associated_allocator_t<Handler>;
+
+    allocator_type get_allocator() const noexcept {
+        return asio::get_associated_allocator(handler_);
+    }
+};
+
+} // namespace detail
+
+/**
+ * @brief Connection source which fails fast while its host is down
+ *
+ * When a host is down, each connection attempt to it waits for the connect time-out and burns
+ * the time constraint of an operation which could be used for a healthy host. The circuit breaker
+ * counts consecutive connection failures of the underlying source:
+ *
+ * * the circuit is closed initially, connection attempts are passed to the source;
+ * * after `circuit_breaker_config::failure_threshold` consecutive connection failures the circuit
+ *   is opened, and connection attempts are completed immediately with `ozo::error::circuit_breaker_open`;
+ * * after `circuit_breaker_config::open_duration` the circuit becomes half-open and passes up to
+ *   `circuit_breaker_config::half_open_probes` probe attempts, the rest are rejected;
+ * * a successful probe closes the circuit and a failed one opens it again.
+ *
+ * Only errors of the `ozo::errc::connection_error` condition are counted as failures.
+ * `ozo::error::circuit_breaker_open` belongs to this condition, so the failover strategies recover
+ * it like other connection errors. Also the strategies skip the sources with open circuits via
+ * `ozo::is_circuit_open()`, so the time constraint of an operation is divided between the healthy
+ * hosts only. Copies of the breaker share the circuit.
+ *
+ * ### Example
+ *
+ * @code{cpp}
+auto conn_info = ozo::failover::make_role_based_connection_source(
+    ozo::failover::master=ozo::make_connection_pool(ozo::make_circuit_breaker(master_conn_info), pool_config),
+    ozo::failover::replica=ozo::make_connection_pool(ozo::make_circuit_breaker(replica_conn_info), pool_config)
+);
+ * @endcode
+ *
+ * @tparam Source --- underlying `ConnectionSource` which is being used to create connections to a database.
+ * @tparam ThreadSafety --- admissibility to use in multithreaded environment without additional synchronization.
+ * Thread safe by default.
+ *
+ * @ingroup group-connection-types
+ * @models{ConnectionSource}
+ */
+template <typename Source, typename ThreadSafety = std::decay_t<decltype(thread_safe)>>
+class circuit_breaker {
+    static_assert(ozo::ConnectionSource<Source>, "Source should model ConnectionSource concept");
+
+    using state_type = detail::circuit_breaker_state<ThreadSafety>;
+
+public:
+    using connection_type = ozo::connection_type<Source>; //!< Type of connection which is produced by the source.
+
+    /**
+     * Construct a new circuit breaker object
+     *
+     * @param source --- `ConnectionSource` object which is being used to create connections to a database.
+     * @param config --- configuration of the circuit breaker.
+     * @param thread_safety --- admissibility to use in multithreaded environment without additional synchronization.
+     */
+    circuit_breaker(Source source, const circuit_breaker_config& config = {},
+            const ThreadSafety& /*thread_safety*/ = ThreadSafety{})
+    : source_(std::move(source)), state_(std::make_shared<state_type>(config)) {}
+
+    /**
+     * Establish a connection via the underlying source unless the circuit is open.
+     *
+     * @param io --- `io_context` for the connection IO.
+     * @param t --- #TimeConstraint for the operation.
+     * @param handler --- #Handler.
+     */
+    template <typename TimeConstraint, typename Handler>
+    void operator ()(io_context& io, TimeConstraint t, Handler&& handler) const {
+        static_assert(ozo::TimeConstraint<TimeConstraint>, "should model TimeConstraint concept");
+        const auto admission = state_->admit();
+        if (admission == state_type::admission::rejected) {
+            return asio::post(io.get_executor(),
+                detail::bind(std::forward<Handler>(handler), error_code{error::circuit_breaker_open}, connection_type{}));
+        }
+        using handler_type = detail::circuit_breaker_handler<std::decay_t<Handler>, ThreadSafety>;
+        source_(io, std::move(t), handler_type{state_, admission, std::forward<Handler>(handler)});
+    }
+
+    /**
+     * Determine if connection attempts are rejected now, see `ozo::is_circuit_open()`.
+     */
+    bool is_circuit_open() const { return state_->is_open(); }
+
+    /**
+     * Get the current state of the circuit.
+     */
+    circuit_state state() const { return state_->state(); }
+
+    /**
+     * Get the number of connection attempts which have been rejected since the breaker was created.
+     */
+    std::size_t rejected() const { return state_->rejected(); }
+
+    /**
+     * Drop the oid map shared by new connections of the underlying source,
+     * see `ozo::connection_info::invalidate_oid_map()`.
+     */
+    template <typename S = Source>
+    auto invalidate_oid_map() const -> decltype(std::declval<const S&>().invalidate_oid_map()) {
+        return source_.invalidate_oid_map();
+    }
+
+    auto operator [](io_context& io) const & {
+        return connection_provider(*this, io);
+    }
+
+    auto operator [](io_context& io) && {
+        return connection_provider(std::move(*this), io);
+    }
+
+private:
+    Source source_;
+    std::shared_ptr<state_type> state_;
+};
+
+/**
+ * @brief Circuit breaker construct helper function
+ *
+ * @param source --- connection source object which is being used to create connections to a database.
+ * @param config --- configuration of the circuit breaker.
+ * @param thread_safety --- admissibility to use in multithreaded environment without additional synchronization.
+ * Thread safe by default (`ozo::thread_safety<true>`).
+ *
+ * @return `ozo::circuit_breaker` object.
+ * @ingroup group-connection-functions
+ * @relates ozo::circuit_breaker
+ */
+template <typename ConnectionSource, typename ThreadSafety = decltype(thread_safe)>
+auto make_circuit_breaker(ConnectionSource&& source, const circuit_breaker_config& config = {},
+                          const ThreadSafety& thread_safety = ThreadSafety{}) {
+    static_assert(ozo::ConnectionSource<ConnectionSource>, "source should model ConnectionSource concept");
+    return circuit_breaker<std::decay_t<ConnectionSource>, std::decay_t<ThreadSafety>>{
+        std::forward<ConnectionSource>(source), config, thread_safety};
+}
+
+} // namespace ozo
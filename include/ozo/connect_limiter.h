@@ -0,0 +1,313 @@
+#pragma once
+
+#include <ozo/asio.h>
+#include <ozo/connection.h>
+#include <ozo/connector.h>
+#include <ozo/deadline.h>
+#include <ozo/core/thread_safety.h>
+#include <ozo/detail/bind.h>
+#include <ozo/detail/connection_pool_queue.h>
+#include <ozo/detail/make_copyable.h>
+
+#include <boost/asio/post.hpp>
+
+#include <algorithm>
+#include <optional>
+#include <random>
+
+namespace ozo {
+
+/**
+ * @brief Configuration of the `ozo::connect_limiter`
+ * @ingroup group-connection-types
+ */
+struct connect_limiter_config {
+    std::size_t max_in_flight = 8; //!< maximum number of concurrent connection attempts
+    double connects_per_second = 0; //!< maximum rate of new connection attempts, `0` disables the rate limit
+    std::size_t queue_capacity = 1024; //!< maximum number of connection attempts waiting for the limits
+    time_traits::duration backoff = std::chrono::milliseconds(100); //!< delay of the next attempt after the first failure, it is doubled on each subsequent failure, `0` disables the backoff
+    time_traits::duration max_backoff = std::chrono::seconds(10); //!< maximum delay of the next attempt after failures
+};
+
+namespace detail {
+
+/**
+ * State shared by copies of a `connect_limiter`, e.g. by the copies which are made
+ * by a connection pool for each connection attempt. The rate limit is implemented via
+ * reservation of the start time: each attempt takes the next free time slot.
+ */
+template <typename ThreadSafety>
+class connect_limiter_state {
+public:
+    using queue_type = connection_pool_queue<ThreadSafety>;
+
+    explicit connect_limiter_state(const connect_limiter_config& config)
+    : config_(config),
+      queue_(std::make_shared<queue_type>(std::max<std::size_t>(config.max_in_flight, 1), config.queue_capacity, false)),
+      random_(std::random_device{}()) {}
+
+    queue_type& queue() noexcept { return *queue_; }
+
+    /**
+     * Reserves the time to start the next attempt if it is earlier than the deadline. An attempt
+     * which can not be started in time does not take the time, so it does not delay the next ones.
+     */
+    std::optional<time_traits::time_point> reserve(time_traits::time_point deadline) {
+        const auto now = time_traits::now();
+        const std::lock_guard lock(mutex_);
+        const auto result = std::max({now, next_start_, backoff_until_});
+        if (result >= deadline) {
+            return std::nullopt;
+        }
+        if (config_.connects_per_second > 0) {
+            next_start_ = result + std::chrono::duration_cast<time_traits::duration>(
+                std::chrono::duration<double>(1.0 / config_.connects_per_second));
+        }
+        return result;
+    }
+
+    /**
+     * Updates the backoff by the result of an attempt started at the given time. The delay is jittered
+     * between a half and a whole of the exponential backoff, so attempts of many clients do not come
+     * to the database at once. The backoff is escalated only by an attempt started after the previous
+     * escalation, so concurrent attempts which fail together count as one failure. A cancelled attempt
+     * and an attempt out of the caller's time constraint say nothing about the database and are ignored.
+     */
+    void complete(const error_code& ec, time_traits::time_point started_at) {
+        if (ec == asio::error::operation_aborted || ec == asio::error::timed_out) {
+            return;
+        }
+        const std::lock_guard lock(mutex_);
+        if (!ec) {
+            failures_ = 0;
+            backoff_until_ = time_traits::time_point{};
+            return;
+        }
+        if (config_.backoff == time_traits::duration(0) || started_at < escalated_at_) {
+            return;
+        }
+        const auto factor = std::int64_t(1) << std::min(failures_, max_exponent);
+        const auto backoff = std::min(config_.max_backoff, config_.backoff * factor);
+        ++failures_;
+        std::uniform_int_distribution<time_traits::duration::rep> jitter(0, backoff.count() / 2);
+        escalated_at_ = time_traits::now();
+        backoff_until_ = escalated_at_ + backoff - time_traits::duration(jitter(random_));
+    }
+
+    std::size_t in_flight() const { return queue_->in_use(); }
+
+    std::size_t queue_size() const { return queue_->size(); }
+
+private:
+    static constexpr std::size_t max_exponent = 16;
+
+    connect_limiter_config config_;
+    std::shared_ptr<queue_type> queue_;
+    get_connection_pool_mutex_t<ThreadSafety> mutex_;
+    time_traits::time_point next_start_ {};
+    time_traits::time_point backoff_until_ {};
+    time_traits::time_point escalated_at_ {};
+    std::size_t failures_ = 0;
+    std::minstd_rand random_;
+};
+
+/**
+ * Completes the limited connection attempt: updates the backoff, releases
+ * the in-flight slot and then invokes the handler.
+ */
+template <typename Handler, typename ThreadSafety>
+struct connect_limiter_handler {
+    std::shared_ptr<connect_limiter_state<ThreadSafety>> state_;
+    std::shared_ptr<void> lease_;
+    Handler handler_;
+    time_traits::time_point started_at_ {};
+
+    template <typename Connection>
+    void operator ()(error_code ec, Connection&& conn) {
+        state_->complete(ec, started_at_);
+        lease_.reset();
+        handler_(std::move(ec), std::forward<Connection>(conn));
+    }
+
+    using executor_type = asio::associated_executor_t<Handler>;
+
+    executor_type get_executor() const noexcept {
+        return asio::get_associated_executor(handler_);
+    }
+
+    using allocator_type = asio::associated_allocator_t<Handler>;
+
+    allocator_type get_allocator() const noexcept {
+        return asio::get_associated_allocator(handler_);
+    }
+};
+
+} // namespace detail
+
+/**
+ * @brief Connection source which limits connection attempts of the underlying source
+ *
+ * When a database restarts, all the clients try to reconnect at once and thousands of
+ * simultaneous connection attempts overwhelm the database authentication. The limiter
+ * protects the database from such a storm:
+ *
+ * * no more than `connect_limiter_config::max_in_flight` attempts are performed concurrently,
+ *   the rest wait in a FIFO queue within their time constraints;
+ * * attempts are started no faster than `connect_limiter_config::connects_per_second`;
+ * * after a failed attempt the next ones are delayed by an exponential backoff with jitter,
+ *   the backoff is reset by a successful attempt. Attempts which fail together, e.g. all the
+ *   in-flight attempts of a restart, escalate the backoff once. Cancelled attempts and attempts
+ *   completed with `boost::asio::error::timed_out` do not affect the backoff.
+ *
+ * Copies of the limiter share the limits, so a single limiter may be used by several connection pools.
+ * An attempt which waits for the limits longer than its time constraint is completed with
+ * `boost::asio::error::timed_out`, an attempt beyond the queue capacity is completed with
+ * `ozo::error::pool_queue_overflow`.
+ *
+ * ### Example
+ *
+ * @code{cpp}
+ozo::connect_limiter_config limits;
+limits.max_in_flight = 4;
+limits.connects_per_second = 20;
+auto pool = ozo::make_connection_pool(ozo::make_connect_limiter(conn_info, limits), pool_config);
+ * @endcode
+ *
+ * @tparam Source --- underlying `ConnectionSource` which is being used to create connections to a database.
+ * @tparam ThreadSafety --- admissibility to use in multithreaded environment without additional synchronization.
+ * Thread safe by default.
+ *
+ * @ingroup group-connection-types
+ * @models{ConnectionSource}
+ */
+template <typename Source, typename ThreadSafety = std::decay_t<decltype(thread_safe)>>
+class connect_limiter {
+    static_assert(ozo::ConnectionSource<Source>, "Source should model ConnectionSource concept");
+
+public:
+    using connection_type = ozo::connection_type<Source>; //!< Type of connection which is produced by the source.
+
+    /**
+     * Construct a new limiter object
+     *
+     * @param source --- `ConnectionSource` object which is being used to create connections to a database.
+     * @param config --- limits of connection attempts.
+     * @param thread_safety --- admissibility to use in multithreaded environment without additional synchronization.
+     */
+    connect_limiter(Source source, const connect_limiter_config& config = {},
+            const ThreadSafety& /*thread_safety*/ = ThreadSafety{})
+    : source_(std::move(source)),
+      state_(std::make_shared<detail::connect_limiter_state<ThreadSafety>>(config)) {}
+
+    /**
+     * Establish a connection via the underlying source when the limits allow it.
+     *
+     * @param io --- `io_context` for the connection IO.
+     * @param t --- #TimeConstraint for the operation including the wait for the limits.
+     * @param handler --- #Handler.
+     */
+    template <typename TimeConstraint, typename Handler>
+    void operator ()(io_context& io, TimeConstraint t, Handler&& handler) const {
+        static_assert(ozo::TimeConstraint<TimeConstraint>, "should model TimeConstraint concept");
+        const auto at = deadline(t);
+        auto lease = state_->queue().acquire(io.get_executor(), wait_deadline(at), [&] {
+            return [self = *this, &io, at, handler = detail::make_copyable_t<Handler>(std::forward<Handler>(handler))]
+                    (error_code ec, auto lease) mutable {
+                if (ec) {
+                    return asio::post(io.get_executor(), detail::bind(std::move(handler), ec, connection_type{}));
+                }
+                self.start(io, at, std::move(lease), std::move(handler));
+            };
+        });
+        if (lease) {
+            start(io, at, std::move(lease), std::forward<Handler>(handler));
+        }
+    }
+
+    /**
+     * Drop the oid map shared by new connections of the underlying source,
+     * see `ozo::connection_info::invalidate_oid_map()`.
+     */
+    template <typename S = Source>
+    auto invalidate_oid_map() const -> decltype(std::declval<const S&>().invalidate_oid_map()) {
+        return source_.invalidate_oid_map();
+    }
+
+    /**
+     * Get the number of connection attempts in progress, including the ones which wait for the rate limit or the backoff.
+     */
+    std::size_t in_flight() const { return state_->in_flight(); }
+
+    /**
+     * Get the number of connection attempts which wait for a free in-flight slot.
+     */
+    std::size_t queue_size() const { return state_->queue_size(); }
+
+    auto operator [](io_context& io) const & {
+        return connection_provider(*this, io);
+    }
+
+    auto operator [](io_context& io) && {
+        return connection_provider(std::move(*this), io);
+    }
+
+private:
+    static auto wait_deadline(time_traits::time_point at) {
+        return at;
+    }
+
+    static auto wait_deadline(none_t) {
+        return time_traits::time_point::max();
+    }
+
+    template <typename Deadline, typename Handler>
+    void start(io_context& io, Deadline at, std::shared_ptr<void> lease, Handler&& handler) const {
+        const auto start_at = state_->reserve(wait_deadline(at));
+        if (!start_at) {
+            // The attempt is not started at all, so it does not affect the backoff.
+            lease.reset();
+            return asio::post(io.get_executor(),
+                detail::bind(std::forward<Handler>(handler), error_code{asio::error::timed_out}, connection_type{}));
+        }
+        using handler_type = detail::connect_limiter_handler<std::decay_t<Handler>, ThreadSafety>;
+        handler_type limited {state_, std::move(lease), std::forward<Handler>(handler)};
+        if (*start_at <= time_traits::now()) {
+            limited.started_at_ = time_traits::now();
+            return source_(io, at, std::move(limited));
+        }
+        auto timer = std::make_shared<std::decay_t<decltype(detail::get_operation_timer(io.get_executor(), *start_at))>>(
+            detail::get_operation_timer(io.get_executor(), *start_at));
+        timer->async_wait([source = source_, &io, at, timer, limited = std::move(limited)] (error_code ec) mutable {
+            if (ec) {
+                return limited(std::move(ec), connection_type{});
+            }
+            limited.started_at_ = time_traits::now();
+            source(io, at, std::move(limited));
+        });
+    }
+
+    Source source_;
+    std::shared_ptr<detail::connect_limiter_state<ThreadSafety>> state_;
+};
+
+/**
+ * @brief Connection limiter construct helper function
+ *
+ * @param source --- connection source object which is being used to create connections to a database.
+ * @param config --- limits of connection attempts.
+ * @param thread_safety --- admissibility to use in multithreaded environment without additional synchronization.
+ * Thread safe by default (`ozo::thread_safety<true>`).
+ *
+ * @return `ozo::connect_limiter` object.
+ * @ingroup group-connection-functions
+ * @relates ozo::connect_limiter
+ */
+template <typename ConnectionSource, typename ThreadSafety = decltype(thread_safe)>
+auto make_connect_limiter(ConnectionSource&& source, const connect_limiter_config& config = {},
+                          const ThreadSafety& thread_safety = ThreadSafety{}) {
+    static_assert(ozo::ConnectionSource<ConnectionSource>, "source should model ConnectionSource concept");
+    return connect_limiter<std::decay_t<ConnectionSource>, std::decay_t<ThreadSafety>>{
+        std::forward<ConnectionSource>(source), config, thread_safety};
+}
+
+} // namespace ozo
@@ -6,11 +6,15 @@
 #include <ozo/core/concept.h>
 #include <ozo/core/recursive.h>
 #include <ozo/core/none.h>
+#include <ozo/core/thread_safety.h>
 #include <ozo/deadline.h>
+#include <ozo/statement_cache.h>
+#include <ozo/statistics.h>
 #include <ozo/pg/handle.h>
 
 #include <ozo/detail/bind.h>
 #include <ozo/detail/functional.h>
+#include <ozo/detail/oid_map_cache.h>
 
 #include <boost/asio/dispatch.hpp>
 #include <boost/asio/posix/stream_descriptor.hpp>
@@ -83,7 +87,7 @@ inline constexpr decltype(auto) unwrap_connection(T&& conn) noexcept {
  * The class object is non-copyable.
  *
  * @tparam OidMap --- oid map of types are used with connection
- * @tparam Statistics --- statistics of the connection (not supported yet)
+ * @tparam Statistics --- statistics of the connection, e.g. `ozo::basic_statistics`, `ozo::no_statistics` to collect nothing
  *
  * @thread_safety{Safe,Unsafe}
  * @ingroup group-connection-types
@@ -96,12 +100,13 @@ public:
     using oid_map_type = OidMap; //!< Oid map of types that are used with the connection
     using error_context_type = std::string; //!< Additional error context which could provide context depended information for errors
     using executor_type = io_context::executor_type; //!< The type of the executor associated with the object.
+    using statement_cache_type = ozo::statement_cache; //!< Cache of server-side prepared statements
 
     /**
      * Construct a new connection object.
      *
      * @param io --- execution context for IO operations associated with the object.
-     * @param statistics --- initial statistics (not supported yet)
+     * @param statistics --- initial statistics
      */
     connection(io_context& io, Statistics statistics);
 
@@ -132,12 +137,41 @@ public:
      */
     const oid_map_type& oid_map() const noexcept { return oid_map_;}
 
+    /**
+     * Add the value to the statistics item. Is used by the library operations.
+     *
+     * @param key --- one of `ozo::statistics_key` items.
+     * @param value --- value to add.
+     */
     template <typename Key, typename Value>
-    void update_statistics(const Key&, const Value&) noexcept {
-        static_assert(std::is_void_v<Key>, "update_statistics is not supperted");
+    void update_statistics(const Key& key, const Value& value) noexcept {
+        static_assert(!std::is_same_v<Statistics, no_statistics>, "statistics are not collected for the connection");
+        statistics_.update(key, value);
     }
+    /**
+     * Get statistics collected for the connection.
+     *
+     * @return const Statistics& --- statistics object.
+     */
     const Statistics& statistics() const noexcept { return statistics_;}
 
+    /**
+     * Get a reference to the cache of server-side prepared statements of the connection.
+     * The cache is disabled by default, assign a cache with non-zero capacity to enable
+     * transparent usage of prepared statements for the operations with the connection.
+     *
+     * @return statement_cache_type& --- reference on the statement cache object.
+     */
+    statement_cache_type& statement_cache() noexcept { return statement_cache_;}
+
+    /**
+     * Get a reference to the oid map cache of the connection source the connection is bound to.
+     * The cache is invalidated if a result can not be received because of `ozo::error::oid_type_mismatch`.
+     *
+     * @return reference on the cache pointer, it is `nullptr` if the connection is not bound to a cache.
+     */
+    std::shared_ptr<detail::oid_map_cache<oid_map_type>>& oid_map_cache() noexcept { return oid_map_cache_;}
+
     /**
      * Get the additional context object for an error that occurred during the last operation on the connection.
      *
@@ -270,6 +304,8 @@ private:
     oid_map_type oid_map_;
     Statistics statistics_;
     error_context_type error_context_;
+    statement_cache_type statement_cache_;
+    std::shared_ptr<detail::oid_map_cache<oid_map_type>> oid_map_cache_;
 };
 
 /**
@@ -339,6 +375,37 @@ template <typename T>
 inline constexpr auto Connection = is_connection<std::decay_t<decltype(unwrap_connection(std::declval<T>()))>>::value;
 //! @endcond
 
+/**
+ * @brief Thread safety of a `Connection` operations
+ *
+ * Defines whether completions of the operations on the connection may be invoked
+ * from multiple threads concurrently. For the thread safe connection each operation
+ * is performed via a strand created from the connection's executor. For not thread
+ * safe connection the connection's executor is used as is, so there is no strand
+ * queue and no extra dispatch for each completion. That is suitable for an `io_context`
+ * which is run by a single thread only, e.g. for the thread-per-core model.
+ *
+ * Uses `Connection::thread_safety_type` if it is defined, `ozo::thread_safety<true>`
+ * otherwise. Connections of `ozo::connection_pool` with `ozo::thread_safety<false>`
+ * are not thread safe.
+ *
+ * @tparam T --- `Connection` type.
+ * @ingroup group-connection-types
+ */
+template <typename T, typename = std::void_t<>>
+struct get_connection_thread_safety {
+    using type = thread_safety<true>;
+};
+
+template <typename T>
+struct get_connection_thread_safety<T, std::void_t<typename T::thread_safety_type>> {
+    using type = typename T::thread_safety_type;
+};
+
+template <typename T>
+using connection_thread_safety = typename get_connection_thread_safety<
+    std::decay_t<decltype(unwrap_connection(std::declval<T&>()))>>::type;
+
 /**
  * @defgroup group-connection-functions Related functions
  * @ingroup group-connection
@@ -645,7 +712,7 @@ struct connection_source_traits {
  *
  * @par Concrete models
  *
- * `ozo::connection_info`, `ozo::connection_pool`, `ozo::failover::role_based_connection_source`.
+ * `ozo::connection_info`, `ozo::connection_pool`, `ozo::connect_limiter`, `ozo::circuit_breaker`, `ozo::failover::role_based_connection_source`.
  *
  * @par Definition
  *
@@ -753,6 +820,37 @@ template <typename T>
 inline constexpr auto ConnectionProvider = is_connection_provider<std::decay_t<T>>::value;
 //! @endcond
 
+template <typename T, typename = hana::when<true>>
+struct is_circuit_open_impl {
+    static constexpr bool apply(const T&) noexcept { return false;}
+};
+
+template <typename T>
+struct is_circuit_open_impl<T, hana::when_valid<decltype(std::declval<const T&>().is_circuit_open())>> {
+    static bool apply(const T& v) { return v.is_circuit_open();}
+};
+
+/**
+ * @brief Determines if a connection attempt is rejected by a circuit breaker
+ *
+ * Failover strategies use the function to skip a `ConnectionSource` or a `ConnectionProvider`
+ * which would fail fast with `ozo::error::circuit_breaker_open`, see `ozo::circuit_breaker`.
+ * By default it calls `v.is_circuit_open()` if there is such member function and returns `false` otherwise.
+ *
+ * @param v --- `ConnectionSource` or `ConnectionProvider` object.
+ * @return `true` --- connection attempts are rejected now.
+ * @return `false` --- otherwise.
+ *
+ * ###Customization Point
+ *
+ * This function may be customized via specialization of `ozo::is_circuit_open_impl`.
+ * @ingroup group-connection-functions
+ */
+template <typename T>
+inline bool is_circuit_open(const T& v) {
+    return is_circuit_open_impl<std::decay_t<decltype(unwrap(v))>>::apply(unwrap(v));
+}
+
 #ifdef OZO_DOCUMENTATION
 /**
  * @brief Get a connection object from connection provider with time constaint.
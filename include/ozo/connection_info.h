@@ -28,6 +28,7 @@ template <
 class connection_info {
     std::string conn_str;
     Statistics statistics;
+    std::shared_ptr<detail::oid_map_cache<OidMap>> oid_map_cache;
 
 public:
     using connection_type = std::shared_ptr<ozo::connection<OidMap, Statistics>>; //!< Type of connection which is produced by the source.
@@ -41,7 +42,8 @@ public:
      * @param statistics --- statistics are being used for connections.
      */
     connection_info(std::string conn_str, const OidMap& = OidMap{}, Statistics statistics = Statistics{})
-            : conn_str(std::move(conn_str)), statistics(std::move(statistics)) {
+            : conn_str(std::move(conn_str)), statistics(std::move(statistics)),
+              oid_map_cache(std::make_shared<detail::oid_map_cache<OidMap>>()) {
     }
 
     /**
@@ -61,7 +63,21 @@ public:
         static_assert(ozo::TimeConstraint<TimeConstraint>, "should model TimeConstraint concept");
         auto allocator = asio::get_associated_allocator(handler);
         impl::async_connect(conn_str, t, std::allocate_shared<ozo::connection<OidMap, Statistics>>(allocator, io, statistics),
-            std::forward<Handler>(handler));
+            oid_map_cache, std::forward<Handler>(handler));
+    }
+
+    /**
+     * @brief Drops the oid map shared by connections of the source
+     *
+     * Oids of custom types are requested by the first connection and are shared with all
+     * the next connections of the source and its copies (e.g. connections of a `connection_pool`
+     * which is created from the source), so the new connections do not perform the oid request.
+     * The map is dropped automatically if a result can not be received because of
+     * `ozo::error::oid_type_mismatch`. Call this function if the custom types have been
+     * recreated in a database, the next connection would request the oids again.
+     */
+    void invalidate_oid_map() const {
+        oid_map_cache->invalidate();
     }
 
     auto operator [](io_context& io) const & {
@@ -4,11 +4,78 @@
 #include <ozo/transaction_status.h>
 #include <ozo/asio.h>
 #include <ozo/connector.h>
+#include <ozo/connection_pool_metrics.h>
 #include <ozo/core/thread_safety.h>
 #include <ozo/detail/connection_pool.h>
+#include <ozo/detail/connection_pool_queue.h>
+
+#include <algorithm>
+#include <atomic>
 
 namespace ozo {
 
+/**
+ * @brief Policy of returning a connection with not idle transaction status to the pool
+ * @ingroup group-connection-types
+ *
+ * A connection may be returned to the pool with an open transaction or an in-flight query,
+ * e.g. if a coroutine throws within a transaction or a request is timed out. By default
+ * such a connection is closed, so the pool has to establish a new one. Under a burst of
+ * errors it causes a burst of reconnects. The connection may be reset in background instead.
+ */
+enum class connection_reset_policy {
+    waste, //!< close the connection
+    rollback, //!< drain results of the in-flight query and rollback the transaction
+    discard_all, //!< same as `rollback` with the `DISCARD ALL` command to reset the session state
+};
+
+/**
+ * @brief Options of returning a connection with not idle transaction status to the pool
+ * @ingroup group-connection-types
+ *
+ * The connection is reset in background and returned to the pool if its transaction status
+ * becomes idle within the timeout, otherwise it is closed. The connection occupies a pool
+ * slot during the reset.
+ */
+struct connection_reset_options {
+    connection_reset_policy policy = connection_reset_policy::waste; //!< how to reset the connection
+    time_traits::duration timeout = std::chrono::seconds(1); //!< time budget of the reset
+};
+
+/**
+ * @brief Order of serving requests which wait for a free connection of the pool
+ * @ingroup group-connection-types
+ */
+enum class connection_pool_queue_policy {
+    fifo, //!< requests are served in the order of arrival
+    earliest_deadline_first, //!< requests with earlier deadlines are served first, requests with less time left than the median connection usage time are rejected with `ozo::error::pool_deadline_too_close`
+};
+
+/**
+ * @brief Order of handing out idle connections of the pool
+ * @ingroup group-connection-types
+ */
+enum class connection_pool_idle_order {
+    fifo, //!< the least recently used connection first, so all the connections are used evenly
+    lifo, //!< the most recently used connection first, so a small hot set serves most of the traffic and the rest reach `connection_pool_config::idle_timeout`
+};
+
+/**
+ * @brief Options of the adaptive concurrency limit of the connection pool
+ * @ingroup group-connection-types
+ *
+ * The pool limits the number of requests which use connections concurrently between `min`
+ * and `connection_pool_config::capacity`. The limit starts from `min` and is increased by one while
+ * all the connections are busy and the time requests use connections stays near the baseline. The limit
+ * is decreased by the `backoff` ratio when the average time exceeds the baseline by the `tolerance` ratio,
+ * e.g. when the database becomes overloaded. Requests beyond the limit wait in the queue of the pool.
+ */
+struct connection_pool_adaptive_limit {
+    std::size_t min = 0; //!< lower bound of the limit, `0` disables the adaptive limit
+    double tolerance = 2.0; //!< ratio of the connection usage time to the baseline which is treated as overload
+    double backoff = 0.9; //!< multiplier of the limit on overload
+};
+
 /**
  * @brief Connection pool configuration
  * @ingroup group-connection-types
@@ -22,6 +89,17 @@ struct connection_pool_config {
     std::size_t queue_capacity = 128; //!< maximum number of queued requests to get available connection
     time_traits::duration idle_timeout = std::chrono::seconds(60); //!< time interval to close connection after last usage
     time_traits::duration lifespan = std::chrono::hours(24); //!< time interval to keep connection open
+    std::size_t statement_cache_capacity = 0; //!< maximum number of server-side prepared statements per connection, `0` disables the prepared statements usage
+    std::size_t min_idle = 0; //!< minimum number of idle connections to keep established in background, `0` disables the maintenance
+    std::size_t warm_up = 0; //!< number of connections to establish by `connection_pool::warm_up()`, at least `min_idle` connections are established
+    time_traits::duration min_idle_interval = std::chrono::seconds(1); //!< time interval between checks of the `min_idle` connections number
+    time_traits::duration min_idle_connect_timeout = std::chrono::seconds(10); //!< time budget of each connection established to keep `min_idle` connections
+    std::size_t shards = 1; //!< number of independent sub-pools to reduce lock contention between threads, e.g. number of `io_context` objects
+    std::shared_ptr<connection_pool_metrics> metrics; //!< instrumentation of the pool, `nullptr` disables it
+    connection_reset_options reset; //!< how to return connections with not idle transaction status to the pool
+    connection_pool_queue_policy queue_policy = connection_pool_queue_policy::fifo; //!< order of serving requests which wait for a free connection
+    connection_pool_adaptive_limit adaptive_limit; //!< limit of concurrently used connections driven by latency, disabled by default
+    connection_pool_idle_order idle_order = connection_pool_idle_order::fifo; //!< order of handing out idle connections
 };
 
 /**
@@ -48,6 +126,7 @@ struct connection_traits {
     using oid_map_type = typename Rep::oid_map_type; //!< Oid map of types that are used with the connection
     using error_context_type = typename Rep::error_context_type; //!< Additional error context which could provide context depended information for errors
     using statistics_type = typename Rep::statistics_type; //!< Connection statistics to be collected
+    using stream_type = typename Rep::stream_type; //!< Connection socket type
 };
 
 template <typename OidMap, typename Statistics = none_t>
@@ -57,6 +136,8 @@ public:
     using native_handle_type = typename ozo::pg::conn::pointer;
     using statistics_type = Statistics;
     using error_context_type = std::string;
+    using statement_cache_type = ozo::statement_cache;
+    using stream_type = typename detail::connection_stream<asio::io_context::executor_type>::type;
 
     const ozo::pg::conn& safe_native_handle() const & {return safe_handle_;}
     ozo::pg::conn& safe_native_handle() & {return safe_handle_;}
@@ -67,8 +148,9 @@ public:
     const auto& statistics() const & {return statistics_;}
 
     template <typename Key, typename Value>
-    void update_statistics(const Key&, Value&&) noexcept {
-        static_assert(std::is_void_v<Key>, "update_statistics is not supperted");
+    void update_statistics(const Key& key, const Value& value) noexcept {
+        static_assert(!std::is_same_v<Statistics, none_t>, "statistics are not collected for the connection");
+        statistics_.update(key, value);
     }
 
     const error_context_type& get_error_context() const noexcept {
@@ -78,20 +160,49 @@ public:
         error_context_ = std::move(v);
     }
 
+    statement_cache_type& statement_cache() & {return statement_cache_;}
+
+    std::shared_ptr<detail::oid_map_cache<oid_map_type>>& oid_map_cache() & {return oid_map_cache_;}
+
+    /**
+     * Get the connection socket bound to the execution context of the executor.
+     * The socket stays registered while the connection is idle in the pool.
+     */
+    template <typename Executor>
+    stream_type& stream(const Executor& ex) & {
+        return stream_.get(ex, PQsocket(safe_handle_.get()));
+    }
+
+    /**
+     * Deregister the connection socket, e.g. before the native handle is closed.
+     */
+    void release_stream() noexcept { stream_.release();}
+
+    /**
+     * Get the time the representation has been created, i.e. the connection has been established.
+     */
+    time_traits::time_point created_at() const noexcept { return created_at_;}
+
     connection_rep(
         ozo::pg::conn&& safe_handle,
         OidMap oid_map = OidMap{},
         error_context_type error_context = {},
-        Statistics statistics = Statistics{})
+        Statistics statistics = Statistics{},
+        statement_cache_type statement_cache = statement_cache_type{})
     : safe_handle_(std::move(safe_handle)),
       oid_map_(std::move(oid_map)),
       error_context_(std::move(error_context)),
-      statistics_(std::move(statistics)) {}
+      statistics_(std::move(statistics)),
+      statement_cache_(std::move(statement_cache)) {}
 private:
     ozo::pg::conn safe_handle_;
     oid_map_type oid_map_;
     error_context_type error_context_;
     statistics_type statistics_;
+    statement_cache_type statement_cache_;
+    std::shared_ptr<detail::oid_map_cache<oid_map_type>> oid_map_cache_;
+    detail::pooled_connection_stream<stream_type> stream_;
+    time_traits::time_point created_at_ = time_traits::now();
 };
 
 /**
@@ -102,17 +213,23 @@ private:
  * underlying handle that contains a connection will be returned to the handle-associated
  * connection pool. If the connection is in a bad state either its current transaction
  * status is different than `ozo::transaction_status::idle` then it will not return to
- * the pool and be closed. The class object is non-copyable.
+ * the pool and be closed. The connection socket is kept registered within the
+ * `io_context` reactor by the underlying representation, so getting a connection
+ * from the pool performs no descriptor registration system calls if the connection
+ * was used with the same `io_context` before. The class object is non-copyable.
  *
  * @tparam Rep      --- underlying connection pool representation for the real connection.
  * @tparam Executor --- the type of the executor is used to perform IO; currently only
  *                      `boost::asio::io_context::executor_type` is supported.
+ * @tparam ThreadSafety --- thread safety of the connection pool the connection is obtained from,
+ *                      see `ozo::connection_thread_safety`.
  *
  * @thread_safety{Safe,Unsafe}
  * @ingroup group-connection-types
  * @models{Connection}
  */
-template <typename Rep, typename Executor = asio::io_context::executor_type>
+template <typename Rep, typename Executor = asio::io_context::executor_type,
+          typename ThreadSafety = thread_safety<true>>
 class pooled_connection {
 public:
     using rep_type = Rep; //!< Connection representation type
@@ -120,9 +237,18 @@ public:
     using oid_map_type = typename connection_traits<rep_type>::oid_map_type; //!< Oid map of types that are used with the connection
     using error_context_type = typename connection_traits<rep_type>::error_context_type; //!< Additional error context which could provide context depended information for errors
     using statistics_type = typename connection_traits<rep_type>::statistics_type; //!< Connection statistics to be collected
+    using statement_cache_type = ozo::statement_cache; //!< Cache of server-side prepared statements
     using executor_type = Executor; //!< The type of the executor associated with the object.
+    using thread_safety_type = ThreadSafety; //!< Thread safety of the connection operations
+
+    using idle_stack_type = detail::connection_pool_idle_stack<Rep, ThreadSafety>; //!< LIFO idle connections of the pool
+    using pool_statistics_type = detail::connection_pool_statistics<statistics_type, ThreadSafety>; //!< Statistics of the connections of the pool
+    using drain_borrow_type = typename detail::connection_pool_drain<ThreadSafety>::borrow_type; //!< Borrow of the pool which is counted to drain it
 
-    pooled_connection(const Executor& ex, Rep&& rep);
+    pooled_connection(const Executor& ex, Rep&& rep, std::shared_ptr<connection_pool_metrics> metrics = nullptr,
+        connection_reset_options reset = {}, std::shared_ptr<void> lease = nullptr,
+        std::shared_ptr<idle_stack_type> idle = nullptr, std::shared_ptr<pool_statistics_type> statistics = nullptr,
+        drain_borrow_type borrow = {});
 
     /**
      * Get native connection handle object.
@@ -142,11 +268,31 @@ public:
     const oid_map_type& oid_map() const noexcept { return ozo::unwrap(rep_).oid_map();}
 
     template <typename Key, typename Value>
-    void update_statistics(const Key& key, Value&& v) noexcept {
-        ozo::unwrap(rep_).update_statistics(key, std::forward<Value(v)>);
+    void update_statistics(const Key& key, const Value& v) noexcept {
+        ozo::unwrap(rep_).update_statistics(key, v);
+        if (pool_statistics_) {
+            checkout_statistics_.update(key, v);
+        }
     }
     const statistics_type& statistics() const noexcept { return ozo::unwrap(rep_).statistics();}
 
+    /**
+     * Get a reference to the cache of server-side prepared statements. The cache
+     * belongs to the underlying representation, so it is kept with the pooled connection
+     * between usages. Its capacity is defined by `connection_pool_config::statement_cache_capacity`.
+     *
+     * @return statement_cache_type& --- reference on the statement cache object.
+     */
+    statement_cache_type& statement_cache() noexcept { return ozo::unwrap(rep_).statement_cache();}
+
+    /**
+     * Get a reference to the oid map cache of the connection source the connection is bound to.
+     */
+    template <typename R = Rep>
+    auto oid_map_cache() noexcept -> decltype(ozo::unwrap(std::declval<R&>()).oid_map_cache()) {
+        return ozo::unwrap(rep_).oid_map_cache();
+    }
+
     /**
      * Get the additional context object for an error that occurred during the last operation on the connection.
      *
@@ -249,11 +395,24 @@ public:
 
     ~pooled_connection();
 private:
-    using stream_type = typename detail::connection_stream<executor_type>::type;
+    using stream_type = typename connection_traits<rep_type>::stream_type;
 
+    void waste(connection_waste_reason reason);
+    bool reset() noexcept;
+
+    // The borrow of the pool is returned after the admission slot of the pool queue is released,
+    // and the slot is released after the handle is returned to the pool.
+    drain_borrow_type borrow_;
+    std::shared_ptr<void> lease_;
     rep_type rep_;
     executor_type ex_;
-    stream_type stream_;
+    stream_type* stream_;
+    std::shared_ptr<connection_pool_metrics> metrics_;
+    connection_reset_options reset_;
+    std::shared_ptr<idle_stack_type> idle_;
+    // Statistics collected while the connection is borrowed, they are added to the pool ones on return.
+    std::shared_ptr<pool_statistics_type> pool_statistics_;
+    statistics_type checkout_statistics_ {};
 };
 
 template <typename ...Ts>
@@ -279,11 +438,50 @@ struct connection_traits<yamail::resource_pool::handle<T>> :
  *
  * The request may be limited by time via optional `connection_pool_timeouts` argument of the `connection_pool::operator()`.
  *
+ * Waiting requests are served in the order of arrival by default. With `connection_pool_queue_policy::earliest_deadline_first`
+ * the request with the earliest deadline gets a free connection first, so requests with short deadlines do not expire
+ * behind requests with long ones. A request which has less time left than the median time the connections are used
+ * by requests is rejected immediately with `ozo::error::pool_deadline_too_close` since it would likely expire anyway.
+ * The wait queue is limited by `connection_pool_config::queue_capacity`, requests beyond it are rejected with
+ * `ozo::error::pool_queue_overflow`.
+ *
+ * The number of concurrently used connections may be adjusted by the pool between the minimum and the capacity
+ * via `connection_pool_config::adaptive_limit`. The limit follows the time requests use connections, so the pool
+ * backs off when the database is overloaded and grows while it keeps up with the load.
+ *
+ * Idle connections are handed out in the order of the underlying resource pool by default, so all of them are used
+ * evenly. With `connection_pool_idle_order::lifo` the most recently used idle connection is handed out first, so a hot
+ * set of connections keeps server-side caches warm and the rest are closed after `connection_pool_config::idle_timeout`
+ * when the load decreases. They are closed by a timer which is started by a request with its `io_context`, so
+ * the `io_context` keeps running until the idle connections are closed after the traffic is over.
+ *
+ * The pool may be divided into shards via `connection_pool_config::shards` to reduce lock contention if it is used
+ * by many threads. Each `io_context` gets connections from its own shard, if the shard has no idle connections the idle
+ * connection is taken from another shard, and its socket is registered within the reactor of the `io_context` which takes it.
+ * The capacity is divided between shards. Requests which find a slot in some shard take no pool-wide lock. Requests which
+ * find all the shards busy wait in the single queue of the pool, so `connection_pool_config::queue_capacity` limits
+ * the whole pool and a request gets the first connection returned into any shard.
+ *
+ * Connections may be established ahead of traffic via `connection_pool::warm_up()`. If `connection_pool_config::min_idle`
+ * is set, the pool checks the number of idle connections each `connection_pool_config::min_idle_interval` and establishes
+ * missing ones in background within `connection_pool_config::min_idle_connect_timeout`. Requests do not wait for these
+ * connections. The connections are established in free slots of the pool and returned to it, so they are handed out
+ * the same way as the ones established by requests. The checks are started by a request with its `io_context` and stop
+ * after an interval without requests, so the pool does not keep the `io_context` running when the traffic is over.
+ *
+ * The pool may be drained via `connection_pool::drain()`, e.g. before a graceful shutdown. The pool stops handing
+ * out connections, waits for the borrowed ones to be returned and closes all the idle connections.
+ *
  * `connection_pool` models `ConnectionSource` concept itself using underlying `ConnectionSource`.
  *
+ * Sockets of idle connections stay registered within the `io_context` objects they were used with
+ * last time. If such an `io_context` is destroyed before the pool, the sockets are destroyed with it,
+ * and the connections get new sockets when they are used next time.
+ *
  * @tparam Source --- underlying `ConnectionSource` which is being used to create connection to a database.
  * @tparam ThreadSafety --- admissibility to use in multithreaded environment without additional synchronization.
- * Thread safe by default.
+ * Thread safe by default. For `ozo::thread_safety<false>` the connections of the pool are not thread safe too,
+ * so operations on them are performed without a strand (see `ozo::connection_thread_safety`).
  *
  * ###Example
  *
@@ -303,9 +501,12 @@ class connection_pool {
     static_assert(ConnectionSource<Source>, "should model ConnectionSource concept");
 
 public:
-    using connection_rep_type = ozo::connection_rep<typename ozo::unwrap_type<ozo::connection_type<Source>>::oid_map_type>;
+    using connection_rep_type = ozo::connection_rep<
+        typename ozo::unwrap_type<ozo::connection_type<Source>>::oid_map_type,
+        detail::connection_statistics_t<ozo::unwrap_type<ozo::connection_type<Source>>>>;
 
-    using impl_type = detail::get_connection_pool_impl_t<connection_rep_type, ThreadSafety>;
+    using impl_type = detail::connection_pool_shards<detail::get_connection_pool_impl_t<connection_rep_type, ThreadSafety>,
+        ThreadSafety>;
     /**
      * Construct a new connection pool object
      *
@@ -315,13 +516,25 @@ public:
      * Thread safe by default (`ozo::thread_safety<true>`).
      */
     connection_pool(Source source, const connection_pool_config& config, const ThreadSafety& /*thread_safety*/ = ThreadSafety{})
-    : impl_(config.capacity, config.queue_capacity, config.idle_timeout, config.lifespan),
-      source_(std::move(source)) {}
+    : state_(std::make_shared<state>(std::move(source), config)) {}
+
+    connection_pool(connection_pool&&) = default;
+
+    /**
+     * Requests which are waiting in the deadline ordered queue and pending
+     * `drain()` operations are completed with `boost::asio::error::operation_aborted`.
+     */
+    ~connection_pool() {
+        if (state_) {
+            state_->close();
+        }
+    }
 
     /**
      * Type of connection depends on connection type of Source. The definition is used to model `ConnectionSource`
      */
-    using connection_type = std::shared_ptr<pooled_connection<yamail::resource_pool::handle<connection_rep_type>>>;
+    using connection_type = std::shared_ptr<pooled_connection<yamail::resource_pool::handle<connection_rep_type>,
+        asio::io_context::executor_type, ThreadSafety>>;
 
     /**
      * Get connection is bound to the given `io_context` object.
@@ -336,30 +549,297 @@ public:
     template <typename TimeConstraint, typename Handler>
     void operator ()(io_context& io, TimeConstraint t, Handler&& handler);
 
+    /**
+     * Establish connections ahead of traffic.
+     *
+     * Opens connections up to `connection_pool_config::warm_up` or `connection_pool_config::min_idle`,
+     * whichever is greater, but no more than the pool capacity. Connections which are already in
+     * the pool are counted. The connections are established concurrently and returned to the pool
+     * as idle ones, so requests may be served while the operation is in progress. The operation
+     * completes with the first error occurred, if any, after all the connection attempts are finished.
+     *
+     * @param io --- `io_context` for the connections IO.
+     * @param t --- #TimeConstraint for each connection establishing.
+     * @param token --- operation #CompletionToken with `void(ozo::error_code)` signature.
+     * @return deduced from #CompletionToken.
+     */
+    template <typename TimeConstraint, typename CompletionToken>
+    decltype(auto) warm_up(io_context& io, TimeConstraint t, CompletionToken&& token);
+
+    /**
+     * Establish connections ahead of traffic without time constraint.
+     *
+     * @param io --- `io_context` for the connections IO.
+     * @param token --- operation #CompletionToken with `void(ozo::error_code)` signature.
+     * @return deduced from #CompletionToken.
+     */
+    template <typename CompletionToken>
+    decltype(auto) warm_up(io_context& io, CompletionToken&& token) {
+        return warm_up(io, none, std::forward<CompletionToken>(token));
+    }
+
+    /**
+     * Drain the pool, e.g. before a graceful shutdown.
+     *
+     * The pool stops handing out connections: requests which wait for a connection in any
+     * queue of the pool and all the new requests are completed with `ozo::error::pool_draining`,
+     * a connection returned to the pool for a waiting request is closed instead.
+     * The operation waits for connections which are in use or being established to be returned
+     * to the pool, and then closes all the idle connections at once. If the time constraint
+     * expires first, the operation closes the idle connections and completes
+     * with `boost::asio::error::timed_out`, the rest of the connections are closed when they are
+     * returned. The pool can not be used after the operation is started. If the pool is destroyed
+     * before the operation completes, it completes with `boost::asio::error::operation_aborted`.
+     *
+     * @param io --- `io_context` for the deadline timer.
+     * @param t --- #TimeConstraint for the operation.
+     * @param token --- operation #CompletionToken with `void(ozo::error_code)` signature.
+     * @return deduced from #CompletionToken.
+     */
+    template <typename TimeConstraint, typename CompletionToken>
+    decltype(auto) drain(io_context& io, TimeConstraint t, CompletionToken&& token);
+
+    /**
+     * Drain the pool without time constraint.
+     *
+     * @param io --- `io_context` for the operation.
+     * @param token --- operation #CompletionToken with `void(ozo::error_code)` signature.
+     * @return deduced from #CompletionToken.
+     */
+    template <typename CompletionToken>
+    decltype(auto) drain(io_context& io, CompletionToken&& token) {
+        return drain(io, none, std::forward<CompletionToken>(token));
+    }
+
+    /**
+     * Determine whether the pool is drained by `drain()`.
+     *
+     * @return true --- the pool does not hand out connections anymore.
+     */
+    bool draining() const {
+        return state_->drain_->draining();
+    }
+
     auto stats() const {
-        return impl_.stats();
+        auto result = state_->impl_.stats();
+        // Idle connections kept out of the resource pool are used from its point of view.
+        const auto idle = state_->idle_size();
+        result.available += idle;
+        result.used -= std::min(result.used, idle);
+        if (state_->queue_) {
+            result.queue_size += state_->queue_->size();
+        }
+        return result;
     }
 
-    auto operator [](io_context& io) {
-        return connection_provider(*this, io);
+    /**
+     * Get the current limit of concurrently used connections. It is the pool capacity
+     * unless `connection_pool_config::adaptive_limit` is enabled.
+     *
+     * @return std::size_t --- the limit.
+     */
+    std::size_t concurrency_limit() const {
+        return state_->queue_ ? state_->queue_->limit() : state_->impl_.capacity();
     }
 
-private:
+    /**
+     * Get the instrumentation of the pool passed via `connection_pool_config::metrics`.
+     *
+     * @return const std::shared_ptr<connection_pool_metrics>& --- metrics object or `nullptr` if it is disabled.
+     */
+    const std::shared_ptr<connection_pool_metrics>& metrics() const noexcept {
+        return state_->metrics_;
+    }
+
+    /**
+     * Get statistics of all the connections of the pool, if the connection source collects statistics,
+     * e.g. `ozo::basic_statistics`. Statistics of a borrowed connection are added when it is returned
+     * to the pool, connection establishing is counted when the connection is established. The statistics
+     * type should support `operator +=`.
+     *
+     * @return statistics of the connections or `ozo::none` if the statistics are not collected.
+     */
+    auto statistics() const {
+        return state_->statistics_->get();
+    }
 
-    auto queue_timeout(time_traits::time_point at) const {
-        return time_left(at);
+    /**
+     * Drop the oid map shared by new connections of the underlying source,
+     * see `ozo::connection_info::invalidate_oid_map()`. Connections which are
+     * already in the pool keep their oid maps.
+     */
+    void invalidate_oid_map() {
+        state_->source_.invalidate_oid_map();
     }
 
-    auto queue_timeout(time_traits::duration t) const {
-        return t;
+    /**
+     * Determine whether new connections of the underlying source are rejected by a circuit breaker,
+     * see `ozo::is_circuit_open()`.
+     */
+    bool is_circuit_open() const {
+        return ozo::is_circuit_open(state_->source_);
     }
 
-    auto queue_timeout(none_t) const {
-        return time_traits::duration(0);
+    auto operator [](io_context& io) {
+        return connection_provider(*this, io);
     }
 
-    impl_type impl_;
-    Source source_;
+private:
+    using queue_type = detail::connection_pool_queue<ThreadSafety>;
+    using idle_stack_type = typename connection_type::element_type::idle_stack_type;
+    using drain_type = detail::connection_pool_drain<ThreadSafety>;
+    using pool_statistics_type = typename connection_type::element_type::pool_statistics_type;
+
+    /**
+     * State of the pool which is shared with its pending operations, e.g. requests waiting
+     * in the queue and timers, so the operations do not refer to the pool object itself
+     * and the object may be moved.
+     */
+    struct state : std::enable_shared_from_this<state> {
+        impl_type impl_;
+        Source source_;
+        std::size_t statement_cache_capacity_;
+        std::size_t min_idle_;
+        std::size_t warm_up_;
+        time_traits::duration min_idle_interval_;
+        time_traits::duration min_idle_connect_timeout_;
+        std::shared_ptr<std::atomic<std::size_t>> pending_connects_;
+        std::atomic<bool> maintenance_ {false};
+        std::atomic<bool> active_ {false};
+        detail::get_connection_pool_mutex_t<ThreadSafety> maintenance_mutex_;
+        std::weak_ptr<asio::steady_timer> maintenance_timer_;
+        std::shared_ptr<connection_pool_metrics> metrics_;
+        connection_reset_options reset_;
+        std::shared_ptr<queue_type> queue_;
+        std::shared_ptr<idle_stack_type> idle_;
+        std::shared_ptr<drain_type> drain_;
+        std::shared_ptr<pool_statistics_type> statistics_;
+
+        state(Source source, const connection_pool_config& config)
+        : impl_(config.capacity, config.queue_capacity, config.idle_timeout, config.lifespan, config.shards),
+          source_(std::move(source)),
+          statement_cache_capacity_(config.statement_cache_capacity),
+          min_idle_(config.min_idle),
+          warm_up_(config.warm_up),
+          min_idle_interval_(config.min_idle_interval),
+          min_idle_connect_timeout_(config.min_idle_connect_timeout),
+          pending_connects_(std::make_shared<std::atomic<std::size_t>>(0)),
+          metrics_(config.metrics),
+          reset_(config.reset),
+          queue_(make_queue(config)),
+          idle_(make_idle_stack(config)),
+          drain_(std::make_shared<drain_type>()),
+          statistics_(std::make_shared<pool_statistics_type>()) {}
+
+        void close() {
+            std::shared_ptr<asio::steady_timer> timer;
+            {
+                std::lock_guard lock(maintenance_mutex_);
+                timer = maintenance_timer_.lock();
+            }
+            if (timer) {
+                asio::post(timer->get_executor(), [timer] { timer->cancel(); });
+            }
+            if (queue_) {
+                queue_->abort();
+            }
+            drain_->abort();
+            if (idle_) {
+                idle_->close();
+            }
+        }
+
+        static auto queue_timeout(time_traits::time_point at) {
+            return time_left(at);
+        }
+
+        static auto queue_timeout(time_traits::duration t) {
+            return t;
+        }
+
+        static auto queue_timeout(none_t) {
+            return time_traits::duration(0);
+        }
+
+        static bool keeps_idle(const connection_pool_config& config) {
+            // The resource pool hands out idle connections in its own order, so the LIFO ones are kept out of it.
+            return config.idle_order == connection_pool_idle_order::lifo;
+        }
+
+        static std::shared_ptr<queue_type> make_queue(const connection_pool_config& config) {
+            // Idle connections kept out of the resource pool are used from its point of view, so requests
+            // are admitted by the pool queue to do not wait in the resource pool queue for them.
+            const auto& adaptive = config.adaptive_limit;
+            if (config.queue_policy == connection_pool_queue_policy::fifo && adaptive.min == 0 && !keeps_idle(config)) {
+                return nullptr;
+            }
+            std::optional<detail::adaptive_concurrency_limit> limit;
+            if (adaptive.min != 0) {
+                limit.emplace(adaptive.min, config.capacity, adaptive.tolerance, adaptive.backoff);
+            }
+            return std::make_shared<queue_type>(config.capacity, config.queue_capacity,
+                config.queue_policy == connection_pool_queue_policy::earliest_deadline_first, limit);
+        }
+
+        static std::shared_ptr<idle_stack_type> make_idle_stack(const connection_pool_config& config) {
+            if (!keeps_idle(config)) {
+                return nullptr;
+            }
+            return std::make_shared<idle_stack_type>(config.capacity, config.idle_timeout, config.lifespan,
+                config.idle_order == connection_pool_idle_order::lifo);
+        }
+
+        std::size_t idle_size() const {
+            return idle_ ? idle_->size() : 0;
+        }
+
+        template <typename TimeConstraint, typename Handler>
+        auto wrap_handler(io_context& io, TimeConstraint t, Handler&& handler) const;
+
+        template <typename Handler>
+        bool borrow(io_context& io, Handler& handler);
+
+        void close_idle() {
+            if (idle_) {
+                idle_->close();
+            }
+            impl_.invalidate();
+        }
+
+        template <typename Handler>
+        void expire_drain(io_context& io, time_traits::time_point at, Handler handler);
+
+        template <typename Handler>
+        void expire_drain(io_context&, none_t, const Handler&) {}
+
+        template <typename Handler>
+        void get_handle(io_context& io, Handler&& handler, time_traits::duration wait_duration);
+
+        static auto queue_deadline(time_traits::time_point at) {
+            return at;
+        }
+
+        static auto queue_deadline(none_t) {
+            return time_traits::time_point::max();
+        }
+
+        template <typename Deadline, typename Handler>
+        void get_queued(io_context& io, Deadline at, Handler&& handler);
+
+        template <typename TimeConstraint, typename Handler>
+        void connect_idle(io_context& io, TimeConstraint t, std::size_t count, Handler&& handler);
+
+        template <typename TimeConstraint>
+        void maintain_min_idle(io_context& io, TimeConstraint t);
+
+        void start_maintenance(io_context& io);
+
+        time_traits::time_point next_maintenance(time_traits::time_point now);
+
+        void schedule_maintenance(io_context& io, std::shared_ptr<asio::steady_timer> timer, time_traits::time_point at);
+    };
+
+    std::shared_ptr<state> state_;
 };
 
 //[[DEPRECATED]] for backward compatibility only
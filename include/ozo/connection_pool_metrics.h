@@ -0,0 +1,260 @@
+#pragma once
+
+#include <ozo/error.h>
+#include <ozo/time_traits.h>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+namespace ozo {
+
+/**
+ * @brief Snapshot of a latency histogram
+ *
+ * Bucket `i` counts durations which are less than `2^i` microseconds and are not counted
+ * by the previous buckets, the last bucket counts all the greater durations.
+ *
+ * @ingroup group-connection-types
+ */
+struct latency_histogram_snapshot {
+    static constexpr std::size_t buckets_count = 32; //!< number of buckets
+
+    std::array<std::uint64_t, buckets_count> buckets {}; //!< number of durations in each bucket
+    std::uint64_t count = 0; //!< total number of durations
+    time_traits::duration sum {}; //!< sum of all the durations
+
+    /**
+     * Get the exclusive upper bound of the bucket.
+     *
+     * @param index --- bucket index.
+     * @return time_traits::duration --- upper bound, `time_traits::duration::max()` for the last bucket.
+     */
+    static constexpr time_traits::duration upper_bound(std::size_t index) noexcept {
+        if (index + 1 >= buckets_count) {
+            return time_traits::duration::max();
+        }
+        return std::chrono::duration_cast<time_traits::duration>(
+            std::chrono::microseconds(std::int64_t(1) << index));
+    }
+};
+
+/**
+ * @brief Lock-free latency histogram
+ *
+ * Histogram with exponential buckets, see `ozo::latency_histogram_snapshot`.
+ *
+ * @thread_safety{Safe,Safe}
+ * @ingroup group-connection-types
+ */
+class latency_histogram {
+public:
+    /**
+     * Record the duration.
+     *
+     * @param value --- duration to record.
+     */
+    void record(time_traits::duration value) noexcept {
+        buckets_[bucket(value)].fetch_add(1, std::memory_order_relaxed);
+        count_.fetch_add(1, std::memory_order_relaxed);
+        sum_.fetch_add(value.count(), std::memory_order_relaxed);
+    }
+
+    /**
+     * Get the histogram snapshot. The snapshot is not atomic
+     * in respect to concurrent `record()` calls.
+     *
+     * @return latency_histogram_snapshot --- current values.
+     */
+    latency_histogram_snapshot snapshot() const noexcept {
+        latency_histogram_snapshot result;
+        for (std::size_t i = 0; i != buckets_.size(); ++i) {
+            result.buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+        }
+        result.count = count_.load(std::memory_order_relaxed);
+        result.sum = time_traits::duration(sum_.load(std::memory_order_relaxed));
+        return result;
+    }
+
+private:
+    static std::size_t bucket(time_traits::duration value) noexcept {
+        const auto us = std::chrono::duration_cast<std::chrono::microseconds>(value).count();
+        std::size_t result = 0;
+        while (result + 1 < latency_histogram_snapshot::buckets_count && us >= (std::int64_t(1) << result)) {
+            ++result;
+        }
+        return result;
+    }
+
+    std::array<std::atomic<std::uint64_t>, latency_histogram_snapshot::buckets_count> buckets_ {};
+    std::atomic<std::uint64_t> count_ {0};
+    std::atomic<time_traits::duration::rep> sum_ {0};
+};
+
+/**
+ * @brief Reason why a pooled connection is not returned to the pool
+ * @ingroup group-connection-types
+ */
+enum class connection_waste_reason {
+    bad_connection, //!< the connection is closed or in bad state
+    not_idle, //!< the connection has transaction status different from `ozo::transaction_status::idle`
+};
+
+/**
+ * @brief Reason why a request is refused by the pool
+ * @ingroup group-connection-types
+ */
+enum class connection_acquire_failure {
+    other, //!< any other error, e.g. the request is aborted with the pool
+    queue_overflow, //!< the wait queue of the pool is full
+    wait_timeout, //!< the time constraint of the request is expired while it waits for a connection
+    deadline_too_close, //!< the request is not expected to complete in time, see `connection_pool_queue_policy::earliest_deadline_first`
+    draining, //!< the pool is drained by `connection_pool::drain()`
+};
+
+/**
+ * @brief Optional callbacks of the connection pool instrumentation
+ *
+ * Callbacks are called synchronously within the pool operations, so they should be cheap,
+ * should not throw, and should be thread safe if the pool is used from several threads.
+ *
+ * @ingroup group-connection-types
+ */
+struct connection_pool_callbacks {
+    std::function<void(error_code, time_traits::duration)> on_acquire; //!< a connection is obtained from the pool with the wait time
+    std::function<void(error_code, time_traits::duration)> on_connect; //!< a connection establishing is finished with the connect time
+    std::function<void(connection_waste_reason)> on_waste; //!< a pooled connection is wasted
+};
+
+/**
+ * @brief Snapshot of the connection pool instrumentation
+ * @ingroup group-connection-types
+ */
+struct connection_pool_metrics_snapshot {
+    std::uint64_t acquired = 0; //!< number of requests served by the pool with an idle connection or a free slot for a new one
+    std::uint64_t acquire_failed = 0; //!< number of requests refused by the pool for any reason
+    std::uint64_t queue_overflow = 0; //!< number of requests refused because the wait queue is full
+    std::uint64_t wait_timeout = 0; //!< number of requests refused because the time constraint is expired while waiting
+    std::uint64_t deadline_too_close = 0; //!< number of requests refused because they are not expected to complete in time
+    std::uint64_t drain_rejected = 0; //!< number of requests refused because the pool is drained
+    std::uint64_t connects = 0; //!< number of established connections
+    std::uint64_t connect_failed = 0; //!< number of failed connection attempts
+    std::uint64_t reconnects = 0; //!< number of idle connections which are found in bad state and reconnected
+    std::uint64_t wasted_bad = 0; //!< number of connections wasted because of bad state
+    std::uint64_t wasted_not_idle = 0; //!< number of connections wasted because of not idle transaction status
+    latency_histogram_snapshot acquire_wait; //!< time spent waiting for a connection in the pool, including the wait queue
+    latency_histogram_snapshot connect_time; //!< time spent establishing connections
+};
+
+/**
+ * @brief Instrumentation of the connection pool
+ *
+ * Lock-free counters and latency histograms of a connection pool. Pass the object to the pool
+ * via `connection_pool_config::metrics` and export `snapshot()` to a metrics system. If no object
+ * is passed, the pool does not collect anything. The number of busy and idle connections and the wait
+ * queue size are provided by `connection_pool::stats()`.
+ *
+ * @thread_safety{Safe,Safe}
+ * @ingroup group-connection-types
+ */
+class connection_pool_metrics {
+public:
+    /**
+     * Construct a new metrics object
+     *
+     * @param callbacks --- optional callbacks to be called on the pool events.
+     */
+    explicit connection_pool_metrics(connection_pool_callbacks callbacks = {})
+    : callbacks_(std::move(callbacks)) {}
+
+    connection_pool_metrics(const connection_pool_metrics&) = delete;
+    connection_pool_metrics& operator =(const connection_pool_metrics&) = delete;
+
+    /**
+     * Get the current values of the counters and histograms.
+     *
+     * @return connection_pool_metrics_snapshot --- current values.
+     */
+    connection_pool_metrics_snapshot snapshot() const noexcept {
+        connection_pool_metrics_snapshot result;
+        result.acquired = acquired_.load(std::memory_order_relaxed);
+        result.acquire_failed = acquire_failed_.load(std::memory_order_relaxed);
+        result.queue_overflow = queue_overflow_.load(std::memory_order_relaxed);
+        result.wait_timeout = wait_timeout_.load(std::memory_order_relaxed);
+        result.deadline_too_close = deadline_too_close_.load(std::memory_order_relaxed);
+        result.drain_rejected = drain_rejected_.load(std::memory_order_relaxed);
+        result.connects = connects_.load(std::memory_order_relaxed);
+        result.connect_failed = connect_failed_.load(std::memory_order_relaxed);
+        result.reconnects = reconnects_.load(std::memory_order_relaxed);
+        result.wasted_bad = wasted_bad_.load(std::memory_order_relaxed);
+        result.wasted_not_idle = wasted_not_idle_.load(std::memory_order_relaxed);
+        result.acquire_wait = acquire_wait_.snapshot();
+        result.connect_time = connect_time_.snapshot();
+        return result;
+    }
+
+    void on_acquire(const error_code& ec, time_traits::duration wait,
+            connection_acquire_failure failure = connection_acquire_failure::other) {
+        (ec ? acquire_failed_ : acquired_).fetch_add(1, std::memory_order_relaxed);
+        if (ec) {
+            if (auto counter = failure_counter(failure)) {
+                counter->fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        acquire_wait_.record(wait);
+        if (callbacks_.on_acquire) {
+            callbacks_.on_acquire(ec, wait);
+        }
+    }
+
+    void on_connect(const error_code& ec, time_traits::duration time) {
+        (ec ? connect_failed_ : connects_).fetch_add(1, std::memory_order_relaxed);
+        connect_time_.record(time);
+        if (callbacks_.on_connect) {
+            callbacks_.on_connect(ec, time);
+        }
+    }
+
+    void on_reconnect() noexcept {
+        reconnects_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void on_waste(connection_waste_reason reason) {
+        (reason == connection_waste_reason::bad_connection ? wasted_bad_ : wasted_not_idle_)
+            .fetch_add(1, std::memory_order_relaxed);
+        if (callbacks_.on_waste) {
+            callbacks_.on_waste(reason);
+        }
+    }
+
+private:
+    std::atomic<std::uint64_t>* failure_counter(connection_acquire_failure failure) noexcept {
+        switch (failure) {
+            case connection_acquire_failure::queue_overflow: return std::addressof(queue_overflow_);
+            case connection_acquire_failure::wait_timeout: return std::addressof(wait_timeout_);
+            case connection_acquire_failure::deadline_too_close: return std::addressof(deadline_too_close_);
+            case connection_acquire_failure::draining: return std::addressof(drain_rejected_);
+            case connection_acquire_failure::other: break;
+        }
+        return nullptr;
+    }
+
+    connection_pool_callbacks callbacks_;
+    std::atomic<std::uint64_t> acquired_ {0};
+    std::atomic<std::uint64_t> acquire_failed_ {0};
+    std::atomic<std::uint64_t> queue_overflow_ {0};
+    std::atomic<std::uint64_t> wait_timeout_ {0};
+    std::atomic<std::uint64_t> deadline_too_close_ {0};
+    std::atomic<std::uint64_t> drain_rejected_ {0};
+    std::atomic<std::uint64_t> connects_ {0};
+    std::atomic<std::uint64_t> connect_failed_ {0};
+    std::atomic<std::uint64_t> reconnects_ {0};
+    std::atomic<std::uint64_t> wasted_bad_ {0};
+    std::atomic<std::uint64_t> wasted_not_idle_ {0};
+    latency_histogram acquire_wait_;
+    latency_histogram connect_time_;
+};
+
+} // namespace ozo
@@ -105,6 +105,19 @@ public:
         std::move(source_)(io_, std::move(t), std::forward<Handler>(h));
     }
 
+    /**
+     * Determine whether connection attempts of the source are rejected by a circuit breaker,
+     * see `ozo::is_circuit_open()`.
+     */
+    bool is_circuit_open() const {
+        return ozo::is_circuit_open(source_);
+    }
+
+    /**
+     * Get the `io_context` the provider is bound to.
+     */
+    io_context& get_io_context() const noexcept { return io_;}
+
 private:
     ConnectionSource source_;
     io_context& io_;
@@ -0,0 +1,300 @@
+#pragma once
+
+#include <ozo/impl/async_copy.h>
+
+namespace ozo {
+
+/**
+ * @brief Rows handler for `ozo::copy_out()` which passes decoded rows to a callback
+ *
+ * Use `ozo::for_each_row()` to create the handler.
+ *
+ * @tparam Row --- `std::tuple`, `boost::fusion` or `boost::hana` adapted structure.
+ * @tparam Callback --- callback type with `void(Row&& row)` signature.
+ * @ingroup group-requests-types
+ */
+template <typename Row, typename Callback>
+struct for_each_row_handler {
+    Callback callback; //!< callback to pass rows to
+
+    template <typename OidMap>
+    bool operator() (istream& in, const OidMap& oid_map) {
+        Row row{};
+        if (!recv_copy_row(in, oid_map, row)) {
+            return false;
+        }
+        callback(std::move(row));
+        return true;
+    }
+};
+
+/**
+ * @brief Creates a rows handler for `ozo::copy_out()` which passes each row to the callback
+ *
+ * @tparam Row --- `std::tuple`, `boost::fusion` or `boost::hana` adapted structure.
+ * @param callback --- callback with `void(Row&& row)` signature.
+ * @return `ozo::for_each_row_handler` object.
+ * @ingroup group-requests-functions
+ */
+template <typename Row, typename Callback>
+inline auto for_each_row(Callback&& callback) {
+    return for_each_row_handler<Row, std::decay_t<Callback>>{std::forward<Callback>(callback)};
+}
+
+#ifdef OZO_DOCUMENTATION
+/**
+ * @brief Copies rows into a table with time constraint
+ *
+ * The function performs `COPY table (columns...) FROM STDIN (FORMAT binary)` and passes
+ * the rows encoded in PostgreSQL binary COPY format. It is much cheaper for a database
+ * than multi-row `INSERT` statements and has no parameters number limit. Rows are encoded
+ * by chunks, and the next chunk is encoded only after the previous one has been written
+ * to the socket, so the memory consumption does not depend on the number of rows and
+ * the operation is throttled by the database consumption rate. The function can be called
+ * as any of Boost.Asio asynchronous function with #CompletionToken. The request would be
+ * cancelled if time constrain is reached while performing.
+ *
+ * Each row should be a `std::tuple`, `boost::fusion` or `boost::hana` adapted structure with
+ * members which can be sent as query parameters. The number and types of the members should
+ * correspond to the columns. If a row can not be encoded the COPY is aborted and the request
+ * completes with the database error, `get_error_context()` contains the reason.
+ *
+ * @note The function does not participate in ADL since could be implemented via functional object.
+ * @note The table and columns names are placed into the statement as is, so they should
+ * be properly quoted if needed and never be obtained from an untrusted source.
+ *
+ * @param provider --- connection provider object to get connection from.
+ * @param table --- name of the table to copy rows into, optionally schema-qualified.
+ * @param columns --- #Iterable of the columns names, empty for all the table columns.
+ * @param rows --- #Iterable of rows; it is moved (or copied) into the operation, use a range view to avoid this.
+ * @param time_constraint --- request #TimeConstraint; this time constrain <b>includes</b> time for getting connection from provider.
+ * @param token --- operation #CompletionToken.
+ * @return deduced from #CompletionToken.
+ *
+ * ###Example
+ *
+ * @code
+#include <ozo/copy.h>
+#include <ozo/connection_info.h>
+#include <ozo/shortcuts.h>
+#include <boost/asio.hpp>
+
+int main() {
+    boost::asio::io_context io;
+    auto conn_info = ozo::connection_info("host=... port=...");
+
+    using namespace std::chrono_literals;
+
+    ozo::rows_of<std::int64_t, std::string> rows;
+    for (std::int64_t i = 0; i < 1000000; ++i) {
+        rows.emplace_back(i, "user #" + std::to_string(i));
+    }
+
+    const std::vector<std::string> columns{"id", "name"};
+
+    ozo::copy_in(conn_info[io], "users_info", columns, std::move(rows), 60s,
+            [&](ozo::error_code ec, auto conn) {
+        if (ec) {
+            std::cerr << ec.message() << " | " << error_message(conn);
+            if (!is_null_recursive(conn)) {
+                std::cerr << " | " << get_error_context(conn);
+            }
+        }
+    });
+    io.run();
+}
+ * @endcode
+ * @ingroup group-requests-functions
+ */
+template <typename ConnectionProvider, typename Columns, typename Rows, typename TimeConstraint, typename CompletionToken>
+decltype(auto) copy_in (ConnectionProvider&& provider, std::string_view table, const Columns& columns, Rows&& rows, TimeConstraint time_constraint, CompletionToken&& token);
+
+/**
+ * @brief Copies rows into a table
+ *
+ * This function is time constrain free shortcut to `ozo::copy_in()` function.
+ * Its call is equal to `ozo::copy_in(provider, table, columns, rows, ozo::none, token)` call.
+ *
+ * @note The function does not participate in ADL since could be implemented via functional object.
+ *
+ * @param provider --- connection provider object to get connection from.
+ * @param table --- name of the table to copy rows into.
+ * @param columns --- #Iterable of the columns names.
+ * @param rows --- #Iterable of rows.
+ * @param token --- operation #CompletionToken.
+ * @return deduced from #CompletionToken.
+ * @ingroup group-requests-functions
+ */
+template <typename ConnectionProvider, typename Columns, typename Rows, typename CompletionToken>
+decltype(auto) copy_in (ConnectionProvider&& provider, std::string_view table, const Columns& columns, Rows&& rows, CompletionToken&& token);
+
+/**
+ * @brief Copies rows out of a table or a query result with time constraint
+ *
+ * The function performs `COPY table (columns...) TO STDOUT (FORMAT binary)` and decodes
+ * the rows in PostgreSQL binary COPY format as soon as they arrive, so neither the whole
+ * result nor the whole data is materialized in memory. It is much cheaper for a database
+ * than `SELECT` of the same rows. The function can be called as any of Boost.Asio
+ * asynchronous function with #CompletionToken. The request would be cancelled if time
+ * constrain is reached while performing.
+ *
+ * Rows are received via `ozo::recv()` for each of the members, so the row should be a `std::tuple`,
+ * `boost::fusion` or `boost::hana` adapted structure with members corresponding to the columns.
+ * Since binary COPY data does not contain types oids, only the number of columns is verified.
+ * The output may be an #InsertIterator, e.g. `ozo::into(rows)`, or a rows handler created via
+ * `ozo::for_each_row()`. If a row can not be decoded, the rest of the data is consumed without
+ * decoding and the request completes with `ozo::error::bad_copy_data` or
+ * `ozo::error::bad_result_process` error, `get_error_context()` contains the reason.
+ *
+ * @note The function does not participate in ADL since could be implemented via functional object.
+ * @note The table and columns names are placed into the statement as is, so they should
+ * be properly quoted if needed and never be obtained from an untrusted source.
+ *
+ * @param provider --- connection provider object to get connection from.
+ * @param table --- name of the table to copy rows from, optionally schema-qualified, or a query in parentheses.
+ * @param columns --- #Iterable of the columns names, empty for all the table columns; should be empty for a query.
+ * @param out --- #InsertIterator or a rows handler to receive rows.
+ * @param time_constraint --- request #TimeConstraint; this time constrain <b>includes</b> time for getting connection from provider.
+ * @param token --- operation #CompletionToken.
+ * @return deduced from #CompletionToken.
+ *
+ * ###Example
+ *
+ * @code
+#include <ozo/copy.h>
+#include <ozo/connection_info.h>
+#include <ozo/shortcuts.h>
+#include <boost/asio.hpp>
+
+int main() {
+    boost::asio::io_context io;
+    auto conn_info = ozo::connection_info("host=... port=...");
+
+    using namespace std::chrono_literals;
+    using row = std::tuple<std::int64_t, std::string>;
+
+    const std::vector<std::string> columns{"id", "name"};
+
+    auto on_row = ozo::for_each_row<row>([](row&& v) {
+        std::cout << std::get<0>(v) << '\t' << std::get<1>(v) << std::endl;
+    });
+
+    ozo::copy_out(conn_info[io], "users_info", columns, std::move(on_row), 60s,
+            [&](ozo::error_code ec, auto conn) {
+        if (ec) {
+            std::cerr << ec.message() << " | " << error_message(conn);
+            if (!is_null_recursive(conn)) {
+                std::cerr << " | " << get_error_context(conn);
+            }
+        }
+    });
+    io.run();
+}
+ * @endcode
+ * @ingroup group-requests-functions
+ */
+template <typename ConnectionProvider, typename Columns, typename Out, typename TimeConstraint, typename CompletionToken>
+decltype(auto) copy_out (ConnectionProvider&& provider, std::string_view table, const Columns& columns, Out&& out, TimeConstraint time_constraint, CompletionToken&& token);
+
+/**
+ * @brief Copies rows out of a table or a query result
+ *
+ * This function is time constrain free shortcut to `ozo::copy_out()` function.
+ * Its call is equal to `ozo::copy_out(provider, table, columns, out, ozo::none, token)` call.
+ *
+ * @note The function does not participate in ADL since could be implemented via functional object.
+ *
+ * @param provider --- connection provider object to get connection from.
+ * @param table --- name of the table or a query in parentheses to copy rows from.
+ * @param columns --- #Iterable of the columns names.
+ * @param out --- #InsertIterator or a rows handler to receive rows.
+ * @param token --- operation #CompletionToken.
+ * @return deduced from #CompletionToken.
+ * @ingroup group-requests-functions
+ */
+template <typename ConnectionProvider, typename Columns, typename Out, typename CompletionToken>
+decltype(auto) copy_out (ConnectionProvider&& provider, std::string_view table, const Columns& columns, Out&& out, CompletionToken&& token);
+
+#else
+
+template <typename Initiator>
+struct copy_in_op : base_async_operation <copy_in_op<Initiator>, Initiator> {
+    using base = typename copy_in_op::base;
+    using base::base;
+
+    template <typename P, typename Columns, typename Rows, typename TimeConstraint, typename CompletionToken>
+    decltype(auto) operator() (P&& provider, std::string_view table, const Columns& columns, Rows&& rows,
+            TimeConstraint t, CompletionToken&& token) const {
+        static_assert(ConnectionProvider<P>, "provider should be a ConnectionProvider");
+        static_assert(ozo::TimeConstraint<TimeConstraint>, "should model TimeConstraint concept");
+        return async_initiate<CompletionToken, handler_signature<P>>(
+            get_operation_initiator(*this), token, std::forward<P>(provider), t,
+            impl::make_copy_query(table, columns, " FROM STDIN"), std::forward<Rows>(rows));
+    }
+
+    template <typename P, typename Columns, typename Rows, typename CompletionToken>
+    decltype(auto) operator() (P&& provider, std::string_view table, const Columns& columns, Rows&& rows,
+            CompletionToken&& token) const {
+        return (*this)(std::forward<P>(provider), table, columns, std::forward<Rows>(rows), none,
+            std::forward<CompletionToken>(token));
+    }
+
+    template <typename OtherInitiator>
+    constexpr static auto rebind_initiator(const OtherInitiator& other) {
+        return copy_in_op<OtherInitiator>{other};
+    }
+};
+
+template <typename Initiator>
+struct copy_out_op : base_async_operation <copy_out_op<Initiator>, Initiator> {
+    using base = typename copy_out_op::base;
+    using base::base;
+
+    template <typename P, typename Columns, typename Out, typename TimeConstraint, typename CompletionToken>
+    decltype(auto) operator() (P&& provider, std::string_view table, const Columns& columns, Out&& out,
+            TimeConstraint t, CompletionToken&& token) const {
+        static_assert(ConnectionProvider<P>, "provider should be a ConnectionProvider");
+        static_assert(ozo::TimeConstraint<TimeConstraint>, "should model TimeConstraint concept");
+        return async_initiate<CompletionToken, handler_signature<P>>(
+            get_operation_initiator(*this), token, std::forward<P>(provider), t,
+            impl::make_copy_query(table, columns, " TO STDOUT"), std::forward<Out>(out));
+    }
+
+    template <typename P, typename Columns, typename Out, typename CompletionToken>
+    decltype(auto) operator() (P&& provider, std::string_view table, const Columns& columns, Out&& out,
+            CompletionToken&& token) const {
+        return (*this)(std::forward<P>(provider), table, columns, std::forward<Out>(out), none,
+            std::forward<CompletionToken>(token));
+    }
+
+    template <typename OtherInitiator>
+    constexpr static auto rebind_initiator(const OtherInitiator& other) {
+        return copy_out_op<OtherInitiator>{other};
+    }
+};
+
+namespace detail {
+struct initiate_async_copy_in {
+    template <typename Handler, typename P, typename TimeConstraint, typename Rows>
+    constexpr void operator()(Handler&& h, P&& p, TimeConstraint t, std::string query, Rows&& rows) const {
+        impl::async_copy_in_request(std::forward<P>(p), std::move(query), std::forward<Rows>(rows), t,
+            std::forward<Handler>(h));
+    }
+};
+
+struct initiate_async_copy_out {
+    template <typename Handler, typename P, typename TimeConstraint, typename Out>
+    constexpr void operator()(Handler&& h, P&& p, TimeConstraint t, std::string query, Out&& out) const {
+        impl::async_copy_out_request(std::forward<P>(p), std::move(query), std::forward<Out>(out), t,
+            std::forward<Handler>(h));
+    }
+};
+} // namespace detail
+
+constexpr copy_in_op<detail::initiate_async_copy_in> copy_in;
+
+constexpr copy_out_op<detail::initiate_async_copy_out> copy_out;
+
+#endif
+
+} // namespace ozo
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <ozo/detail/stub_mutex.h>
+
+#include <mutex>
 #include <type_traits>
 
 namespace ozo {
@@ -22,4 +25,10 @@ struct thread_safety : std::bool_constant<enabled> {
 
 constexpr thread_safety<true> thread_safe;
 
+namespace detail {
+
+template <typename ThreadSafety>
+using get_connection_pool_mutex_t = std::conditional_t<std::decay_t<ThreadSafety>::value, std::mutex, stub_mutex>;
+
+} // namespace detail
 } // namespace ozo
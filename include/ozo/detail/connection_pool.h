@@ -1,11 +1,27 @@
 #pragma once
 
+#include <ozo/asio.h>
+#include <ozo/error.h>
+#include <ozo/recycling_allocator.h>
+#include <ozo/statistics.h>
+#include <ozo/core/none.h>
 #include <ozo/core/thread_safety.h>
+#include <ozo/time_traits.h>
 #include <ozo/detail/stub_mutex.h>
 
 #include <yamail/resource_pool/async/pool.hpp>
 
+#include <boost/circular_buffer.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
 #include <mutex>
+#include <optional>
+#include <unordered_set>
+#include <vector>
 
 namespace ozo::detail {
 
@@ -25,4 +41,766 @@ struct get_connection_pool_impl<ConnectionRepType, thread_safety<false>> {
 template <typename ConnectionRepType, typename ThreadSafety>
 using get_connection_pool_impl_t = typename get_connection_pool_impl<ConnectionRepType, std::decay_t<ThreadSafety>>::type;
 
+/**
+ * Statistics of the connections of a pool. Statistics collected by a connection are
+ * added when the connection is returned to the pool, statistics of a connection
+ * establishing are added when the connection is established.
+ */
+template <typename Statistics, typename ThreadSafety>
+class connection_pool_statistics {
+public:
+    void add([[maybe_unused]] const Statistics& v) noexcept {
+        if constexpr (!std::is_same_v<Statistics, none_t>) {
+            const std::lock_guard lock(mutex_);
+            value_ += v;
+        }
+    }
+
+    Statistics get() const {
+        const std::lock_guard lock(mutex_);
+        return value_;
+    }
+
+private:
+    mutable get_connection_pool_mutex_t<ThreadSafety> mutex_;
+    Statistics value_ {};
+};
+
+/**
+ * Statistics of the connections of a thread safe pool are summed up per item via relaxed
+ * atomics, so returning a connection does not take a pool-wide lock. Items are independent,
+ * so a snapshot may see some of the items of a concurrently added statistics only.
+ */
+template <>
+class connection_pool_statistics<basic_statistics, thread_safety<true>> {
+public:
+    void add(const basic_statistics& v) noexcept {
+        add(requests_, v.requests);
+        add(round_trips_, v.round_trips);
+        add(bytes_sent_, v.bytes_sent);
+        add(result_memory_, v.result_memory);
+        add(rows_decoded_, v.rows_decoded);
+        add(errors_, v.errors);
+        add(connects_, v.connects);
+        add(connect_errors_, v.connect_errors);
+        add(send_time_, v.send_time.count());
+        add(wait_time_, v.wait_time.count());
+        add(decode_time_, v.decode_time.count());
+        add(connect_time_, v.connect_time.count());
+    }
+
+    basic_statistics get() const noexcept {
+        basic_statistics result;
+        result.requests = load(requests_);
+        result.round_trips = load(round_trips_);
+        result.bytes_sent = load(bytes_sent_);
+        result.result_memory = load(result_memory_);
+        result.rows_decoded = load(rows_decoded_);
+        result.errors = load(errors_);
+        result.connects = load(connects_);
+        result.connect_errors = load(connect_errors_);
+        result.send_time = time_traits::duration(load(send_time_));
+        result.wait_time = time_traits::duration(load(wait_time_));
+        result.decode_time = time_traits::duration(load(decode_time_));
+        result.connect_time = time_traits::duration(load(connect_time_));
+        return result;
+    }
+
+private:
+    using counter = std::atomic<std::uint64_t>;
+    using duration_counter = std::atomic<time_traits::duration::rep>;
+
+    template <typename T>
+    static void add(std::atomic<T>& item, T value) noexcept {
+        // Most of the items of a single connection checkout are zero
+        if (value != T(0)) {
+            item.fetch_add(value, std::memory_order_relaxed);
+        }
+    }
+
+    template <typename T>
+    static T load(const std::atomic<T>& item) noexcept {
+        return item.load(std::memory_order_relaxed);
+    }
+
+    counter requests_ {0};
+    counter round_trips_ {0};
+    counter bytes_sent_ {0};
+    counter result_memory_ {0};
+    counter rows_decoded_ {0};
+    counter errors_ {0};
+    counter connects_ {0};
+    counter connect_errors_ {0};
+    duration_counter send_time_ {0};
+    duration_counter wait_time_ {0};
+    duration_counter decode_time_ {0};
+    duration_counter connect_time_ {0};
+};
+
+/**
+ * Execution context service which numbers the contexts, the number is used to bind
+ * the context to a pool shard. Requests of the same context use the same shard, so
+ * the shard is not shared between threads which run different contexts.
+ */
+class connection_pool_shard_id_service : public asio::execution_context::service {
+public:
+    static inline asio::execution_context::id id;
+
+    explicit connection_pool_shard_id_service(asio::execution_context& context)
+    : asio::execution_context::service(context), value_(next_value()) {}
+
+    std::size_t value() const noexcept { return value_;}
+
+private:
+    void shutdown() override {}
+
+    static std::size_t next_value() noexcept {
+        static std::atomic<std::size_t> next{0};
+        return next.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    const std::size_t value_;
+};
+
+inline std::size_t shard_id(asio::execution_context& context) {
+    return asio::use_service<connection_pool_shard_id_service>(context).value();
+}
+
+/**
+ * Connection pool which consists of independent shards to reduce lock contention
+ * between threads. Each `io_context` gets connections from its own shard first. If the shard
+ * has no idle connections, the idle connection is taken from another shard if any, so
+ * connections established by other threads are not wasted. The socket of a taken connection
+ * is registered within the reactor of the `io_context` which uses it, i.e. it costs a couple
+ * of system calls, which is much cheaper than establishing a new connection. If there is no
+ * idle connection and the shard is full, a new connection is established in a shard with a free slot.
+ *
+ * The capacity of the pool is divided between shards. A request reserves a slot of the shard
+ * it is sent to, the slot is released with the lease of the request, i.e. after the connection is
+ * returned into the shard, so concurrent requests do not choose the same last slot of a shard.
+ * Slots are reserved with atomics, so a request which finds a slot takes no lock except the one
+ * of its shard. Only requests which find all the shards exhausted wait in the queue of the whole
+ * pool limited by the queue capacity, and a released slot of any shard is given to the first of them.
+ * New requests do not overtake the waiting ones.
+ */
+template <typename Impl, typename ThreadSafety = thread_safety<true>>
+class connection_pool_shards {
+public:
+    connection_pool_shards(std::size_t capacity, std::size_t queue_capacity,
+            time_traits::duration idle_timeout, time_traits::duration lifespan, std::size_t shards = 1)
+    : state_(std::make_shared<state_type>(std::max<std::size_t>(1, std::min(shards, capacity)), queue_capacity)) {
+        const auto count = std::size(state_->slots);
+        for (std::size_t i = 0; i != count; ++i) {
+            state_->shards.emplace_back(share(capacity, count, i), queue_capacity, idle_timeout, lifespan);
+        }
+    }
+
+    ~connection_pool_shards() {
+        state_->abort();
+    }
+
+    /**
+     * Gets a connection from the shard of the `io_context`. The handler should have `lease_`
+     * member, the reservation of the shard slot is added to the lease if there are many shards.
+     * If all the shards are exhausted, the handler waits for a released slot within `wait_duration`,
+     * it is called with `get_resource_timeout` if the time is over and with `request_queue_overflow`
+     * if the queue is full.
+     */
+    template <typename Handler>
+    void get_auto_recycle(io_context& io, Handler&& handler, time_traits::duration wait_duration) {
+        const auto& shards = state_->shards;
+        if (std::size(shards) == 1) {
+            return state_->shards.front().get_auto_recycle(io, std::forward<Handler>(handler), wait_duration);
+        }
+        if (state_->waiting.load() == 0) {
+            if (const auto index = state_->reserve(shard_id(io) % std::size(shards))) {
+                return dispatch(state_, io, *index, std::forward<Handler>(handler), wait_duration);
+            }
+        }
+        wait(io, std::forward<Handler>(handler), wait_duration);
+    }
+
+    std::size_t capacity() const { return sum([] (const auto& v) { return v.capacity(); }); }
+    std::size_t size() const { return sum([] (const auto& v) { return v.size(); }); }
+    std::size_t available() const { return sum([] (const auto& v) { return v.available(); }); }
+
+    auto stats() const {
+        const auto& shards = state_->shards;
+        auto result = shards.front().stats();
+        std::for_each(std::next(std::begin(shards)), std::end(shards), [&] (const auto& shard) {
+            const auto v = shard.stats();
+            result.size += v.size;
+            result.available += v.available;
+            result.used += v.used;
+            result.queue_size += v.queue_size;
+        });
+        result.queue_size += state_->waiting.load();
+        return result;
+    }
+
+    std::size_t shards() const noexcept { return std::size(state_->shards);}
+
+    /**
+     * Closes idle connections of all the shards, connections in use are closed when they are returned.
+     */
+    void invalidate() {
+        for (auto& shard : state_->shards) {
+            shard.invalidate();
+        }
+    }
+
+private:
+    using waiter_handler = std::function<void(error_code, std::size_t)>;
+
+    struct waiter {
+        std::size_t id;
+        io_context* io;
+        waiter_handler handler;
+    };
+
+    struct state_type {
+        std::vector<std::atomic<std::size_t>> slots;
+        std::deque<Impl> shards;
+        std::size_t queue_capacity;
+        // Number of the waiting requests, it is checked without the lock when a slot is released.
+        std::atomic<std::size_t> waiting {0};
+        get_connection_pool_mutex_t<ThreadSafety> mutex;
+        std::deque<waiter> waiters;
+        std::size_t next_id = 0;
+        bool closed = false;
+
+        state_type(std::size_t count, std::size_t queue_capacity)
+        : slots(count), queue_capacity(queue_capacity) {}
+
+        bool try_reserve(std::size_t index) {
+            auto& value = slots[index];
+            const auto capacity = shards[index].capacity();
+            auto reserved = value.load();
+            while (reserved < capacity) {
+                if (value.compare_exchange_weak(reserved, reserved + 1)) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        std::optional<std::size_t> reserve(std::size_t local) {
+            const auto count = std::size(shards);
+            const auto find = [&] (auto predicate) -> std::optional<std::size_t> {
+                for (std::size_t i = 0; i != count; ++i) {
+                    if (const auto index = (local + i) % count; predicate(index) && try_reserve(index)) {
+                        return index;
+                    }
+                }
+                return std::nullopt;
+            };
+            // Steal an idle connection first, then take a free slot to establish a new connection.
+            // The number of idle connections is a hint only, the slot is reserved atomically.
+            if (const auto index = find([&] (auto i) { return shards[i].available() != 0; })) {
+                return index;
+            }
+            return find([] (auto) { return true; });
+        }
+
+        void release(std::size_t index) {
+            slots[index].fetch_sub(1);
+            // The waiter count is increased before a waiter tries to reserve a slot,
+            // so either the waiter finds the released slot or the slot is given to it here.
+            if (waiting.load() == 0) {
+                return;
+            }
+            const std::lock_guard lock(mutex);
+            while (!std::empty(waiters)) {
+                auto& front = waiters.front();
+                const auto reserved = reserve(shard_id(*front.io) % std::size(shards));
+                if (!reserved) {
+                    break;
+                }
+                asio::post(*front.io, [handler = std::move(front.handler), index = *reserved] () mutable {
+                    handler(error_code{}, index);
+                });
+                waiters.pop_front();
+                waiting.fetch_sub(1);
+            }
+        }
+
+        void expire(std::size_t id) {
+            std::unique_lock lock(mutex);
+            const auto it = std::find_if(std::begin(waiters), std::end(waiters),
+                [&] (const auto& v) { return v.id == id; });
+            if (it == std::end(waiters)) {
+                return;
+            }
+            auto handler = std::move(it->handler);
+            waiters.erase(it);
+            waiting.fetch_sub(1);
+            lock.unlock();
+            handler(yamail::resource_pool::error::get_resource_timeout, 0);
+        }
+
+        void abort() {
+            std::unique_lock lock(mutex);
+            closed = true;
+            auto aborted = std::move(waiters);
+            waiters.clear();
+            waiting.fetch_sub(std::size(aborted));
+            lock.unlock();
+            for (auto& v : aborted) {
+                asio::post(*v.io, [handler = std::move(v.handler)] () mutable {
+                    handler(asio::error::operation_aborted, 0);
+                });
+            }
+        }
+    };
+
+    struct reservation {
+        std::shared_ptr<state_type> state;
+        std::size_t index;
+        std::shared_ptr<void> lease;
+
+        reservation(std::shared_ptr<state_type> state, std::size_t index, std::shared_ptr<void> lease)
+        : state(std::move(state)), index(index), lease(std::move(lease)) {}
+
+        ~reservation() {
+            state->release(index);
+        }
+    };
+
+    template <typename Handler>
+    static void dispatch(const std::shared_ptr<state_type>& state, io_context& io, std::size_t index,
+            Handler&& handler, time_traits::duration wait_duration) {
+        handler.lease_ = std::allocate_shared<reservation>(recycling_allocator<char>{}, state, index,
+            std::move(handler.lease_));
+        state->shards[index].get_auto_recycle(io, std::forward<Handler>(handler), wait_duration);
+    }
+
+    template <typename Handler>
+    void wait(io_context& io, Handler&& handler, time_traits::duration wait_duration) {
+        using handle_type = typename std::decay_t<Handler>::handle_type;
+        auto timer = std::make_shared<asio::steady_timer>(io);
+        timer->expires_after(wait_duration);
+        // The handler is called within the io_context, so the timer is used by it safely.
+        waiter_handler on_slot = [state = state_, &io, timer, handler = std::forward<Handler>(handler)]
+                (error_code ec, std::size_t index) mutable {
+            timer->cancel();
+            if (ec) {
+                return handler(std::move(ec), handle_type{});
+            }
+            const auto left = timer->expiry() - time_traits::now();
+            dispatch(state, io, index, std::move(handler), std::max(left, time_traits::duration(0)));
+        };
+
+        std::unique_lock lock(state_->mutex);
+        if (state_->closed || std::size(state_->waiters) >= state_->queue_capacity) {
+            const auto ec = state_->closed ? error_code{asio::error::operation_aborted}
+                : error_code{yamail::resource_pool::error::request_queue_overflow};
+            lock.unlock();
+            return asio::post(io, [on_slot = std::move(on_slot), ec] () mutable { on_slot(ec, 0); });
+        }
+        state_->waiting.fetch_add(1);
+        if (std::empty(state_->waiters)) {
+            if (const auto index = state_->reserve(shard_id(io) % std::size(state_->shards))) {
+                state_->waiting.fetch_sub(1);
+                lock.unlock();
+                return asio::post(io, [on_slot = std::move(on_slot), index = *index] () mutable {
+                    on_slot(error_code{}, index);
+                });
+            }
+        }
+        const auto id = state_->next_id++;
+        state_->waiters.push_back(waiter{id, std::addressof(io), std::move(on_slot)});
+        lock.unlock();
+        timer->async_wait([weak = std::weak_ptr<state_type>(state_), id] (error_code ec) {
+            if (ec) {
+                return;
+            }
+            if (const auto state = weak.lock()) {
+                state->expire(id);
+            }
+        });
+    }
+
+    static constexpr std::size_t share(std::size_t total, std::size_t count, std::size_t index) noexcept {
+        return total / count + (index < total % count ? 1 : 0);
+    }
+
+    template <typename F>
+    std::size_t sum(F&& f) const {
+        std::size_t result = 0;
+        for (const auto& shard : state_->shards) {
+            result += f(shard);
+        }
+        return result;
+    }
+
+    std::shared_ptr<state_type> state_;
+};
+
+template <typename Stream>
+class pooled_connection_stream_service;
+
+/**
+ * Connection socket bound to an execution context. It is kept apart from the connection
+ * so the execution context service may destroy it when the context is destroyed.
+ */
+template <typename Stream>
+struct pooled_connection_stream_binding {
+    std::optional<Stream> stream;
+    const void* context = nullptr;
+    pooled_connection_stream_service<Stream>* service = nullptr;
+};
+
+/**
+ * Execution context service which tracks sockets of pooled connections bound to the context.
+ * The sockets are destroyed with the service, i.e. before the context I/O services they are
+ * registered within, so a connection pool may outlive the execution contexts it was used with.
+ */
+template <typename Stream>
+class pooled_connection_stream_service : public asio::execution_context::service {
+public:
+    using binding_type = pooled_connection_stream_binding<Stream>;
+
+    static asio::execution_context::id id;
+
+    explicit pooled_connection_stream_service(asio::execution_context& context)
+    : asio::execution_context::service(context) {}
+
+    ~pooled_connection_stream_service() {
+        const std::lock_guard lock(mutex_);
+        for (auto binding : bindings_) {
+            binding->stream->release();
+            binding->stream.reset();
+            binding->context = nullptr;
+            binding->service = nullptr;
+        }
+    }
+
+    void add(binding_type& binding) {
+        const std::lock_guard lock(mutex_);
+        bindings_.insert(std::addressof(binding));
+    }
+
+    void remove(binding_type& binding) noexcept {
+        const std::lock_guard lock(mutex_);
+        bindings_.erase(std::addressof(binding));
+    }
+
+private:
+    // Handlers which own pooled connections are destroyed on the shutdown,
+    // so the sockets are kept until the service is destroyed.
+    void shutdown() override {}
+
+    std::mutex mutex_;
+    std::unordered_set<binding_type*> bindings_;
+};
+
+template <typename Stream>
+asio::execution_context::id pooled_connection_stream_service<Stream>::id;
+
+/**
+ * Connection socket which stays registered within the reactor of an execution
+ * context while the connection is idle in the pool, so checking out the connection
+ * does not cost the descriptor registration and deregistration system calls.
+ * The socket is bound to a context again only if the connection is used with another
+ * one. The descriptor is owned by libpq, so it is released and never closed here.
+ * If the context is destroyed first, the socket is destroyed with it, see
+ * `pooled_connection_stream_service`.
+ */
+template <typename Stream>
+class pooled_connection_stream {
+public:
+    using binding_type = pooled_connection_stream_binding<Stream>;
+    using service_type = pooled_connection_stream_service<Stream>;
+
+    pooled_connection_stream() = default;
+    pooled_connection_stream(const pooled_connection_stream&) = delete;
+    pooled_connection_stream& operator =(const pooled_connection_stream&) = delete;
+    pooled_connection_stream(pooled_connection_stream&&) noexcept = default;
+
+    pooled_connection_stream& operator =(pooled_connection_stream&& other) noexcept {
+        if (this != std::addressof(other)) {
+            unbind();
+            binding_ = std::move(other.binding_);
+        }
+        return *this;
+    }
+
+    ~pooled_connection_stream() { unbind(); }
+
+    template <typename Executor, typename NativeHandle>
+    Stream& get(const Executor& ex, NativeHandle fd) {
+        auto& context = ex.context();
+        if (!binding_ || !binding_->stream || binding_->context != std::addressof(context)
+                || binding_->stream->native_handle() != fd) {
+            unbind();
+            if (!binding_) {
+                binding_ = std::make_unique<binding_type>();
+            }
+            binding_->stream.emplace(get_connection_stream(ex));
+            // The service is created after the stream I/O service, so it is destroyed before.
+            binding_->service = std::addressof(asio::use_service<service_type>(context));
+            binding_->service->add(*binding_);
+            binding_->context = std::addressof(context);
+            if (fd != -1) {
+                binding_->stream->assign(fd);
+            }
+        }
+        return *binding_->stream;
+    }
+
+    void release() noexcept {
+        if (binding_ && binding_->stream) {
+            binding_->stream->release();
+        }
+    }
+
+private:
+    void unbind() noexcept {
+        if (binding_ && binding_->stream) {
+            binding_->service->remove(*binding_);
+            binding_->stream->release();
+            binding_->stream.reset();
+            binding_->context = nullptr;
+            binding_->service = nullptr;
+        }
+    }
+
+    std::unique_ptr<binding_type> binding_;
+};
+
+/**
+ * Idle connections of the pool which are kept out of the underlying resource pool, the handles
+ * stay used from its point of view. So the resource pool hands out only free slots, and connections
+ * are established in background into them without taking the idle ones. In the LIFO order a small set
+ * of the most recently used connections serves most of the requests, in the FIFO order all of them
+ * are used evenly.
+ * A connection which is idle here longer than the idle timeout is closed by `close_expired()`,
+ * the pool calls it by a timer, and on pop. A connection which is older than the lifespan
+ * is not kept, it is returned to the resource pool to be recycled. The storage is allocated
+ * for the pool capacity at once, so a connection is pushed without allocation, e.g. from
+ * a destructor.
+ */
+template <typename Handle, typename ThreadSafety>
+class connection_pool_idle_stack {
+public:
+    connection_pool_idle_stack(std::size_t capacity, time_traits::duration idle_timeout, time_traits::duration lifespan,
+            bool lifo = true)
+    : idle_timeout_(idle_timeout), lifespan_(lifespan), handles_(capacity), lifo_(lifo) {}
+
+    /**
+     * Keeps the handle if it is not older than the lifespan and the stack is not full,
+     * otherwise the handle is left untouched, so it is returned to the resource pool by the caller.
+     */
+    void push(Handle& handle) noexcept {
+        const auto now = time_traits::now();
+        if (now - handle->created_at() >= lifespan_) {
+            return;
+        }
+        const std::lock_guard lock(mutex_);
+        if (!closed_ && !handles_.full()) {
+            handles_.push_back(entry{std::move(handle), now});
+        }
+    }
+
+    /**
+     * Takes the most recently pushed handle in the LIFO order or the least recently pushed one
+     * in the FIFO order, if any.
+     */
+    std::optional<Handle> pop() {
+        close_expired(time_traits::now());
+        const std::lock_guard lock(mutex_);
+        if (handles_.empty()) {
+            return std::nullopt;
+        }
+        if (lifo_) {
+            std::optional<Handle> result(std::move(handles_.back().handle));
+            handles_.pop_back();
+            return result;
+        }
+        std::optional<Handle> result(std::move(handles_.front().handle));
+        handles_.pop_front();
+        return result;
+    }
+
+    std::size_t size() const {
+        const std::lock_guard lock(mutex_);
+        return handles_.size();
+    }
+
+    /**
+     * Closes the handles which are idle longer than the idle timeout.
+     *
+     * @return time_traits::time_point --- time point the next handle expires, if a handle
+     * is pushed later it expires later than the idle timeout after now.
+     */
+    time_traits::time_point close_expired(time_traits::time_point now) {
+        // The oldest handles are at the front, they are closed one by one
+        // to do not hold the lock while a connection is closed.
+        for (;;) {
+            std::unique_lock lock(mutex_);
+            if (handles_.empty()) {
+                return now + idle_timeout_;
+            }
+            if (const auto expiry = handles_.front().since + idle_timeout_; now < expiry) {
+                return expiry;
+            }
+            auto handle = std::move(handles_.front().handle);
+            handles_.pop_front();
+            lock.unlock();
+            handle.waste();
+        }
+    }
+
+    /**
+     * Returns all the handles to the resource pool and stops keeping new ones,
+     * e.g. when the pool is destroyed.
+     */
+    void close() {
+        std::unique_lock lock(mutex_);
+        closed_ = true;
+        boost::circular_buffer<entry> handles;
+        handles.swap(handles_);
+        lock.unlock();
+    }
+
+private:
+    struct entry {
+        Handle handle;
+        time_traits::time_point since;
+    };
+
+    mutable get_connection_pool_mutex_t<ThreadSafety> mutex_;
+    time_traits::duration idle_timeout_;
+    time_traits::duration lifespan_;
+    boost::circular_buffer<entry> handles_;
+    bool lifo_;
+    bool closed_ = false;
+};
+
+/**
+ * Borrowed connections of the pool which are counted to drain the pool. A request borrows
+ * the pool when it is admitted to get a connection and returns it when the connection is
+ * returned to the pool, so a borrow covers both the connection usage and its establishing.
+ * After `drain()` is called nothing can be borrowed, and the drain handlers are called once
+ * all the borrows are returned.
+ *
+ * The borrows are counted by an atomic state together with the draining flag, so borrowing
+ * and returning take no lock and allocate nothing; the mutex guards the drain handlers only.
+ */
+template <typename ThreadSafety>
+class connection_pool_drain : public std::enable_shared_from_this<connection_pool_drain<ThreadSafety>> {
+public:
+    using handler_type = std::function<void(error_code)>;
+
+    /**
+     * Borrow of the pool which is returned when the last copy of it is destroyed.
+     * A default constructed borrow is empty and returns nothing.
+     */
+    class borrow_type {
+    public:
+        borrow_type() = default;
+
+        borrow_type(const borrow_type& other) noexcept : drain_(other.drain_) {
+            if (drain_) {
+                drain_->state_.fetch_add(borrow_step, std::memory_order_relaxed);
+            }
+        }
+
+        borrow_type(borrow_type&&) noexcept = default;
+
+        borrow_type& operator =(borrow_type other) noexcept {
+            std::swap(drain_, other.drain_);
+            return *this;
+        }
+
+        ~borrow_type() {
+            if (drain_) {
+                drain_->release();
+            }
+        }
+
+        explicit operator bool() const noexcept { return static_cast<bool>(drain_);}
+
+    private:
+        friend class connection_pool_drain;
+
+        explicit borrow_type(std::shared_ptr<connection_pool_drain> drain) noexcept
+        : drain_(std::move(drain)) {}
+
+        std::shared_ptr<connection_pool_drain> drain_;
+    };
+
+    /**
+     * Borrows the pool if it is not drained.
+     *
+     * @return borrow_type --- the borrow, empty if the pool is drained.
+     */
+    borrow_type borrow() {
+        auto state = state_.load(std::memory_order_relaxed);
+        do {
+            if (state & draining_flag) {
+                return borrow_type{};
+            }
+        } while (!state_.compare_exchange_weak(state, state + borrow_step, std::memory_order_acquire,
+            std::memory_order_relaxed));
+        return borrow_type{this->shared_from_this()};
+    }
+
+    /**
+     * Stops borrowing and calls the handler with no error when all the borrows are
+     * returned. The handler is called immediately if nothing is borrowed.
+     */
+    void drain(handler_type handler) {
+        std::unique_lock lock(mutex_);
+        handlers_.push_back(std::move(handler));
+        if (state_.fetch_or(draining_flag, std::memory_order_acq_rel) >= borrow_step) {
+            return;
+        }
+        notify(std::move(lock), error_code{});
+    }
+
+    /**
+     * Calls the pending drain handlers with `asio::error::operation_aborted`,
+     * e.g. when the pool is destroyed.
+     */
+    void abort() {
+        std::unique_lock lock(mutex_);
+        state_.fetch_or(draining_flag, std::memory_order_acq_rel);
+        notify(std::move(lock), asio::error::operation_aborted);
+    }
+
+    bool draining() const {
+        return state_.load(std::memory_order_acquire) & draining_flag;
+    }
+
+    std::size_t borrowed() const {
+        return state_.load(std::memory_order_acquire) / borrow_step;
+    }
+
+private:
+    static constexpr std::size_t draining_flag = 1;
+    static constexpr std::size_t borrow_step = 2;
+
+    void release() noexcept {
+        // Only the last borrow returned after the drain started notifies the handlers.
+        if (state_.fetch_sub(borrow_step, std::memory_order_acq_rel) != (borrow_step | draining_flag)) {
+            return;
+        }
+        notify(std::unique_lock(mutex_), error_code{});
+    }
+
+    void notify(std::unique_lock<get_connection_pool_mutex_t<ThreadSafety>> lock, error_code ec) noexcept {
+        auto handlers = std::move(handlers_);
+        handlers_.clear();
+        lock.unlock();
+        for (auto& handler : handlers) {
+            handler(ec);
+        }
+    }
+
+    std::atomic<std::size_t> state_ {0};
+    get_connection_pool_mutex_t<ThreadSafety> mutex_;
+    std::vector<handler_type> handlers_;
+};
+
 } // namespace ozo::detail
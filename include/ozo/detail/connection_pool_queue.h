@@ -0,0 +1,374 @@
+#pragma once
+
+#include <ozo/asio.h>
+#include <ozo/deadline.h>
+#include <ozo/error.h>
+#include <ozo/time_traits.h>
+#include <ozo/recycling_allocator.h>
+#include <ozo/core/thread_safety.h>
+
+#include <boost/asio/post.hpp>
+
+#include <algorithm>
+#include <array>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+
+namespace ozo::detail {
+
+/**
+ * Median of the last durations of connection usage by requests. The median is
+ * recalculated periodically, so it follows the load and costs almost nothing per sample.
+ * It is zero until enough samples are collected.
+ */
+class connection_usage_median {
+public:
+    void record(time_traits::duration value) noexcept {
+        samples_[count_++ % samples_.size()] = value;
+        if (count_ % update_period == 0) {
+            auto samples = samples_;
+            const auto size = std::min<std::size_t>(count_, samples.size());
+            const auto middle = samples.begin() + size / 2;
+            std::nth_element(samples.begin(), middle, samples.begin() + size);
+            value_ = *middle;
+        }
+    }
+
+    time_traits::duration value() const noexcept { return value_; }
+
+private:
+    static constexpr std::size_t update_period = 16;
+
+    std::array<time_traits::duration, 64> samples_ {};
+    std::size_t count_ = 0;
+    time_traits::duration value_ {};
+};
+
+/**
+ * Concurrency limit which follows the load of a database with the additive increase and
+ * multiplicative decrease (AIMD) algorithm. Connection usage times are averaged over windows
+ * of at least `limit` samples. The limit is decreased by the backoff ratio if the average
+ * is greater than the baseline by the tolerance ratio, otherwise it is increased by one if
+ * all the slots have been in use during the window. The baseline is the minimal average,
+ * it slowly drifts to greater averages, so the limit follows a new normal, e.g. after
+ * a change of queries.
+ */
+class adaptive_concurrency_limit {
+public:
+    adaptive_concurrency_limit(std::size_t min, std::size_t max, double tolerance, double backoff) noexcept
+    : min_(std::max<std::size_t>(min, 1)), max_(std::max(min_, max)),
+      tolerance_(tolerance), backoff_(backoff), value_(min_) {}
+
+    std::size_t value() const noexcept { return value_; }
+
+    /**
+     * Records the time a connection was used by a request.
+     *
+     * @param usage --- connection usage time.
+     * @param saturated --- all the slots are in use or there are waiting requests.
+     */
+    void record(time_traits::duration usage, bool saturated) noexcept {
+        sum_ += usage;
+        saturated_ = saturated_ || saturated;
+        if (++count_ < std::max(value_, min_window)) {
+            return;
+        }
+        const auto average = sum_ / count_;
+        const bool overloaded = baseline_ != time_traits::duration(0)
+            && average.count() > baseline_.count() * tolerance_;
+        if (overloaded) {
+            value_ = std::max(min_, static_cast<std::size_t>(value_ * backoff_));
+        } else if (saturated_) {
+            value_ = std::min(max_, value_ + 1);
+        }
+        if (baseline_ == time_traits::duration(0) || average < baseline_) {
+            baseline_ = average;
+        } else {
+            baseline_ += (average - baseline_) / baseline_drift;
+        }
+        sum_ = time_traits::duration(0);
+        count_ = 0;
+        saturated_ = false;
+    }
+
+    time_traits::duration baseline() const noexcept { return baseline_; }
+
+private:
+    static constexpr std::size_t min_window = 16;
+    static constexpr int baseline_drift = 16;
+
+    std::size_t min_;
+    std::size_t max_;
+    double tolerance_;
+    double backoff_;
+    std::size_t value_;
+    time_traits::duration baseline_ {};
+    time_traits::duration sum_ {};
+    std::size_t count_ = 0;
+    bool saturated_ = false;
+};
+
+/**
+ * Admission queue of the connection pool. It limits the number of requests which use
+ * connections of the pool and keeps the rest waiting. The waiting requests are served
+ * either in the order of arrival or in the order of deadlines, so a request which expires
+ * earlier gets a connection first. The queue of the underlying resource pool is FIFO only,
+ * so a request goes to the resource pool after it is admitted here.
+ *
+ * An admitted request gets a lease, the slot is released when the last copy
+ * of the lease is destroyed. The lease and the completion of a waiting request are
+ * allocated when the request is queued, so a released slot is handed over to the next
+ * waiter without allocations within the lease destructor. With the deadline order a request which is not expected
+ * to complete in time is rejected immediately with `error::pool_deadline_too_close`
+ * instead of occupying the queue: the time left to its deadline is compared with the
+ * median time of connection usage by the previous requests. The number of admitted requests
+ * is limited either by a fixed limit or by `adaptive_concurrency_limit`.
+ */
+template <typename ThreadSafety>
+class connection_pool_queue : public std::enable_shared_from_this<connection_pool_queue<ThreadSafety>> {
+public:
+    using lease_type = std::shared_ptr<void>;
+    using waiter_type = std::function<void(error_code, lease_type)>;
+
+    connection_pool_queue(std::size_t limit, std::size_t capacity, bool earliest_deadline_first,
+            std::optional<adaptive_concurrency_limit> adaptive_limit = std::nullopt)
+    : limit_(adaptive_limit ? adaptive_limit->value() : limit), capacity_(capacity),
+      earliest_deadline_first_(earliest_deadline_first), adaptive_limit_(adaptive_limit) {}
+
+    /**
+     * Admits the request if there is a free slot and nobody waits, otherwise the waiter
+     * created by `make_waiter()` is queued and nullptr is returned. The waiter is called
+     * later with a lease, posted to the executor, or with an error: `asio::error::timed_out` if the deadline is
+     * expired, the reason passed to `abort()` if the queue is aborted. The waiter is
+     * called immediately with an error if the request is rejected or the queue is aborted.
+     *
+     * @param ex --- executor for the deadline timer and the waiter completion with a lease.
+     * @param deadline --- time point the request expires, `time_point::max()` for no deadline.
+     * @param make_waiter --- function which returns the waiter, called only if the request is not admitted immediately.
+     * @return lease_type --- lease of the admitted request or nullptr.
+     */
+    template <typename Executor, typename MakeWaiter>
+    lease_type acquire(const Executor& ex, time_traits::time_point deadline, MakeWaiter&& make_waiter) {
+        std::unique_lock lock(mutex_);
+        if (!aborted_ && waiters_.empty() && in_use_ < limit_) {
+            ++in_use_;
+            lock.unlock();
+            return make_lease();
+        }
+
+        error_code ec;
+        if (aborted_) {
+            ec = abort_reason_;
+        } else if (waiters_.size() >= capacity_) {
+            ec = error::pool_queue_overflow;
+        } else if (earliest_deadline_first_ && time_left(deadline) < usage_median_.value()) {
+            ec = error::pool_deadline_too_close;
+        }
+        if (ec) {
+            lock.unlock();
+            waiter_type waiter = make_waiter();
+            waiter(ec, nullptr);
+            return nullptr;
+        }
+
+        const key_type key {earliest_deadline_first_ ? deadline : time_traits::time_point{}, next_id_++};
+        auto waiter = make_waiter_state(ex, make_waiter());
+        if (deadline != time_traits::time_point::max()) {
+            waiter->timer = std::make_shared<typename waiter_state<Executor>::timer_type>(
+                get_operation_timer(ex, deadline));
+            waiter->timer->async_wait([weak = this->weak_from_this(), key, timer = waiter->timer] (error_code ec) {
+                if (auto self = weak.lock(); self && !ec) {
+                    self->expire(key);
+                }
+            });
+        }
+        waiters_.emplace(key, std::move(waiter));
+        return nullptr;
+    }
+
+    /**
+     * Completes all the waiters with the reason, e.g. `asio::error::operation_aborted`
+     * when the pool is destroyed. Released slots are not given anymore and new
+     * requests are rejected with the same reason.
+     */
+    void abort(error_code reason = asio::error::operation_aborted) {
+        std::unique_lock lock(mutex_);
+        aborted_ = true;
+        abort_reason_ = reason;
+        auto waiters = std::move(waiters_);
+        waiters_.clear();
+        lock.unlock();
+        for (auto& [key, waiter] : waiters) {
+            waiter->cancel();
+            waiter->handler(reason, nullptr);
+        }
+    }
+
+    std::size_t size() const {
+        const std::lock_guard lock(mutex_);
+        return waiters_.size();
+    }
+
+    std::size_t in_use() const {
+        const std::lock_guard lock(mutex_);
+        return in_use_;
+    }
+
+    std::size_t limit() const {
+        const std::lock_guard lock(mutex_);
+        return limit_;
+    }
+
+    time_traits::duration usage_median() const {
+        const std::lock_guard lock(mutex_);
+        return usage_median_.value();
+    }
+
+private:
+    /**
+     * State of a lease, the slot is released by its destructor if it has been granted.
+     */
+    struct lease_state {
+        std::shared_ptr<connection_pool_queue> queue;
+        time_traits::time_point start;
+
+        ~lease_state() {
+            if (queue) {
+                queue->release(time_traits::now() - start);
+            }
+        }
+
+        void grant(std::shared_ptr<connection_pool_queue> q) noexcept {
+            start = time_traits::now();
+            queue = std::move(q);
+        }
+    };
+
+    struct waiter_base {
+        waiter_type handler;
+        std::shared_ptr<lease_state> lease;
+
+        virtual ~waiter_base() = default;
+
+        // Posts the completion with the granted lease to the executor of the waiter.
+        virtual void complete() noexcept = 0;
+
+        // Cancels the deadline timer of the waiter.
+        virtual void cancel() = 0;
+    };
+
+    using waiter_ptr = std::shared_ptr<waiter_base>;
+    using arena_allocator = operation_arena_allocator<char, recycling_allocator<char>>;
+
+    // The waiter, its lease and the posted completion operation fit the arena.
+    static constexpr std::size_t waiter_arena_capacity = 768;
+
+    template <typename Executor>
+    struct waiter_state final : waiter_base, std::enable_shared_from_this<waiter_state<Executor>> {
+        using timer_type = std::decay_t<decltype(get_operation_timer(std::declval<const Executor&>(), time_traits::time_point{}))>;
+
+        Executor executor;
+        std::shared_ptr<timer_type> timer;
+        arena_allocator allocator;
+
+        waiter_state(const Executor& ex, const arena_allocator& alloc)
+        : executor(ex), allocator(alloc) {}
+
+        // The completion is posted in the lease destructor of another request, so it is
+        // allocated in the arena of the waiter, and the waiter is completed within its own
+        // executor, so its exceptions do not reach the destructor.
+        struct completion {
+            std::shared_ptr<waiter_state> self;
+
+            using allocator_type = arena_allocator;
+
+            allocator_type get_allocator() const noexcept { return self->allocator;}
+
+            void operator() () {
+                if (self->timer) {
+                    self->timer->cancel();
+                }
+                self->handler(error_code{}, lease_type(std::move(self->lease)));
+            }
+        };
+
+        void complete() noexcept override {
+            asio::post(executor, completion{this->shared_from_this()});
+        }
+
+        void cancel() override {
+            if (timer) {
+                asio::post(timer->get_executor(), [timer = timer] { timer->cancel(); });
+            }
+        }
+    };
+
+    template <typename Executor>
+    std::shared_ptr<waiter_state<Executor>> make_waiter_state(const Executor& ex, waiter_type handler) {
+        const arena_allocator allocator(operation_arena<recycling_allocator<char>>::create({}, waiter_arena_capacity));
+        auto waiter = std::allocate_shared<waiter_state<Executor>>(allocator, ex, allocator);
+        waiter->handler = std::move(handler);
+        waiter->lease = std::allocate_shared<lease_state>(allocator);
+        return waiter;
+    }
+
+    // The order of waiters: the deadline, or the same value for all for the FIFO
+    // order, and then the arrival number.
+    using key_type = std::pair<time_traits::time_point, std::uint64_t>;
+
+    lease_type make_lease() {
+        auto lease = std::allocate_shared<lease_state>(recycling_allocator<char>{});
+        lease->grant(this->shared_from_this());
+        return lease;
+    }
+
+    void expire(const key_type& key) {
+        std::unique_lock lock(mutex_);
+        const auto it = waiters_.find(key);
+        if (it == waiters_.end()) {
+            return;
+        }
+        auto waiter = std::move(it->second);
+        waiters_.erase(it);
+        lock.unlock();
+        waiter->handler(asio::error::timed_out, nullptr);
+    }
+
+    void release(time_traits::duration usage) noexcept {
+        std::unique_lock lock(mutex_);
+        const bool saturated = in_use_ >= limit_ || !waiters_.empty();
+        --in_use_;
+        usage_median_.record(usage);
+        if (adaptive_limit_) {
+            adaptive_limit_->record(usage, saturated);
+            limit_ = adaptive_limit_->value();
+        }
+        while (!aborted_ && !waiters_.empty() && in_use_ < limit_) {
+            auto waiter = std::move(waiters_.begin()->second);
+            waiters_.erase(waiters_.begin());
+            ++in_use_;
+            waiter->lease->grant(this->shared_from_this());
+            lock.unlock();
+            waiter->complete();
+            waiter.reset();
+            lock.lock();
+        }
+    }
+
+    mutable get_connection_pool_mutex_t<ThreadSafety> mutex_;
+    std::size_t limit_;
+    std::size_t capacity_;
+    bool earliest_deadline_first_;
+    bool aborted_ = false;
+    error_code abort_reason_;
+    std::size_t in_use_ = 0;
+    std::uint64_t next_id_ = 0;
+    std::map<key_type, waiter_ptr> waiters_;
+    connection_usage_median usage_median_;
+    std::optional<adaptive_concurrency_limit> adaptive_limit_;
+};
+
+} // namespace ozo::detail
@@ -4,6 +4,7 @@
 #include <ozo/error.h>
 #include <ozo/deadline.h>
 #include <ozo/detail/bind.h>
+#include <ozo/recycling_allocator.h>
 
 #include <boost/asio/dispatch.hpp>
 
@@ -15,7 +16,17 @@ public:
     template <typename TimeConstraint>
     io_deadline_handler (Stream& stream, const TimeConstraint& t, Handler handler)
     : timer_(ozo::detail::get_operation_timer(stream.get_executor(), t)) {
-        auto allocator = asio::get_associated_allocator(handler);
+        auto allocator = detail::get_operation_allocator(handler);
+        ctx_ = std::allocate_shared<context>(allocator, stream, std::move(handler));
+        timer_.async_wait(timer_handler{ctx_});
+    }
+
+    /**
+     * The context is allocated with the allocator, e.g. with the arena of the operation.
+     */
+    template <typename TimeConstraint, typename Allocator>
+    io_deadline_handler (Stream& stream, const TimeConstraint& t, Handler handler, const Allocator& allocator)
+    : timer_(ozo::detail::get_operation_timer(stream.get_executor(), t)) {
         ctx_ = std::allocate_shared<context>(allocator, stream, std::move(handler));
         timer_.async_wait(timer_handler{ctx_});
     }
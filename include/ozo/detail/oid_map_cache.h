@@ -0,0 +1,107 @@
+#pragma once
+
+#include <ozo/error.h>
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace ozo::detail {
+
+/**
+ * Oid map shared by connections of a single connection source. The first connection
+ * requests oids of the custom types from a database and stores the map here, so the
+ * next connections get the map without the oid request round trip. The cache is
+ * versioned: the map which has been requested before the invalidation is not stored,
+ * so a connection which started the request with outdated oids can not fill the cache.
+ */
+template <typename OidMap>
+class oid_map_cache {
+public:
+    using version_type = std::size_t;
+
+    /**
+     * Returns the cached oid map and the cache version. The map is empty
+     * if it has not been requested yet or has been invalidated.
+     */
+    std::pair<std::optional<OidMap>, version_type> get() const {
+        const std::lock_guard lock(mutex_);
+        return {oid_map_, version_};
+    }
+
+    /**
+     * Stores the oid map requested from a database if the cache has not been
+     * invalidated since the version was got.
+     */
+    void update(const OidMap& oid_map, version_type version) {
+        const std::lock_guard lock(mutex_);
+        if (version == version_) {
+            oid_map_ = oid_map;
+        }
+    }
+
+    /**
+     * Drops the cached oid map, e.g. if custom types have been recreated
+     * in a database, so the next connection requests the oids again.
+     */
+    void invalidate() {
+        const std::lock_guard lock(mutex_);
+        oid_map_.reset();
+        ++version_;
+    }
+
+private:
+    mutable std::mutex mutex_;
+    std::optional<OidMap> oid_map_;
+    version_type version_ = 0;
+};
+
+template <typename T, typename = std::void_t<>>
+struct has_oid_map_cache : std::false_type {};
+
+template <typename T>
+struct has_oid_map_cache<T, std::void_t<decltype(std::declval<T&>().oid_map_cache())>> : std::true_type {};
+
+/**
+ * Returns the oid map cache the connection is bound to, or `nullptr` if the connection
+ * does not support the cache.
+ */
+template <typename Connection>
+inline auto get_oid_map_cache(Connection& conn) noexcept {
+    if constexpr (has_oid_map_cache<Connection>::value) {
+        return conn.oid_map_cache();
+    } else {
+        return nullptr;
+    }
+}
+
+/**
+ * Binds the connection to the oid map cache, so the cache is invalidated if a result of the
+ * connection can not be received because of outdated oids. Does nothing if the connection
+ * does not support the cache.
+ */
+template <typename Connection, typename Cache>
+inline void set_oid_map_cache([[maybe_unused]] Connection& conn, [[maybe_unused]] Cache cache) noexcept {
+    if constexpr (has_oid_map_cache<Connection>::value && !std::is_null_pointer_v<Cache>) {
+        conn.oid_map_cache() = std::move(cache);
+    }
+}
+
+/**
+ * Drops the oid map cache the connection is bound to if a result can not be received
+ * because of `ozo::error::oid_type_mismatch`, e.g. custom types have been recreated in
+ * a database, so the next connection of the source requests the oids again.
+ */
+template <typename Connection>
+inline void invalidate_oid_map_cache_on_error([[maybe_unused]] Connection& conn, [[maybe_unused]] const error_code& ec) {
+    if constexpr (has_oid_map_cache<Connection>::value) {
+        if (ec == error::oid_type_mismatch && conn.oid_map_cache()) {
+            conn.oid_map_cache()->invalidate();
+        }
+    }
+}
+
+} // namespace ozo::detail
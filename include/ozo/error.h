@@ -96,6 +96,21 @@ enum code {
     bad_composite_size, //!< a composite's fields number received does not equal to the expected or not supported by the type
     pq_cancel_failed, //!< libpq PQcancel function call failed, see `get_error_context()` for more information
     pq_get_cancel_failed, //!< libpq PQgetCancel function call failed, see `get_error_context()` for more information
+    pg_enter_pipeline_mode_failed, //!< libpq PQenterPipelineMode function failed
+    pg_exit_pipeline_mode_failed, //!< libpq PQexitPipelineMode function failed
+    pg_pipeline_sync_failed, //!< libpq PQpipelineSync function failed
+    pg_send_query_prepared_failed, //!< libpq PQsendQueryPrepared function failed
+    pg_send_prepare_failed, //!< libpq PQsendPrepare function failed
+    pg_send_query_failed, //!< libpq PQsendQuery function failed
+    pg_put_copy_data_failed, //!< libpq PQputCopyData function failed
+    pg_put_copy_end_failed, //!< libpq PQputCopyEnd function failed
+    pg_get_copy_data_failed, //!< libpq PQgetCopyData function failed
+    bad_copy_data, //!< binary COPY data received does not match the format or the row type
+    pool_queue_overflow, //!< the connection pool wait queue is full
+    pool_deadline_too_close, //!< time left to the request deadline is less than the median time of connection usage, so the request is rejected by the connection pool
+    pool_draining, //!< the connection pool is drained by `connection_pool::drain()` and does not hand out connections
+    circuit_breaker_open, //!< the circuit breaker of a host is open, so the connection attempt is rejected without trying the host, see `ozo::circuit_breaker`
+    pg_set_rows_mode_failed, //!< libpq PQsetSingleRowMode or PQsetChunkedRowsMode function failed after the query has been sent, so the connection is closed
 };
 
 /**
@@ -493,6 +508,36 @@ public:
                 return "libpq PQcancel function call failed";
             case pq_get_cancel_failed:
                 return "libpq PQgetCancel function call failed";
+            case pg_enter_pipeline_mode_failed:
+                return "pg_enter_pipeline_mode_failed - PQenterPipelineMode function failed";
+            case pg_exit_pipeline_mode_failed:
+                return "pg_exit_pipeline_mode_failed - PQexitPipelineMode function failed";
+            case pg_pipeline_sync_failed:
+                return "pg_pipeline_sync_failed - PQpipelineSync function failed";
+            case pg_send_query_prepared_failed:
+                return "pg_send_query_prepared_failed - PQsendQueryPrepared function failed";
+            case pg_send_prepare_failed:
+                return "pg_send_prepare_failed - PQsendPrepare function failed";
+            case pg_send_query_failed:
+                return "pg_send_query_failed - PQsendQuery function failed";
+            case pg_put_copy_data_failed:
+                return "pg_put_copy_data_failed - PQputCopyData function failed";
+            case pg_put_copy_end_failed:
+                return "pg_put_copy_end_failed - PQputCopyEnd function failed";
+            case pg_get_copy_data_failed:
+                return "pg_get_copy_data_failed - PQgetCopyData function failed";
+            case bad_copy_data:
+                return "binary COPY data received does not match the format or the row type";
+            case pool_queue_overflow:
+                return "connection pool wait queue is full";
+            case pool_deadline_too_close:
+                return "time left to the deadline is less than the median time of connection usage";
+            case pool_draining:
+                return "connection pool is drained and does not hand out connections";
+            case circuit_breaker_open:
+                return "circuit breaker is open and rejects connection attempts";
+            case pg_set_rows_mode_failed:
+                return "pg_set_rows_mode_failed - PQsetSingleRowMode or PQsetChunkedRowsMode function failed";
         }
         return "no message for value: " + std::to_string(value);
     }
@@ -885,7 +930,16 @@ struct codes_for_condition<connection_error> {
         ozo::error::pg_send_query_params_failed,
         ozo::error::pg_consume_input_failed,
         ozo::error::pg_set_nonblocking_failed,
-        ozo::error::pg_flush_failed
+        ozo::error::pg_flush_failed,
+        ozo::error::pg_pipeline_sync_failed,
+        ozo::error::pg_send_query_prepared_failed,
+        ozo::error::pg_send_prepare_failed,
+        ozo::error::pg_send_query_failed,
+        ozo::error::pg_put_copy_data_failed,
+        ozo::error::pg_put_copy_end_failed,
+        ozo::error::pg_get_copy_data_failed,
+        ozo::error::circuit_breaker_open,
+        ozo::error::pg_set_rows_mode_failed
     );
 };
 
@@ -902,6 +956,7 @@ struct codes_for_condition<introspection_error> {
         ozo::error::bad_array_size,
         ozo::error::bad_array_dimension,
         ozo::error::bad_composite_size,
+        ozo::error::bad_copy_data,
         ozo::error::unexpected_eof
     );
 };
@@ -918,7 +973,9 @@ struct codes_for_condition<protocol_error> {
         ozo::error::result_status_unexpected,
         ozo::error::result_status_empty_query,
         ozo::error::result_status_bad_response,
-        ozo::error::oid_request_failed
+        ozo::error::oid_request_failed,
+        ozo::error::pg_enter_pipeline_mode_failed,
+        ozo::error::pg_exit_pipeline_mode_failed
     );
 };
 
@@ -0,0 +1,707 @@
+#pragma once
+
+#include <ozo/failover/latency_aware.h>
+#include <ozo/cancel.h>
+#include <ozo/core/concept.h>
+
+#include <boost/asio/post.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+#include <array>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+
+/**
+ * @defgroup group-failover-hedged Hedged Requests
+ * @ingroup group-failover
+ * @brief Failover operation by a duplicate try on another host
+ *
+ * This type of failover strategy is dedicated to the tail latency of read operations on a set
+ * of equivalent hosts, e.g. replicas. An operation is started on the best host, and if it is
+ * not completed within the hedge delay, e.g. the observed 95th percentile of the latency, the
+ * duplicate try is started on another host. The first successful try wins and the query of
+ * the other one is canceled on the server side via `ozo::cancel()`.
+ *
+ * The strategy is implemented via `ozo::failover::hedged_strategy` class and can be
+ * instantiated via `ozo::failover::hedged` function. Like `ozo::failover::latency_aware_strategy`
+ * it works only with `ozo::failover::latency_aware_connection_provider` and shares the statistics
+ * of the hosts with it.
+ */
+
+namespace ozo::failover {
+
+/**
+ * @brief Options for hedged requests
+ *
+ * These options can be used with `ozo::failover::hedged_strategy`.
+ * @ingroup group-failover-hedged
+ */
+struct hedged_options {
+    class delay_tag;
+    class conditions_tag;
+    class on_hedge_tag;
+    class cancel_timeout_tag;
+
+    constexpr static option<delay_tag> delay{}; //!< Set delay of the duplicate try, `ozo::time_traits::duration` or a callable which returns it.
+    constexpr static option<conditions_tag> conditions{}; //!< Set error conditions to start the duplicate try immediately.
+    constexpr static option<on_hedge_tag> on_hedge{}; //!< Set handler for hedge event, called with index of the host of the duplicate try, may be useful for logging.
+    constexpr static option<cancel_timeout_tag> cancel_timeout{}; //!< Set time constraint of the cancel of the loser's query, `ozo::time_traits::duration`, 1 second by default.
+};
+
+namespace detail {
+
+/**
+ * Argument of an operation try. Since both of the tries are running concurrently the output
+ * of an operation, `ozo::into()` of a container or of an `ozo::result`, is buffered by each
+ * try and is moved to the user's output by the winner only. Other outputs can not be buffered
+ * and are rejected, other arguments are passed as is.
+ */
+template <typename T>
+class hedged_arg {
+    static_assert(!OutputIterator<T> && !ForwardIterator<T>,
+        "hedged operation output should be ozo::into() of a container or of an ozo::result, "
+        "other output iterators would be written by both of the tries");
+
+public:
+    explicit hedged_arg(const T& value) : value_(value) {}
+
+    const T& get() const noexcept { return value_;}
+
+    void commit() {}
+
+private:
+    T value_;
+};
+
+template <typename Container>
+class hedged_arg<std::back_insert_iterator<Container>> {
+public:
+    explicit hedged_arg(const std::back_insert_iterator<Container>& out)
+    : out_(out), buffer_(std::make_unique<Container>()) {}
+
+    auto get() const { return std::back_inserter(*buffer_);}
+
+    void commit() { std::move(std::begin(*buffer_), std::end(*buffer_), out_);}
+
+private:
+    std::back_insert_iterator<Container> out_;
+    std::unique_ptr<Container> buffer_;
+};
+
+template <typename T>
+class hedged_arg<std::reference_wrapper<T>> {
+public:
+    explicit hedged_arg(const std::reference_wrapper<T>& out)
+    : out_(out), buffer_(std::make_unique<T>()) {}
+
+    auto get() const { return std::ref(*buffer_);}
+
+    void commit() { out_.get() = std::move(*buffer_);}
+
+private:
+    std::reference_wrapper<T> out_;
+    std::unique_ptr<T> buffer_;
+};
+
+template <typename ...Ts>
+inline auto make_hedged_args(const hana::tuple<Ts...>& args) {
+    return hana::transform(args, [] (const auto& arg) {
+        return hedged_arg<std::decay_t<decltype(arg)>>(arg);
+    });
+}
+
+} // namespace detail
+
+template <typename Connection>
+struct get_hedged_canceller_impl {
+    static auto apply(const Connection& conn) {
+        return [handle = get_cancel_handle(conn)] (io_context& io, time_traits::duration timeout) mutable {
+            ozo::cancel(std::move(handle), io, timeout, [] (error_code, std::string) {});
+        };
+    }
+};
+
+/**
+ * @brief Get a canceller of the query of a try
+ *
+ * The canceller is obtained when the try gets a connection and is called once if the try
+ * loses the race. By default it cancels the query via `ozo::get_cancel_handle()` and
+ * `ozo::cancel()` on the `boost::asio::system_executor`, since the libpq's cancel operation
+ * is synchronous. The wait for the cancel is limited by the time constraint on the `io_context`
+ * of the operation.
+ *
+ * @param conn --- `Connection` of the try.
+ * @return callable object with signature `void(ozo::io_context&, ozo::time_traits::duration)`.
+ *
+ * ###Customization Point
+ *
+ * This function may be customized for a `Connection` via specialization
+ * of `ozo::failover::get_hedged_canceller_impl`.
+ * @ingroup group-failover-hedged
+ */
+template <typename Connection>
+inline auto get_hedged_canceller(const Connection& conn) {
+    return get_hedged_canceller_impl<Connection>::apply(conn);
+}
+
+/**
+ * @brief Operation try of the hedged strategy
+ *
+ * The try is bound to the best host among the hosts which have not been tried by the operation yet.
+ * It buffers the output of the operation, see `ozo::failover::hedged_try::commit()`. The latency
+ * and the result of the try are recorded to the host statistics on its completion.
+ *
+ * @tparam Options --- map of `ozo::failover::hedged_options`.
+ * @tparam Context --- operation context, compartible with `ozo::failover::basic_context`.
+ * @ingroup group-failover-hedged
+ */
+template <typename Options, typename Context>
+class hedged_try {
+    using op = hedged_options;
+    using mask_type = detail::host_latency_stats::mask_type;
+    using args_type = decltype(detail::make_hedged_args(ozo::unwrap(std::declval<const Context&>()).args));
+
+    Context ctx_;
+    Options options_;
+    std::size_t host_;
+    mask_type tried_;
+    time_traits::time_point start_;
+    args_type args_;
+
+    hedged_try(Options options, Context ctx, std::size_t host, mask_type tried)
+    : ctx_(std::move(ctx)), options_(std::move(options)), host_(host),
+      tried_(tried | (mask_type(1) << host)), start_(time_traits::now()),
+      args_(detail::make_hedged_args(ozo::unwrap(ctx_).args)) {}
+
+    decltype(auto) source() const {
+        return ozo::unwrap(ctx_).provider.source();
+    }
+
+    detail::host_latency_stats& host_stats() const {
+        return source().host_stats();
+    }
+
+public:
+    using connection_type = typename std::decay_t<decltype(ozo::unwrap(std::declval<const Context&>()).provider)>::connection_type;
+
+    /**
+     * @brief Construct the first try object.
+     *
+     * @param options --- map of `ozo::failover::hedged_options`.
+     * @param ctx --- operation context, compartible with `ozo::failover::basic_context`
+     */
+    hedged_try(Options options, Context ctx)
+    : hedged_try(std::move(options), std::move(ctx), 0, 0) {
+        static_assert(decltype(hana::is_a<hana::map_tag>(options_))::value, "Options should be boost::hana::map");
+        host_ = *source().select(0);
+        tried_ = mask_type(1) << host_;
+    }
+
+    hedged_try(const hedged_try&) = delete;
+    hedged_try(hedged_try&&) = default;
+    hedged_try& operator = (const hedged_try&) = delete;
+    hedged_try& operator = (hedged_try&&) = default;
+
+    constexpr const Options& options() const { return options_;}
+    constexpr Options& options() { return options_;}
+
+    /**
+     * Index of the host the try is bound to.
+     */
+    std::size_t host() const noexcept { return host_;}
+
+    /**
+     * Get the `io_context` of the operation.
+     */
+    io_context& get_io_context() const noexcept { return ozo::unwrap(ctx_).provider.get_io_context();}
+
+    /**
+     * @brief Get the operation context.
+     *
+     * @return `boost::hana::tuple` --- operation initiation context for the try with the provider
+     *                  bound to the host of the try, the operation time constraint and the
+     *                  output of the operation replaced with the buffer of the try.
+     */
+    auto get_context() const {
+        return hana::concat(
+            hana::make_tuple(ozo::unwrap(ctx_).provider.rebind_host(host_), ozo::unwrap(ctx_).time_constraint),
+            hana::transform(args_, [] (const auto& arg) { return arg.get();})
+        );
+    }
+
+    /**
+     * Records the latency and the result of the try to the host statistics,
+     * see `ozo::failover::complete_try()`.
+     *
+     * @param ec --- error code of the try.
+     */
+    void complete(const error_code& ec) {
+        host_stats().complete(host_, time_traits::now() - start_, ec);
+    }
+
+    /**
+     * Releases the try in the host statistics without recording its result. It is called
+     * for the try which has failed after the race is over, since its failure is caused by
+     * the cancel of the query rather than by the host.
+     */
+    void abandon() {
+        host_stats().release(host_);
+    }
+
+    /**
+     * Moves the buffered output of the try to the output of the operation. It should be
+     * called for the try which wins the race only.
+     */
+    void commit() {
+        hana::for_each(args_, [] (auto& arg) { arg.commit();});
+    }
+
+    /**
+     * @brief Delay of the duplicate try
+     *
+     * @return `time_traits::duration` --- value of `ozo::failover::hedged_options::delay`.
+     */
+    time_traits::duration delay() const {
+        const auto& value = get_option(options(), op::delay);
+        if constexpr (std::is_invocable_v<decltype(value)>) {
+            return time_traits::duration(value());
+        } else {
+            return time_traits::duration(value);
+        }
+    }
+
+    /**
+     * @brief Time constraint of the cancel of the query of the try if it loses the race
+     *
+     * @return `time_traits::duration` --- value of `ozo::failover::hedged_options::cancel_timeout`.
+     */
+    time_traits::duration cancel_timeout() const {
+        return time_traits::duration(get_option(options(), op::cancel_timeout, default_cancel_timeout_));
+    }
+
+    /**
+     * @brief Get the duplicate try
+     *
+     * The duplicate try is bound to the best host among the hosts which have not been tried yet.
+     * The hosts with open circuits are skipped, see `ozo::is_circuit_open()`.
+     *
+     * @return `std::optional<hedged_try>` --- initialized with the try object if there is a host left to try.
+     * @return `std::nullopt` --- otherwise.
+     */
+    std::optional<hedged_try> get_hedge() const {
+        std::optional<hedged_try> retval;
+        if (const auto host = host_stats().select(tried_ | source().open_hosts())) {
+            get_option(options(), op::on_hedge, [](auto&&...){})(*host);
+            retval.emplace(hedged_try{options_, ctx_, *host, tried_});
+        }
+        return retval;
+    }
+
+    /**
+     * @brief Check if the duplicate try should be started immediately
+     *
+     * @param ec --- error code of the try.
+     * @return `true` --- if `ec` matches `ozo::failover::hedged_options::conditions`.
+     * @return `false` --- otherwise.
+     */
+    bool can_hedge([[maybe_unused]] error_code ec) const {
+        if constexpr (decltype(hana::is_empty(get_conditions()))::value) {
+            return false;
+        } else {
+            return errc::match_code(get_conditions(), ec);
+        }
+    }
+
+    /**
+     * @brief Error conditions to start the duplicate try immediately
+     *
+     * @return auto --- `boost::hana::tuple` of error conditions.
+     */
+    constexpr decltype(auto) get_conditions() const {
+        return get_option(options(), op::conditions, no_conditions_);
+    }
+
+private:
+    constexpr static const auto no_conditions_ = hana::make_tuple();
+    constexpr static const time_traits::duration default_cancel_timeout_ = std::chrono::seconds(1);
+};
+
+namespace detail {
+
+template <typename Race>
+struct hedged_leg_handler {
+    std::shared_ptr<Race> race_;
+    std::size_t index_;
+
+    template <typename Connection>
+    void operator() (error_code ec, Connection&& conn) const {
+        race_->complete(index_, std::move(ec), std::forward<Connection>(conn));
+    }
+
+    using executor_type = typename Race::executor_type;
+
+    executor_type get_executor() const { return race_->get_executor();}
+
+    using allocator_type = typename Race::allocator_type;
+
+    allocator_type get_allocator() const { return race_->get_allocator();}
+};
+
+template <typename Handler, typename Race>
+struct hedged_connection_handler {
+    Handler handler_;
+    std::shared_ptr<Race> race_;
+    std::size_t index_;
+
+    template <typename Connection>
+    void operator() (error_code ec, Connection&& conn) {
+        // The try which gets a connection after the race is over should not send its query.
+        if (!ec && !race_->connected(index_, conn)) {
+            ec = asio::error::operation_aborted;
+        }
+        handler_(std::move(ec), std::forward<Connection>(conn));
+    }
+
+    using executor_type = asio::associated_executor_t<Handler>;
+
+    executor_type get_executor() const { return asio::get_associated_executor(handler_);}
+
+    using allocator_type = asio::associated_allocator_t<Handler>;
+
+    allocator_type get_allocator() const { return asio::get_associated_allocator(handler_);}
+};
+
+/**
+ * `ConnectionProvider` of a try which tells the race about the connection of the try,
+ * so the query of the try can be canceled if the other try wins.
+ */
+template <typename Provider, typename Race>
+class hedged_leg_provider {
+public:
+    using connection_type = typename connection_provider_traits<Provider>::connection_type;
+
+    hedged_leg_provider(Provider provider, std::shared_ptr<Race> race, std::size_t index)
+    : provider_(std::move(provider)), race_(std::move(race)), index_(index) {}
+
+    template <typename TimeConstraint, typename Handler>
+    void async_get_connection(TimeConstraint t, Handler&& h) const {
+        ozo::async_get_connection(provider_, t,
+            hedged_connection_handler<std::decay_t<Handler>, Race>{std::forward<Handler>(h), race_, index_});
+    }
+
+private:
+    Provider provider_;
+    std::shared_ptr<Race> race_;
+    std::size_t index_;
+};
+
+/**
+ * Race of the first try and the duplicate one. The duplicate try is started by the timer
+ * or by the failure of the first try with one of the hedge conditions. The first successful
+ * try wins, and the operation is completed with an error only if both of the tries have failed.
+ */
+template <typename Operation, typename Try, typename Handler>
+class hedged_race : public std::enable_shared_from_this<hedged_race<Operation, Try, Handler>> {
+public:
+    using executor_type = asio::associated_executor_t<Handler>;
+    using allocator_type = asio::associated_allocator_t<Handler>;
+    using connection_type = typename Try::connection_type;
+
+    hedged_race(const Operation& op, Try first_try, Handler handler)
+    : op_(op), handler_(std::move(handler)),
+      executor_(asio::get_associated_executor(handler_)),
+      allocator_(asio::get_associated_allocator(handler_)),
+      timer_(first_try.get_io_context()) {
+        legs_[0].try_.emplace(std::move(first_try));
+    }
+
+    executor_type get_executor() const { return executor_;}
+
+    allocator_type get_allocator() const { return allocator_;}
+
+    void start() {
+        timer_.expires_after(legs_[0].try_->delay());
+        timer_.async_wait([self = this->shared_from_this()] (error_code ec) {
+            if (!ec) {
+                self->hedge();
+            }
+        });
+        initiate(0);
+    }
+
+    template <typename Connection>
+    bool connected(std::size_t index, const Connection& conn) {
+        const std::lock_guard lock(mutex_);
+        if (finished_) {
+            return false;
+        }
+        legs_[index].canceller_.emplace(get_hedged_canceller(conn));
+        return true;
+    }
+
+    template <typename Connection>
+    void complete(std::size_t index, error_code ec, Connection&& conn) {
+        std::unique_lock lock(mutex_);
+        auto& leg = legs_[index];
+        auto& other = legs_[1 - index];
+        leg.done_ = true;
+        leg.canceller_.reset();
+
+        if (finished_ && ec) {
+            leg.try_->abandon();
+        } else {
+            leg.try_->complete(ec);
+        }
+
+        if (finished_) {
+            // The query of the loser has been canceled, the connection may be still busy with it
+            // and it should not be reused.
+            auto guard = defer_close_connection(leg.canceled_ ? std::addressof(conn) : nullptr);
+            return;
+        }
+
+        const bool other_running = other.try_ && !other.done_;
+        if (ec) {
+            if (other_running) {
+                auto guard = defer_close_connection(std::addressof(conn));
+                return;
+            }
+            if (!other.try_ && leg.try_->can_hedge(ec) && emplace_hedge()) {
+                cancel_timer();
+                lock.unlock();
+                auto guard = defer_close_connection(std::addressof(conn));
+                initiate(1);
+                return;
+            }
+        } else {
+            leg.try_->commit();
+        }
+
+        finished_ = true;
+        cancel_timer();
+        std::optional<canceller_type> canceller;
+        if (other_running && other.canceller_) {
+            canceller.emplace(std::move(*other.canceller_));
+            other.canceller_.reset();
+            other.canceled_ = true;
+        }
+        lock.unlock();
+
+        if (canceller) {
+            (*canceller)(other.try_->get_io_context(), other.try_->cancel_timeout());
+        }
+        handler_(std::move(ec), std::forward<Connection>(conn));
+    }
+
+private:
+    using canceller_type = decltype(get_hedged_canceller(std::declval<const connection_type&>()));
+
+    struct leg {
+        std::optional<Try> try_;
+        std::optional<canceller_type> canceller_;
+        bool done_ = false;
+        bool canceled_ = false;
+    };
+
+    // The leg's handler may be called on any thread, so the timer is canceled
+    // within its own executor.
+    void cancel_timer() {
+        asio::post(timer_.get_executor(), [self = this->shared_from_this()] {
+            self->timer_.cancel();
+        });
+    }
+
+    bool emplace_hedge() {
+        if (finished_ || legs_[1].try_) {
+            return false;
+        }
+        auto hedge = legs_[0].try_->get_hedge();
+        if (!hedge) {
+            return false;
+        }
+        legs_[1].try_.emplace(std::move(*hedge));
+        return true;
+    }
+
+    void hedge() {
+        std::unique_lock lock(mutex_);
+        if (emplace_hedge()) {
+            lock.unlock();
+            initiate(1);
+        }
+    }
+
+    void initiate(std::size_t index) {
+        hana::unpack(get_try_context(*legs_[index].try_), [&] (auto&& provider, auto&& ...args) {
+            ozo::get_operation_initiator(op_)(
+                hedged_leg_handler<hedged_race>{this->shared_from_this(), index},
+                hedged_leg_provider<std::decay_t<decltype(provider)>, hedged_race>{
+                    std::forward<decltype(provider)>(provider), this->shared_from_this(), index
+                },
+                std::forward<decltype(args)>(args)...
+            );
+        });
+    }
+
+    Operation op_;
+    Handler handler_;
+    executor_type executor_;
+    allocator_type allocator_;
+    asio::steady_timer timer_;
+    std::mutex mutex_;
+    std::array<leg, 2> legs_;
+    bool finished_ = false;
+};
+
+template <typename FailoverStrategy, typename Operation>
+struct hedged_operation_initiator {
+    FailoverStrategy strategy_;
+    Operation op_;
+
+    constexpr hedged_operation_initiator(FailoverStrategy strategy, const Operation& op)
+    : strategy_(std::move(strategy)), op_(op) {}
+
+    template <typename Handler, typename ...Args>
+    void operator() (Handler&& handler, Args&& ...args) const {
+        const auto allocator = asio::get_associated_allocator(handler);
+        auto first_try = get_first_try(op_, strategy_, allocator, std::forward<Args>(args)...);
+        using race_type = hedged_race<Operation, decltype(first_try), std::decay_t<Handler>>;
+        std::allocate_shared<race_type>(allocator, op_, std::move(first_try), std::forward<Handler>(handler))->start();
+    }
+};
+
+} // namespace detail
+
+/**
+ * @brief Hedged strategy
+ *
+ * Hedged strategy is a factory for `ozo::failover::hedged_try` objects. This class is
+ * an options' factory (see `ozo::options_factory_base`), it accepts `ozo::failover::hedged_options`.
+ *
+ * @ingroup group-failover-hedged
+ */
+template <typename Options = decltype(hana::make_map())>
+class hedged_strategy : public ozo::options_factory_base<hedged_strategy<Options>, Options> {
+    using op = hedged_options;
+
+    friend class ozo::options_factory_base<hedged_strategy<Options>, Options>;
+    using base = ozo::options_factory_base<hedged_strategy<Options>, Options>;
+
+    template <typename OtherOptions>
+    constexpr static auto rebind_options(OtherOptions&& options) {
+        return hedged_strategy<std::decay_t<OtherOptions>>(std::forward<OtherOptions>(options));
+    }
+
+public:
+    /**
+     * @brief Construct a new hedged strategy object
+     *
+     * @param options --- `boost::hana::map` of `ozo::failover::hedged_options` and values.
+     */
+    constexpr hedged_strategy(Options options = Options{}) : base(std::move(options)) {
+        static_assert(decltype(hana::is_a<hana::map_tag>(options))::value, "Options should be boost::hana::map");
+    }
+
+    template <typename Operation, typename Allocator, typename Source,
+            typename TimeConstraint, typename ...Args>
+    auto get_first_try(const Operation&, const Allocator&,
+            latency_aware_connection_provider<Source> provider, TimeConstraint t, Args&& ...args) const {
+
+        static_assert(decltype(this->has(op::delay))::value, "delay of the duplicate try should be specified");
+
+        return hedged_try {
+            this->options(),
+            basic_context{std::move(provider), ozo::deadline(t), std::forward<Args>(args)...}
+        };
+    }
+
+    /**
+     * @brief Specify delay of the duplicate try
+     *
+     * @param d --- `ozo::time_traits::duration` or a callable which returns it, e.g. the
+     *              observed 95th percentile of the operation latency.
+     * @return `hedged_strategy` specialization object
+     */
+    template <typename Delay>
+    constexpr decltype(auto) delay(Delay d) const & { return this->set(op::delay, std::move(d));}
+    template <typename Delay>
+    constexpr decltype(auto) delay(Delay d) && { return std::move(*this).set(op::delay, std::move(d));}
+
+    /**
+     * @brief Specify time constraint of the cancel of the loser's query
+     *
+     * @param t --- `ozo::time_traits::duration` to wait for the cancel.
+     * @return `hedged_strategy` specialization object
+     */
+    constexpr decltype(auto) cancel_timeout(time_traits::duration t) const & { return this->set(op::cancel_timeout, t);}
+    constexpr decltype(auto) cancel_timeout(time_traits::duration t) && { return std::move(*this).set(op::cancel_timeout, t);}
+};
+
+/**
+ * Try an operation on the best current host and start its duplicate on another host after the delay.
+ *
+ * The first try is bound to the best host like a try of `ozo::failover::latency_aware()`. If it is not
+ * completed within the delay or it fails with one of the specified error conditions, the duplicate try
+ * is started on the best of the other hosts. Both tries are limited by the operation time constraint.
+ * The first successful try wins, its output is moved to the output of the operation and the query of
+ * the other try is canceled on the server side. If the winner is found before the other try gets its
+ * connection, the other try is aborted with `boost::asio::error::operation_aborted` without a query.
+ *
+ * @param delay --- `ozo::time_traits::duration` or a callable which returns it, e.g. the observed 95th
+ *                  percentile of the operation latency.
+ * @param ec --- variadic of error conditions to start the duplicate try immediately.
+ * @return `ozo::failover::hedged_strategy` specialization.
+ *
+ * @note This strategy works only with `ozo::failover::latency_aware_connection_provider`
+ * `ConnectionProvider` implementation.
+ *
+ * @note The output of the operation is buffered by each try, so it should be `ozo::into()` of a container
+ * or of an `ozo::result`. Other output iterators can not be buffered and are rejected at compile time.
+ *
+ * @note Since the loser is canceled via `ozo::cancel()`, the strategy should be used for the
+ * read-only operations without external connection poolers, see the notes for `ozo::cancel()`.
+ *
+ * ###Example
+ *
+ * Start the duplicate request on another replica if it takes more than 20ms.
+ *
+ * @code
+auto replicas = ozo::failover::make_latency_aware_connection_source(std::vector{
+    ozo::connection_info(cfg.replica_dc1_connstr),
+    ozo::connection_info(cfg.replica_dc2_connstr),
+});
+
+//...
+
+auto strategy = failover::hedged(20ms, errc::connection_error);
+ozo::request[strategy](replicas[io], query, .5s, out, yield);
+ * @endcode
+ *
+ * @sa `ozo::failover::hedged_strategy`, `ozo::failover::latency_aware_connection_source`
+ * @ingroup group-failover-hedged
+ */
+template <typename Delay, typename ...ErrorConditions>
+constexpr auto hedged(Delay delay, ErrorConditions ...ec) {
+    if constexpr (sizeof...(ec) != 0) {
+        return hedged_strategy{}.delay(std::move(delay)).set(hedged_options::conditions=hana::make_tuple(ec...));
+    } else {
+        return hedged_strategy{}.delay(std::move(delay));
+    }
+}
+
+} // namespace ozo::failover
+
+namespace ozo {
+
+template <typename ...Ts, typename Op>
+struct construct_initiator_impl<failover::hedged_strategy<Ts...>, Op> {
+    template <typename FailoverStrategy>
+    constexpr static auto apply(FailoverStrategy&& strategy, const Op& op) {
+        return failover::detail::hedged_operation_initiator(std::forward<FailoverStrategy>(strategy), op);
+    }
+};
+
+} // namespace ozo
@@ -0,0 +1,648 @@
+#pragma once
+
+#include <ozo/failover/strategy.h>
+#include <ozo/failover/retry.h>
+#include <ozo/core/options.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+/**
+ * @defgroup group-failover-latency_aware Latency-Aware Host Selection
+ * @ingroup group-failover
+ * @brief Failover operation by the best host selection
+ *
+ * This type of failover strategy is dedicated to a set of equivalent hosts, e.g. replicas
+ * in several data centers. Each try of an operation is sent to the best current candidate
+ * host instead of the first one in a fixed order. The hosts are compared by the moving
+ * averages of the try latency and the error rate which are collected by the strategy.
+ *
+ * The strategy is implemented via `ozo::failover::latency_aware_strategy` class and can be
+ * instantiated via `ozo::failover::latency_aware` function. It works only with
+ * `ozo::failover::latency_aware_connection_provider` which is obtained from
+ * `ozo::failover::latency_aware_connection_source`.
+ */
+
+namespace ozo::failover {
+
+/**
+ * @brief Configuration of the latency-aware host selection
+ * @ingroup group-failover-latency_aware
+ */
+struct latency_aware_config {
+    double decay = 0.2; //!< weight of a new sample in the moving averages of the latency and the error rate
+    time_traits::duration error_penalty = std::chrono::seconds(1); //!< cost of a failed try which is added to the latency in proportion to the error rate
+};
+
+/**
+ * @brief Statistics of a host of the `ozo::failover::latency_aware_connection_source`
+ * @ingroup group-failover-latency_aware
+ */
+struct latency_aware_host_stats {
+    time_traits::duration latency {}; //!< moving average of the successful try latency
+    double error_rate = 0; //!< moving average of the try error rate
+    std::size_t in_flight = 0; //!< number of tries which are in progress
+};
+
+namespace detail {
+
+/**
+ * Moving averages of the try latency and the error rate of hosts, shared by copies of
+ * a `latency_aware_connection_source`. A host is selected by the power of two choices:
+ * two random candidates are compared by the expected cost and the cheapest one wins,
+ * so the load is spread between similar hosts while slow and failing ones get less of it.
+ * The expected cost of a host is its latency multiplied by the number of its tries in
+ * progress plus one, and the error penalty multiplied by its error rate. A host without
+ * samples costs nothing, so it is tried as soon as possible.
+ */
+class host_latency_stats {
+public:
+    using mask_type = std::uint64_t;
+
+    static constexpr std::size_t max_hosts = 64;
+
+    host_latency_stats(std::size_t hosts, const latency_aware_config& config)
+    : config_(config), hosts_(hosts), random_(std::random_device{}()) {}
+
+    std::size_t size() const noexcept { return hosts_.size();}
+
+    /**
+     * Selects a host which is not in the excluded mask.
+     *
+     * @param excluded --- mask of hosts to skip, e.g. the hosts which have been tried already.
+     * @param track --- count the try as in progress until `complete()` is called.
+     * @return std::optional<std::size_t> --- index of the host or `std::nullopt` if all the hosts are excluded.
+     */
+    std::optional<std::size_t> select(mask_type excluded, bool track = true) {
+        const std::lock_guard lock(mutex_);
+        std::size_t candidates[max_hosts];
+        std::size_t count = 0;
+        for (std::size_t i = 0; i != hosts_.size(); ++i) {
+            if (!(excluded & (mask_type(1) << i))) {
+                candidates[count++] = i;
+            }
+        }
+        if (count == 0) {
+            return std::nullopt;
+        }
+        auto result = candidates[0];
+        if (count > 1) {
+            std::uniform_int_distribution<std::size_t> distribution(0, count - 1);
+            const auto first = distribution(random_);
+            auto second = distribution(random_);
+            while (second == first) {
+                second = distribution(random_);
+            }
+            result = cost(candidates[second]) < cost(candidates[first]) ? candidates[second] : candidates[first];
+        }
+        if (track) {
+            ++hosts_[result].in_flight;
+        }
+        return result;
+    }
+
+    /**
+     * Records the result of a try which was tracked by `select()`.
+     */
+    void complete(std::size_t host, time_traits::duration latency, const error_code& ec) {
+        const std::lock_guard lock(mutex_);
+        auto& stats = hosts_[host];
+        stats.in_flight -= std::min<std::size_t>(stats.in_flight, 1);
+        stats.error_rate += config_.decay * ((ec ? 1.0 : 0.0) - stats.error_rate);
+        // A fast failure says nothing about the host latency, so only successful tries are averaged.
+        if (!ec) {
+            stats.latency = stats.samples++ == 0 ? latency : stats.latency + std::chrono::duration_cast<time_traits::duration>(
+                config_.decay * (latency - stats.latency));
+        }
+    }
+
+    /**
+     * Releases a try which was tracked by `select()` without recording its result,
+     * e.g. if the try has been abandoned by the operation.
+     */
+    void release(std::size_t host) {
+        const std::lock_guard lock(mutex_);
+        auto& stats = hosts_[host];
+        stats.in_flight -= std::min<std::size_t>(stats.in_flight, 1);
+    }
+
+    latency_aware_host_stats stats(std::size_t host) const {
+        const std::lock_guard lock(mutex_);
+        const auto& stats = hosts_[host];
+        return {stats.latency, stats.error_rate, stats.in_flight};
+    }
+
+private:
+    struct host_type : latency_aware_host_stats {
+        std::size_t samples = 0;
+    };
+
+    double cost(std::size_t host) const {
+        const auto& stats = hosts_[host];
+        return double(stats.latency.count()) * double(stats.in_flight + 1)
+            + double(config_.error_penalty.count()) * stats.error_rate;
+    }
+
+    latency_aware_config config_;
+    mutable std::mutex mutex_;
+    std::vector<host_type> hosts_;
+    std::minstd_rand random_;
+};
+
+} // namespace detail
+
+/**
+ * `ConnectionProvider` implementation for the latency-aware failover strategy.
+ *
+ * This is the latency-aware implementation of the `ConnectionProvider` concept. It binds
+ * `io_context` to the `ozo::failover::latency_aware_connection_source` and may be bound to
+ * a certain host of the source via `rebind_host()`. If the provider is not bound to a host,
+ * the best host is selected for each connection.
+ *
+ * @tparam Source --- `ConnectionSource` implementation of a host
+ * @ingroup group-failover-latency_aware
+ * @models{ConnectionProvider}
+ */
+template <typename Source>
+class latency_aware_connection_provider;
+
+/**
+ * @brief Connection source which selects the best of equivalent hosts
+ *
+ * The source contains connection sources of equivalent hosts, e.g. `ozo::connection_pool` objects
+ * for replicas in different data centers. Copies of the source share the statistics of the hosts,
+ * so they should be copied from a single source object. Being used as a plain `ConnectionSource`
+ * it selects the best host by the current statistics for each connection. The statistics are
+ * collected by the `ozo::failover::latency_aware_strategy`.
+ *
+ * @tparam Source --- `ConnectionSource` implementation of a host.
+ * @sa `ozo::failover::make_latency_aware_connection_source()`
+ * @ingroup group-failover-latency_aware
+ * @models{ConnectionSource}
+ */
+template <typename Source>
+class latency_aware_connection_source {
+public:
+    static_assert(ozo::ConnectionSource<Source>, "Source should model a ConnectionSource concept");
+
+    /**
+     * `Connection` implementation type according to `ConnectionSource` requirements.
+     * Specifies the `Connection` implementation type which can be obtained from this source.
+     */
+    using connection_type = typename connection_source_traits<Source>::connection_type;
+
+    /**
+     * Construct a new source object.
+     *
+     * @param hosts --- connection sources of the hosts, no more than 64 hosts.
+     * @param config --- configuration of the host selection.
+     */
+    explicit latency_aware_connection_source(std::vector<Source> hosts, const latency_aware_config& config = {})
+    : hosts_(std::make_shared<std::vector<Source>>(std::move(hosts))) {
+        if (hosts_->empty() || hosts_->size() > detail::host_latency_stats::max_hosts) {
+            throw std::invalid_argument("number of hosts should be from 1 to 64");
+        }
+        stats_ = std::make_shared<detail::host_latency_stats>(hosts_->size(), config);
+    }
+
+    /**
+     * Get the number of hosts.
+     */
+    std::size_t size() const noexcept { return hosts_->size();}
+
+    /**
+     * Get the connection source of the host. The host sources are shared by
+     * copies of the source, so a host may be e.g. a non-copyable `ozo::connection_pool`.
+     */
+    Source& host(std::size_t index) const { return (*hosts_)[index];}
+
+    /**
+     * Get the statistics of the host.
+     */
+    latency_aware_host_stats stats(std::size_t index) const { return stats_->stats(index);}
+
+    detail::host_latency_stats& host_stats() const noexcept { return *stats_;}
+
+    /**
+     * Get the mask of the hosts which reject connection attempts by an open circuit breaker,
+     * see `ozo::is_circuit_open()`. Such hosts are skipped by the host selection.
+     */
+    detail::host_latency_stats::mask_type open_hosts() const {
+        detail::host_latency_stats::mask_type result = 0;
+        for (std::size_t i = 0; i != size(); ++i) {
+            if (ozo::is_circuit_open(host(i))) {
+                result |= detail::host_latency_stats::mask_type(1) << i;
+            }
+        }
+        return result;
+    }
+
+    /**
+     * Selects the best host among the hosts which are not excluded and have no open circuit.
+     * If all of them have open circuits, the best of them is selected anyway since there is
+     * nothing better to try.
+     */
+    std::optional<std::size_t> select(detail::host_latency_stats::mask_type excluded, bool track = true) const {
+        if (const auto index = stats_->select(excluded | open_hosts(), track)) {
+            return index;
+        }
+        return stats_->select(excluded, track);
+    }
+
+    template <typename TimeConstraint, typename Handler>
+    void operator() (io_context& io, TimeConstraint t, Handler&& h) const {
+        const auto index = select(0, false);
+        host(*index)(io, std::move(t), std::forward<Handler>(h));
+    }
+
+    auto operator[] (io_context& io) const {
+        return latency_aware_connection_provider<Source>(*this, io);
+    }
+
+private:
+    std::shared_ptr<std::vector<Source>> hosts_;
+    std::shared_ptr<detail::host_latency_stats> stats_;
+};
+
+template <typename Source>
+class latency_aware_connection_provider {
+public:
+    using source_type = latency_aware_connection_source<Source>; //!< Source type according to `ConnectionProvider` requirements
+
+    /**
+     * `Connection` implementation type according to `ConnectionProvider` requirements.
+     * Specifies the `Connection` implementation type which can be obtained from this provider.
+     */
+    using connection_type = typename source_type::connection_type;
+
+    /**
+     * Construct a new provider object which is not bound to a host
+     *
+     * @param source --- source of the hosts.
+     * @param io --- `io_context` for asynchronous IO.
+     */
+    latency_aware_connection_provider(source_type source, io_context& io)
+    : source_(std::move(source)), io_(io) {}
+
+    /**
+     * @brief Rebind the `ConnectionProvider` to a host
+     *
+     * @param index --- index of the host in the source.
+     * @return new `ConnectionProvider` object
+     */
+    latency_aware_connection_provider rebind_host(std::size_t index) const {
+        return {source_, io_, index};
+    }
+
+    /**
+     * Get the source of the hosts.
+     */
+    const source_type& source() const noexcept { return source_;}
+
+    /**
+     * Get the host the provider is bound to, if any.
+     */
+    std::optional<std::size_t> host() const noexcept { return host_;}
+
+    /**
+     * Get the `io_context` the provider is bound to.
+     */
+    io_context& get_io_context() const noexcept { return io_;}
+
+    template <typename TimeConstraint, typename Handler>
+    void async_get_connection(TimeConstraint t, Handler&& h) const {
+        static_assert(ozo::TimeConstraint<TimeConstraint>, "should model TimeConstraint concept");
+        if (host_) {
+            source_.host(*host_)(io_, std::move(t), std::forward<Handler>(h));
+        } else {
+            source_(io_, std::move(t), std::forward<Handler>(h));
+        }
+    }
+
+private:
+    latency_aware_connection_provider(source_type source, io_context& io, std::size_t host)
+    : source_(std::move(source)), io_(io), host_(host) {}
+
+    source_type source_;
+    io_context& io_;
+    std::optional<std::size_t> host_;
+};
+
+/**
+ * Creates connection source which selects the best of given equivalent hosts.
+ *
+ * ###Example
+ *
+ * Replicas in different data centers.
+ *
+@code
+#include <ozo/failover/latency_aware.h>
+
+//...
+
+auto replicas = ozo::failover::make_latency_aware_connection_source(std::vector{
+    ozo::connection_info(cfg.replica_dc1_connstr),
+    ozo::connection_info(cfg.replica_dc2_connstr),
+});
+@endcode
+ * @ingroup group-failover-latency_aware
+ */
+template <typename Source>
+auto make_latency_aware_connection_source(std::vector<Source> hosts, const latency_aware_config& config = {}) {
+    return latency_aware_connection_source<Source>(std::move(hosts), config);
+}
+
+/**
+ * @brief Operation try of the latency-aware strategy
+ *
+ * The try is bound to the best host among the hosts which have not been tried by the operation yet.
+ * The latency and the result of the try are recorded to the host statistics on its completion.
+ *
+ * @tparam Options --- map of `ozo::failover::retry_options`.
+ * @tparam Context --- operation context, compartible with `ozo::failover::basic_context`.
+ * @ingroup group-failover-latency_aware
+ */
+template <typename Options, typename Context>
+class latency_aware_try {
+    using op = retry_options;
+    using mask_type = detail::host_latency_stats::mask_type;
+
+    Context ctx_;
+    Options options_;
+    std::size_t host_;
+    mask_type tried_;
+    time_traits::time_point start_;
+
+    latency_aware_try(Options options, Context ctx, std::size_t host, mask_type tried)
+    : ctx_(std::move(ctx)), options_(std::move(options)), host_(host),
+      tried_(tried | (mask_type(1) << host)), start_(time_traits::now()) {}
+
+    decltype(auto) source() const {
+        return ozo::unwrap(ctx_).provider.source();
+    }
+
+    detail::host_latency_stats& host_stats() const {
+        return source().host_stats();
+    }
+
+public:
+    /**
+     * @brief Construct the first try object.
+     *
+     * @param options --- map of `ozo::failover::retry_options`.
+     * @param ctx --- operation context, compartible with `ozo::failover::basic_context`
+     */
+    latency_aware_try(Options options, Context ctx)
+    : ctx_(std::move(ctx)), options_(std::move(options)), host_(0), tried_(0), start_(time_traits::now()) {
+        static_assert(decltype(hana::is_a<hana::map_tag>(options))::value, "Options should be boost::hana::map");
+        host_ = *source().select(tried_);
+        tried_ = mask_type(1) << host_;
+    }
+
+    latency_aware_try(const latency_aware_try&) = delete;
+    latency_aware_try(latency_aware_try&&) = default;
+    latency_aware_try& operator = (const latency_aware_try&) = delete;
+    latency_aware_try& operator = (latency_aware_try&&) = default;
+
+    constexpr const Options& options() const { return options_;}
+    constexpr Options& options() { return options_;}
+
+    /**
+     * Index of the host the try is bound to.
+     */
+    std::size_t host() const noexcept { return host_;}
+
+    /**
+     * @brief Get the operation context.
+     *
+     * @return `boost::hana::tuple` --- operation initiation context for the try with the provider
+     *                  bound to the host of the try and the time constraint of the try.
+     */
+    auto get_context() const {
+        return hana::concat(
+            hana::make_tuple(ozo::unwrap(ctx_).provider.rebind_host(host_), time_constraint()),
+            ozo::unwrap(ctx_).args
+        );
+    }
+
+    /**
+     * Records the latency and the result of the try to the host statistics,
+     * see `ozo::failover::complete_try()`.
+     *
+     * @param ec --- error code of the try.
+     */
+    void complete(const error_code& ec) {
+        host_stats().complete(host_, time_traits::now() - start_, ec);
+    }
+
+    /**
+     * @brief Get the next try
+     *
+     * Return next try object for retry operation if it possible. See
+     * `ozo::fallback::get_next_try()` for details. The next try is bound to the best
+     * host among the hosts which have not been tried yet.
+     *
+     * @param ec --- error code which should be examined for retry ability.
+     * @param conn --- `Connection` object which should be closed in any case.
+     * @return `std::optional<latency_aware_try>` --- initialized with the try object if retry is possible.
+     * @return `std::nullopt` --- retry is not possible due to `ec` value, tries remain count
+     *                            or there is no host left to try.
+     */
+    template <typename Connection>
+    std::optional<latency_aware_try> get_next_try(ozo::error_code ec, Connection&& conn) {
+        auto guard = defer_close_connection(get_option(options(), op::close_connection, true) ? std::addressof(conn) : nullptr);
+
+        std::optional<latency_aware_try> retval;
+        options_[op::tries] = std::max(0, tries_remain() - 1);
+        if (!can_retry(ec)) {
+            return retval;
+        }
+        // The hosts with open circuits fail fast, so they are skipped to leave
+        // the rest of the time constraint to the healthy hosts.
+        if (const auto host = host_stats().select(tried_ | source().open_hosts())) {
+            get_option(options(), op::on_retry, [](auto&&...){})(ec, conn);
+            retval.emplace(latency_aware_try{std::move(options_), std::move(ctx_), *host, tried_});
+        }
+        return retval;
+    }
+
+    /**
+     * @brief Number of tries remains
+     *
+     * @return int --- number of tries remains to execute an operation, not less than 0.
+     */
+    constexpr int tries_remain() const { return get_option(options(), op::tries);}
+
+    /**
+     * @brief Retry conditions for the try
+     *
+     * @return auto --- `boost::hana::tuple` of error conditions which have a good
+     *                             chance to be solved by a retry.
+     */
+    constexpr decltype(auto) get_conditions() const {
+        return get_option(options(), op::conditions, no_conditions_);
+    }
+
+    /**
+     * Time constraint for the try. The operation time constraint is divided between the tries
+     * which remain, but no more than the hosts which have not been tried yet and have no open circuit.
+     *
+     * @return time constraint type value calculated for the try
+     */
+    auto time_constraint() const {
+        return detail::get_try_time_constraint(ozo::unwrap(ctx_).time_constraint, std::min(tries_remain(), hosts_remain()));
+    }
+
+private:
+    int hosts_remain() const {
+        const auto skipped = tried_ | source().open_hosts();
+        int result = 0;
+        for (std::size_t i = 0; i != host_stats().size(); ++i) {
+            result += (skipped & (mask_type(1) << i)) ? 0 : 1;
+        }
+        // The host of this try is counted too.
+        return result + 1;
+    }
+
+    bool can_retry([[maybe_unused]] error_code ec) const {
+        if (tries_remain() < 1) {
+            return false;
+        }
+
+        if constexpr (decltype(hana::is_empty(get_conditions()))::value) {
+            return true;
+        } else {
+            return errc::match_code(get_conditions(), ec);
+        }
+    }
+    constexpr static const auto no_conditions_ = hana::make_tuple();
+};
+
+/**
+ * @brief Latency-aware strategy
+ *
+ * Latency-aware strategy is a factory for `ozo::failover::latency_aware_try` object. This class is
+ * an options' factory (see `ozo::options_factory_base`), it accepts `ozo::failover::retry_options`.
+ *
+ * @ingroup group-failover-latency_aware
+ */
+template <typename Options = decltype(hana::make_map())>
+class latency_aware_strategy : public ozo::options_factory_base<latency_aware_strategy<Options>, Options> {
+    using op = retry_options;
+
+    friend class ozo::options_factory_base<latency_aware_strategy<Options>, Options>;
+    using base = ozo::options_factory_base<latency_aware_strategy<Options>, Options>;
+
+    template <typename OtherOptions>
+    constexpr static auto rebind_options(OtherOptions&& options) {
+        return latency_aware_strategy<std::decay_t<OtherOptions>>(std::forward<OtherOptions>(options));
+    }
+
+public:
+    /**
+     * @brief Construct a new latency-aware strategy object
+     *
+     * @param options --- `boost::hana::map` of `ozo::failover::retry_options` and values.
+     */
+    constexpr latency_aware_strategy(Options options = Options{}) : base(std::move(options)) {
+        static_assert(decltype(hana::is_a<hana::map_tag>(options))::value, "Options should be boost::hana::map");
+    }
+
+    template <typename Operation, typename Allocator, typename Source,
+            typename TimeConstraint, typename ...Args>
+    auto get_first_try(const Operation&, const Allocator&,
+            latency_aware_connection_provider<Source> provider, TimeConstraint t, Args&& ...args) const {
+
+        static_assert(decltype(this->has(op::tries))::value, "number of tries should be specified");
+
+        return latency_aware_try {
+            this->options(),
+            basic_context{std::move(provider), ozo::deadline(t), std::forward<Args>(args)...}
+        };
+    }
+
+    /**
+     * @brief Specify number of tries
+     *
+     * Each try is performed on a different host, so the number of tries is limited by
+     * the number of hosts too. The time constraint is divided between tries as described
+     * in `ozo::failover::retry_strategy::tries()`.
+     *
+     * @param n --- number of tries
+     * @return `latency_aware_strategy` specialization object
+     */
+    constexpr decltype(auto) tries(int n) const & { return this->set(op::tries, n);}
+    constexpr decltype(auto) tries(int n) && { return std::move(*this).set(op::tries, n);}
+
+    /**
+     * @brief Sintactic sugar for `ozo::failover::latency_aware_strategy::tries()`
+     *
+     * @param n --- number of tries
+     * @return `latency_aware_strategy` specialization object
+     */
+    constexpr decltype(auto) operator * (int n) const & { return tries(n); }
+    constexpr decltype(auto) operator * (int n) && { return std::move(*this).tries(n); }
+};
+
+template <typename ...Ts>
+constexpr decltype(auto) operator * (int n, const latency_aware_strategy<Ts...>& s) { return s * n;}
+template <typename ...Ts>
+constexpr decltype(auto) operator * (int n, latency_aware_strategy<Ts...>&& s) { return std::move(s) * n;}
+
+/**
+ * Try an operation on the best current host with retry on other hosts on specified error conditions.
+ *
+ * Each try is bound to a host selected by the power of two choices among the hosts which have not
+ * been tried by the operation yet: two random candidates are compared by the moving averages of the
+ * latency and the error rate of their tries, so a slow or failing host, e.g. a replica in a far data
+ * center, gets less load while a faster one is available.
+ *
+ * @param ec --- variadic of error conditions to retry
+ * @return `ozo::failover::latency_aware_strategy` specialization.
+ *
+ * @note This strategy works only with `ozo::failover::latency_aware_connection_provider`
+ * `ConnectionProvider` implementation.
+ *
+ * ###Example
+ *
+ * Try the request on up to two replicas on a connection problem.
+ *
+ * @code
+auto replicas = ozo::failover::make_latency_aware_connection_source(std::vector{
+    ozo::connection_info(cfg.replica_dc1_connstr),
+    ozo::connection_info(cfg.replica_dc2_connstr),
+});
+
+//...
+
+auto strategy = failover::latency_aware(errc::connection_error)*2;
+ozo::request[strategy](replicas[io], query, .5s, out, yield);
+ * @endcode
+ *
+ * @sa `ozo::failover::latency_aware_strategy`, `ozo::failover::latency_aware_connection_source`
+ * @ingroup group-failover-latency_aware
+ */
+template <typename ...ErrorConditions>
+constexpr auto latency_aware(ErrorConditions ...ec) {
+    if constexpr (sizeof...(ec) != 0) {
+        return latency_aware_strategy{}.set(retry_options::conditions=hana::make_tuple(ec...));
+    } else {
+        return latency_aware_strategy{};
+    }
+}
+
+} // namespace ozo::failover
+
+namespace ozo {
+
+template <typename ...Ts, typename Op>
+struct construct_initiator_impl<failover::latency_aware_strategy<Ts...>, Op>
+: failover::construct_initiator_impl {};
+
+} // namespace ozo
@@ -0,0 +1,432 @@
+#pragma once
+
+#include <ozo/connector.h>
+#include <ozo/query.h>
+#include <ozo/request.h>
+
+#include <boost/asio/post.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <vector>
+
+/**
+ * @defgroup group-failover-lsn_aware Replication-Lag-Aware Read Routing
+ * @ingroup group-failover
+ * @brief Routing of reads to the replicas which have replayed the writes of a client
+ *
+ * Reads which follow a write should see the write, so they are usually sent to the primary
+ * host. It is not necessary if a replica has already replayed the write. The write-ahead log
+ * position of the primary (`pg_current_wal_lsn()`) may be captured after a write via
+ * `ozo::failover::get_current_wal_lsn()`, and the reads which are bound to this position via
+ * `ozo::failover::lsn_aware_connection_source::rebind_lsn()` are routed to the replicas which
+ * have replayed the log at least up to it. If there is no such replica, a read is routed to the
+ * primary. The replay positions (`pg_last_wal_replay_lsn()`) of the replicas are polled in
+ * the background, so the routing does not cost any additional query.
+ */
+
+namespace ozo::failover {
+
+/**
+ * @brief Position in the write-ahead log
+ *
+ * The number of bytes from the beginning of the log, i.e. `pg_lsn` value minus `'0/0'`.
+ * @ingroup group-failover-lsn_aware
+ */
+using wal_lsn = std::int64_t;
+
+/**
+ * @brief Configuration of the `ozo::failover::lsn_aware_connection_source`
+ * @ingroup group-failover-lsn_aware
+ */
+struct lsn_aware_config {
+    time_traits::duration poll_interval = std::chrono::milliseconds(100); //!< interval between polls of the replay position of a replica
+    time_traits::duration poll_timeout = std::chrono::seconds(1); //!< time constraint of a poll including the connection
+};
+
+/**
+ * @brief Replication state of a replica of the `ozo::failover::lsn_aware_connection_source`
+ * @ingroup group-failover-lsn_aware
+ */
+struct lsn_aware_host_stats {
+    wal_lsn replay_lsn = 0; //!< replay position of the last successful poll
+    bool available = false; //!< the last poll is successful, the replica is never routed to otherwise
+    time_traits::time_point updated {}; //!< time of the last successful poll
+};
+
+namespace detail {
+
+inline auto current_wal_lsn_query() {
+    return make_query("SELECT (pg_current_wal_lsn() - '0/0'::pg_lsn)::bigint");
+}
+
+// A replica during start-up has no replay position yet, and a promoted replica has no replay
+// position at all, but its own log is ahead of anything it has replayed.
+inline auto replay_wal_lsn_query() {
+    return make_query(
+        "SELECT (COALESCE(CASE WHEN pg_is_in_recovery() THEN pg_last_wal_replay_lsn() ELSE pg_current_wal_lsn() END,"
+        " '0/0'::pg_lsn) - '0/0'::pg_lsn)::bigint");
+}
+
+/**
+ * Replay positions of replicas, shared by copies of a `lsn_aware_connection_source`.
+ * The polled position is a lower bound of the actual one since the replay never goes back,
+ * so a replica which is selected for a position has surely replayed it.
+ */
+class replication_state {
+public:
+    explicit replication_state(std::size_t hosts) : hosts_(hosts) {}
+
+    std::size_t size() const noexcept { return hosts_.size();}
+
+    /**
+     * Selects an available replica which has replayed the log at least up to the position,
+     * round robin between suitable replicas.
+     *
+     * @return std::optional<std::size_t> --- index of the replica or `std::nullopt` if there is no suitable one.
+     */
+    std::optional<std::size_t> select(wal_lsn lsn) const {
+        const auto start = next_.fetch_add(1, std::memory_order_relaxed);
+        const std::lock_guard lock(mutex_);
+        for (std::size_t i = 0; i != hosts_.size(); ++i) {
+            const auto index = (start + i) % hosts_.size();
+            const auto& host = hosts_[index];
+            if (host.available && host.replay_lsn >= lsn) {
+                return index;
+            }
+        }
+        return std::nullopt;
+    }
+
+    void update(std::size_t host, const error_code& ec, wal_lsn lsn) {
+        const std::lock_guard lock(mutex_);
+        auto& stats = hosts_[host];
+        stats.available = !ec;
+        if (!ec) {
+            stats.replay_lsn = std::max(stats.replay_lsn, lsn);
+            stats.updated = time_traits::now();
+        }
+    }
+
+    lsn_aware_host_stats stats(std::size_t host) const {
+        const std::lock_guard lock(mutex_);
+        return hosts_[host];
+    }
+
+    /**
+     * Starts a new generation of the polls.
+     *
+     * @return std::optional<std::uint64_t> --- generation of the polls or `std::nullopt` if the polls are already running.
+     */
+    std::optional<std::uint64_t> start() {
+        const std::lock_guard lock(mutex_);
+        if (running_) {
+            return std::nullopt;
+        }
+        running_ = true;
+        return ++generation_;
+    }
+
+    bool stopped() const {
+        const std::lock_guard lock(mutex_);
+        return !running_;
+    }
+
+    /**
+     * Determines whether the polls of the generation are stopped, they are not resumed
+     * by a later `start()` which starts a new generation.
+     */
+    bool stopped(std::uint64_t generation) const {
+        const std::lock_guard lock(mutex_);
+        return !running_ || generation != generation_;
+    }
+
+    void on_stop(std::function<void()> handler) {
+        const std::lock_guard lock(mutex_);
+        stop_handlers_.push_back(std::move(handler));
+    }
+
+    void stop() {
+        std::vector<std::function<void()>> handlers;
+        {
+            const std::lock_guard lock(mutex_);
+            running_ = false;
+            handlers.swap(stop_handlers_);
+        }
+        for (auto& handler : handlers) {
+            handler();
+        }
+    }
+
+private:
+    mutable std::mutex mutex_;
+    mutable std::atomic<std::size_t> next_ {0};
+    std::vector<lsn_aware_host_stats> hosts_;
+    std::vector<std::function<void()>> stop_handlers_;
+    bool running_ = false;
+    std::uint64_t generation_ = 0;
+};
+
+/**
+ * Background poll of the replay position of a replica. The poll is repeated until
+ * its generation of the replication state is stopped. The connection of a successful poll
+ * is kept for the next one, so the replica is not reconnected each poll interval.
+ */
+template <typename Source>
+class replay_lsn_poller : public std::enable_shared_from_this<replay_lsn_poller<Source>> {
+public:
+    using connection_type = typename connection_source_traits<Source>::connection_type;
+
+    replay_lsn_poller(std::shared_ptr<std::vector<Source>> hosts, std::shared_ptr<replication_state> state,
+            std::size_t host, std::uint64_t generation, io_context& io, const lsn_aware_config& config)
+    : hosts_(std::move(hosts)), state_(std::move(state)), host_(host), generation_(generation), io_(io),
+      config_(config), timer_(io) {}
+
+    void start() {
+        state_->on_stop([weak = this->weak_from_this(), &io = io_] {
+            asio::post(io, [weak] {
+                if (const auto self = weak.lock()) {
+                    self->timer_.cancel();
+                }
+            });
+        });
+        poll();
+    }
+
+private:
+    void poll() {
+        if (state_->stopped(generation_)) {
+            return;
+        }
+        auto handler = [self = this->shared_from_this()] (error_code ec, connection_type conn) {
+            self->state_->update(self->host_, ec, self->lsn_);
+            // A failed connection is replaced by a new one on the next poll.
+            if (!ec) {
+                self->conn_ = std::move(conn);
+            }
+            self->wait();
+        };
+        if (!is_null_recursive(conn_) && connection_good(conn_)) {
+            return ozo::request(std::move(conn_), replay_wal_lsn_query(), config_.poll_timeout,
+                std::addressof(lsn_), std::move(handler));
+        }
+        conn_ = connection_type{};
+        ozo::request(connection_provider((*hosts_)[host_], io_), replay_wal_lsn_query(), config_.poll_timeout,
+            std::addressof(lsn_), std::move(handler));
+    }
+
+    void wait() {
+        if (state_->stopped(generation_)) {
+            return;
+        }
+        timer_.expires_after(config_.poll_interval);
+        timer_.async_wait([self = this->shared_from_this()] (error_code) {
+            self->poll();
+        });
+    }
+
+    std::shared_ptr<std::vector<Source>> hosts_;
+    std::shared_ptr<replication_state> state_;
+    std::size_t host_;
+    std::uint64_t generation_;
+    io_context& io_;
+    lsn_aware_config config_;
+    asio::steady_timer timer_;
+    connection_type conn_ {};
+    wal_lsn lsn_ = 0;
+};
+
+} // namespace detail
+
+/**
+ * @brief Connection source which routes reads to the replicas which have replayed a write
+ *
+ * The source contains connection sources of the primary host and of the replicas, e.g.
+ * `ozo::connection_pool` objects. The replay positions of the replicas are polled in the background
+ * after `start_polling()` until `stop_polling()` is called. Each replica is polled via its own long-lived
+ * connection which is established by the replica source and is replaced only if a poll fails, so with
+ * `ozo::connection_pool` replicas the polls occupy one connection of each replica pool. Copies of the source
+ * share the hosts and the polled positions, so they should be copied from a single source object.
+ *
+ * A connection is obtained from an available replica which has replayed the log at least up to the position
+ * the source is bound to via `rebind_lsn()`, round robin between such replicas. The source which is not bound
+ * to a position routes to any available replica. If there is no suitable replica, e.g. before the first poll
+ * or if all the replicas lag behind, the connection is obtained from the primary.
+ *
+ * ###Example
+ *
+ * @code{cpp}
+auto source = ozo::failover::make_lsn_aware_connection_source(
+    ozo::connection_info(cfg.primary_connstr),
+    std::vector{
+        ozo::connection_info(cfg.replica_dc1_connstr),
+        ozo::connection_info(cfg.replica_dc2_connstr),
+    }
+);
+source.start_polling(io);
+//...
+ozo::failover::wal_lsn lsn = 0;
+auto conn = ozo::execute(source.primary()[io], update_query, timeout, yield);
+ozo::failover::get_current_wal_lsn(conn, timeout, lsn, yield);
+//...
+ozo::request(source.rebind_lsn(lsn)[io], select_query, timeout, ozo::into(result), yield);
+ * @endcode
+ *
+ * @tparam Source --- `ConnectionSource` implementation of a host.
+ * @sa `ozo::failover::make_lsn_aware_connection_source()`
+ * @ingroup group-failover-lsn_aware
+ * @models{ConnectionSource}
+ */
+template <typename Source>
+class lsn_aware_connection_source {
+public:
+    static_assert(ozo::ConnectionSource<Source>, "Source should model a ConnectionSource concept");
+
+    /**
+     * `Connection` implementation type according to `ConnectionSource` requirements.
+     * Specifies the `Connection` implementation type which can be obtained from this source.
+     */
+    using connection_type = typename connection_source_traits<Source>::connection_type;
+
+    /**
+     * Construct a new source object.
+     *
+     * @param primary --- connection source of the primary host.
+     * @param replicas --- connection sources of the replicas.
+     * @param config --- configuration of the replay position polls.
+     */
+    lsn_aware_connection_source(Source primary, std::vector<Source> replicas, const lsn_aware_config& config = {})
+    : primary_(std::make_shared<Source>(std::move(primary))),
+      replicas_(std::make_shared<std::vector<Source>>(std::move(replicas))),
+      state_(std::make_shared<detail::replication_state>(replicas_->size())),
+      config_(config) {}
+
+    /**
+     * Get the number of replicas.
+     */
+    std::size_t size() const noexcept { return replicas_->size();}
+
+    /**
+     * Get the connection source of the primary host, e.g. for writes.
+     */
+    Source& primary() const { return *primary_;}
+
+    /**
+     * Get the connection source of the replica.
+     */
+    Source& replica(std::size_t index) const { return (*replicas_)[index];}
+
+    /**
+     * Get the replication state of the replica.
+     */
+    lsn_aware_host_stats stats(std::size_t index) const { return state_->stats(index);}
+
+    detail::replication_state& replication_state() const noexcept { return *state_;}
+
+    /**
+     * Get the position the source is bound to.
+     */
+    wal_lsn lsn() const noexcept { return lsn_;}
+
+    /**
+     * @brief Bind the source to a position in the write-ahead log
+     *
+     * @param lsn --- position which should be replayed by a replica to be used, typically
+     *                obtained via `ozo::failover::get_current_wal_lsn()` after a write.
+     * @return new source object which shares the hosts with this one.
+     */
+    lsn_aware_connection_source rebind_lsn(wal_lsn lsn) const {
+        auto result = *this;
+        result.lsn_ = lsn;
+        return result;
+    }
+
+    /**
+     * @brief Start the background polls of the replay positions of the replicas
+     *
+     * The polls are running on the `io_context` until `stop_polling()` is called,
+     * so the `io_context` does not run out of work. The polls may be started again after
+     * `stop_polling()`, a call while the polls are running has no effect.
+     *
+     * @param io --- `io_context` for the polls.
+     */
+    void start_polling(io_context& io) const {
+        const auto generation = state_->start();
+        if (!generation) {
+            return;
+        }
+        for (std::size_t i = 0; i != size(); ++i) {
+            std::make_shared<detail::replay_lsn_poller<Source>>(replicas_, state_, i, *generation, io, config_)->start();
+        }
+    }
+
+    /**
+     * Stop the background polls of the replay positions. The replicas keep the last polled positions.
+     * The poll connections are closed when the polls in progress are finished.
+     */
+    void stop_polling() const {
+        state_->stop();
+    }
+
+    template <typename TimeConstraint, typename Handler>
+    void operator() (io_context& io, TimeConstraint t, Handler&& h) const {
+        if (const auto index = state_->select(lsn_)) {
+            return replica(*index)(io, std::move(t), std::forward<Handler>(h));
+        }
+        primary()(io, std::move(t), std::forward<Handler>(h));
+    }
+
+    auto operator[] (io_context& io) const {
+        return connection_provider(*this, io);
+    }
+
+private:
+    std::shared_ptr<Source> primary_;
+    std::shared_ptr<std::vector<Source>> replicas_;
+    std::shared_ptr<detail::replication_state> state_;
+    lsn_aware_config config_;
+    wal_lsn lsn_ = 0;
+};
+
+/**
+ * Creates connection source which routes reads to the replicas which have replayed a write.
+ *
+ * @param primary --- connection source of the primary host.
+ * @param replicas --- connection sources of the replicas.
+ * @param config --- configuration of the replay position polls.
+ * @return `ozo::failover::lsn_aware_connection_source` object.
+ * @ingroup group-failover-lsn_aware
+ */
+template <typename Source>
+auto make_lsn_aware_connection_source(Source primary, std::vector<Source> replicas, const lsn_aware_config& config = {}) {
+    return lsn_aware_connection_source<Source>(std::move(primary), std::move(replicas), config);
+}
+
+/**
+ * @brief Get the current write position of the primary host
+ *
+ * Captures `pg_current_wal_lsn()` which should be replayed by a replica to see the writes which
+ * have been committed before. It should be called on the primary host after a write, e.g. with
+ * the connection the write has been made on.
+ *
+ * @param provider --- `ConnectionProvider` of the primary host or a `Connection`.
+ * @param t --- #TimeConstraint for the operation.
+ * @param lsn --- write position output.
+ * @param token --- #CompletionToken.
+ * @return deduced from #CompletionToken.
+ * @ingroup group-failover-lsn_aware
+ */
+template <typename P, typename TimeConstraint, typename CompletionToken>
+decltype(auto) get_current_wal_lsn(P&& provider, TimeConstraint t, wal_lsn& lsn, CompletionToken&& token) {
+    static_assert(ozo::ConnectionProvider<P>, "provider should be a ConnectionProvider");
+    return ozo::request(std::forward<P>(provider), detail::current_wal_lsn_query(), t, std::addressof(lsn),
+        std::forward<CompletionToken>(token));
+}
+
+} // namespace ozo::failover
@@ -3,6 +3,11 @@
 #include <ozo/failover/strategy.h>
 #include <ozo/core/options.h>
 
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <random>
+
 /**
  * @defgroup group-failover-retry Retry
  * @ingroup group-failover
@@ -31,6 +36,173 @@ constexpr auto make_errcs_tuple(ErrorConditions ...errcs) {
 
 } // namespace detail
 
+/**
+ * @brief Exponential backoff between tries
+ *
+ * The delay before the n<small>th</small> retry is a random value from zero to
+ * `min(max, base * 2^(n-1))`, so the retries of concurrent operations which have failed
+ * together are spread in time instead of hitting the database at once.
+ *
+ * @ingroup group-failover-retry
+ */
+struct retry_backoff {
+    time_traits::duration base = std::chrono::milliseconds(10); //!< upper bound of the delay before the first retry
+    time_traits::duration max = std::chrono::seconds(1); //!< upper bound of the delay before any retry
+};
+
+/**
+ * @brief Configuration of the `ozo::failover::retry_budget`
+ * @ingroup group-failover-retry
+ */
+struct retry_budget_config {
+    double ratio = 0.1; //!< number of retries earned by an operation, e.g. 0.1 allows to retry 10% of operations
+    double min_retries_per_second = 10; //!< number of retries allowed regardless of the ratio, so operations are retried under a low load too
+    double capacity = 100; //!< maximum number of retries which may be accumulated by the budget
+};
+
+/**
+ * @brief Counters of the `ozo::failover::retry_budget`
+ * @ingroup group-failover-retry
+ */
+struct retry_budget_stats {
+    std::size_t operations = 0; //!< number of operations which have been started with the budget
+    std::size_t retries = 0; //!< number of retries which have been allowed by the budget
+    std::size_t rejected = 0; //!< number of retries which have been rejected since the budget was exhausted
+    std::size_t delayed = 0; //!< number of retries which have been delayed by the backoff
+    time_traits::duration backoff {}; //!< total delay of the retries by the backoff
+};
+
+/**
+ * @brief Retry budget shared by operations
+ *
+ * Retries multiply the load on a database by the number of tries just when it is struggling.
+ * The budget is a token bucket which limits retries to a fraction of operations: each operation
+ * deposits `retry_budget_config::ratio` of a token and each retry withdraws a whole token. Besides that
+ * the budget is refilled by `retry_budget_config::min_retries_per_second`. A retry is not made if there
+ * is no token in the budget. Typically one budget object is shared by all the operations of a process
+ * via `ozo::failover::retry_strategy::budget()`. The budget is thread safe.
+ *
+ * @ingroup group-failover-retry
+ */
+class retry_budget {
+public:
+    /**
+     * Construct a new budget object. The budget contains the minimum retries of one second initially.
+     *
+     * @param config --- configuration of the budget.
+     */
+    explicit retry_budget(const retry_budget_config& config = {})
+    : config_(config), tokens_(std::min(config.capacity, config.min_retries_per_second)),
+      updated_(time_traits::now()) {}
+
+    /**
+     * Deposits the share of an operation which is being started.
+     */
+    void deposit() {
+        const std::lock_guard lock(mutex_);
+        ++stats_.operations;
+        tokens_ = std::min(config_.capacity, tokens_ + config_.ratio);
+    }
+
+    /**
+     * Withdraws a token for a retry.
+     *
+     * @param delay --- backoff delay of the retry.
+     * @return `true` --- the retry is allowed.
+     * @return `false` --- the budget is exhausted.
+     */
+    bool withdraw(time_traits::duration delay = time_traits::duration(0)) {
+        const auto now = time_traits::now();
+        const std::lock_guard lock(mutex_);
+        const std::chrono::duration<double> elapsed = now - updated_;
+        updated_ = now;
+        tokens_ = std::min(config_.capacity, tokens_ + elapsed.count() * config_.min_retries_per_second);
+        if (tokens_ < 1) {
+            ++stats_.rejected;
+            return false;
+        }
+        tokens_ -= 1;
+        ++stats_.retries;
+        if (delay > time_traits::duration(0)) {
+            ++stats_.delayed;
+            stats_.backoff += delay;
+        }
+        return true;
+    }
+
+    /**
+     * Get the counters of the budget.
+     */
+    retry_budget_stats stats() const {
+        const std::lock_guard lock(mutex_);
+        return stats_;
+    }
+
+private:
+    retry_budget_config config_;
+    mutable std::mutex mutex_;
+    double tokens_;
+    time_traits::time_point updated_;
+    retry_budget_stats stats_;
+};
+
+namespace detail {
+
+inline time_traits::duration get_backoff_delay(const retry_backoff& backoff, int retry) {
+    auto limit = backoff.base;
+    for (int i = 0; i < retry && limit < backoff.max; ++i) {
+        limit *= 2;
+    }
+    limit = std::min(limit, backoff.max);
+    if (limit <= time_traits::duration(0)) {
+        return time_traits::duration(0);
+    }
+    thread_local std::minstd_rand random(std::random_device{}());
+    std::uniform_int_distribution<time_traits::duration::rep> distribution(0, limit.count());
+    return time_traits::duration(distribution(random));
+}
+
+/**
+ * `ConnectionProvider` which waits for the backoff delay of a retry on a timer
+ * of the provider's `io_context` before it gets a connection from the target provider.
+ */
+template <typename Provider>
+class backoff_connection_provider {
+public:
+    static_assert(ConnectionProvider<Provider>, "Provider should model ConnectionProvider concept");
+
+    using target_type = Provider;
+    using connection_type = ozo::connection_type<target_type>;
+
+    backoff_connection_provider(Provider target, time_traits::duration delay)
+    : target_(std::move(target)), delay_(delay) {}
+
+    template <typename TimeConstraint, typename Handler>
+    void async_get_connection(TimeConstraint t, Handler&& handler) const {
+        static_assert(ozo::TimeConstraint<TimeConstraint>, "should model TimeConstraint concept");
+        if (delay_ <= time_traits::duration(0)) {
+            return ozo::async_get_connection(target_, t, std::forward<Handler>(handler));
+        }
+        auto& io = ozo::unwrap(target_).get_io_context();
+        auto timer = std::make_shared<std::decay_t<decltype(ozo::detail::get_operation_timer(io.get_executor(), delay_))>>(
+            ozo::detail::get_operation_timer(io.get_executor(), delay_));
+        timer->async_wait([target = target_, t, timer, handler = std::forward<Handler>(handler)] (error_code) mutable {
+            ozo::async_get_connection(target, t, std::move(handler));
+        });
+    }
+
+    bool is_circuit_open() const { return ozo::is_circuit_open(target_);}
+
+    const target_type& target() const & noexcept { return target_;}
+    constexpr time_traits::duration delay() const noexcept { return delay_;}
+
+private:
+    target_type target_;
+    time_traits::duration delay_;
+};
+
+} // namespace detail
+
 /**
  * @brief Options for retry
  *
@@ -42,11 +214,15 @@ struct retry_options {
     class close_connection_tag;
     class tries_tag;
     class conditions_tag;
+    class backoff_tag;
+    class budget_tag;
 
     constexpr static option<on_retry_tag> on_retry{}; //!< Set handler for retry event, may be useful for logging.
     constexpr static option<close_connection_tag> close_connection{}; //!< Set close connection policy on retry, possible values `true`(default), `false`.
     constexpr static option<tries_tag> tries{}; //!< Set number of tries, see `ozo::retry_strategy::tries()` for more information.
     constexpr static option<conditions_tag> conditions{}; //!< Set error conditions to retry
+    constexpr static option<backoff_tag> backoff{}; //!< Set `ozo::failover::retry_backoff` to delay retries, see `ozo::retry_strategy::backoff()` for more information.
+    constexpr static option<budget_tag> budget{}; //!< Set `std::shared_ptr<ozo::failover::retry_budget>` to limit retries, see `ozo::retry_strategy::budget()` for more information.
 };
 
 /**
@@ -63,8 +239,21 @@ template <typename Options, typename Context>
 class basic_try {
     Context ctx_;
     Options options_;
+    int retries_ = 0;
+    time_traits::duration delay_ {0};
     using op = retry_options;
 
+    basic_try(Options options, Context ctx, int retries, time_traits::duration delay)
+    : ctx_(std::move(ctx)), options_(std::move(options)), retries_(retries), delay_(delay) {}
+
+    static constexpr bool has_backoff() {
+        return decltype(hana::contains(std::declval<const Options&>(), op::backoff))::value;
+    }
+
+    static constexpr bool has_budget() {
+        return decltype(hana::contains(std::declval<const Options&>(), op::budget))::value;
+    }
+
 public:
     /**
      * @brief Construct a new basic try object.
@@ -88,11 +277,12 @@ public:
      * @brief Get the operation context.
      *
      * @return `boost::hana::tuple` --- operation initiation context for the try with modified time constraint;
-     *                  see `ozo::retry_strategy::tries()` for details about calculations.
+     *                  see `ozo::retry_strategy::tries()` for details about calculations. If the backoff is set,
+     *                  the provider waits for the backoff delay of the try before getting a connection.
      */
     auto get_context() const {
         return hana::concat(
-            hana::make_tuple(ozo::unwrap(ctx_).provider, time_constraint()),
+            hana::make_tuple(provider(), time_constraint()),
             ozo::unwrap(ctx_).args
         );
     }
@@ -116,8 +306,11 @@ public:
         std::optional<basic_try> retval;
         adjust_tries_remain();
         if (can_retry(ec)) {
-            get_option(options(), op::on_retry, [](auto&&...){})(ec, conn);
-            retval.emplace(basic_try{std::move(options_), std::move(ctx_)});
+            const auto delay = backoff_delay();
+            if (fits_time_constraint(delay) && withdraw_budget(delay)) {
+                get_option(options(), op::on_retry, [](auto&&...){})(ec, conn);
+                retval.emplace(basic_try{std::move(options_), std::move(ctx_), retries_ + 1, delay});
+            }
         }
 
         return retval;
@@ -140,11 +333,71 @@ public:
         return get_option(options(), op::conditions, no_conditions_);
     }
 
+    /**
+     * @brief Backoff delay of the try
+     *
+     * @return time_traits::duration --- delay before the try gets a connection, zero for the first try
+     *                                   or if the backoff is not set.
+     */
+    time_traits::duration delay() const noexcept { return delay_;}
+
+    /**
+     * @brief Time constraint of the try
+     *
+     * @return --- the share of the operation time constraint for the try. If the try is delayed
+     *             by the backoff, the share is calculated from the time left after the delay,
+     *             and the delay is added to it since the try waits for it within the constraint.
+     */
     auto time_constraint() const {
-        return detail::get_try_time_constraint(ozo::unwrap(ctx_).time_constraint, tries_remain());
+        const auto t = ozo::unwrap(ctx_).time_constraint;
+        if constexpr (!has_backoff()) {
+            return detail::get_try_time_constraint(t, tries_remain());
+        } else if constexpr (std::is_same_v<decltype(t), const time_traits::time_point>) {
+            const auto now = time_traits::now();
+            return now + delay_ + detail::get_try_time_constraint(t - delay_, tries_remain(), [now] { return now;});
+        } else if constexpr (std::is_same_v<decltype(t), const time_traits::duration>) {
+            return delay_ + detail::get_try_time_constraint(std::max(t - delay_, time_traits::duration(0)), tries_remain());
+        } else {
+            return t;
+        }
     }
 
 private:
+    auto provider() const {
+        if constexpr (has_backoff()) {
+            return detail::backoff_connection_provider{ozo::unwrap(ctx_).provider, delay_};
+        } else {
+            return ozo::unwrap(ctx_).provider;
+        }
+    }
+
+    time_traits::duration backoff_delay() const {
+        if constexpr (has_backoff()) {
+            return detail::get_backoff_delay(get_option(options(), op::backoff), retries_);
+        } else {
+            return time_traits::duration(0);
+        }
+    }
+
+    // The delay should leave time for the try within its share of the time constraint.
+    bool fits_time_constraint([[maybe_unused]] time_traits::duration delay) const {
+        const auto t = ozo::unwrap(ctx_).time_constraint;
+        if constexpr (!has_backoff() || t == none) {
+            return true;
+        } else {
+            return delay < detail::get_try_time_constraint(t, tries_remain());
+        }
+    }
+
+    bool withdraw_budget(time_traits::duration delay) const {
+        if constexpr (has_budget()) {
+            const auto& budget = get_option(options(), op::budget);
+            return !budget || budget->withdraw(delay);
+        } else {
+            return true;
+        }
+    }
+
     void adjust_tries_remain() {
         options_[op::tries] = std::max(0, tries_remain() - 1);
     }
@@ -154,6 +407,11 @@ private:
             return false;
         }
 
+        // A retry would be rejected by the open circuit immediately.
+        if (ozo::is_circuit_open(ozo::unwrap(ctx_).provider)) {
+            return false;
+        }
+
         if constexpr (decltype(hana::is_empty(get_conditions()))::value) {
             return true;
         } else {
@@ -211,6 +469,12 @@ public:
 
         static_assert(decltype(this->has(op::tries))::value, "number of tries should be specified");
 
+        if constexpr (decltype(this->has(op::budget))::value) {
+            if (const auto& budget = this->get(op::budget)) {
+                budget->deposit();
+            }
+        }
+
         return basic_try {
             this->options(),
             basic_context{
@@ -255,6 +519,51 @@ public:
     constexpr decltype(auto) tries(int n) const & { return this->set(op::tries, n);}
     constexpr decltype(auto) tries(int n) && { return std::move(*this).set(op::tries, n);}
 
+    /**
+     * @brief Specify backoff between tries
+     *
+     * Each retry waits for a random delay on a timer of the `io_context` the connection provider
+     * is bound to, see `ozo::failover::retry_backoff` for the delay calculation. The retry gets
+     * its share of the time left after the delay in addition to the delay, and it is not made
+     * if the delay is not less than its share of the time left. The connection provider should
+     * have `get_io_context()` member function like
+     * `ozo::connection_provider` does.
+     *
+     * @param b --- backoff parameters.
+     * @return `retry_strategy` specialization object
+     *
+     * ###Example
+     *
+     * @code
+    auto retry = failover::retry(errc::connection_error).backoff({10ms, 100ms})*3;
+    ozo::request[retry](pool[io], query, .5s, out, yield);
+     * @endcode
+     */
+    constexpr decltype(auto) backoff(retry_backoff b) const & { return this->set(op::backoff, b);}
+    constexpr decltype(auto) backoff(retry_backoff b) && { return std::move(*this).set(op::backoff, b);}
+
+    /**
+     * @brief Specify retry budget
+     *
+     * Each operation deposits to the budget and each retry withdraws from it, so the retries
+     * are limited to a fraction of operations, see `ozo::failover::retry_budget`. The budget
+     * counters are available via `ozo::failover::retry_budget::stats()`.
+     *
+     * @param b --- budget shared by operations, `nullptr` disables the limit.
+     * @return `retry_strategy` specialization object
+     *
+     * ###Example
+     *
+     * @code
+    const auto budget = std::make_shared<failover::retry_budget>();
+    //...
+    auto retry = failover::retry(errc::connection_error).budget(budget)*3;
+    ozo::request[retry](pool[io], query, .5s, out, yield);
+     * @endcode
+     */
+    decltype(auto) budget(std::shared_ptr<retry_budget> b) const & { return this->set(op::budget, std::move(b));}
+    decltype(auto) budget(std::shared_ptr<retry_budget> b) && { return std::move(*this).set(op::budget, std::move(b));}
+
     /**
      * @brief Number of maximum tries count are setted with `ozo::retry_strategy::tries()`
      *
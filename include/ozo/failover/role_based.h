@@ -204,6 +204,15 @@ struct connection_source_supports_role <
     hana::when_valid<decltype(std::declval<Source>().rebind_role(std::declval<const Role&>()))>
 > : std::true_type {};
 
+template <typename Provider, typename Role, typename = hana::when<true>>
+struct connection_provider_has_circuit_breaker : std::false_type {};
+
+template <typename Provider, typename Role>
+struct connection_provider_has_circuit_breaker <
+    Provider, Role,
+    hana::when_valid<decltype(std::declval<const Provider&>().is_circuit_open(std::declval<const Role&>()))>
+> : std::true_type {};
+
 } // namespace detail
 
 /**
@@ -317,6 +326,31 @@ public:
         static_assert(ozo::TimeConstraint<TimeConstraint>, "should model TimeConstraint concept");
         ozo::unwrap(std::forward<Source>(source_))(io_, std::move(t), std::forward<Handler>(h));
     }
+
+    /**
+     * Determine whether connection attempts of the source are rejected by a circuit breaker,
+     * see `ozo::is_circuit_open()`.
+     */
+    template <typename S = Source>
+    auto is_circuit_open() const -> decltype(ozo::unwrap(std::declval<const S&>()).is_circuit_open()) {
+        return ozo::unwrap(source_).is_circuit_open();
+    }
+
+    /**
+     * Determine whether connection attempts of the source for an other role are rejected by
+     * a circuit breaker without rebinding the provider, see `ozo::is_circuit_open()`.
+     *
+     * @param r --- other role to examine.
+     */
+    template <typename OtherRole, typename S = Source>
+    auto is_circuit_open(const OtherRole& r) const -> decltype(ozo::unwrap(std::declval<const S&>()).is_circuit_open(r)) {
+        return ozo::unwrap(source_).is_circuit_open(r);
+    }
+
+    /**
+     * Get the `io_context` the provider is bound to.
+     */
+    io_context& get_io_context() const noexcept { return io_;}
 };
 
 template <typename T>
@@ -383,6 +417,23 @@ struct role_based_connection_source {
         std::move(sources_[role_])(io, std::move(t), std::forward<Handler>(h));
     }
 
+    /**
+     * Determine whether connection attempts of the source for the current role are rejected
+     * by a circuit breaker, see `ozo::is_circuit_open()`.
+     */
+    bool is_circuit_open() const {
+        return is_circuit_open(role_);
+    }
+
+    /**
+     * Determine whether connection attempts of the source for an other role are rejected
+     * by a circuit breaker, see `ozo::is_circuit_open()`.
+     */
+    template <typename OtherRole>
+    auto is_circuit_open(const OtherRole& r) const -> Require<is_supported<OtherRole>(), bool> {
+        return ozo::is_circuit_open(sources_[r]);
+    }
+
     constexpr auto operator[] (io_context& io) const & {
         return role_based_connection_provider(*this, io);
     }
@@ -482,12 +533,21 @@ public:
     }
 
     /**
-     * Time constraint for the try
+     * Time constraint for the try. The operation time constraint is divided between the roles
+     * which remain, except the roles with open circuits since they fail fast.
      *
      * @return time constraint type value calculated for the try
      */
     auto time_constraint() const {
-        return detail::get_try_time_constraint(ozo::unwrap(ctx_).time_constraint, tries_left().value);
+        return detail::get_try_time_constraint(ozo::unwrap(ctx_).time_constraint, healthy_tries_left());
+    }
+
+    /**
+     * Determine whether the connection source of the try's role rejects connection attempts
+     * by an open circuit breaker, see `ozo::is_circuit_open()`.
+     */
+    bool is_circuit_open() const {
+        return is_circuit_open(role());
     }
 
     /**
@@ -508,6 +568,32 @@ public:
         return decltype(hana::size(roles_seq()) - role_index()){};
     }
 
+    /**
+     * Tries left after this try except the tries of the roles with open circuits
+     *
+     * @return int --- number of tries left, at least 1 for the try itself.
+     */
+    int healthy_tries_left() const {
+        int result = 0;
+        hana::for_each(hana::drop_front(roles_seq(), role_index()), [&](const auto& r) {
+            result += is_circuit_open(r) ? 0 : 1;
+        });
+        return std::max(result, 1);
+    }
+
+private:
+    template <typename Role>
+    bool is_circuit_open(const Role& r) const {
+        using provider_type = std::decay_t<decltype(ozo::unwrap(ctx_).provider)>;
+        if constexpr (detail::connection_provider_has_circuit_breaker<provider_type, Role>::value) {
+            return ozo::unwrap(ctx_).provider.is_circuit_open(r);
+        } else {
+            return false;
+        }
+    }
+
+public:
+
     /**
      * Return next try object for retry operation if it possible. See
      * `ozo::fallback::get_next_try()` for details.
@@ -526,7 +612,9 @@ public:
             using fallback_try = role_based_try<Options, Context, decltype(role_index() + hana::size_c<1>)>;
             fallback_try fallback{std::move(options_), std::move(ctx_)};
 
-            if (can_recover(fallback.role(), ec)) {
+            // A role with an open circuit fails fast, so it is skipped in favour of the next one.
+            if (can_recover(fallback.role(), ec) && !(decltype(fallback.tries_left() > hana::size_c<1>)::value
+                    && fallback.is_circuit_open())) {
                 get_option(fallback.options(), opt::on_fallback, [](auto&&...){})(ec, conn, std::as_const(fallback));
                 init(std::move(fallback));
             } else {
@@ -364,6 +364,62 @@ inline auto initiate_next_try(Try& a_try, const error_code& ec, Connection& conn
 
 namespace detail {
 
+template <typename Try, typename = hana::when<true>>
+struct try_has_complete : std::false_type {};
+
+template <typename Try>
+struct try_has_complete<
+    Try,
+    hana::when_valid<decltype(std::declval<Try&>().complete(std::declval<const error_code&>()))>
+> : std::true_type {};
+
+} // namespace detail
+
+template <typename Try>
+struct complete_try_impl {
+    static void apply(Try& a_try, const error_code& ec) {
+        if constexpr (detail::try_has_complete<Try>::value) {
+            a_try.complete(ec);
+        }
+    }
+};
+
+/**
+ * @brief Notifies the try about its completion
+ *
+ * This function is called once for each try when the operation execution of the try is completed,
+ * either successfully or with an error, before the next try is requested. It allows a strategy
+ * to collect statistics of the tries, e.g. latency of hosts. By default it calls `a_try.complete(ec)`
+ * if the #FailoverTry has such member function and does nothing otherwise.
+ *
+ * @param a_try --- current #FailoverTry object.
+ * @param ec --- current try error code.
+ *
+ * ###Customization Point
+ *
+ * This function may be customized for a #FailoverTry via specialization
+ * of `ozo::failover::complete_try_impl`. E.g.:
+ * @code
+namespace ozo::failover {
+
+template <>
+struct complete_try_impl<my_strategy_try> {
+    static void apply(my_strategy_try& obj, const error_code& ec) {
+        obj.log_notice("try completed with {0}", ec);
+    }
+};
+
+} // namespace ozo::failover
+ * @endcode
+ * @ingroup group-failover-strategy
+ */
+template <typename Try>
+inline void complete_try(Try& a_try, const error_code& ec) {
+    ozo::detail::apply<complete_try_impl>(ozo::unwrap(a_try), ec);
+}
+
+namespace detail {
+
 template <template<typename...> typename Template, typename Allocator, typename ...Ts>
 static auto allocate_shared(const Allocator& alloc, Ts&& ...vs) {
     using type = decltype(Template{std::forward<Ts>(vs)...});
@@ -385,6 +441,7 @@ struct continuation {
     template <typename Connection>
     void operator() (error_code ec, Connection&& conn) {
         static_assert(ozo::Connection<Connection>, "conn should model Connection concept");
+        complete_try(try_, ec);
         if (ec) {
             bool initiated = false;
 
@@ -3,10 +3,12 @@
 #include <ozo/detail/wrap_executor.h>
 #include <ozo/detail/timeout_handler.h>
 #include <ozo/detail/deadline.h>
+#include <ozo/detail/oid_map_cache.h>
 #include <ozo/impl/io.h>
 #include <ozo/impl/request_oid_map.h>
 #include <ozo/time_traits.h>
 #include <ozo/connection.h>
+#include <ozo/statistics.h>
 
 #include <boost/asio/bind_executor.hpp>
 #include <boost/asio/steady_timer.hpp>
@@ -23,6 +25,7 @@ template <typename Connection, typename Handler>
 struct async_connect_op {
     Connection connection_;
     Handler handler_;
+    detail::statistics_stopwatch_t<decltype(unwrap_connection(std::declval<Connection&>()))> stopwatch_;
 
     auto& connection() noexcept {
         return unwrap_connection(connection_);
@@ -77,6 +80,12 @@ struct async_connect_op {
     }
 
     void done(error_code ec = error_code {}) {
+        if (ec) {
+            detail::update_statistics(connection(), statistics_key::connect_errors, std::uint64_t(1));
+        } else {
+            detail::update_statistics(connection(), statistics_key::connects, std::uint64_t(1));
+        }
+        detail::update_statistics(connection(), statistics_key::connect_time, stopwatch_.lap());
         handler_(std::move(ec), std::move(connection_));
     }
 
@@ -145,13 +154,44 @@ constexpr auto apply_oid_map_request(Handler&& handler) {
     }
 }
 
+template <typename Handler, typename OidMap>
+struct update_oid_map_cache_handler {
+    Handler handler_;
+    std::shared_ptr<detail::oid_map_cache<OidMap>> cache_;
+    typename detail::oid_map_cache<OidMap>::version_type version_;
+
+    template <typename Connection>
+    void operator() (error_code ec, Connection&& conn) {
+        if (!ec) {
+            cache_->update(unwrap_connection(conn).oid_map(), version_);
+        }
+        handler_(std::move(ec), std::forward<Connection>(conn));
+    }
+
+    using executor_type = asio::associated_executor_t<Handler>;
+
+    executor_type get_executor() const noexcept {
+        return asio::get_associated_executor(handler_);
+    }
+
+    using allocator_type = asio::associated_allocator_t<Handler>;
+
+    allocator_type get_allocator() const noexcept {
+        return asio::get_associated_allocator(handler_);
+    }
+};
+
+template <typename Handler, typename OidMap, typename Version>
+update_oid_map_cache_handler(Handler, std::shared_ptr<detail::oid_map_cache<OidMap>>, Version)
+    -> update_oid_map_cache_handler<Handler, OidMap>;
+
 template <typename TimeConstraint, typename Connection, typename Handler>
 inline auto apply_time_constaint(const TimeConstraint& t, [[maybe_unused]] Connection& conn, Handler&& handler) {
     if constexpr (IsNone<TimeConstraint>) {
         return detail::wrap_executor {get_executor(conn), std::forward<Handler>(handler)};
     } else {
         auto h = detail::wrap_executor {
-            ozo::detail::make_strand_executor(get_executor(conn)), std::forward<Handler>(handler)
+            ozo::detail::make_operation_executor(conn), std::forward<Handler>(handler)
         };
         return detail::io_deadline_handler<std::decay_t<decltype(unwrap_connection(conn))>, std::decay_t<decltype(h)>, Connection> {
             unwrap_connection(conn), t, std::move(h)
@@ -171,5 +211,32 @@ inline void async_connect(std::string conninfo, const TimeConstraint& t,
     op.perform(conninfo);
 }
 
+/**
+ * Connects with the oid map shared between connections of a source. If the map has been
+ * requested by a previous connection it is assigned to the connection and no oid request
+ * is performed, otherwise the map is requested and stored into the cache.
+ */
+template <typename Connection, typename TimeConstraint, typename OidMap, typename Handler>
+inline void async_connect(std::string conninfo, const TimeConstraint& t,
+        Connection&& conn, const std::shared_ptr<detail::oid_map_cache<OidMap>>& cache, Handler&& handler) {
+    static_assert(ozo::Connection<Connection>, "conn should model Connection concept");
+
+    if constexpr (OidMapEmpty<Connection>) {
+        async_connect(std::move(conninfo), t, std::forward<Connection>(conn), std::forward<Handler>(handler));
+    } else {
+        detail::set_oid_map_cache(unwrap_connection(conn), cache);
+        auto [oid_map, version] = cache->get();
+        if (oid_map) {
+            unwrap_connection(conn).oid_map() = std::move(*oid_map);
+            auto wrapped_handler = apply_time_constaint(t, conn, std::forward<Handler>(handler));
+            auto op = async_connect_op {std::forward<Connection>(conn), std::move(wrapped_handler)};
+            op.perform(conninfo);
+        } else {
+            async_connect(std::move(conninfo), t, std::forward<Connection>(conn),
+                update_oid_map_cache_handler{std::forward<Handler>(handler), cache, version});
+        }
+    }
+}
+
 } // namespace impl
 } // namespace ozo
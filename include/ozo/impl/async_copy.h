@@ -0,0 +1,648 @@
+#pragma once
+
+#include <ozo/impl/async_request.h>
+#include <ozo/io/copy.h>
+
+namespace ozo {
+namespace impl {
+
+/**
+* Size of the data chunk which is passed to libpq at once during the COPY.
+*/
+constexpr std::size_t copy_chunk_size = 64 * 1024;
+
+template <typename Columns>
+inline std::string make_copy_query(std::string_view table, const Columns& columns, std::string_view direction) {
+    std::string text = "COPY ";
+    text += table;
+    if (!std::empty(columns)) {
+        const char* delimiter = " (";
+        for (const auto& column : columns) {
+            text += delimiter;
+            text += column;
+            delimiter = ", ";
+        }
+        text += ")";
+    }
+    text += direction;
+    text += " (FORMAT binary)";
+    return text;
+}
+
+/**
+* Rows to be copied with the position of the next one and the buffer for the encoded data.
+* The state is allocated once per operation since the operation object is moved between
+* asynchronous calls, so iterators to the rows should not be stored in the operation itself.
+*/
+template <typename Rows>
+struct copy_in_state {
+    Rows rows;
+    decltype(std::begin(rows)) next;
+    std::vector<char> buffer;
+    bool header_written = false;
+    bool trailer_written = false;
+
+    copy_in_state(Rows rows) : rows(std::move(rows)), next(std::begin(this->rows)) {
+        buffer.reserve(copy_chunk_size);
+    }
+
+    template <typename OidMap>
+    void fill_buffer(const OidMap& oid_map) {
+        buffer.clear();
+        ostream out(buffer);
+        if (!header_written) {
+            write_copy_header(out);
+            header_written = true;
+        }
+        while (next != std::end(rows) && buffer.size() < copy_chunk_size) {
+            send_copy_row(out, oid_map, *next);
+            ++next;
+        }
+        if (next == std::end(rows)) {
+            write_copy_trailer(out);
+            trailer_written = true;
+        }
+    }
+};
+
+#include <boost/asio/yield.hpp>
+
+/**
+* Performs COPY FROM STDIN in the binary format. Rows are encoded into chunks of
+* `copy_chunk_size` bytes and each chunk is passed to libpq only after the previous one
+* has been flushed to the socket, so the memory consumption does not depend on the number
+* of rows, and the operation is throttled by the server consumption rate. If a row can not
+* be encoded the COPY is aborted with the exception message as the error message.
+*/
+template <typename Context, typename Rows>
+struct async_copy_in_op : boost::asio::coroutine {
+    Context ctx_;
+    std::string query_;
+    std::shared_ptr<copy_in_state<Rows>> state_;
+    using result_type = std::decay_t<decltype(get_result(get_connection(ctx_)))>;
+    result_type result_;
+    error_code ec_;
+    std::string abort_message_;
+    query_state flush_state_ = query_state::send_in_progress;
+    int put_state_ = 0;
+
+    async_copy_in_op(Context ctx, std::string query, std::shared_ptr<copy_in_state<Rows>> state)
+    : ctx_(std::move(ctx)), query_(std::move(query)), state_(std::move(state)) {}
+
+    void perform() {
+        (*this)();
+    }
+
+    void done(error_code ec) {
+        if (std::empty(get_error_context(get_connection(ctx_)))) {
+            get_connection(ctx_).set_error_context("error while copy in");
+        }
+        return impl::done(ctx_, ec);
+    }
+
+    void operator() (error_code ec = error_code{}, std::size_t = 0) {
+        if (ec) {
+            // Bad descriptor error can occur here if the connection
+            // has been closed by user during processing.
+            if (ec == asio::error::bad_descriptor) {
+                ec = asio::error::operation_aborted;
+            }
+            return done(ec);
+        }
+
+        reenter(*this) {
+            if (auto err = set_nonblocking(get_connection(ctx_))) {
+                return done(err);
+            }
+
+            if (!send_query(get_connection(ctx_), query_)) {
+                return done(error::pg_send_query_failed);
+            }
+
+            while ((flush_state_ = flush_output(get_connection(ctx_))) == query_state::send_in_progress) {
+                yield get_connection(ctx_).async_wait_write(std::move(*this));
+            }
+
+            if (flush_state_ == query_state::error) {
+                return done(error::pg_flush_failed);
+            }
+
+            while (is_busy(get_connection(ctx_))) {
+                yield get_connection(ctx_).async_wait_read(std::move(*this));
+                if (auto err = consume_input(get_connection(ctx_))) {
+                    return done(err);
+                }
+            }
+
+            result_ = get_result(get_connection(ctx_));
+
+            if (!result_) {
+                return done(error::result_status_unexpected);
+            }
+
+            if (result_status(*result_) != PGRES_COPY_IN) {
+                // Something went wrong, e.g. the table does not exist, so the
+                // result with the error should be handled as a usual.
+                for (;;) {
+                    handle_result();
+                    while (is_busy(get_connection(ctx_))) {
+                        yield get_connection(ctx_).async_wait_read(std::move(*this));
+                        if (auto err = consume_input(get_connection(ctx_))) {
+                            return done(err);
+                        }
+                    }
+                    result_ = get_result(get_connection(ctx_));
+                    if (!result_) {
+                        return finish();
+                    }
+                }
+            }
+
+            while (!state_->trailer_written) {
+                if (!fill_buffer()) {
+                    break;
+                }
+
+                while ((put_state_ = put_copy_data(get_connection(ctx_), state_->buffer)) == 0) {
+                    yield get_connection(ctx_).async_wait_write(std::move(*this));
+                }
+
+                if (put_state_ < 0) {
+                    return done(error::pg_put_copy_data_failed);
+                }
+
+                while ((flush_state_ = flush_output(get_connection(ctx_))) == query_state::send_in_progress) {
+                    yield get_connection(ctx_).async_wait_write(std::move(*this));
+                }
+
+                if (flush_state_ == query_state::error) {
+                    return done(error::pg_flush_failed);
+                }
+            }
+
+            while ((put_state_ = put_copy_end(get_connection(ctx_), abort_message())) == 0) {
+                yield get_connection(ctx_).async_wait_write(std::move(*this));
+            }
+
+            if (put_state_ < 0) {
+                return done(error::pg_put_copy_end_failed);
+            }
+
+            while ((flush_state_ = flush_output(get_connection(ctx_))) == query_state::send_in_progress) {
+                yield get_connection(ctx_).async_wait_write(std::move(*this));
+            }
+
+            if (flush_state_ == query_state::error) {
+                return done(error::pg_flush_failed);
+            }
+
+            for (;;) {
+                while (is_busy(get_connection(ctx_))) {
+                    yield get_connection(ctx_).async_wait_read(std::move(*this));
+                    if (auto err = consume_input(get_connection(ctx_))) {
+                        return done(err);
+                    }
+                }
+
+                result_ = get_result(get_connection(ctx_));
+
+                if (!result_) {
+                    return finish();
+                }
+
+                handle_result();
+            }
+        }
+    }
+
+    bool fill_buffer() noexcept {
+        try {
+            state_->fill_buffer(get_connection(ctx_).oid_map());
+        } catch (const std::exception& e) {
+            abort_message_ = e.what();
+            if (std::empty(abort_message_)) {
+                abort_message_ = "row encoding failed";
+            }
+            return false;
+        }
+        return true;
+    }
+
+    const char* abort_message() const noexcept {
+        return std::empty(abort_message_) ? nullptr : abort_message_.c_str();
+    }
+
+    void handle_result() {
+        if (ec_) {
+            return;
+        }
+        const auto status = result_status(*result_);
+        switch (status) {
+            case PGRES_COMMAND_OK:
+                return;
+            case PGRES_FATAL_ERROR:
+                ec_ = result_error(*result_);
+                if (!std::empty(abort_message_)) {
+                    get_connection(ctx_).set_error_context(abort_message_);
+                }
+                return;
+            default:
+                break;
+        }
+        get_connection(ctx_).set_error_context(get_result_status_name(status));
+        ec_ = error::result_status_unexpected;
+    }
+
+    void finish() {
+        if (ec_) {
+            return done(ec_);
+        }
+        impl::done(ctx_);
+    }
+
+    using executor_type = std::decay_t<decltype(asio::get_associated_executor(get_handler(ctx_)))>;
+
+    executor_type get_executor() const noexcept {
+        return asio::get_associated_executor(get_handler(ctx_));
+    }
+
+    using allocator_type = std::decay_t<decltype(asio::get_associated_allocator(get_handler(ctx_)))>;
+
+    allocator_type get_allocator() const noexcept {
+        return asio::get_associated_allocator(get_handler(ctx_));
+    }
+};
+
+template <typename Context, typename Rows>
+async_copy_in_op(Context, std::string, std::shared_ptr<copy_in_state<Rows>>) -> async_copy_in_op<Context, Rows>;
+
+#include <boost/asio/unyield.hpp>
+
+template <typename Context, typename Rows>
+inline void async_copy_in(Context ctx, std::string query, Rows&& rows) {
+    using state_type = copy_in_state<std::decay_t<Rows>>;
+    auto state = std::allocate_shared<state_type>(
+        get_allocator(ctx), std::forward<Rows>(rows));
+    async_copy_in_op op{std::move(ctx), std::move(query), std::move(state)};
+    op.perform();
+}
+
+template <typename Rows, typename TimeConstraint, typename Handler>
+struct async_copy_in_request_op {
+    std::string query_;
+    Rows rows_;
+    TimeConstraint time_constraint_;
+    Handler handler_;
+
+    async_copy_in_request_op(std::string query, Rows rows, TimeConstraint time_constrain, Handler handler)
+    : query_(std::move(query)), rows_(std::move(rows)), time_constraint_(time_constrain), handler_(std::move(handler)) {}
+
+    template <typename Connection, typename SourceHandler, typename Allocator>
+    auto apply_time_constaint (Connection& conn, SourceHandler&& handler,
+            [[maybe_unused]] const Allocator& allocator) const {
+        if constexpr (IsNone<TimeConstraint>) {
+            return std::forward<SourceHandler>(handler);
+        } else {
+            return detail::io_deadline_handler<std::decay_t<decltype(unwrap_connection(conn))>, std::decay_t<SourceHandler>, Connection> {
+                unwrap_connection(conn), time_constraint_, std::forward<SourceHandler>(handler), allocator
+            };
+        }
+    }
+
+    template <typename Connection>
+    void operator() (error_code ec, Connection conn) {
+        if (ec) {
+            return handler_(ec, std::move(conn));
+        }
+
+        const auto allocator = detail::make_operation_arena_allocator(handler_,
+            detail::operation_arena_capacity<Handler, Rows>);
+
+        auto handler = apply_time_constaint(conn, detail::wrap_executor {
+            detail::make_operation_executor(conn),
+            std::move(handler_)
+        }, allocator);
+
+        auto ctx = make_request_operation_context(std::move(conn), std::move(handler), allocator);
+
+        async_copy_in(std::move(ctx), std::move(query_), std::move(rows_));
+    }
+
+    using executor_type = std::decay_t<decltype(asio::get_associated_executor(handler_))>;
+
+    executor_type get_executor() const noexcept {
+        return asio::get_associated_executor(handler_);
+    }
+
+    using allocator_type = std::decay_t<decltype(asio::get_associated_allocator(handler_))>;
+
+    allocator_type get_allocator() const noexcept {
+        return asio::get_associated_allocator(handler_);
+    }
+};
+
+template <typename Rows, typename TimeConstraint, typename Handler>
+async_copy_in_request_op(std::string, Rows, TimeConstraint, Handler) -> async_copy_in_request_op<Rows, TimeConstraint, Handler>;
+
+template <typename P, typename Rows, typename TimeConstraint, typename Handler>
+inline void async_copy_in_request(P&& provider, std::string query, Rows&& rows, TimeConstraint t, Handler&& handler) {
+    static_assert(ConnectionProvider<P>, "is not a ConnectionProvider");
+    static_assert(Iterable<std::decay_t<Rows>>, "rows should be an Iterable");
+    static_assert(ozo::TimeConstraint<TimeConstraint>, "should model TimeConstraint concept");
+    async_get_connection(std::forward<P>(provider), deadline(t),
+        async_copy_in_request_op{
+            std::move(query),
+            std::forward<Rows>(rows),
+            deadline(t),
+            std::forward<Handler>(handler)
+        }
+    );
+}
+
+template <typename OidMap, typename Out>
+inline Require<InsertIterator<Out>, bool> recv_copy_data(istream& in, const OidMap& oid_map, Out& out) {
+    typename Out::container_type::value_type v{};
+    if (!recv_copy_row(in, oid_map, v)) {
+        return false;
+    }
+    *out++ = std::move(v);
+    return true;
+}
+
+template <typename OidMap, typename Out>
+inline auto recv_copy_data(istream& in, const OidMap& oid_map, Out& out) -> decltype(out(in, oid_map)) {
+    return out(in, oid_map);
+}
+
+#include <boost/asio/yield.hpp>
+
+/**
+* Performs COPY TO STDOUT in the binary format. The server sends each tuple in a separate
+* CopyData message, the header is prepended to the first one, and the trailer is sent
+* in the last one. So every message received via PQgetCopyData is decoded into a single
+* row immediately and released, and the memory consumption does not depend on the number
+* of rows. If a row can not be decoded the rest of the data is consumed without decoding,
+* so the connection stays consistent and reusable.
+*/
+template <typename Context, typename Out>
+struct async_copy_out_op : boost::asio::coroutine {
+    Context ctx_;
+    std::string query_;
+    Out out_;
+    using result_type = std::decay_t<decltype(get_result(get_connection(ctx_)))>;
+    result_type result_;
+    error_code ec_;
+    query_state flush_state_ = query_state::send_in_progress;
+    int get_state_ = 0;
+    bool header_read_ = false;
+
+    async_copy_out_op(Context ctx, std::string query, Out out)
+    : ctx_(std::move(ctx)), query_(std::move(query)), out_(std::move(out)) {}
+
+    void perform() {
+        (*this)();
+    }
+
+    void done(error_code ec) {
+        if (std::empty(get_error_context(get_connection(ctx_)))) {
+            get_connection(ctx_).set_error_context("error while copy out");
+        }
+        return impl::done(ctx_, ec);
+    }
+
+    void operator() (error_code ec = error_code{}, std::size_t = 0) {
+        if (ec) {
+            // Bad descriptor error can occur here if the connection
+            // has been closed by user during processing.
+            if (ec == asio::error::bad_descriptor) {
+                ec = asio::error::operation_aborted;
+            }
+            return done(ec);
+        }
+
+        reenter(*this) {
+            if (auto err = set_nonblocking(get_connection(ctx_))) {
+                return done(err);
+            }
+
+            if (!send_query(get_connection(ctx_), query_)) {
+                return done(error::pg_send_query_failed);
+            }
+
+            while ((flush_state_ = flush_output(get_connection(ctx_))) == query_state::send_in_progress) {
+                yield get_connection(ctx_).async_wait_write(std::move(*this));
+            }
+
+            if (flush_state_ == query_state::error) {
+                return done(error::pg_flush_failed);
+            }
+
+            while (is_busy(get_connection(ctx_))) {
+                yield get_connection(ctx_).async_wait_read(std::move(*this));
+                if (auto err = consume_input(get_connection(ctx_))) {
+                    return done(err);
+                }
+            }
+
+            result_ = get_result(get_connection(ctx_));
+
+            if (!result_) {
+                return done(error::result_status_unexpected);
+            }
+
+            if (result_status(*result_) == PGRES_COPY_OUT) {
+                while ((get_state_ = get_copy_data()) != -1) {
+                    if (get_state_ < -1) {
+                        return done(error::pg_get_copy_data_failed);
+                    }
+                    if (get_state_ == 0) {
+                        yield get_connection(ctx_).async_wait_read(std::move(*this));
+                        if (auto err = consume_input(get_connection(ctx_))) {
+                            return done(ec_ ? ec_ : err);
+                        }
+                    }
+                }
+
+                while (is_busy(get_connection(ctx_))) {
+                    yield get_connection(ctx_).async_wait_read(std::move(*this));
+                    if (auto err = consume_input(get_connection(ctx_))) {
+                        return done(ec_ ? ec_ : err);
+                    }
+                }
+
+                result_ = get_result(get_connection(ctx_));
+
+                if (!result_) {
+                    return finish();
+                }
+            }
+
+            // The result of the COPY itself or an error, e.g. if the table
+            // does not exist, which should be handled as a usual.
+            for (;;) {
+                handle_result();
+                while (is_busy(get_connection(ctx_))) {
+                    yield get_connection(ctx_).async_wait_read(std::move(*this));
+                    if (auto err = consume_input(get_connection(ctx_))) {
+                        return done(ec_ ? ec_ : err);
+                    }
+                }
+                result_ = get_result(get_connection(ctx_));
+                if (!result_) {
+                    return finish();
+                }
+            }
+        }
+    }
+
+    int get_copy_data() {
+        pg::copy_data data;
+        const int size = impl::get_copy_data(get_connection(ctx_), data);
+        if (size > 0 && !ec_) {
+            decode(data.get(), size);
+        }
+        return size;
+    }
+
+    void decode(const char* data, int size) noexcept {
+        try {
+            istream in(data, size);
+            if (!header_read_) {
+                read_copy_header(in);
+                header_read_ = true;
+            }
+            recv_copy_data(in, get_connection(ctx_).oid_map(), out_);
+        } catch (const system_error& e) {
+            detail::invalidate_oid_map_cache_on_error(get_connection(ctx_), e.code());
+            set_error(e.code(), e.what());
+        } catch (const std::exception& e) {
+            set_error(error::bad_result_process, e.what());
+        }
+    }
+
+    void set_error(error_code ec, std::string context) {
+        ec_ = ec;
+        get_connection(ctx_).set_error_context(std::move(context));
+    }
+
+    void handle_result() {
+        if (ec_) {
+            return;
+        }
+        const auto status = result_status(*result_);
+        switch (status) {
+            case PGRES_COMMAND_OK:
+                return;
+            case PGRES_FATAL_ERROR:
+                ec_ = result_error(*result_);
+                return;
+            default:
+                break;
+        }
+        set_error(error::result_status_unexpected, get_result_status_name(status));
+    }
+
+    void finish() {
+        if (ec_) {
+            return done(ec_);
+        }
+        impl::done(ctx_);
+    }
+
+    using executor_type = std::decay_t<decltype(asio::get_associated_executor(get_handler(ctx_)))>;
+
+    executor_type get_executor() const noexcept {
+        return asio::get_associated_executor(get_handler(ctx_));
+    }
+
+    using allocator_type = std::decay_t<decltype(asio::get_associated_allocator(get_handler(ctx_)))>;
+
+    allocator_type get_allocator() const noexcept {
+        return asio::get_associated_allocator(get_handler(ctx_));
+    }
+};
+
+template <typename Context, typename Out>
+async_copy_out_op(Context, std::string, Out) -> async_copy_out_op<Context, Out>;
+
+#include <boost/asio/unyield.hpp>
+
+template <typename Context, typename Out>
+inline void async_copy_out(Context ctx, std::string query, Out&& out) {
+    async_copy_out_op op{std::move(ctx), std::move(query), std::forward<Out>(out)};
+    op.perform();
+}
+
+template <typename Out, typename TimeConstraint, typename Handler>
+struct async_copy_out_request_op {
+    std::string query_;
+    Out out_;
+    TimeConstraint time_constraint_;
+    Handler handler_;
+
+    async_copy_out_request_op(std::string query, Out out, TimeConstraint time_constrain, Handler handler)
+    : query_(std::move(query)), out_(std::move(out)), time_constraint_(time_constrain), handler_(std::move(handler)) {}
+
+    template <typename Connection, typename SourceHandler, typename Allocator>
+    auto apply_time_constaint (Connection& conn, SourceHandler&& handler,
+            [[maybe_unused]] const Allocator& allocator) const {
+        if constexpr (IsNone<TimeConstraint>) {
+            return std::forward<SourceHandler>(handler);
+        } else {
+            return detail::io_deadline_handler<std::decay_t<decltype(unwrap_connection(conn))>, std::decay_t<SourceHandler>, Connection> {
+                unwrap_connection(conn), time_constraint_, std::forward<SourceHandler>(handler), allocator
+            };
+        }
+    }
+
+    template <typename Connection>
+    void operator() (error_code ec, Connection conn) {
+        if (ec) {
+            return handler_(ec, std::move(conn));
+        }
+
+        const auto allocator = detail::make_operation_arena_allocator(handler_,
+            detail::operation_arena_capacity<Handler, Out>);
+
+        auto handler = apply_time_constaint(conn, detail::wrap_executor {
+            detail::make_operation_executor(conn),
+            std::move(handler_)
+        }, allocator);
+
+        auto ctx = make_request_operation_context(std::move(conn), std::move(handler), allocator);
+
+        async_copy_out(std::move(ctx), std::move(query_), std::move(out_));
+    }
+
+    using executor_type = std::decay_t<decltype(asio::get_associated_executor(handler_))>;
+
+    executor_type get_executor() const noexcept {
+        return asio::get_associated_executor(handler_);
+    }
+
+    using allocator_type = std::decay_t<decltype(asio::get_associated_allocator(handler_))>;
+
+    allocator_type get_allocator() const noexcept {
+        return asio::get_associated_allocator(handler_);
+    }
+};
+
+template <typename Out, typename TimeConstraint, typename Handler>
+async_copy_out_request_op(std::string, Out, TimeConstraint, Handler) -> async_copy_out_request_op<Out, TimeConstraint, Handler>;
+
+template <typename P, typename Out, typename TimeConstraint, typename Handler>
+inline void async_copy_out_request(P&& provider, std::string query, Out&& out, TimeConstraint t, Handler&& handler) {
+    static_assert(ConnectionProvider<P>, "is not a ConnectionProvider");
+    static_assert(ozo::TimeConstraint<TimeConstraint>, "should model TimeConstraint concept");
+    async_get_connection(std::forward<P>(provider), deadline(t),
+        async_copy_out_request_op{
+            std::move(query),
+            std::forward<Out>(out),
+            deadline(t),
+            std::forward<Handler>(handler)
+        }
+    );
+}
+
+} // namespace impl
+} // namespace ozo
@@ -0,0 +1,472 @@
+#pragma once
+
+#include <ozo/impl/async_request.h>
+
+#include <boost/hana/concept/foldable.hpp>
+#include <boost/hana/for_each.hpp>
+
+#include <iterator>
+#include <optional>
+
+#ifndef LIBPQ_HAS_PIPELINING
+#error "ozo::pipeline requires libpq with the pipeline mode support (PostgreSQL 14 or newer)"
+#endif
+
+namespace ozo {
+namespace impl {
+
+template <typename Steps>
+inline constexpr auto PipelineSteps = hana::Foldable<Steps>::value || Iterable<Steps>;
+
+template <typename Steps, typename Function>
+inline void for_each_pipeline_step(Steps& steps, Function&& f) {
+    if constexpr (hana::Foldable<Steps>::value) {
+        hana::for_each(steps, std::forward<Function>(f));
+    } else {
+        for (auto& step : steps) {
+            f(step);
+        }
+    }
+}
+
+/**
+ * Position of the pipeline step which gets the next result. Results are received in
+ * the order of the steps, so the steps are iterated only once for the whole pipeline.
+ * The position of random access steps is kept as an index since moving an array
+ * invalidates its iterators. Moving other containers keeps iterators valid, so their
+ * iterator is kept while the result handler is moved between asynchronous operations.
+ */
+template <typename Steps, typename = hana::when<true>>
+struct pipeline_steps_cursor {
+    template <typename Function>
+    void apply(Steps& steps, std::size_t n, Function&& f) {
+        std::size_t i = 0;
+        hana::for_each(steps, [&](auto& step) {
+            if (i++ == n) {
+                f(step);
+            }
+        });
+    }
+};
+
+template <typename Steps>
+struct pipeline_steps_cursor<Steps, hana::when<!hana::Foldable<Steps>::value>> {
+    using iterator = decltype(std::begin(std::declval<Steps&>()));
+    using iterator_category = typename std::iterator_traits<iterator>::iterator_category;
+
+    std::optional<iterator> pos_;
+    std::size_t index_ = 0;
+
+    template <typename Function>
+    void apply(Steps& steps, std::size_t n, Function&& f) {
+        if constexpr (std::is_base_of_v<std::random_access_iterator_tag, iterator_category>) {
+            f(*std::next(std::begin(steps), n));
+        } else {
+            if (!pos_ || n < index_) {
+                pos_.emplace(std::begin(steps));
+                index_ = 0;
+            }
+            std::advance(*pos_, n - index_);
+            index_ = n;
+            f(**pos_);
+        }
+    }
+};
+
+/**
+ * Completes the pipeline which has no pending results. If the connection can not leave
+ * the pipeline mode it is closed, so it is not reused, and the exit error is reported.
+ */
+template <typename Context>
+inline void pipeline_done(const Context& ctx, error_code ec) {
+    if (auto exit_ec = exit_pipeline_mode(get_connection(ctx))) {
+        close_connection(get_connection(ctx));
+        ec = std::move(exit_ec);
+    }
+    done(ctx, std::move(ec));
+}
+
+/**
+ * Completes the pipeline which has pending results and can not be synchronized, so the
+ * connection can not leave the pipeline mode and is closed to be not reused.
+ */
+template <typename Context>
+inline void pipeline_abort(const Context& ctx, error_code ec) {
+    close_connection(get_connection(ctx));
+    done(ctx, std::move(ec));
+}
+
+template <typename Context>
+struct async_send_pipeline_op {
+    Context ctx_;
+
+    async_send_pipeline_op(Context ctx) : ctx_(std::move(ctx)) {}
+
+    /**
+     * Sends the queries of the pipeline and the sync point. If a query can not be sent after
+     * some of them have been, the pipeline is synchronized anyway, so the results of the sent
+     * queries are drained and the connection stays reusable. The send error is returned to be
+     * reported by the result operation after the sync point.
+     */
+    template <typename Steps>
+    error_code perform(const Steps& steps) {
+        decltype(auto) conn = get_connection(ctx_);
+        if (auto ec = set_nonblocking(conn)) {
+            done(ctx_, ec);
+            return {};
+        }
+
+        if (auto ec = enter_pipeline_mode(conn)) {
+            done(ctx_, ec);
+            return {};
+        }
+
+        std::size_t sent = 0;
+        error_code send_ec;
+        for_each_pipeline_step(steps, [&](const auto& step) {
+            if (!send_ec) {
+                const auto query = to_binary_query(step.query, conn.oid_map(),
+                    impl::get_allocator(ctx_));
+                if (!send_query_params(conn, query)) {
+                    send_ec = error::pg_send_query_params_failed;
+                    return;
+                }
+                if constexpr (std::decay_t<decltype(*ctx_)>::collects_statistics) {
+                    impl::update_statistics(ctx_, statistics_key::requests, std::uint64_t(1));
+                    impl::update_statistics(ctx_, statistics_key::bytes_sent, std::uint64_t(sent_size(query)));
+                }
+                ++sent;
+            }
+        });
+
+        if (send_ec && sent == 0) {
+            pipeline_done(ctx_, send_ec);
+            return {};
+        }
+
+        if (auto ec = pipeline_sync(conn)) {
+            pipeline_abort(ctx_, ec);
+            return {};
+        }
+
+        if (send_ec) {
+            get_connection(ctx_).set_error_context("error while send pipeline query #" + std::to_string(sent));
+        }
+
+        // All the queries of the pipeline are answered up to the sync point in one round trip.
+        impl::update_statistics(ctx_, statistics_key::round_trips, std::uint64_t(1));
+
+        (*this)();
+        return send_ec;
+    }
+
+    void operator () (error_code ec = error_code{}, std::size_t = 0) {
+        // if data has been flushed or error has been set by
+        // read operation no write operation handling is needed
+        // anymore.
+        if (get_query_state(ctx_) != query_state::send_in_progress) {
+            return;
+        }
+
+        if (ec) {
+            return done(ctx_, ec);
+        }
+
+        switch (flush_output(get_connection(ctx_))) {
+            case query_state::error:
+                done(ctx_, error::pg_flush_failed);
+                break;
+            case query_state::send_in_progress:
+                get_connection(ctx_).async_wait_write(std::move(*this));
+                break;
+            case query_state::send_finish:
+                set_query_state(ctx_, query_state::send_finish);
+                break;
+        }
+    }
+
+    using executor_type = std::decay_t<decltype(asio::get_associated_executor(get_handler(ctx_)))>;
+
+    executor_type get_executor() const noexcept {
+        return asio::get_associated_executor(get_handler(ctx_));
+    }
+
+    using allocator_type = std::decay_t<decltype(asio::get_associated_allocator(get_handler(ctx_)))>;
+
+    allocator_type get_allocator() const noexcept {
+        return asio::get_associated_allocator(get_handler(ctx_));
+    }
+};
+
+template <typename Context>
+async_send_pipeline_op(Context) -> async_send_pipeline_op<Context>;
+
+template <typename Context, typename Steps>
+error_code async_send_pipeline(Context ctx, const Steps& steps) {
+    async_send_pipeline_op op{std::move(ctx)};
+    return op.perform(steps);
+}
+
+#include <boost/asio/yield.hpp>
+
+/**
+ * Receives results of the pipelined queries. The libpq delivers results of each
+ * query followed by nullptr result, and the whole pipeline is terminated
+ * by the PGRES_PIPELINE_SYNC result. Results are passed to the processor with
+ * the index of the query they belong to. The first error is remembered and
+ * reported after the pipeline synchronization point has been reached, so the
+ * connection stays consistent and reusable after a query failure. The error of
+ * a query which has not been sent is passed on construction and is reported
+ * the same way.
+ */
+template <typename Context, typename ResultProcessor>
+struct async_get_pipeline_result_op : boost::asio::coroutine {
+    Context ctx_;
+    ResultProcessor process_;
+    using result_type = std::decay_t<decltype(get_result(get_connection(ctx_)))>;
+    result_type result_;
+    std::size_t index_ = 0;
+    error_code ec_;
+
+    async_get_pipeline_result_op(Context ctx, ResultProcessor process, error_code ec = error_code{})
+    : ctx_(ctx), process_(process), ec_(ec) {}
+
+    void perform() {
+        (*this)();
+    }
+
+    void done(error_code ec) {
+        if (std::empty(get_error_context(get_connection(ctx_)))) {
+            get_connection(ctx_).set_error_context("error while get pipeline result");
+        }
+        return impl::done(ctx_, ec);
+    }
+
+    void operator() (error_code ec = error_code{}, std::size_t = 0) {
+        // In case when query error state has been set by send pipeline
+        // operation skip handle and do nothing more.
+        if (get_query_state(ctx_) == query_state::error) {
+            return;
+        }
+
+        if (ec) {
+            // Bad descriptor error can occur here if the connection
+            // has been closed by user during processing.
+            if (ec == asio::error::bad_descriptor) {
+                ec = asio::error::operation_aborted;
+            }
+            return done(ec);
+        }
+
+        reenter(*this) {
+            for (;;) {
+                while (is_busy(get_connection(ctx_))) {
+                    yield get_connection(ctx_).async_wait_read(std::move(*this));
+                    if (auto err = consume_input(get_connection(ctx_))) {
+                        return done(err);
+                    }
+                }
+
+                result_ = get_result(get_connection(ctx_));
+
+                if (!result_) {
+                    ++index_;
+                } else if (result_status(*result_) == PGRES_PIPELINE_SYNC) {
+                    return finish();
+                } else {
+                    handle_result();
+                }
+            }
+        }
+    }
+
+    void handle_result() {
+        const auto status = result_status(*result_);
+        switch (status) {
+            case PGRES_TUPLES_OK:
+            case PGRES_COMMAND_OK:
+                process(std::move(result_));
+                return;
+            case PGRES_PIPELINE_ABORTED:
+                // The pipeline has been aborted by the previous query failure
+                // which error is already stored.
+                return;
+            case PGRES_BAD_RESPONSE:
+                set_error(error::result_status_bad_response);
+                return;
+            case PGRES_EMPTY_QUERY:
+                set_error(error::result_status_empty_query);
+                return;
+            case PGRES_FATAL_ERROR:
+                set_error(result_error(*result_));
+                return;
+            case PGRES_SINGLE_TUPLE:
+            case PGRES_COPY_OUT:
+            case PGRES_COPY_IN:
+            case PGRES_COPY_BOTH:
+            case PGRES_NONFATAL_ERROR:
+            case PGRES_PIPELINE_SYNC:
+#ifdef LIBPQ_HAS_CHUNK_MODE
+            case PGRES_TUPLES_CHUNK:
+#endif
+                break;
+        }
+
+        set_error(error::result_status_unexpected, get_result_status_name(status));
+    }
+
+    void set_error(error_code ec, std::string context = {}) {
+        if (!ec_) {
+            ec_ = ec;
+            if (std::empty(context)) {
+                context = "error in pipeline query #" + std::to_string(index_);
+            }
+            get_connection(ctx_).set_error_context(std::move(context));
+        }
+    }
+
+    template <typename Result>
+    void process(Result&& res) noexcept {
+        if (ec_) {
+            return;
+        }
+        try {
+            process_(index_, std::forward<Result>(res), get_connection(ctx_));
+        } catch (const system_error& e) {
+            detail::invalidate_oid_map_cache_on_error(get_connection(ctx_), e.code());
+            set_error(error::bad_result_process, e.what());
+        } catch (const std::exception& e) {
+            set_error(error::bad_result_process, e.what());
+        }
+    }
+
+    void finish() {
+        if (auto ec = exit_pipeline_mode(get_connection(ctx_))) {
+            close_connection(get_connection(ctx_));
+            set_error(ec);
+        }
+        if (ec_) {
+            return impl::done(ctx_, ec_);
+        }
+        impl::done(ctx_);
+    }
+
+    using executor_type = std::decay_t<decltype(asio::get_associated_executor(get_handler(ctx_)))>;
+
+    executor_type get_executor() const noexcept {
+        return asio::get_associated_executor(get_handler(ctx_));
+    }
+
+    using allocator_type = std::decay_t<decltype(asio::get_associated_allocator(get_handler(ctx_)))>;
+
+    allocator_type get_allocator() const noexcept {
+        return asio::get_associated_allocator(get_handler(ctx_));
+    }
+};
+
+template <typename Context, typename ResultProcessor>
+async_get_pipeline_result_op(Context, ResultProcessor) -> async_get_pipeline_result_op<Context, ResultProcessor>;
+
+template <typename Context, typename ResultProcessor>
+async_get_pipeline_result_op(Context, ResultProcessor, error_code) -> async_get_pipeline_result_op<Context, ResultProcessor>;
+
+#include <boost/asio/unyield.hpp>
+
+template <typename Context, typename ResultProcessor>
+inline void async_get_pipeline_result(Context&& ctx, ResultProcessor&& p, error_code ec = error_code{}) {
+    async_get_pipeline_result_op op{std::forward<Context>(ctx), std::forward<ResultProcessor>(p), ec};
+    op.perform();
+}
+
+template <typename Steps>
+struct async_pipeline_out_handler {
+    Steps steps;
+    pipeline_steps_cursor<Steps> cursor;
+
+    async_pipeline_out_handler(Steps steps) : steps(std::move(steps)) {}
+
+    template <typename Handle, typename Conn>
+    void operator() (std::size_t n, Handle&& h, Conn& conn) {
+        cursor.apply(steps, n, [&] (auto& step) {
+            auto res = ozo::make_result(std::forward<Handle>(h));
+            ozo::recv_result(res, ozo::unwrap_connection(conn).oid_map(), step.out);
+        });
+    }
+};
+
+template <typename Steps>
+async_pipeline_out_handler(Steps) -> async_pipeline_out_handler<Steps>;
+
+template <typename Steps, typename TimeConstraint, typename Handler>
+struct async_pipeline_op {
+    Steps steps_;
+    TimeConstraint time_constraint_;
+    Handler handler_;
+
+    async_pipeline_op(Steps steps, TimeConstraint time_constrain, Handler handler)
+    : steps_(std::move(steps)), time_constraint_(time_constrain), handler_(std::move(handler)) {}
+
+    template <typename Connection, typename SourceHandler, typename Allocator>
+    auto apply_time_constaint (Connection& conn, SourceHandler&& handler,
+            [[maybe_unused]] const Allocator& allocator) const {
+        if constexpr (IsNone<TimeConstraint>) {
+            return std::forward<SourceHandler>(handler);
+        } else {
+            return detail::io_deadline_handler<std::decay_t<decltype(unwrap_connection(conn))>, std::decay_t<SourceHandler>, Connection> {
+                unwrap_connection(conn), time_constraint_, std::forward<SourceHandler>(handler), allocator
+            };
+        }
+    }
+
+    template <typename Connection>
+    void operator() (error_code ec, Connection conn) {
+        if (ec) {
+            return handler_(ec, std::move(conn));
+        }
+
+        const auto allocator = detail::make_operation_arena_allocator(handler_,
+            detail::operation_arena_capacity<Handler, Steps>);
+
+        auto handler = apply_time_constaint(conn, detail::wrap_executor {
+            detail::make_operation_executor(conn),
+            std::move(handler_)
+        }, allocator);
+
+        auto ctx = make_request_operation_context(std::move(conn), std::move(handler), allocator);
+
+        auto send_ec = async_send_pipeline(ctx, steps_);
+        async_get_pipeline_result(std::move(ctx), async_pipeline_out_handler{std::move(steps_)}, send_ec);
+    }
+
+    using executor_type = std::decay_t<decltype(asio::get_associated_executor(handler_))>;
+
+    executor_type get_executor() const noexcept {
+        return asio::get_associated_executor(handler_);
+    }
+
+    using allocator_type = std::decay_t<decltype(asio::get_associated_allocator(handler_))>;
+
+    allocator_type get_allocator() const noexcept {
+        return asio::get_associated_allocator(handler_);
+    }
+};
+
+template <typename Steps, typename TimeConstraint, typename Handler>
+async_pipeline_op(Steps, TimeConstraint, Handler) -> async_pipeline_op<Steps, TimeConstraint, Handler>;
+
+template <typename P, typename Steps, typename TimeConstraint, typename Handler>
+inline void async_pipeline(P&& provider, Steps&& steps, TimeConstraint t, Handler&& handler) {
+    static_assert(ConnectionProvider<P>, "is not a ConnectionProvider");
+    static_assert(PipelineSteps<std::decay_t<Steps>>, "steps should be a hana::Foldable or an Iterable of pipeline steps");
+    static_assert(ozo::TimeConstraint<TimeConstraint>, "should model TimeConstraint concept");
+    async_get_connection(std::forward<P>(provider), deadline(t),
+        async_pipeline_op{
+            std::forward<Steps>(steps),
+            deadline(t),
+            std::forward<Handler>(handler)
+        }
+    );
+}
+
+} // namespace impl
+} // namespace ozo
@@ -1,37 +1,60 @@
 #pragma once
 
 #include <ozo/detail/deadline.h>
+#include <ozo/detail/oid_map_cache.h>
 #include <ozo/detail/timeout_handler.h>
 #include <ozo/detail/wrap_executor.h>
+#include <ozo/recycling_allocator.h>
 #include <ozo/impl/io.h>
 #include <ozo/io/binary_query.h>
 #include <ozo/connection.h>
 #include <ozo/query_builder.h>
 #include <ozo/deadline.h>
+#include <ozo/statement_cache.h>
+#include <ozo/statistics.h>
 
 #include <boost/asio/bind_executor.hpp>
 #include <boost/asio/coroutine.hpp>
 
+#include <cstring>
+#include <numeric>
+
 namespace ozo {
 namespace impl {
 
-template <typename Connection, typename Handler>
+template <typename Connection, typename Handler,
+          typename Allocator = decltype(detail::get_operation_allocator(std::declval<const std::decay_t<Handler>&>()))>
 struct request_operation_context {
+    using connection_type = std::decay_t<decltype(unwrap_connection(std::declval<std::decay_t<Connection>&>()))>;
+    static constexpr bool collects_statistics = detail::CollectsStatistics<connection_type>;
+
     std::decay_t<Connection> conn;
     std::decay_t<Handler> handler;
+    Allocator allocator;
     query_state state = query_state::send_in_progress;
+    detail::statistics_stopwatch<collects_statistics> stopwatch;
 
-    request_operation_context(Connection conn, Handler handler)
+    request_operation_context(Connection conn, Handler handler, const Allocator& allocator)
       : conn(std::forward<Connection>(conn)),
-        handler(std::forward<Handler>(handler)) {}
+        handler(std::forward<Handler>(handler)),
+        allocator(allocator) {}
 };
 
+/**
+* Creates the context of the operation. The context and the rest of the operation state,
+* e.g. the binary query, are allocated with the allocator.
+*/
+template <typename Connection, typename Handler, typename Allocator>
+inline decltype(auto) make_request_operation_context(Connection&& conn, Handler&& h, const Allocator& allocator) {
+    return std::allocate_shared<request_operation_context<Connection, Handler, Allocator>>(
+        allocator, std::forward<Connection>(conn), std::forward<Handler>(h), allocator
+    );
+}
+
 template <typename Connection, typename Handler>
 inline decltype(auto) make_request_operation_context(Connection&& conn, Handler&& h) {
-    auto allocator = asio::get_associated_allocator(h);
-    return std::allocate_shared<request_operation_context<Connection, Handler>>(
-        allocator, std::forward<Connection>(conn), std::forward<Handler>(h)
-    );
+    const auto allocator = detail::get_operation_allocator(h);
+    return make_request_operation_context(std::forward<Connection>(conn), std::forward<Handler>(h), allocator);
 }
 
 template <typename ...Ts>
@@ -58,8 +81,27 @@ auto& get_handler(const request_operation_context_ptr<Ts ...>& context) noexcept
     return context->handler;
 }
 
+template <typename ... Ts>
+const auto& get_allocator(const request_operation_context_ptr<Ts ...>& context) noexcept {
+    return context->allocator;
+}
+
+template <typename ...Ts, typename Key, typename Value>
+inline void update_statistics(const request_operation_context_ptr<Ts...>& ctx, const Key& key, const Value& value) noexcept {
+    detail::update_statistics(get_connection(ctx), key, value);
+}
+
+/**
+* Adds the time passed since the previous phase of the operation to the statistics item.
+*/
+template <typename ...Ts, typename Key>
+inline void update_statistics_time(const request_operation_context_ptr<Ts...>& ctx, const Key& key) noexcept {
+    impl::update_statistics(ctx, key, ctx->stopwatch.lap());
+}
+
 template <typename ...Ts>
 inline void done(const request_operation_context_ptr<Ts...>& ctx, error_code ec) {
+    impl::update_statistics(ctx, statistics_key::errors, std::uint64_t(1));
     set_query_state(ctx, query_state::error);
     get_connection(ctx).cancel();
     std::move(get_handler(ctx))(std::move(ec), ctx->conn);
@@ -70,12 +112,53 @@ inline void done(const request_operation_context_ptr<Ts...>& ctx) {
     std::move(get_handler(ctx))(error_code {}, ctx->conn);
 }
 
-template <typename Context>
+/**
+* Query which is sent via the server-side prepared statement.
+*/
+struct prepared_query {
+    std::string name;
+    binary_query query;
+};
+
+template <typename T>
+inline int send_query_params(T& conn, const prepared_query& q) noexcept {
+    return send_query_prepared(conn, q.name, q.query);
+}
+
+inline std::size_t params_size(const binary_query& q) noexcept {
+    return std::accumulate(q.lengths(), q.lengths() + q.params_count(), std::size_t(0));
+}
+
+inline std::size_t sent_size(const binary_query& q) noexcept {
+    return std::strlen(q.text()) + params_size(q);
+}
+
+inline std::size_t sent_size(const prepared_query& q) noexcept {
+    return q.name.size() + params_size(q.query);
+}
+
+constexpr error::code send_query_params_error(const binary_query&) noexcept {
+    return error::pg_send_query_params_failed;
+}
+
+constexpr error::code send_query_params_error(const prepared_query&) noexcept {
+    return error::pg_send_query_prepared_failed;
+}
+
+template <typename T, typename Query>
+inline error_code try_send_query_params(T& conn, const Query& q) noexcept {
+    if (!send_query_params(conn, q)) {
+        return send_query_params_error(q);
+    }
+    return {};
+}
+
+template <typename Context, typename Query = binary_query>
 struct async_send_query_params_op {
     Context ctx_;
-    binary_query query_;
+    Query query_;
 
-    async_send_query_params_op(Context ctx, binary_query query)
+    async_send_query_params_op(Context ctx, Query query)
     : ctx_(std::move(ctx)), query_(std::move(query)) {}
 
     void perform() {
@@ -84,8 +167,14 @@ struct async_send_query_params_op {
             return done(ctx_, ec);
         }
 
-        if (!send_query_params(conn, query_)) {
-            return done(ctx_, error::pg_send_query_params_failed);
+        if (auto ec = try_send_query_params(conn, query_)) {
+            return done(ctx_, ec);
+        }
+
+        if constexpr (std::decay_t<decltype(*ctx_)>::collects_statistics) {
+            impl::update_statistics(ctx_, statistics_key::requests, std::uint64_t(1));
+            impl::update_statistics(ctx_, statistics_key::round_trips, std::uint64_t(1));
+            impl::update_statistics(ctx_, statistics_key::bytes_sent, std::uint64_t(sent_size(query_)));
         }
 
         (*this)();
@@ -116,6 +205,7 @@ struct async_send_query_params_op {
                 break;
             case query_state::send_finish:
                 set_query_state(ctx_, query_state::send_finish);
+                update_statistics_time(ctx_, statistics_key::send_time);
                 break;
         }
     }
@@ -133,19 +223,25 @@ struct async_send_query_params_op {
     }
 };
 
-template <typename Context>
-async_send_query_params_op(Context, binary_query) -> async_send_query_params_op<Context>;
+template <typename Context, typename Query>
+async_send_query_params_op(Context, Query) -> async_send_query_params_op<Context, Query>;
 
 template <typename Context, typename Query>
 void async_send_query_params(std::shared_ptr<Context> ctx, Query&& query) {
     auto q = to_binary_query(std::forward<Query>(query),
                         get_connection(ctx).oid_map(),
-                        asio::get_associated_allocator(get_handler(ctx)));
+                        get_allocator(ctx));
 
     async_send_query_params_op op{std::move(ctx), std::move(q)};
     op.perform();
 }
 
+template <typename Context>
+void async_send_prepared_query(std::shared_ptr<Context> ctx, prepared_query query) {
+    async_send_query_params_op op{std::move(ctx), std::move(query)};
+    op.perform();
+}
+
 #include <boost/asio/yield.hpp>
 
 template <typename Context, typename ResultProcessor>
@@ -203,6 +299,8 @@ struct async_get_result_op : boost::asio::coroutine {
                 return done();
             }
 
+            update_statistics_time(ctx_, statistics_key::wait_time);
+
             if (result_status(*result_) != PGRES_SINGLE_TUPLE) {
                 do {
                     while (is_busy(get_connection(ctx_))) {
@@ -239,6 +337,13 @@ struct async_get_result_op : boost::asio::coroutine {
             case PGRES_COPY_IN:
             case PGRES_COPY_BOTH:
             case PGRES_NONFATAL_ERROR:
+#ifdef LIBPQ_HAS_PIPELINING
+            case PGRES_PIPELINE_SYNC:
+            case PGRES_PIPELINE_ABORTED:
+#endif
+#ifdef LIBPQ_HAS_CHUNK_MODE
+            case PGRES_TUPLES_CHUNK:
+#endif
                 break;
         }
 
@@ -248,15 +353,30 @@ struct async_get_result_op : boost::asio::coroutine {
 
     template <typename Result>
     void process_and_done(Result&& res) noexcept {
+        if constexpr (std::decay_t<decltype(*ctx_)>::collects_statistics) {
+            update_result_statistics(*res);
+        }
         try {
             process_(std::forward<Result>(res), get_connection(ctx_));
+        } catch (const system_error& e) {
+            detail::invalidate_oid_map_cache_on_error(get_connection(ctx_), e.code());
+            get_connection(ctx_).set_error_context(e.what());
+            return done(error::bad_result_process);
         } catch (const std::exception& e) {
             get_connection(ctx_).set_error_context(e.what());
             return done(error::bad_result_process);
         }
+        update_statistics_time(ctx_, statistics_key::decode_time);
         done();
     }
 
+    template <typename Result>
+    void update_result_statistics(const Result& res) noexcept {
+        // The size of the whole result is taken as is, so the statistics cost does not depend on the result size.
+        impl::update_statistics(ctx_, statistics_key::rows_decoded, std::uint64_t(ntuples(res)));
+        impl::update_statistics(ctx_, statistics_key::result_memory, std::uint64_t(result_size(res)));
+    }
+
     using executor_type = std::decay_t<decltype(asio::get_associated_executor(get_handler(ctx_)))>;
 
     executor_type get_executor() const noexcept {
@@ -273,6 +393,173 @@ struct async_get_result_op : boost::asio::coroutine {
 template <typename Context, typename ResultProcessor>
 async_get_result_op(Context, ResultProcessor) -> async_get_result_op<Context, ResultProcessor>;
 
+/**
+* Prepares the server-side statement for the query and adds it to the connection
+* statement cache. Obsolete statements of the cache are deallocated in a batch before
+* the preparation if there are enough of them. Stages are performed sequentially since
+* only one command may be processed by libpq at a time outside of the pipeline mode.
+*/
+template <typename Context>
+struct async_prepare_op : boost::asio::coroutine {
+    enum class stage { deallocate, prepare, done };
+
+    Context ctx_;
+    binary_query query_;
+    std::string name_;
+    using result_type = std::decay_t<decltype(get_result(get_connection(ctx_)))>;
+    result_type result_;
+    error_code ec_;
+    stage stage_ = stage::prepare;
+    query_state flush_state_ = query_state::send_in_progress;
+
+    async_prepare_op(Context ctx, binary_query query)
+    : ctx_(std::move(ctx)), query_(std::move(query)) {}
+
+    void perform() {
+        (*this)();
+    }
+
+    statement_cache& cache() noexcept {
+        return *detail::get_statement_cache(get_connection(ctx_));
+    }
+
+    void done(error_code ec) {
+        if (std::empty(get_error_context(get_connection(ctx_)))) {
+            get_connection(ctx_).set_error_context("error while prepare statement");
+        }
+        return impl::done(ctx_, ec);
+    }
+
+    void operator() (error_code ec = error_code{}, std::size_t = 0) {
+        if (ec) {
+            // Bad descriptor error can occur here if the connection
+            // has been closed by user during processing.
+            if (ec == asio::error::bad_descriptor) {
+                ec = asio::error::operation_aborted;
+            }
+            return done(ec);
+        }
+
+        reenter(*this) {
+            if (auto err = set_nonblocking(get_connection(ctx_))) {
+                return done(err);
+            }
+
+            stage_ = cache().should_deallocate() ? stage::deallocate : stage::prepare;
+
+            while (stage_ != stage::done) {
+                if (auto err = send_stage()) {
+                    return done(err);
+                }
+
+                while ((flush_state_ = flush_output(get_connection(ctx_))) == query_state::send_in_progress) {
+                    yield get_connection(ctx_).async_wait_write(std::move(*this));
+                }
+
+                if (flush_state_ == query_state::error) {
+                    return done(error::pg_flush_failed);
+                }
+
+                for (;;) {
+                    while (is_busy(get_connection(ctx_))) {
+                        yield get_connection(ctx_).async_wait_read(std::move(*this));
+                        if (auto err = consume_input(get_connection(ctx_))) {
+                            return done(err);
+                        }
+                    }
+
+                    result_ = get_result(get_connection(ctx_));
+                    if (!result_) {
+                        break;
+                    }
+                    handle_result();
+                }
+
+                if (auto err = finish_stage()) {
+                    return done(err);
+                }
+            }
+
+            impl::done(ctx_);
+        }
+    }
+
+    error_code send_stage() {
+        ec_ = error_code{};
+        if (stage_ == stage::deallocate) {
+            std::string text;
+            for (const auto& name : cache().obsolete()) {
+                text += "DEALLOCATE " + name + ";";
+            }
+            if (!send_query(get_connection(ctx_), text)) {
+                return error::pg_send_query_failed;
+            }
+        } else {
+            name_ = cache().make_name();
+            if (!send_prepare(get_connection(ctx_), name_, query_)) {
+                return error::pg_send_prepare_failed;
+            }
+        }
+        impl::update_statistics(ctx_, statistics_key::round_trips, std::uint64_t(1));
+        return {};
+    }
+
+    void handle_result() {
+        if (ec_) {
+            return;
+        }
+        const auto status = result_status(*result_);
+        switch (status) {
+            case PGRES_COMMAND_OK:
+                return;
+            case PGRES_FATAL_ERROR:
+                ec_ = result_error(*result_);
+                return;
+            default:
+                break;
+        }
+        get_connection(ctx_).set_error_context(get_result_status_name(status));
+        ec_ = error::result_status_unexpected;
+    }
+
+    error_code finish_stage() {
+        if (stage_ == stage::deallocate) {
+            // Deallocation failure is not critical, and the statements are considered
+            // as deallocated if they do not exist, e.g. due to the DISCARD ALL call.
+            // If the transaction is aborted the preparation would fail in the same way.
+            if (!ec_ || ec_ == sqlstate::invalid_sql_statement_name) {
+                cache().clear_obsolete();
+            }
+            get_connection(ctx_).set_error_context();
+            stage_ = stage::prepare;
+            return {};
+        }
+
+        if (ec_) {
+            return ec_;
+        }
+
+        cache().add(query_.text(), {query_.types(), std::size_t(query_.params_count())}, std::move(name_));
+        stage_ = stage::done;
+        return {};
+    }
+
+    using executor_type = std::decay_t<decltype(asio::get_associated_executor(get_handler(ctx_)))>;
+
+    executor_type get_executor() const noexcept {
+        return asio::get_associated_executor(get_handler(ctx_));
+    }
+
+    using allocator_type = std::decay_t<decltype(asio::get_associated_allocator(get_handler(ctx_)))>;
+
+    allocator_type get_allocator() const noexcept {
+        return asio::get_associated_allocator(get_handler(ctx_));
+    }
+};
+
+template <typename Context>
+async_prepare_op(Context, binary_query) -> async_prepare_op<Context>;
+
 #include <boost/asio/unyield.hpp>
 
 template <typename Context, typename ResultProcessor>
@@ -281,6 +568,55 @@ inline void async_get_result(Context&& ctx, ResultProcessor&& p) {
     op.perform();
 }
 
+template <typename Context>
+inline void async_prepare(Context&& ctx, binary_query query) {
+    async_prepare_op op{std::forward<Context>(ctx), std::move(query)};
+    op.perform();
+}
+
+/**
+* Updates the connection statement cache on errors which are related to
+* the prepared statement has been used for a request.
+*/
+template <typename Handler>
+struct prepared_statement_handler {
+    std::string name_;
+    Handler handler_;
+
+    prepared_statement_handler(std::string name, Handler handler)
+    : name_(std::move(name)), handler_(std::move(handler)) {}
+
+    template <typename Connection>
+    void operator() (error_code ec, Connection&& conn) {
+        if (ec) {
+            if (auto cache = detail::get_statement_cache(unwrap_connection(conn))) {
+                if (ec == sqlstate::invalid_sql_statement_name) {
+                    cache->forget(name_);
+                } else if (ec == sqlstate::feature_not_supported) {
+                    // E.g. "cached plan must not change result type"
+                    cache->invalidate(name_);
+                }
+            }
+        }
+        handler_(std::move(ec), std::forward<Connection>(conn));
+    }
+
+    using executor_type = std::decay_t<decltype(asio::get_associated_executor(handler_))>;
+
+    executor_type get_executor() const noexcept {
+        return asio::get_associated_executor(handler_);
+    }
+
+    using allocator_type = std::decay_t<decltype(asio::get_associated_allocator(handler_))>;
+
+    allocator_type get_allocator() const noexcept {
+        return asio::get_associated_allocator(handler_);
+    }
+};
+
+template <typename Handler>
+prepared_statement_handler(std::string, Handler) -> prepared_statement_handler<Handler>;
+
 template <typename OutHandler, typename Query, typename TimeConstraint, typename Handler>
 struct async_request_op {
     OutHandler out_;
@@ -291,34 +627,77 @@ struct async_request_op {
     async_request_op(Query query, TimeConstraint time_constrain, OutHandler out, Handler handler)
     : out_(std::move(out)), query_(std::move(query)), time_constraint_(time_constrain), handler_(std::move(handler)) {}
 
-    template <typename Connection, typename SourceHandler>
-    auto apply_time_constaint_or_strand (Connection& conn, SourceHandler&& handler) const {
+    template <typename Connection, typename SourceHandler, typename Allocator>
+    auto apply_time_constaint_or_strand (Connection& conn, SourceHandler&& handler,
+            [[maybe_unused]] const Allocator& allocator) const {
         if constexpr (IsNone<TimeConstraint>) {
             return std::forward<SourceHandler>(handler);
         } else {
             return detail::io_deadline_handler<std::decay_t<decltype(unwrap_connection(conn))>, std::decay_t<SourceHandler>, Connection> {
-                unwrap_connection(conn), time_constraint_, std::forward<SourceHandler>(handler)
+                unwrap_connection(conn), time_constraint_, std::forward<SourceHandler>(handler), allocator
             };
         }
     }
 
+    auto make_operation_allocator() const {
+        return detail::make_operation_arena_allocator(handler_,
+            detail::operation_arena_capacity<Handler, Query>);
+    }
+
     template <typename Connection>
     void operator() (error_code ec, Connection conn) {
         if (ec) {
             return handler_(ec, std::move(conn));
         }
 
+        if (auto cache = detail::get_statement_cache(unwrap_connection(conn))) {
+            return request_prepared(*cache, std::move(conn));
+        }
+
+        const auto allocator = make_operation_allocator();
+
         auto handler = apply_time_constaint_or_strand(conn, detail::wrap_executor {
-            detail::make_strand_executor(ozo::get_executor(conn)),
+            detail::make_operation_executor(conn),
             std::move(handler_)
-        });
+        }, allocator);
 
-        auto ctx = make_request_operation_context(std::move(conn), std::move(handler));
+        auto ctx = make_request_operation_context(std::move(conn), std::move(handler), allocator);
 
         async_send_query_params(ctx, std::move(query_));
         async_get_result(std::move(ctx), std::move(out_));
     }
 
+    template <typename Connection>
+    void request_prepared(statement_cache& cache, Connection conn) {
+        const auto allocator = make_operation_allocator();
+
+        auto query = to_binary_query(query_, unwrap_connection(conn).oid_map(), allocator);
+
+        if (auto name = cache.find(query.text(), {query.types(), std::size_t(query.params_count())})) {
+            auto handler = apply_time_constaint_or_strand(conn, detail::wrap_executor {
+                detail::make_operation_executor(conn),
+                prepared_statement_handler{*name, std::move(handler_)}
+            }, allocator);
+
+            auto ctx = make_request_operation_context(std::move(conn), std::move(handler), allocator);
+
+            async_send_prepared_query(ctx, prepared_query{*name, std::move(query)});
+            async_get_result(std::move(ctx), std::move(out_));
+            return;
+        }
+
+        // The operation would be continued with the cached statement
+        // after the preparation.
+        auto handler = apply_time_constaint_or_strand(conn, detail::wrap_executor {
+            detail::make_operation_executor(conn),
+            std::move(*this)
+        }, allocator);
+
+        auto ctx = make_request_operation_context(std::move(conn), std::move(handler), allocator);
+
+        async_prepare(std::move(ctx), std::move(query));
+    }
+
     using executor_type = std::decay_t<decltype(asio::get_associated_executor(handler_))>;
 
     executor_type get_executor() const noexcept {
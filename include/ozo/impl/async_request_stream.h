@@ -0,0 +1,304 @@
+#pragma once
+
+#include <ozo/impl/async_request.h>
+
+namespace ozo {
+namespace impl {
+
+#ifdef LIBPQ_HAS_CHUNK_MODE
+/**
+* Number of rows libpq collects into a single result in the chunked rows mode.
+*/
+constexpr int stream_chunk_rows = 1024;
+#endif
+
+/**
+* Query which result is delivered row by row (or chunk by chunk if libpq supports it)
+* instead of a single result with all the rows.
+*/
+struct streamed_query {
+    binary_query query;
+};
+
+template <typename T>
+inline int set_rows_streaming_mode(T& conn) noexcept {
+#ifdef LIBPQ_HAS_CHUNK_MODE
+    return set_chunked_rows_mode(conn, stream_chunk_rows);
+#else
+    return set_single_row_mode(conn);
+#endif
+}
+
+template <typename T>
+inline error_code try_send_query_params(T& conn, const streamed_query& q) noexcept {
+    if (!send_query_params(conn, q.query)) {
+        return error::pg_send_query_params_failed;
+    }
+    // The rows mode must be set immediately after the query has been sent. Otherwise
+    // the query is executed in the normal mode and its results can not be told apart
+    // from the streamed ones, so the connection is closed to be not reused.
+    if (!set_rows_streaming_mode(conn)) {
+        close_connection(conn);
+        return error::pg_set_rows_mode_failed;
+    }
+    return {};
+}
+
+inline std::size_t sent_size(const streamed_query& q) noexcept {
+    return sent_size(q.query);
+}
+
+template <typename Context, typename Query>
+void async_send_streamed_query(std::shared_ptr<Context> ctx, Query&& query) {
+    auto q = to_binary_query(std::forward<Query>(query),
+                        get_connection(ctx).oid_map(),
+                        get_allocator(ctx));
+
+    async_send_query_params_op op{std::move(ctx), streamed_query{std::move(q)}};
+    op.perform();
+}
+
+#include <boost/asio/yield.hpp>
+
+/**
+* Receives results of the streamed query. Each result contains a single row (or
+* a chunk of rows) and is passed to the processor as soon as it has been received,
+* so only one result is kept in memory at a time. The last result contains no rows
+* and is passed to the processor too, so it may be used as the end of stream mark.
+* In case of an error the rest results are consumed without processing, so the
+* connection stays consistent and reusable.
+*/
+template <typename Context, typename ResultProcessor>
+struct async_get_stream_result_op : boost::asio::coroutine {
+    Context ctx_;
+    ResultProcessor process_;
+    using result_type = std::decay_t<decltype(get_result(get_connection(ctx_)))>;
+    result_type result_;
+    error_code ec_;
+
+    async_get_stream_result_op(Context ctx, ResultProcessor process)
+    : ctx_(ctx), process_(process) {}
+
+    void perform() {
+        (*this)();
+    }
+
+    void done(error_code ec) {
+        if (std::empty(get_error_context(get_connection(ctx_)))) {
+            get_connection(ctx_).set_error_context("error while get request stream result");
+        }
+        return impl::done(ctx_, ec);
+    }
+
+    void operator() (error_code ec = error_code{}, std::size_t = 0) {
+        // In case when query error state has been set by send query params
+        // operation skip handle and do nothing more.
+        if (get_query_state(ctx_) == query_state::error) {
+            return;
+        }
+
+        if (ec) {
+            // Bad descriptor error can occur here if the connection
+            // has been closed by user during processing.
+            if (ec == asio::error::bad_descriptor) {
+                ec = asio::error::operation_aborted;
+            }
+            return done(ec);
+        }
+
+        reenter(*this) {
+            for (;;) {
+                while (is_busy(get_connection(ctx_))) {
+                    yield get_connection(ctx_).async_wait_read(std::move(*this));
+                    if (auto err = consume_input(get_connection(ctx_))) {
+                        return done(ec_ ? ec_ : err);
+                    }
+                }
+
+                result_ = get_result(get_connection(ctx_));
+
+                if (!result_) {
+                    return finish();
+                }
+
+                if (!ec_) {
+                    handle_result();
+                }
+            }
+        }
+    }
+
+    void handle_result() {
+        const auto status = result_status(*result_);
+        switch (status) {
+            case PGRES_SINGLE_TUPLE:
+#ifdef LIBPQ_HAS_CHUNK_MODE
+            case PGRES_TUPLES_CHUNK:
+#endif
+            case PGRES_TUPLES_OK:
+            case PGRES_COMMAND_OK:
+                process(std::move(result_));
+                return;
+            case PGRES_BAD_RESPONSE:
+                set_error(error::result_status_bad_response);
+                return;
+            case PGRES_EMPTY_QUERY:
+                set_error(error::result_status_empty_query);
+                return;
+            case PGRES_FATAL_ERROR:
+                set_error(result_error(*result_));
+                return;
+            case PGRES_COPY_OUT:
+            case PGRES_COPY_IN:
+            case PGRES_COPY_BOTH:
+            case PGRES_NONFATAL_ERROR:
+#ifdef LIBPQ_HAS_PIPELINING
+            case PGRES_PIPELINE_SYNC:
+            case PGRES_PIPELINE_ABORTED:
+#endif
+                break;
+        }
+
+        set_error(error::result_status_unexpected, get_result_status_name(status));
+    }
+
+    void set_error(error_code ec, std::string context = {}) {
+        ec_ = ec;
+        if (!std::empty(context)) {
+            get_connection(ctx_).set_error_context(std::move(context));
+        }
+    }
+
+    template <typename Result>
+    void process(Result&& res) noexcept {
+        try {
+            process_(std::forward<Result>(res), get_connection(ctx_));
+        } catch (const system_error& e) {
+            detail::invalidate_oid_map_cache_on_error(get_connection(ctx_), e.code());
+            set_error(error::bad_result_process, e.what());
+        } catch (const std::exception& e) {
+            set_error(error::bad_result_process, e.what());
+        }
+    }
+
+    void finish() {
+        if (ec_) {
+            return done(ec_);
+        }
+        impl::done(ctx_);
+    }
+
+    using executor_type = std::decay_t<decltype(asio::get_associated_executor(get_handler(ctx_)))>;
+
+    executor_type get_executor() const noexcept {
+        return asio::get_associated_executor(get_handler(ctx_));
+    }
+
+    using allocator_type = std::decay_t<decltype(asio::get_associated_allocator(get_handler(ctx_)))>;
+
+    allocator_type get_allocator() const noexcept {
+        return asio::get_associated_allocator(get_handler(ctx_));
+    }
+};
+
+template <typename Context, typename ResultProcessor>
+async_get_stream_result_op(Context, ResultProcessor) -> async_get_stream_result_op<Context, ResultProcessor>;
+
+#include <boost/asio/unyield.hpp>
+
+template <typename Context, typename ResultProcessor>
+inline void async_get_stream_result(Context&& ctx, ResultProcessor&& p) {
+    async_get_stream_result_op op{std::forward<Context>(ctx), std::forward<ResultProcessor>(p)};
+    op.perform();
+}
+
+template <typename T>
+struct async_request_stream_out_handler {
+    T out;
+
+    async_request_stream_out_handler(T out) : out(std::move(out)) {}
+
+    template <typename Handle, typename Conn>
+    void operator() (Handle&& h, Conn& conn) {
+        out(ozo::make_result(std::forward<Handle>(h)), ozo::unwrap_connection(conn).oid_map());
+    }
+};
+
+template <typename T>
+async_request_stream_out_handler(T) -> async_request_stream_out_handler<T>;
+
+template <typename OutHandler, typename Query, typename TimeConstraint, typename Handler>
+struct async_request_stream_op {
+    OutHandler out_;
+    Query query_;
+    TimeConstraint time_constraint_;
+    Handler handler_;
+
+    async_request_stream_op(Query query, TimeConstraint time_constrain, OutHandler out, Handler handler)
+    : out_(std::move(out)), query_(std::move(query)), time_constraint_(time_constrain), handler_(std::move(handler)) {}
+
+    template <typename Connection, typename SourceHandler, typename Allocator>
+    auto apply_time_constaint (Connection& conn, SourceHandler&& handler,
+            [[maybe_unused]] const Allocator& allocator) const {
+        if constexpr (IsNone<TimeConstraint>) {
+            return std::forward<SourceHandler>(handler);
+        } else {
+            return detail::io_deadline_handler<std::decay_t<decltype(unwrap_connection(conn))>, std::decay_t<SourceHandler>, Connection> {
+                unwrap_connection(conn), time_constraint_, std::forward<SourceHandler>(handler), allocator
+            };
+        }
+    }
+
+    template <typename Connection>
+    void operator() (error_code ec, Connection conn) {
+        if (ec) {
+            return handler_(ec, std::move(conn));
+        }
+
+        const auto allocator = detail::make_operation_arena_allocator(handler_,
+            detail::operation_arena_capacity<Handler, Query>);
+
+        auto handler = apply_time_constaint(conn, detail::wrap_executor {
+            detail::make_operation_executor(conn),
+            std::move(handler_)
+        }, allocator);
+
+        auto ctx = make_request_operation_context(std::move(conn), std::move(handler), allocator);
+
+        async_send_streamed_query(ctx, std::move(query_));
+        async_get_stream_result(std::move(ctx), std::move(out_));
+    }
+
+    using executor_type = std::decay_t<decltype(asio::get_associated_executor(handler_))>;
+
+    executor_type get_executor() const noexcept {
+        return asio::get_associated_executor(handler_);
+    }
+
+    using allocator_type = std::decay_t<decltype(asio::get_associated_allocator(handler_))>;
+
+    allocator_type get_allocator() const noexcept {
+        return asio::get_associated_allocator(handler_);
+    }
+};
+
+template <typename OutHandler, typename Query, typename TimeConstraint, typename Handler>
+async_request_stream_op(Query, TimeConstraint, OutHandler, Handler) -> async_request_stream_op<OutHandler, Query, TimeConstraint, Handler>;
+
+template <typename P, typename Q, typename TimeConstraint, typename Out, typename Handler>
+inline void async_request_stream(P&& provider, Q&& query, TimeConstraint t, Out&& out, Handler&& handler) {
+    static_assert(ConnectionProvider<P>, "is not a ConnectionProvider");
+    static_assert(BinaryQueryConvertible<Q>, "query should be convertible to the binary_query");
+    static_assert(ozo::TimeConstraint<TimeConstraint>, "should model TimeConstraint concept");
+    async_get_connection(std::forward<P>(provider), deadline(t),
+        async_request_stream_op{
+            std::forward<Q>(query),
+            deadline(t),
+            async_request_stream_out_handler{std::forward<Out>(out)},
+            std::forward<Handler>(handler)
+        }
+    );
+}
+
+} // namespace impl
+} // namespace ozo
@@ -0,0 +1,176 @@
+#pragma once
+
+#include <ozo/detail/deadline.h>
+#include <ozo/detail/wrap_executor.h>
+#include <ozo/impl/io.h>
+#include <ozo/connection.h>
+#include <ozo/statement_cache.h>
+#include <ozo/transaction_status.h>
+
+#include <boost/asio/coroutine.hpp>
+
+namespace ozo::impl {
+
+#include <boost/asio/yield.hpp>
+
+/**
+* Resets the connection with not idle transaction status in background, so it
+* could be returned to a pool instead of being closed. Output of the interrupted
+* request is flushed and its results are drained first. If the transaction is still
+* open, `ROLLBACK` is sent, and then `DISCARD ALL` if it is requested. The operation
+* completes with an error if any of these commands fails, the statement cache of the
+* connection is cleared only after `DISCARD ALL` succeeds. The operation does not decide
+* what to do with the connection, the caller checks the error and the transaction status
+* of the connection passed to the handler.
+*/
+template <typename Connection, typename Handler>
+struct async_reset_op : boost::asio::coroutine {
+    enum class stage { drain, rollback, discard_all };
+
+    Connection conn_;
+    Handler handler_;
+    bool discard_all_;
+    stage stage_ = stage::drain;
+    query_state flush_state_ = query_state::send_in_progress;
+    using result_type = std::decay_t<decltype(get_result(unwrap_connection(conn_)))>;
+    result_type result_;
+
+    async_reset_op(Connection conn, Handler handler, bool discard_all)
+    : conn_(std::move(conn)), handler_(std::move(handler)), discard_all_(discard_all) {}
+
+    auto& connection() noexcept {
+        return unwrap_connection(conn_);
+    }
+
+    void done(error_code ec = error_code{}) {
+        handler_(std::move(ec), std::move(conn_));
+    }
+
+    void operator() (error_code ec = error_code{}, std::size_t = 0) {
+        if (ec) {
+            return done(ec);
+        }
+
+        reenter(*this) {
+            for (;;) {
+                while ((flush_state_ = flush_output(connection())) == query_state::send_in_progress) {
+                    yield connection().async_wait_write(std::move(*this));
+                }
+
+                if (flush_state_ == query_state::error) {
+                    return done(error::pg_flush_failed);
+                }
+
+                for (;;) {
+                    while (is_busy(connection())) {
+                        yield connection().async_wait_read(std::move(*this));
+                        if (auto err = consume_input(connection())) {
+                            return done(err);
+                        }
+                    }
+
+                    result_ = get_result(connection());
+                    if (!result_) {
+                        break;
+                    }
+
+                    if (auto err = process_result()) {
+                        return done(err);
+                    }
+                }
+
+                if (!next_stage()) {
+                    return done();
+                }
+
+                if (!send_query(connection(), stage_ == stage::rollback ? "ROLLBACK" : "DISCARD ALL")) {
+                    return done(error::pg_send_query_failed);
+                }
+            }
+        }
+    }
+
+    error_code process_result() {
+        switch (result_status(*result_)) {
+            case PGRES_COPY_OUT:
+            case PGRES_COPY_IN:
+            case PGRES_COPY_BOTH:
+                // COPY can not be finished without the data, so the connection can not be reset.
+                return error::result_status_unexpected;
+            case PGRES_COMMAND_OK:
+                // Prepared statements are deallocated by the server only if DISCARD ALL succeeds.
+                if (stage_ == stage::discard_all) {
+                    if (auto cache = detail::get_statement_cache(connection())) {
+                        *cache = statement_cache{cache->capacity()};
+                    }
+                }
+                break;
+            case PGRES_BAD_RESPONSE:
+                // Results of the interrupted request are not checked, it has failed anyway.
+                if (stage_ != stage::drain) {
+                    return error::result_status_bad_response;
+                }
+                break;
+            case PGRES_FATAL_ERROR:
+                if (stage_ != stage::drain) {
+                    return result_error(*result_);
+                }
+                break;
+            default:
+                break;
+        }
+        return {};
+    }
+
+    bool next_stage() {
+        switch (stage_) {
+            case stage::drain:
+                if (get_transaction_status(connection()) == transaction_status::idle) {
+                    return false;
+                }
+                stage_ = stage::rollback;
+                return true;
+            case stage::rollback:
+                if (!discard_all_ || get_transaction_status(connection()) != transaction_status::idle) {
+                    return false;
+                }
+                stage_ = stage::discard_all;
+                return true;
+            case stage::discard_all:
+                break;
+        }
+        return false;
+    }
+
+    using executor_type = asio::associated_executor_t<Handler>;
+
+    executor_type get_executor() const noexcept {
+        return asio::get_associated_executor(handler_);
+    }
+
+    using allocator_type = asio::associated_allocator_t<Handler>;
+
+    allocator_type get_allocator() const noexcept {
+        return asio::get_associated_allocator(handler_);
+    }
+};
+
+#include <boost/asio/unyield.hpp>
+
+template <typename Connection, typename Handler>
+async_reset_op(Connection, Handler, bool) -> async_reset_op<Connection, Handler>;
+
+template <typename Connection, typename TimeConstraint, typename Handler>
+inline void async_reset(Connection&& conn, bool discard_all, const TimeConstraint& t, Handler&& handler) {
+    static_assert(ozo::Connection<Connection>, "conn should model Connection concept");
+
+    auto h = detail::wrap_executor {detail::make_operation_executor(conn), std::forward<Handler>(handler)};
+    auto deadline_handler = detail::io_deadline_handler<
+            std::decay_t<decltype(unwrap_connection(conn))>, decltype(h), std::decay_t<Connection>> {
+        unwrap_connection(conn), t, std::move(h)
+    };
+    async_reset_op op{std::forward<Connection>(conn), std::move(deadline_handler), discard_all};
+    op();
+}
+
+} // namespace ozo::impl
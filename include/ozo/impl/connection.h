@@ -52,12 +52,14 @@ error_code connection<OidMap, Statistics>::assign(ozo::pg::conn&& handle) {
 
     socket_ = std::move(new_socket);
     handle_ = std::move(handle);
+    statement_cache_ = statement_cache_type{statement_cache_.capacity()};
     return {};
 }
 
 template <typename OidMap, typename Statistics>
 ozo::pg::conn connection<OidMap, Statistics>::release() {
     socket_.release();
+    statement_cache_ = statement_cache_type{statement_cache_.capacity()};
     ozo::pg::conn retval;
     using std::swap;
     swap(retval, handle_);
@@ -137,6 +139,19 @@ inline auto get_executor(const Connection& conn) noexcept {
     return unwrap_connection(conn).get_executor();
 }
 
+namespace detail {
+
+template <typename Connection>
+inline auto make_operation_executor(const Connection& conn) {
+    if constexpr (connection_thread_safety<Connection>::value) {
+        return make_strand_executor(ozo::get_executor(conn));
+    } else {
+        return ozo::get_executor(conn);
+    }
+}
+
+} // namespace detail
+
 namespace detail {
 inline constexpr std::string_view make_string_view(const char* src) {
     return src == nullptr ? std::string_view{} : std::string_view{src};
@@ -3,42 +3,114 @@
 #include <ozo/connection.h>
 #include <yamail/resource_pool/async/pool.hpp>
 #include <ozo/asio.h>
+#include <ozo/recycling_allocator.h>
 #include <ozo/ext/std/shared_ptr.h>
 #include <ozo/detail/make_copyable.h>
+#include <ozo/detail/bind.h>
+#include <ozo/impl/async_reset.h>
+
+#include <boost/asio/dispatch.hpp>
+#include <boost/asio/post.hpp>
+
+#include <atomic>
+#include <functional>
 
 
 namespace ozo::detail {
 
-template <typename Allocator, typename Executor, typename Rep>
-auto create_pooled_connection(const Allocator& alloc, const Executor& ex, Rep&& rep) {
-    return std::allocate_shared<pooled_connection<std::decay_t<Rep>, Executor>>(alloc, ex, std::forward<Rep>(rep));
+template <typename ThreadSafety = thread_safety<true>, typename Allocator, typename Executor, typename Rep>
+auto create_pooled_connection(const Allocator& alloc, const Executor& ex, Rep&& rep,
+        std::shared_ptr<connection_pool_metrics> metrics = nullptr, const connection_reset_options& reset = {},
+        std::shared_ptr<void> lease = nullptr,
+        std::shared_ptr<connection_pool_idle_stack<std::decay_t<Rep>, ThreadSafety>> idle = nullptr,
+        std::shared_ptr<typename pooled_connection<std::decay_t<Rep>, Executor, ThreadSafety>::pool_statistics_type> statistics = nullptr,
+        typename pooled_connection<std::decay_t<Rep>, Executor, ThreadSafety>::drain_borrow_type borrow = {}) {
+    return std::allocate_shared<pooled_connection<std::decay_t<Rep>, Executor, ThreadSafety>>(
+        alloc, ex, std::forward<Rep>(rep), std::move(metrics), reset, std::move(lease), std::move(idle), std::move(statistics),
+        std::move(borrow));
 }
 
-template <typename Source, typename Handler, typename TimeConstraint>
+/**
+ * Reason of a refused request for the pool metrics. Requests are refused either by the
+ * pool queue or by the underlying resource pool, which has its own error codes.
+ */
+inline connection_acquire_failure get_connection_acquire_failure(const error_code& ec) noexcept {
+    if (ec == error::pool_queue_overflow || ec == yamail::resource_pool::error::request_queue_overflow) {
+        return connection_acquire_failure::queue_overflow;
+    }
+    if (ec == asio::error::timed_out || ec == yamail::resource_pool::error::get_resource_timeout) {
+        return connection_acquire_failure::wait_timeout;
+    }
+    if (ec == error::pool_deadline_too_close) {
+        return connection_acquire_failure::deadline_too_close;
+    }
+    if (ec == error::pool_draining) {
+        return connection_acquire_failure::draining;
+    }
+    return connection_acquire_failure::other;
+}
+
+template <typename Source, typename Handler, typename TimeConstraint, typename ThreadSafety = thread_safety<true>>
 struct pooled_connection_wrapper {
-    using connection_ptr = typename connection_pool<Source>::connection_type;
+    using connection_ptr = typename connection_pool<Source, ThreadSafety>::connection_type;
     using connection = typename connection_ptr::element_type;
     using handle_type = typename connection::rep_type;
+    using idle_stack_ptr = std::shared_ptr<typename connection::idle_stack_type>;
+    using statistics_ptr = std::shared_ptr<typename connection::pool_statistics_type>;
+    using drain_ptr = std::shared_ptr<const connection_pool_drain<ThreadSafety>>;
+    using borrow_type = typename connection::drain_borrow_type;
 
     typename connection::executor_type io_executor_;
     Source source_;
     detail::make_copyable_t<Handler> handler_;
     TimeConstraint time_constrain_;
+    std::size_t statement_cache_capacity_;
+    std::shared_ptr<connection_pool_metrics> metrics_;
+    connection_reset_options reset_;
+    time_traits::time_point start_;
+    idle_stack_ptr idle_;
+    statistics_ptr statistics_;
+    drain_ptr drain_;
+    std::shared_ptr<void> lease_ = nullptr;
+    borrow_type borrow_ = {};
 
     struct wrapper {
         Handler handler_;
         handle_type handle_;
+        std::size_t statement_cache_capacity_;
+        std::shared_ptr<connection_pool_metrics> metrics_;
+        connection_reset_options reset_;
+        time_traits::time_point start_;
+        std::shared_ptr<void> lease_;
+        idle_stack_ptr idle_;
+        statistics_ptr statistics_;
+        borrow_type borrow_;
 
         template <typename Conn>
         void operator () (error_code ec, Conn&& conn) {
             static_assert(std::is_same_v<connection_type<Source>, std::decay_t<Conn>>,
                 "Conn should be connection type of Source");
+            if (metrics_) {
+                metrics_->on_connect(ec, time_traits::now() - start_);
+            }
             if (!is_null(conn)) {
                 auto& target = ozo::unwrap_connection(conn);
-
-                handle_.reset({target.release(), target.oid_map(), target.get_error_context()});
-                auto res = create_pooled_connection(
-                    get_allocator(), target.get_executor(), std::move(handle_)
+                auto statistics = detail::get_statistics(target);
+                if (statistics_) {
+                    statistics_->add(statistics);
+                }
+                // The handle of a reconnected connection keeps statistics of the previous connections.
+                if (!handle_.empty()) {
+                    statistics = detail::accumulate_statistics(handle_->statistics(), statistics);
+                }
+
+                handle_.reset({target.release(), target.oid_map(), target.get_error_context(),
+                    std::move(statistics), statement_cache{statement_cache_capacity_}});
+                detail::set_oid_map_cache(ozo::unwrap(handle_), detail::get_oid_map_cache(target));
+                auto res = create_pooled_connection<ThreadSafety>(
+                    detail::get_operation_allocator(handler_), target.get_executor(), std::move(handle_),
+                    std::move(metrics_), reset_, std::move(lease_), std::move(idle_), std::move(statistics_),
+                    std::move(borrow_)
                 );
 
                 handler_(std::move(ec), std::move(res));
@@ -61,16 +133,38 @@ struct pooled_connection_wrapper {
     };
 
     void operator ()(error_code ec, handle_type&& handle) {
+        // A request which has been waiting in the queue of the resource pool since before
+        // the drain started must not be served, the connection is closed instead.
+        if (!ec && drain_ && drain_->draining()) {
+            ec = error::pool_draining;
+            if (!handle.empty()) {
+                handle.waste();
+            }
+        }
+
+        if (metrics_) {
+            metrics_->on_acquire(ec, time_traits::now() - start_, get_connection_acquire_failure(ec));
+        }
+
         if (ec) {
             return handler_(std::move(ec), connection_ptr{});
         }
 
         if (!handle.empty() && !connection_status_bad(handle->safe_native_handle().get())) {
-            auto conn = create_pooled_connection(get_allocator(), io_executor_, std::move(handle));
+            auto conn = create_pooled_connection<ThreadSafety>(
+                detail::get_operation_allocator(handler_), io_executor_, std::move(handle), metrics_, reset_,
+                std::move(lease_), idle_, statistics_, std::move(borrow_));
             return handler_(std::move(ec), std::move(conn));
         }
 
-        source_(io_executor_.context(), time_constrain_, wrapper{std::move(handler_), std::move(handle)});
+        if (!handle.empty() && metrics_) {
+            metrics_->on_reconnect();
+        }
+
+        const auto start = metrics_ ? time_traits::now() : time_traits::time_point{};
+        source_(io_executor_.context(), time_constrain_,
+            wrapper{std::move(handler_), std::move(handle), statement_cache_capacity_, metrics_, reset_, start,
+                std::move(lease_), idle_, statistics_, std::move(borrow_)});
     }
 
     using executor_type = decltype(asio::get_associated_executor(handler_));
@@ -86,15 +180,121 @@ struct pooled_connection_wrapper {
     }
 };
 
-template <typename Source, typename Executor, typename TimeConstraint, typename Handler>
-auto wrap_pooled_connection_handler(const Executor& ex, Source&& source, TimeConstraint t, Handler&& handler) {
+template <typename ThreadSafety = thread_safety<true>, typename Source, typename Executor, typename TimeConstraint, typename Handler>
+auto wrap_pooled_connection_handler(const Executor& ex, Source&& source, TimeConstraint t, Handler&& handler,
+        std::size_t statement_cache_capacity = 0, std::shared_ptr<connection_pool_metrics> metrics = nullptr,
+        const connection_reset_options& reset = {},
+        typename pooled_connection_wrapper<std::decay_t<Source>, std::decay_t<Handler>, TimeConstraint,
+            ThreadSafety>::idle_stack_ptr idle = nullptr,
+        typename pooled_connection_wrapper<std::decay_t<Source>, std::decay_t<Handler>, TimeConstraint,
+            ThreadSafety>::statistics_ptr statistics = nullptr,
+        typename pooled_connection_wrapper<std::decay_t<Source>, std::decay_t<Handler>, TimeConstraint,
+            ThreadSafety>::drain_ptr drain = nullptr) {
     static_assert(ConnectionSource<Source>, "is not a ConnectionSource");
 
-    return pooled_connection_wrapper<std::decay_t<Source>, std::decay_t<Handler>, TimeConstraint> {
-        ex, std::forward<Source>(source), std::forward<Handler>(handler), t
+    const auto start = metrics ? time_traits::now() : time_traits::time_point{};
+    return pooled_connection_wrapper<std::decay_t<Source>, std::decay_t<Handler>, TimeConstraint, ThreadSafety> {
+        ex, std::forward<Source>(source), std::forward<Handler>(handler), t, statement_cache_capacity,
+        std::move(metrics), reset, start, std::move(idle), std::move(statistics), std::move(drain)
     };
 }
 
+/**
+ * Counts connections established in background by the pool and invokes the handler
+ * with the first error, if any, when all of them are finished. Each connection is returned
+ * to the pool as soon as it is established, so it is available to requests at once.
+ */
+template <typename Handler, typename ThreadSafety>
+struct pool_connect_idle_handler {
+    struct context {
+        Handler handler_;
+        std::size_t remaining_;
+        error_code ec_;
+        get_connection_pool_mutex_t<ThreadSafety> mutex_;
+
+        context(Handler handler, std::size_t remaining)
+        : handler_(std::move(handler)), remaining_(remaining) {}
+    };
+
+    std::shared_ptr<context> ctx_;
+
+    pool_connect_idle_handler(Handler handler, std::size_t count) {
+        auto allocator = get_operation_allocator(handler);
+        ctx_ = std::allocate_shared<context>(allocator, std::move(handler), count);
+    }
+
+    template <typename Connection>
+    void operator() (error_code ec, Connection conn) {
+        // The connection is returned to the pool before the handler may be invoked.
+        conn = Connection{};
+        std::unique_lock lock(ctx_->mutex_);
+        if (ec && !ctx_->ec_) {
+            ctx_->ec_ = std::move(ec);
+        }
+        if (--ctx_->remaining_ == 0) {
+            lock.unlock();
+            asio::dispatch(detail::bind(std::move(ctx_->handler_), ctx_->ec_));
+        }
+    }
+
+    using executor_type = asio::associated_executor_t<Handler>;
+
+    executor_type get_executor() const noexcept {
+        return asio::get_associated_executor(ctx_->handler_);
+    }
+
+    using allocator_type = asio::associated_allocator_t<Handler>;
+
+    allocator_type get_allocator() const noexcept {
+        return asio::get_associated_allocator(ctx_->handler_);
+    }
+};
+
+/**
+ * Completes the drain operation either when the pool is drained or when the deadline
+ * is expired, whichever happens first. The caller claims the completion before it is called.
+ */
+template <typename Handler>
+struct pool_drain_handler {
+    struct context {
+        Handler handler_;
+        std::atomic<bool> claimed_ {false};
+        std::function<void()> cancel_timer_;
+
+        explicit context(Handler handler) : handler_(std::move(handler)) {}
+    };
+
+    std::shared_ptr<context> ctx_;
+
+    explicit pool_drain_handler(Handler handler) {
+        auto allocator = get_operation_allocator(handler);
+        ctx_ = std::allocate_shared<context>(allocator, std::move(handler));
+    }
+
+    bool claim() noexcept {
+        return !ctx_->claimed_.exchange(true);
+    }
+
+    void operator() (error_code ec) {
+        if (auto cancel_timer = std::move(ctx_->cancel_timer_)) {
+            cancel_timer();
+        }
+        asio::dispatch(detail::bind(std::move(ctx_->handler_), std::move(ec)));
+    }
+
+    using executor_type = asio::associated_executor_t<Handler>;
+
+    executor_type get_executor() const noexcept {
+        return asio::get_associated_executor(ctx_->handler_);
+    }
+
+    using allocator_type = asio::associated_allocator_t<Handler>;
+
+    allocator_type get_allocator() const noexcept {
+        return asio::get_associated_allocator(ctx_->handler_);
+    }
+};
+
 } // namespace ozo::detail
 
 namespace ozo {
@@ -111,71 +311,343 @@ template <typename Source, typename ThreadSafety>
 template <typename TimeConstraint, typename Handler>
 void connection_pool<Source, ThreadSafety>::operator ()(io_context& io, TimeConstraint t, Handler&& handler) {
     static_assert(ozo::TimeConstraint<TimeConstraint>, "should model TimeConstraint concept");
-    impl_.get_auto_recycle(
-        io,
-        detail::wrap_pooled_connection_handler(
-            io.get_executor(),
-            source_,
-            t,
-            std::forward<Handler>(handler)
-        ),
-        queue_timeout(t)
+    auto wrapper = state_->wrap_handler(io, t, std::forward<Handler>(handler));
+    if (state_->queue_) {
+        state_->get_queued(io, deadline(t), std::move(wrapper));
+    } else {
+        state_->get_handle(io, std::move(wrapper), state::queue_timeout(t));
+    }
+    state_->start_maintenance(io);
+}
+
+template <typename Source, typename ThreadSafety>
+template <typename TimeConstraint, typename Handler>
+auto connection_pool<Source, ThreadSafety>::state::wrap_handler(io_context& io, TimeConstraint t, Handler&& handler) const {
+    return detail::wrap_pooled_connection_handler<ThreadSafety>(
+        io.get_executor(),
+        source_,
+        t,
+        std::forward<Handler>(handler),
+        statement_cache_capacity_,
+        metrics_,
+        reset_,
+        idle_,
+        statistics_,
+        drain_
     );
 }
 
-template <typename Rep, typename Executor>
-pooled_connection<Rep, Executor>::pooled_connection(const Executor& ex, Rep&& rep)
-: rep_(std::move(rep)), ex_(ex), stream_(get_executor().context()) {
-    if (auto fd = PQsocket(native_handle()); fd != -1) {
-        stream_.assign(fd);
+template <typename Source, typename ThreadSafety>
+template <typename Deadline, typename Handler>
+void connection_pool<Source, ThreadSafety>::state::get_queued(io_context& io, Deadline at, Handler&& handler) {
+    using handle_type = typename std::decay_t<Handler>::handle_type;
+    auto lease = queue_->acquire(io.get_executor(), queue_deadline(at), [&] {
+        // A lease is given to the waiter within the io_context, but an error may come from
+        // abort() on any thread, so the handler is posted on error to be completed within the io_context.
+        return [self = this->shared_from_this(), &io, at, handler = std::move(handler)] (error_code ec, auto lease) mutable {
+            if (ec) {
+                return asio::post(io.get_executor(), [handler = std::move(handler), ec] () mutable {
+                    handler(ec, handle_type{});
+                });
+            }
+            handler.lease_ = std::move(lease);
+            self->get_handle(io, std::move(handler), queue_timeout(at));
+        };
+    });
+    if (lease) {
+        handler.lease_ = std::move(lease);
+        get_handle(io, std::forward<Handler>(handler), queue_timeout(at));
     }
 }
 
-template <typename Rep, typename Executor>
-typename pooled_connection<Rep, Executor>::native_handle_type
-pooled_connection<Rep, Executor>::native_handle() const noexcept {
+template <typename Source, typename ThreadSafety>
+template <typename Handler>
+bool connection_pool<Source, ThreadSafety>::state::borrow(io_context& io, Handler& handler) {
+    using handle_type = typename std::decay_t<Handler>::handle_type;
+    handler.borrow_ = drain_->borrow();
+    if (handler.borrow_) {
+        return true;
+    }
+    asio::post(io.get_executor(), [handler = std::move(handler)] () mutable {
+        handler(error_code{error::pool_draining}, handle_type{});
+    });
+    return false;
+}
+
+template <typename Source, typename ThreadSafety>
+template <typename Handler>
+void connection_pool<Source, ThreadSafety>::state::get_handle(io_context& io, Handler&& handler,
+        time_traits::duration wait_duration) {
+    if (!borrow(io, handler)) {
+        return;
+    }
+    if (idle_) {
+        if (auto handle = idle_->pop()) {
+            return asio::post(io.get_executor(),
+                [handler = std::forward<Handler>(handler), handle = std::move(*handle)] () mutable {
+                    handler(error_code{}, std::move(handle));
+                });
+        }
+    }
+    impl_.get_auto_recycle(io, std::forward<Handler>(handler), wait_duration);
+}
+
+template <typename Source, typename ThreadSafety>
+template <typename TimeConstraint, typename CompletionToken>
+decltype(auto) connection_pool<Source, ThreadSafety>::warm_up(io_context& io, TimeConstraint t, CompletionToken&& token) {
+    static_assert(ozo::TimeConstraint<TimeConstraint>, "should model TimeConstraint concept");
+    return async_initiate<CompletionToken, void(error_code)>([self = state_, &io, t] (auto&& handler) {
+        const auto target = std::min(std::max(self->warm_up_, self->min_idle_), self->impl_.capacity());
+        const auto count = target - std::min(target, self->impl_.size());
+        if (count == 0) {
+            return asio::post(io.get_executor(),
+                detail::bind(std::forward<decltype(handler)>(handler), error_code{}));
+        }
+        self->connect_idle(io, t, count, std::forward<decltype(handler)>(handler));
+    }, token);
+}
+
+template <typename Source, typename ThreadSafety>
+template <typename TimeConstraint, typename Handler>
+void connection_pool<Source, ThreadSafety>::state::connect_idle(io_context& io, TimeConstraint t,
+        std::size_t count, Handler&& handler) {
+    // The resource pool hands out its idle connections before free slots, so they are requested
+    // too and returned at once, and the connections are established in the free slots only.
+    const auto requests = impl_.available() + count;
+    detail::pool_connect_idle_handler<std::decay_t<Handler>, ThreadSafety> on_connect{
+        std::forward<Handler>(handler), requests};
+    for (std::size_t i = 0; i != requests; ++i) {
+        auto wrapper = wrap_handler(io, t, on_connect);
+        if (borrow(io, wrapper)) {
+            impl_.get_auto_recycle(io, std::move(wrapper), queue_timeout(t));
+        }
+    }
+}
+
+template <typename Source, typename ThreadSafety>
+void connection_pool<Source, ThreadSafety>::state::start_maintenance(io_context& io) {
+    if ((min_idle_ == 0 && !idle_) || drain_->draining()) {
+        return;
+    }
+    active_.store(true);
+    if (maintenance_.exchange(true)) {
+        return;
+    }
+    auto timer = std::make_shared<asio::steady_timer>(io);
+    {
+        std::lock_guard lock(maintenance_mutex_);
+        maintenance_timer_ = timer;
+    }
+    if (min_idle_ != 0) {
+        maintain_min_idle(io, min_idle_connect_timeout_);
+    }
+    schedule_maintenance(io, std::move(timer), next_maintenance(time_traits::now()));
+}
+
+template <typename Source, typename ThreadSafety>
+time_traits::time_point connection_pool<Source, ThreadSafety>::state::next_maintenance(time_traits::time_point now) {
+    auto result = min_idle_ != 0 ? now + min_idle_interval_ : time_traits::time_point::max();
+    if (idle_) {
+        result = std::min(result, idle_->close_expired(now));
+    }
+    return result;
+}
+
+template <typename Source, typename ThreadSafety>
+void connection_pool<Source, ThreadSafety>::state::schedule_maintenance(io_context& io,
+        std::shared_ptr<asio::steady_timer> timer, time_traits::time_point at) {
+    timer->expires_at(at);
+    timer->async_wait([weak = this->weak_from_this(), &io, timer] (error_code ec) mutable {
+        const auto self = weak.lock();
+        if (!self) {
+            return;
+        }
+        if (!ec) {
+            const bool active = self->active_.exchange(false);
+            if (active && self->min_idle_ != 0) {
+                self->maintain_min_idle(io, self->min_idle_connect_timeout_);
+            }
+            const auto at = self->next_maintenance(time_traits::now());
+            // The timer is not rearmed when there were no requests since the previous check and there are
+            // no connections to close when they are idle, so it does not keep the io_context running after
+            // the traffic is over.
+            const bool idle = self->idle_ && (self->idle_size() != 0 || self->drain_->borrowed() != 0);
+            if (active || idle) {
+                return self->schedule_maintenance(io, std::move(timer), at);
+            }
+        }
+        self->maintenance_.store(false);
+        // A request which came after the check did not start the maintenance while it was running.
+        if (ec || !self->active_.load() || self->maintenance_.exchange(true)) {
+            return;
+        }
+        self->schedule_maintenance(io, std::move(timer), self->next_maintenance(time_traits::now()));
+    });
+}
+
+template <typename Source, typename ThreadSafety>
+template <typename TimeConstraint>
+void connection_pool<Source, ThreadSafety>::state::maintain_min_idle(io_context& io, TimeConstraint t) {
+    if (drain_->draining()) {
+        return;
+    }
+    // Connections being established are counted as idle ones, so the next check
+    // does not start connecting while the previous connections are in progress.
+    const auto idle = impl_.available() + idle_size() + pending_connects_->load();
+    const auto free = impl_.capacity() - std::min(impl_.capacity(), impl_.size());
+    const auto count = std::min(min_idle_ - std::min(min_idle_, idle), free);
+    if (count == 0) {
+        return;
+    }
+    pending_connects_->fetch_add(count);
+    connect_idle(io, t, count, [pending = pending_connects_, count] (error_code) {
+        pending->fetch_sub(count);
+    });
+}
+
+template <typename Source, typename ThreadSafety>
+template <typename TimeConstraint, typename CompletionToken>
+decltype(auto) connection_pool<Source, ThreadSafety>::drain(io_context& io, TimeConstraint t, CompletionToken&& token) {
+    static_assert(ozo::TimeConstraint<TimeConstraint>, "should model TimeConstraint concept");
+    return async_initiate<CompletionToken, void(error_code)>([self = state_, &io, t] (auto&& handler) {
+        detail::pool_drain_handler<std::decay_t<decltype(handler)>> on_drain{
+            std::forward<decltype(handler)>(handler)};
+        if (self->queue_) {
+            self->queue_->abort(error::pool_draining);
+        }
+        self->expire_drain(io, deadline(t), on_drain);
+        // The pool is drained even if the deadline is expired, so connections
+        // which are returned late are closed too. The drain handler is called either
+        // right here or by the last returned connection, so closing of the idle
+        // connections is posted to block neither the caller nor the connection owner.
+        self->drain_->drain([self, ex = io.get_executor(), on_drain] (error_code ec) mutable {
+            asio::post(ex, [self, on_drain, ec] () mutable {
+                if (!ec) {
+                    self->close_idle();
+                }
+                if (on_drain.claim()) {
+                    on_drain(std::move(ec));
+                }
+            });
+        });
+    }, token);
+}
+
+template <typename Source, typename ThreadSafety>
+template <typename Handler>
+void connection_pool<Source, ThreadSafety>::state::expire_drain(io_context& io, time_traits::time_point at, Handler handler) {
+    auto timer = std::make_shared<std::decay_t<decltype(detail::get_operation_timer(io.get_executor(), at))>>(
+        detail::get_operation_timer(io.get_executor(), at));
+    handler.ctx_->cancel_timer_ = [timer] {
+        asio::post(timer->get_executor(), [timer] { timer->cancel(); });
+    };
+    timer->async_wait([self = this->shared_from_this(), handler] (error_code ec) mutable {
+        if (!ec && handler.claim()) {
+            self->close_idle();
+            handler(asio::error::timed_out);
+        }
+    });
+}
+
+template <typename Rep, typename Executor, typename ThreadSafety>
+pooled_connection<Rep, Executor, ThreadSafety>::pooled_connection(const Executor& ex, Rep&& rep,
+        std::shared_ptr<connection_pool_metrics> metrics, connection_reset_options reset, std::shared_ptr<void> lease,
+        std::shared_ptr<idle_stack_type> idle, std::shared_ptr<pool_statistics_type> statistics, drain_borrow_type borrow)
+: borrow_(std::move(borrow)), lease_(std::move(lease)), rep_(std::move(rep)), ex_(ex), stream_(std::addressof(ozo::unwrap(rep_).stream(ex_))),
+  metrics_(std::move(metrics)), reset_(reset), idle_(std::move(idle)), pool_statistics_(std::move(statistics)) {}
+
+template <typename Rep, typename Executor, typename ThreadSafety>
+typename pooled_connection<Rep, Executor, ThreadSafety>::native_handle_type
+pooled_connection<Rep, Executor, ThreadSafety>::native_handle() const noexcept {
     if (rep_.empty()) {
         return {};
     }
     return ozo::unwrap(rep_).safe_native_handle().get();
 }
 
-template <typename Rep, typename Executor>
+template <typename Rep, typename Executor, typename ThreadSafety>
 template <typename WaitHandler>
-void pooled_connection<Rep, Executor>::async_wait_write(WaitHandler&& h) {
-    stream_.async_write_some(asio::null_buffers(), std::forward<WaitHandler>(h));
+void pooled_connection<Rep, Executor, ThreadSafety>::async_wait_write(WaitHandler&& h) {
+    stream_->async_write_some(asio::null_buffers(), std::forward<WaitHandler>(h));
 }
 
-template <typename Rep, typename Executor>
+template <typename Rep, typename Executor, typename ThreadSafety>
 template <typename WaitHandler>
-void pooled_connection<Rep, Executor>::async_wait_read(WaitHandler&& h) {
-    stream_.async_read_some(asio::null_buffers(), std::forward<WaitHandler>(h));
+void pooled_connection<Rep, Executor, ThreadSafety>::async_wait_read(WaitHandler&& h) {
+    stream_->async_read_some(asio::null_buffers(), std::forward<WaitHandler>(h));
 }
 
-template <typename Rep, typename Executor>
-error_code pooled_connection<Rep, Executor>::close() noexcept {
-    stream_.release();
+template <typename Rep, typename Executor, typename ThreadSafety>
+error_code pooled_connection<Rep, Executor, ThreadSafety>::close() noexcept {
+    ozo::unwrap(rep_).release_stream();
     ozo::unwrap(rep_).safe_native_handle().reset();
     return error_code{};
 }
 
-template <typename Rep, typename Executor>
-void pooled_connection<Rep, Executor>::cancel() noexcept {
+template <typename Rep, typename Executor, typename ThreadSafety>
+void pooled_connection<Rep, Executor, ThreadSafety>::cancel() noexcept {
     error_code _;
-    stream_.cancel(_);
+    stream_->cancel(_);
 }
 
-template <typename Rep, typename Executor>
-bool pooled_connection<Rep, Executor>::is_bad() const noexcept {
+template <typename Rep, typename Executor, typename ThreadSafety>
+bool pooled_connection<Rep, Executor, ThreadSafety>::is_bad() const noexcept {
     return !detail::connection_status_ok(native_handle());
 }
 
-template <typename Rep, typename Executor>
-pooled_connection<Rep, Executor>::~pooled_connection() {
-    stream_.release();
-    if (!rep_.empty() && (is_bad() || get_transaction_status(*this) != transaction_status::idle)) {
-        rep_.waste();
+template <typename Rep, typename Executor, typename ThreadSafety>
+void pooled_connection<Rep, Executor, ThreadSafety>::waste(connection_waste_reason reason) {
+    if (metrics_) {
+        metrics_->on_waste(reason);
+    }
+    rep_.waste();
+}
+
+template <typename Rep, typename Executor, typename ThreadSafety>
+pooled_connection<Rep, Executor, ThreadSafety>::~pooled_connection() {
+    if (pool_statistics_) {
+        pool_statistics_->add(checkout_statistics_);
+    }
+    if (rep_.empty()) {
+        return;
+    }
+    if (is_bad()) {
+        waste(connection_waste_reason::bad_connection);
+    } else if (get_transaction_status(*this) != transaction_status::idle) {
+        if (!reset()) {
+            waste(connection_waste_reason::not_idle);
+        }
+    } else if (idle_) {
+        idle_->push(rep_);
+    }
+}
+
+template <typename Rep, typename Executor, typename ThreadSafety>
+bool pooled_connection<Rep, Executor, ThreadSafety>::reset() noexcept {
+    if (reset_.policy == connection_reset_policy::waste) {
+        return false;
+    }
+    // The handle is moved to a connection with the default reset policy, so
+    // its destructor returns the handle to the pool if the reset succeeded
+    // and wastes it otherwise. A connection which has failed a reset command
+    // keeps its session state, so it is wasted by the handler.
+    std::shared_ptr<pooled_connection> conn;
+    try {
+        conn = detail::create_pooled_connection<ThreadSafety>(recycling_allocator<char>{}, ex_, std::move(rep_), metrics_,
+            {}, std::move(lease_), idle_, pool_statistics_, std::move(borrow_));
+    } catch (const std::exception&) {
+        return false;
+    }
+    try {
+        impl::async_reset(std::move(conn), reset_.policy == connection_reset_policy::discard_all,
+            deadline(reset_.timeout), [] (error_code ec, auto conn) {
+                if (ec) {
+                    conn->waste(connection_waste_reason::not_idle);
+                }
+            });
+    } catch (const std::exception&) {
     }
+    return true;
 }
 
 } // namespace ozo
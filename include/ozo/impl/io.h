@@ -62,6 +62,71 @@ inline int send_query_params(T& conn, const binary_query& q) noexcept {
             );
 }
 
+template <typename T>
+inline int send_query_prepared(T& conn, const std::string& name, const binary_query& q) noexcept {
+    static_assert(Connection<T>, "T must be a Connection");
+    return PQsendQueryPrepared(get_native_handle(conn),
+                name.c_str(),
+                q.params_count(),
+                q.values(),
+                q.lengths(),
+                q.formats(),
+                int(result_format::binary)
+            );
+}
+
+template <typename T>
+inline int send_prepare(T& conn, const std::string& name, const binary_query& q) noexcept {
+    static_assert(Connection<T>, "T must be a Connection");
+    return PQsendPrepare(get_native_handle(conn),
+                name.c_str(),
+                q.text(),
+                q.params_count(),
+                q.types()
+            );
+}
+
+template <typename T>
+inline int send_query(T& conn, const std::string& text) noexcept {
+    static_assert(Connection<T>, "T must be a Connection");
+    return PQsendQuery(get_native_handle(conn), text.c_str());
+}
+
+template <typename T>
+inline int put_copy_data(T& conn, const std::vector<char>& buffer) noexcept {
+    static_assert(Connection<T>, "T must be a Connection");
+    return PQputCopyData(get_native_handle(conn), buffer.data(), int(buffer.size()));
+}
+
+template <typename T>
+inline int put_copy_end(T& conn, const char* error_message = nullptr) noexcept {
+    static_assert(Connection<T>, "T must be a Connection");
+    return PQputCopyEnd(get_native_handle(conn), error_message);
+}
+
+template <typename T>
+inline int get_copy_data(T& conn, pg::copy_data& buffer) noexcept {
+    static_assert(Connection<T>, "T must be a Connection");
+    char* data = nullptr;
+    const int size = PQgetCopyData(get_native_handle(conn), std::addressof(data), 1);
+    buffer.reset(data);
+    return size;
+}
+
+template <typename T>
+inline int set_single_row_mode(T& conn) noexcept {
+    static_assert(Connection<T>, "T must be a Connection");
+    return PQsetSingleRowMode(get_native_handle(conn));
+}
+
+#ifdef LIBPQ_HAS_CHUNK_MODE
+template <typename T>
+inline int set_chunked_rows_mode(T& conn, int chunk_size) noexcept {
+    static_assert(Connection<T>, "T must be a Connection");
+    return PQsetChunkedRowsMode(get_native_handle(conn), chunk_size);
+}
+#endif
+
 template <typename T>
 inline error_code set_nonblocking(T& conn) noexcept {
     static_assert(Connection<T>, "T must be a Connection");
@@ -92,6 +157,35 @@ inline query_state flush_output(T& conn) noexcept {
     return static_cast<query_state>(PQflush(get_native_handle(conn)));
 }
 
+#ifdef LIBPQ_HAS_PIPELINING
+template <typename T>
+inline error_code enter_pipeline_mode(T& conn) noexcept {
+    static_assert(Connection<T>, "T must be a Connection");
+    if (!PQenterPipelineMode(get_native_handle(conn))) {
+        return error::pg_enter_pipeline_mode_failed;
+    }
+    return {};
+}
+
+template <typename T>
+inline error_code exit_pipeline_mode(T& conn) noexcept {
+    static_assert(Connection<T>, "T must be a Connection");
+    if (!PQexitPipelineMode(get_native_handle(conn))) {
+        return error::pg_exit_pipeline_mode_failed;
+    }
+    return {};
+}
+
+template <typename T>
+inline error_code pipeline_sync(T& conn) noexcept {
+    static_assert(Connection<T>, "T must be a Connection");
+    if (!PQpipelineSync(get_native_handle(conn))) {
+        return error::pg_pipeline_sync_failed;
+    }
+    return {};
+}
+#endif
+
 template <typename T>
 inline decltype(auto) get_result(T& conn) noexcept {
     static_assert(Connection<T>, "T must be a Connection");
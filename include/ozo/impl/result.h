@@ -45,6 +45,24 @@ inline int pq_ntuples(const PGresult& res) noexcept {
     return PQntuples(std::addressof(res));
 }
 
+template <typename T, typename = std::void_t<>>
+struct has_result_memory_size : std::false_type {};
+
+template <typename T>
+struct has_result_memory_size<T, std::void_t<decltype(PQresultMemorySize(std::declval<const T*>()))>> : std::true_type {};
+
+/**
+ * Memory size of the result, `0` if libpq is older than 12 and does not provide it.
+ */
+template <typename T = PGresult>
+inline std::size_t pq_result_size([[maybe_unused]] const T& res) noexcept {
+    if constexpr (has_result_memory_size<T>::value) {
+        return PQresultMemorySize(std::addressof(res));
+    } else {
+        return 0;
+    }
+}
+
 } // namespace pq
 
 template <typename T>
@@ -95,4 +113,10 @@ inline int ntuples(T&& res) noexcept {
     return pq_ntuples(std::forward<T>(res));
 }
 
+template <typename T>
+inline std::size_t result_size(T&& res) noexcept {
+    using pq::pq_result_size;
+    return pq_result_size(std::forward<T>(res));
+}
+
 } // namespace ozo::impl
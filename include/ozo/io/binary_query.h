@@ -108,6 +108,12 @@ public:
 
 private:
     static constexpr auto binary_format = 1;
+    static constexpr std::size_t max_encode_buffer_capacity = 64 * 1024;
+
+    static std::vector<char>& encode_buffer() {
+        thread_local std::vector<char> buffer;
+        return buffer;
+    }
 
     struct interface {
         virtual const char* text() const noexcept = 0;
@@ -125,10 +131,7 @@ private:
         static_assert(ozo::OidMap<OidMap>, "OidMap should model ozo::OidMap");
         static_assert(ozo::QueryText<Text>, "Text should model ozo::QueryText concept");
 
-        using allocator_type = std::conditional_t<
-                                std::is_same_v<typename Allocator::value_type, char>,
-                                    Allocator,
-                                    typename std::allocator_traits<Allocator>::template rebind_alloc<char>>;
+        using allocator_type = typename std::allocator_traits<Allocator>::template rebind_alloc<char>;
         using buffer_type = std::vector<char, allocator_type>;
         using oid_map_type = OidMap;
         using text_type = std::decay_t<Text>;
@@ -145,7 +148,7 @@ private:
 
         impl_type(Text text, const Params& params,
             const OidMap& oid_map, const Allocator& allocator)
-        : text_(std::move(text)), buffer_(allocator) {
+        : text_(std::move(text)), buffer_(allocator_type(allocator)) {
             formats_.fill(binary_format);
 
             const auto range = hana::to_tuple(hana::make_range(hana::size_c<0>, hana::size_c<params_count_>));
@@ -155,12 +158,21 @@ private:
                 types_[i] = type_oid(oid_map, params[i]);
             });
 
-            buffer_.reserve(hana::unpack(lengths_, [](auto ...x) {return (x + ... + 0);}));
+            // Parameters are encoded into the buffer of the thread, which ozo::ostream writes
+            // directly, and are copied into the buffer of the query with its allocator at once.
+            auto& encoded = encode_buffer();
+            encoded.clear();
+            encoded.reserve(hana::unpack(lengths_, [](auto ...x) {return (x + ... + 0);}));
 
-            ozo::ostream os(buffer_);
+            ozo::ostream os(encoded);
 
             hana::for_each(params, [&] (auto& param) { send(os, oid_map, param);});
 
+            buffer_.assign(std::begin(encoded), std::end(encoded));
+            if (encoded.capacity() > max_encode_buffer_capacity) {
+                std::vector<char>().swap(encoded);
+            }
+
             std::size_t offset = 0;
             hana::for_each(range, [&] (auto i) {
                 values_[i] = lengths_[i] ? std::data(buffer_) + offset : nullptr;
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <ozo/io/composite.h>
+
+#include <boost/core/demangle.hpp>
+
+namespace ozo {
+
+namespace detail {
+
+/**
+ * Signature of the PostgreSQL binary COPY format, the terminating zero is a part of it.
+ */
+constexpr char copy_signature[] = "PGCOPY\n\377\r\n";
+
+struct pg_copy_header {
+    BOOST_HANA_DEFINE_STRUCT(pg_copy_header,
+        (std::int32_t, flags),
+        (std::int32_t, extension_size)
+    );
+};
+
+constexpr std::int16_t copy_trailer = -1;
+
+} // namespace detail
+
+/**
+ * @brief Writes the binary COPY data header
+ * @ingroup group-io-functions
+ *
+ * @param out --- output stream
+ * @return ostream& --- output stream
+ */
+inline ostream& write_copy_header(ostream& out) {
+    out.write(detail::copy_signature, sizeof(detail::copy_signature));
+    return write(out, detail::pg_copy_header{0, 0});
+}
+
+/**
+ * @brief Writes the binary COPY data trailer
+ * @ingroup group-io-functions
+ *
+ * @param out --- output stream
+ * @return ostream& --- output stream
+ */
+inline ostream& write_copy_trailer(ostream& out) {
+    return write(out, detail::copy_trailer);
+}
+
+/**
+ * @brief Serializes a row into the binary COPY tuple
+ * @ingroup group-io-functions
+ *
+ * The tuple contains number of fields followed by data frames of the row members.
+ * Members are serialized via `ozo::send()`, so any type which can be sent as a query
+ * parameter can be a member of the row.
+ *
+ * @param out --- output stream
+ * @param oid_map --- #OidMap to get oid for custom types
+ * @param row --- `std::tuple`, `boost::fusion` or `boost::hana` adapted structure
+ * @return ostream& --- output stream
+ */
+template <typename OidMap, typename Row>
+inline ostream& send_copy_row(ostream& out, const OidMap& oid_map, const Row& row) {
+    static_assert(FusionSequence<Row> || HanaStruct<Row>,
+        "row should be a std::tuple, boost::fusion or boost::hana adapted structure");
+    write(out, std::int16_t(detail::fields_number(row)));
+    detail::for_each_member(row, [&] (const auto& v) {
+        send_data_frame(out, oid_map, v);
+    });
+    return out;
+}
+
+/**
+ * @brief Reads and verifies the binary COPY data header
+ * @ingroup group-io-functions
+ *
+ * @param in --- input stream
+ * @return istream& --- input stream
+ * @throw ozo::system_error with `ozo::error::bad_copy_data` if the header is malformed.
+ */
+inline istream& read_copy_header(istream& in) {
+    char signature[sizeof(detail::copy_signature)];
+    in.read(signature, sizeof(signature));
+    if (!in || !std::equal(std::begin(signature), std::end(signature), std::begin(detail::copy_signature))) {
+        throw system_error(error::bad_copy_data, "unexpected binary COPY signature");
+    }
+    detail::pg_copy_header header;
+    read(in, header);
+    if (header.extension_size < 0) {
+        throw system_error(error::bad_copy_data, "negative binary COPY header extension size");
+    }
+    std::vector<char> extension(header.extension_size);
+    return read(in, extension);
+}
+
+/**
+ * @brief Deserializes a row from the binary COPY tuple
+ * @ingroup group-io-functions
+ *
+ * Members of the row are deserialized via `ozo::recv()`, so any type which can be received
+ * as a result column can be a member of the row. Since the binary COPY data does not contain
+ * types oids, they are not verified.
+ *
+ * @param in --- input stream
+ * @param oid_map --- #OidMap to get oid for custom types
+ * @param out --- `std::tuple`, `boost::fusion` or `boost::hana` adapted structure
+ * @return true --- the row has been received.
+ * @return false --- the trailer has been received, there are no more rows.
+ * @throw ozo::system_error with `ozo::error::bad_copy_data` if the number of fields does not match the row.
+ */
+template <typename OidMap, typename Row>
+inline bool recv_copy_row(istream& in, const OidMap& oid_map, Row& out) {
+    static_assert(FusionSequence<Row> || HanaStruct<Row>,
+        "row should be a std::tuple, boost::fusion or boost::hana adapted structure");
+    std::int16_t count = 0;
+    read(in, count);
+    if (count == detail::copy_trailer) {
+        return false;
+    }
+    if (count != detail::fields_number(out)) {
+        throw system_error(error::bad_copy_data, "incoming tuple fields count " + std::to_string(count)
+            + " does not match fields count " + std::to_string(detail::fields_number(out))
+            + " of type " + boost::core::demangle(typeid(out).name()));
+    }
+    if constexpr (HanaStruct<Row>) {
+        hana::for_each(hana::keys(out), [&](auto key) {
+            recv_data_frame(in, oid_map, hana::at_key(out, key));
+        });
+    } else {
+        fusion::for_each(out, [&](auto& v) {
+            recv_data_frame(in, oid_map, v);
+        });
+    }
+    return true;
+}
+
+} // namespace ozo
@@ -14,6 +14,9 @@
 #include <boost/hana/members.hpp>
 #include <boost/hana/size.hpp>
 
+#include <array>
+#include <optional>
+
 namespace ozo {
 template <int... I>
 constexpr std::tuple<boost::mpl::int_<I>...>
@@ -251,85 +254,146 @@ void recv(const value<T>& in, const OidMap& oids, Out& out) {
     recv(s, in.oid(), (in.is_null() ? null_state_size : in.size()), oids, out);
 }
 
-template <typename T, typename OidMap, typename Out>
-Require<!FusionSequence<Out> && !FusionAdaptedStruct<Out> && !HanaStruct<Out>>
-recv_row(const row<T>& in, const OidMap& oid_map, Out& out) {
-    if (std::size(in) != 1) {
-        throw std::range_error("row size " + std::to_string(std::size(in))
-            + " does not equal 1 for single column result");
-    }
+namespace detail {
 
-    recv(*(in.begin()), oid_map, out);
-}
+template <typename Out, typename = std::void_t<>>
+struct row_fields_count : std::integral_constant<std::size_t, 1> {};
 
-template <typename T, typename OidMap, typename Out>
-Require<FusionSequence<Out> && !FusionAdaptedStruct<Out> && !HanaStruct<Out>>
-recv_row(const row<T>& in, const OidMap& oid_map, Out& out) {
+template <typename Out>
+struct row_fields_count<Out, Require<FusionSequence<Out> && !HanaStruct<Out>>>
+    : std::integral_constant<std::size_t, fusion::result_of::size<Out>::value> {};
 
-    if (static_cast<std::size_t>(fusion::size(out)) != std::size(in)) {
-        throw std::range_error("row size " + std::to_string(std::size(in))
-            + " does not match sequence " + boost::core::demangle(typeid(out).name())
-            + " size " + std::to_string(fusion::size(out)));
-    }
+template <typename Out>
+struct row_fields_count<Out, Require<HanaStruct<Out>>>
+    : std::integral_constant<std::size_t,
+        decltype(hana::size(hana::members(std::declval<Out>())))::value> {};
 
-    auto i = in.begin();
-    fusion::for_each(out, [&](auto& item) {
-        recv(*i, oid_map, item);
-        ++i;
-    });
+/**
+ * Calls `f(index, name, member)` for each field of the row object, `name` is
+ * `nullptr` for the fields which are matched to the columns by position.
+ */
+template <typename Out, typename Func>
+inline void for_each_row_field(Out& out, Func&& f) {
+    if constexpr (HanaStruct<Out>) {
+        std::size_t i = 0;
+        hana::for_each(hana::keys(out), [&](auto key) {
+            f(i++, hana::to<const char*>(key), hana::at_key(out, key));
+        });
+    } else if constexpr (FusionAdaptedStruct<Out>) {
+        fusion::for_each(make_index_sequence(fusion::size(out)), [&](auto idx) {
+            f(std::size_t(idx.value), member_name(out, idx), member_value(out, idx));
+        });
+    } else if constexpr (FusionSequence<Out>) {
+        std::size_t i = 0;
+        fusion::for_each(out, [&](auto& item) {
+            f(i++, nullptr, item);
+        });
+    } else {
+        f(std::size_t(0), nullptr, out);
+    }
 }
 
-template <typename T, typename OidMap, typename Out>
-Require<FusionAdaptedStruct<Out> && !HanaStruct<Out>>
-recv_row(const row<T>& in, const OidMap& oid_map, Out& out) {
-
-    if (static_cast<std::size_t>(fusion::size(out)) != std::size(in)) {
+template <typename T, typename Out>
+inline void verify_row_size(const row<T>& in, const Out& out) {
+    constexpr auto size = row_fields_count<Out>::value;
+    if (size == std::size(in)) {
+        return;
+    }
+    if constexpr (FusionAdaptedStruct<Out> || HanaStruct<Out>) {
         throw std::range_error("row size " + std::to_string(std::size(in))
             + " does not match structure " + boost::core::demangle(typeid(out).name())
-            + " size " + std::to_string(fusion::size(out)));
+            + " size " + std::to_string(size));
+    } else if constexpr (FusionSequence<Out>) {
+        throw std::range_error("row size " + std::to_string(std::size(in))
+            + " does not match sequence " + boost::core::demangle(typeid(out).name())
+            + " size " + std::to_string(size));
+    } else {
+        throw std::range_error("row size " + std::to_string(std::size(in))
+            + " does not equal 1 for single column result");
     }
+}
+
+/**
+ * Decoding plan of the result rows into objects of a particular type. It contains the column
+ * index for each field of the object and whether the column type has been accepted by the field
+ * type. All the rows of a result have the same columns, so the plan is made once per result.
+ * Thus the column names lookup and the oid check are not performed for each value.
+ */
+template <std::size_t N>
+struct recv_row_plan {
+    std::array<int, N> columns;
+    std::array<bool, N> oid_accepted;
+};
 
-    fusion::for_each(make_index_sequence(fusion::size(out)), [&](auto idx) {
-        auto i = in.find(member_name(out, idx));
-        if (i == in.end()) {
+template <typename Out>
+using recv_row_plan_t = recv_row_plan<row_fields_count<Out>::value>;
+
+template <typename T, typename OidMap, typename Out>
+inline recv_row_plan_t<Out> make_recv_row_plan(const row<T>& in, const OidMap& oid_map, Out& out) {
+    verify_row_size(in, out);
+    recv_row_plan_t<Out> plan;
+    for_each_row_field(out, [&](std::size_t i, const char* name, auto& field) {
+        auto column = name ? in.find(name) : in.begin() + int(i);
+        if (column == in.end()) {
             throw std::range_error(std::string("row does not contain \"")
-                + member_name(out, idx) + "\" column for "
+                + name + "\" column for "
                 + boost::core::demangle(typeid(out).name()));
-        } else {
-            recv(*i, oid_map, member_value(out, idx));
         }
+        plan.columns[i] = int(column - in.begin());
+        // A column with a not accepted type still can be received if all the
+        // values are nulls, so the check is performed for each value in this case.
+        plan.oid_accepted[i] = accepts_oid(oid_map, field, (*column).oid());
     });
+    return plan;
 }
 
-template <typename T, typename OidMap, typename Out>
-Require<HanaStruct<Out>>
-recv_row(const row<T>& in, const OidMap& oid_map, Out& out) {
-
-    const auto keys = hana::keys(out);
-    const auto size = size_type(hana::value(hana::size(keys)));
-    if (size != std::size(in)) {
-        throw std::range_error("row size " + std::to_string(std::size(in))
-            + " does not match structure " + boost::core::demangle(typeid(out).name())
-            + " size " + std::to_string(size));
-    }
-
-    hana::for_each(keys, [&](auto key) {
-        auto i = in.find(hana::to<const char*>(key));
-        if (i == in.end()) {
-            throw std::range_error(std::string("row does not contain \"")
-                + hana::to<const char*>(key) + "\" column for "
-                + boost::core::demangle(typeid(out).name()));
+template <typename T, typename OidMap, typename Out, std::size_t N>
+inline void recv_row(const row<T>& in, const OidMap& oid_map, Out& out, const recv_row_plan<N>& plan) {
+    for_each_row_field(out, [&](std::size_t i, const char*, auto& field) {
+        const auto v = in[plan.columns[i]];
+        if (plan.oid_accepted[i]) {
+            istream s(v.data(), v.size());
+            detail::recv(s, null_oid, (v.is_null() ? null_state_size : v.size()), oid_map, field);
         } else {
-            recv(*i, oid_map, hana::at_key(out, key));
+            recv(v, oid_map, field);
         }
     });
 }
 
+} // namespace detail
+
+/**
+ * @brief Receive a result row into an object
+ * @ingroup group-io-functions
+ *
+ * The object may be a single value for a single column row, `std::tuple` or `boost::fusion`
+ * sequence which members are matched to the columns by position, or `boost::fusion` or
+ * `boost::hana` adapted structure which members are matched to the columns by name.
+ *
+ * @note To receive all the rows of a result use `ozo::recv_result()`, which resolves
+ * columns once for the whole result instead of each row.
+ *
+ * @param in --- row of a result
+ * @param oid_map --- #OidMap to get oid for custom types
+ * @param out --- object to receive
+ * @throw std::range_error if the row does not match the object.
+ */
+template <typename T, typename OidMap, typename Out>
+inline void recv_row(const row<T>& in, const OidMap& oid_map, Out& out) {
+    const auto plan = detail::make_recv_row_plan(in, oid_map, out);
+    detail::recv_row(in, oid_map, out, plan);
+}
+
 template <typename T, typename OidMap, typename Out>
 Require<ForwardIterator<Out>, Out>
 recv_result(const basic_result<T>& in, const OidMap& oid_map, Out out) {
+    std::optional<detail::recv_row_plan_t<typename std::iterator_traits<Out>::value_type>> plan;
     for (auto row : in) {
-        recv_row(row, oid_map, *out++);
+        auto&& v = *out++;
+        if (!plan) {
+            plan = detail::make_recv_row_plan(row, oid_map, v);
+        }
+        detail::recv_row(row, oid_map, v, *plan);
     }
     return out;
 }
@@ -337,9 +401,14 @@ recv_result(const basic_result<T>& in, const OidMap& oid_map, Out out) {
 template <typename T, typename OidMap, typename Out>
 Require<InsertIterator<Out>, Out>
 recv_result(const basic_result<T>& in, const OidMap& oid_map, Out out) {
+    using value_type = typename Out::container_type::value_type;
+    std::optional<detail::recv_row_plan_t<value_type>> plan;
     for (auto row : in) {
-        typename Out::container_type::value_type v{};
-        recv_row(row, oid_map, v);
+        value_type v{};
+        if (!plan) {
+            plan = detail::make_recv_row_plan(row, oid_map, v);
+        }
+        detail::recv_row(row, oid_map, v, *plan);
         *out++ = std::move(v);
     }
     return out;
@@ -25,6 +25,14 @@ struct safe_handle<::PGconn> {
     using type = std::unique_ptr<::PGconn, deleter>;
 };
 
+template <>
+struct safe_handle<char> {
+    struct deleter {
+        void operator() (char *ptr) const noexcept { ::PQfreemem(ptr); }
+    };
+    using type = std::unique_ptr<char, deleter>;
+};
+
 template <typename T>
 using safe_handle_t = typename safe_handle<T>::type;
 
@@ -39,6 +47,8 @@ using result = pg::safe_handle_t<::PGresult>;
 
 using shared_result = std::shared_ptr<::PGresult>;
 
+using copy_data = pg::safe_handle_t<char>;
+
 } // namespace ozo::pg
 
 namespace boost::hana {
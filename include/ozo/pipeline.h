@@ -0,0 +1,149 @@
+#pragma once
+
+#include <ozo/impl/async_pipeline.h>
+
+namespace ozo {
+
+/**
+ * @brief Query with its output object to be sent within a pipeline.
+ *
+ * The pipeline step binds a query with an output for its result. Output could be
+ * any object which is supported by the `ozo::request()` as an output, e.g. an Iterator,
+ * an #InsertIterator or `ozo::result` wrapped with `ozo::into()`.
+ *
+ * @tparam Query --- #Query or any type which models #BinaryQueryConvertible.
+ * @tparam Out --- output object type.
+ * @ingroup group-requests-types
+ */
+template <typename Query, typename Out>
+struct pipeline_step {
+    Query query; //!< query to be sent
+    Out out; //!< output for the query result
+};
+
+template <typename Query, typename Out>
+pipeline_step(Query, Out) -> pipeline_step<Query, Out>;
+
+#ifdef OZO_DOCUMENTATION
+/**
+ * @brief Executes a number of queries within a single round trip with a time constraint
+ *
+ * The function uses libpq pipeline mode to send all the queries to a database at once,
+ * then waits for the results and demultiplexes them into the outputs of the steps. The
+ * function can be called as any of Boost.Asio asynchronous function with #CompletionToken.
+ * The request would be cancelled if time constrain is reached while performing.
+ *
+ * Queries are executed by a database independently, the pipeline does not wrap them into
+ * a transaction. If a query fails the rest queries are not executed, and the error of
+ * the first failed query is reported; `get_error_context()` contains the failed query index.
+ * If a query can not be sent, the results of the already sent ones are drained before the
+ * error is reported, so the connection stays reusable. If the connection can not leave the
+ * pipeline mode it is closed.
+ *
+ * @note The function does not participate in ADL since could be implemented via functional object.
+ * @note The function is available only with libpq which supports pipeline mode (PostgreSQL 14 or newer).
+ *
+ * @param provider --- connection provider object to get connection from.
+ * @param steps --- `hana::Foldable` (e.g. `hana::tuple`) or an #Iterable (e.g. `std::vector`) of `ozo::pipeline_step` objects.
+ * @param time_constraint --- request #TimeConstraint; this time constrain <b>includes</b> time for getting connection from provider.
+ * @param token --- operation #CompletionToken.
+ * @return deduced from #CompletionToken.
+ *
+ * ###Example
+ *
+ * @code
+#include <ozo/pipeline.h>
+#include <ozo/connection_info.h>
+#include <ozo/shortcuts.h>
+#include <boost/asio.hpp>
+
+int main() {
+    boost::asio::io_context io;
+    ozo::rows_of<std::int64_t> ids;
+    ozo::rows_of<std::string> names;
+    auto conn_info = ozo::connection_info("host=... port=...");
+
+    using namespace ozo::literals;
+    using namespace std::chrono_literals;
+
+    auto steps = boost::hana::make_tuple(
+        ozo::pipeline_step{"SELECT id FROM users_info"_SQL, ozo::into(ids)},
+        ozo::pipeline_step{"SELECT name FROM users_info"_SQL, ozo::into(names)}
+    );
+
+    ozo::pipeline(conn_info[io], steps, 500ms, [&](ozo::error_code ec, auto conn) {
+        if (ec) {
+            std::cerr << ec.message() << " | " << error_message(conn);
+            if (!is_null_recursive(conn)) {
+                std::cerr << " | " << get_error_context(conn);
+            }
+            return;
+        };
+        std::cout << ids.size() << " ids and " << names.size() << " names received" << std::endl;
+    });
+    io.run();
+}
+ * @endcode
+ * @ingroup group-requests-functions
+ */
+template <typename ConnectionProvider, typename PipelineSteps, typename TimeConstraint, typename CompletionToken>
+decltype(auto) pipeline (ConnectionProvider&& provider, PipelineSteps&& steps, TimeConstraint time_constraint, CompletionToken&& token);
+
+/**
+ * @brief Executes a number of queries within a single round trip
+ *
+ * This function is time constrain free shortcut to `ozo::pipeline()` function.
+ * Its call is equal to `ozo::pipeline(provider, steps, ozo::none, token)` call.
+ *
+ * @note The function does not participate in ADL since could be implemented via functional object.
+ *
+ * @param provider --- connection provider to get connection from.
+ * @param steps --- `hana::Foldable` or an #Iterable of `ozo::pipeline_step` objects.
+ * @param token --- operation #CompletionToken.
+ * @return deduced from #CompletionToken.
+ * @ingroup group-requests-functions
+ */
+template <typename ConnectionProvider, typename PipelineSteps, typename CompletionToken>
+decltype(auto) pipeline (ConnectionProvider&& provider, PipelineSteps&& steps, CompletionToken&& token);
+
+#else
+
+template <typename Initiator>
+struct pipeline_op : base_async_operation <pipeline_op<Initiator>, Initiator> {
+    using base = typename pipeline_op::base;
+    using base::base;
+
+    template <typename P, typename Steps, typename TimeConstraint, typename CompletionToken>
+    decltype(auto) operator() (P&& provider, Steps&& steps, TimeConstraint t, CompletionToken&& token) const {
+        static_assert(ConnectionProvider<P>, "provider should be a ConnectionProvider");
+        static_assert(ozo::TimeConstraint<TimeConstraint>, "should model TimeConstraint concept");
+        return async_initiate<CompletionToken, handler_signature<P>>(
+            get_operation_initiator(*this), token, std::forward<P>(provider), t, std::forward<Steps>(steps));
+    }
+
+    template <typename P, typename Steps, typename CompletionToken>
+    decltype(auto) operator() (P&& provider, Steps&& steps, CompletionToken&& token) const {
+        return (*this)(std::forward<P>(provider), std::forward<Steps>(steps), none,
+            std::forward<CompletionToken>(token));
+    }
+
+    template <typename OtherInitiator>
+    constexpr static auto rebind_initiator(const OtherInitiator& other) {
+        return pipeline_op<OtherInitiator>{other};
+    }
+};
+
+namespace detail {
+struct initiate_async_pipeline {
+    template <typename Handler, typename P, typename TimeConstraint, typename Steps>
+    constexpr void operator()(Handler&& h, P&& p, TimeConstraint t, Steps&& steps) const {
+        impl::async_pipeline(std::forward<P>(p), std::forward<Steps>(steps), t, std::forward<Handler>(h));
+    }
+};
+} // namespace detail
+
+constexpr pipeline_op<detail::initiate_async_pipeline> pipeline;
+
+#endif
+
+} // namespace ozo
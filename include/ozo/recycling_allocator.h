@@ -0,0 +1,403 @@
+#pragma once
+
+#include <ozo/asio.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace ozo {
+
+namespace detail {
+
+/**
+ * Per-thread cache of memory blocks. A request operation allocates its state
+ * when it starts and deallocates it when it completes, so the next operation
+ * on the same thread mostly gets the memory of the previous one instead of
+ * calling the global allocator. Sizes are rounded up to the granularity to let
+ * states of similar operations share blocks. Blocks greater than `max_size`
+ * are not cached. A block may be deallocated on a thread other than the one it
+ * was allocated on, it is cached by the deallocating thread then. A block which is
+ * allocated or deallocated after the cache of the thread has been destroyed, e.g. by
+ * a handler destroyed within the `io_context` destructor at the thread exit, goes
+ * directly to the global allocator.
+ */
+class recycling_memory_cache {
+public:
+    static constexpr std::size_t slots = 16;
+    static constexpr std::size_t granularity = 64;
+    static constexpr std::size_t max_size = 4096;
+
+    recycling_memory_cache() = default;
+    recycling_memory_cache(const recycling_memory_cache&) = delete;
+    recycling_memory_cache& operator =(const recycling_memory_cache&) = delete;
+
+    ~recycling_memory_cache() {
+        destroyed() = true;
+        for (std::size_t i = 0; i < count_; ++i) {
+            ::operator delete(blocks_[i].ptr);
+        }
+    }
+
+    static void* allocate_block(std::size_t size) {
+        if (const auto cache = instance()) {
+            return cache->allocate(size);
+        }
+        return ::operator new(round_up(size));
+    }
+
+    static void deallocate_block(void* ptr, std::size_t size) noexcept {
+        if (const auto cache = instance()) {
+            return cache->deallocate(ptr, size);
+        }
+        ::operator delete(ptr);
+    }
+
+    void* allocate(std::size_t size) {
+        const auto rounded = round_up(size);
+        // The most recently deallocated block is looked up first since
+        // it is the most likely to be in the CPU cache still.
+        for (std::size_t i = count_; i > 0; --i) {
+            if (blocks_[i - 1].size == rounded) {
+                void* ptr = blocks_[i - 1].ptr;
+                blocks_[i - 1] = blocks_[--count_];
+                return ptr;
+            }
+        }
+        return ::operator new(rounded);
+    }
+
+    void deallocate(void* ptr, std::size_t size) noexcept {
+        const auto rounded = round_up(size);
+        if (rounded <= max_size && count_ < slots) {
+            blocks_[count_++] = block{ptr, rounded};
+            return;
+        }
+        ::operator delete(ptr);
+    }
+
+    /**
+     * Returns the cache of the current thread or nullptr if it has been destroyed already.
+     */
+    static recycling_memory_cache* instance() noexcept {
+        if (destroyed()) {
+            return nullptr;
+        }
+        thread_local recycling_memory_cache cache;
+        return std::addressof(cache);
+    }
+
+private:
+    // The flag has no destructor, so it is valid during the whole thread exit.
+    static bool& destroyed() noexcept {
+        thread_local bool value = false;
+        return value;
+    }
+
+    static constexpr std::size_t round_up(std::size_t size) noexcept {
+        return (size + granularity - 1) / granularity * granularity;
+    }
+
+    struct block {
+        void* ptr = nullptr;
+        std::size_t size = 0;
+    };
+
+    std::array<block, slots> blocks_;
+    std::size_t count_ = 0;
+};
+
+} // namespace detail
+
+/**
+ * @brief Allocator which recycles memory blocks within a thread
+ *
+ * The allocator is intended for short-lived per-operation state, e.g. request
+ * context, binary query buffers, and deadline timer context. It keeps a small
+ * per-thread cache of recently deallocated blocks, so a steady stream of requests
+ * rarely calls the global allocator. It is used for the state of operations which
+ * handlers have the default `std::allocator<void>` associated allocator. Another
+ * allocator, e.g. `std::allocator<char>` to use the global allocator directly, can be
+ * associated with a handler via `ozo::bind_allocator()`.
+ *
+ * @tparam T --- type of the object to allocate.
+ * @ingroup group-core-types
+ */
+template <typename T>
+class recycling_allocator {
+public:
+    using value_type = T;
+
+    template <typename U>
+    struct rebind {
+        using other = recycling_allocator<U>;
+    };
+
+    constexpr recycling_allocator() noexcept = default;
+
+    template <typename U>
+    constexpr recycling_allocator(const recycling_allocator<U>&) noexcept {}
+
+    T* allocate(std::size_t n) {
+        static_assert(alignof(T) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__,
+            "over-aligned types are not supported by recycling_allocator");
+        return static_cast<T*>(detail::recycling_memory_cache::allocate_block(sizeof(T) * n));
+    }
+
+    void deallocate(T* ptr, std::size_t n) noexcept {
+        detail::recycling_memory_cache::deallocate_block(ptr, sizeof(T) * n);
+    }
+
+    template <typename U>
+    constexpr bool operator ==(const recycling_allocator<U>&) const noexcept { return true; }
+
+    template <typename U>
+    constexpr bool operator !=(const recycling_allocator<U>&) const noexcept { return false; }
+};
+
+/**
+ * @brief Handler with the associated allocator
+ *
+ * The handler wrapper which is returned by `ozo::bind_allocator()`. It calls the
+ * handler with the same arguments and keeps its associated executor.
+ *
+ * @tparam Allocator --- the allocator to associate with the handler.
+ * @tparam Handler --- the handler type.
+ * @ingroup group-core-types
+ */
+template <typename Allocator, typename Handler>
+class allocator_binder {
+public:
+    using allocator_type = Allocator;
+    using executor_type = asio::associated_executor_t<Handler>;
+
+    allocator_binder(const Allocator& allocator, Handler handler)
+    : handler_(std::move(handler)), allocator_(allocator) {}
+
+    template <typename ...Args>
+    decltype(auto) operator ()(Args&& ...args) {
+        return handler_(std::forward<Args>(args)...);
+    }
+
+    allocator_type get_allocator() const noexcept { return allocator_;}
+
+    executor_type get_executor() const noexcept { return asio::get_associated_executor(handler_);}
+
+private:
+    Handler handler_;
+    Allocator allocator_;
+};
+
+/**
+ * @brief Associate the allocator with the handler
+ *
+ * Operations allocate their state via the handler associated allocator, and via
+ * `ozo::recycling_allocator` if it is the default `std::allocator<void>`. The function
+ * sets the allocator for the operation with the handler, e.g. an arena of the caller or
+ * `std::allocator<char>` to use the global allocator without the per-thread recycling.
+ *
+ * @param allocator --- the allocator to associate with the handler.
+ * @param handler --- the completion handler of an operation.
+ * @return `ozo::allocator_binder` with the allocator and the handler.
+ * @ingroup group-core-types
+ *
+ * ###Example
+ *
+ * @code{cpp}
+ozo::request(pool[io], query, 1s, ozo::into(result), ozo::bind_allocator(std::allocator<char>{},
+    [&](ozo::error_code ec, auto conn) {
+        //...
+    }));
+ * @endcode
+ */
+template <typename Allocator, typename Handler>
+inline auto bind_allocator(const Allocator& allocator, Handler&& handler) {
+    return allocator_binder<Allocator, std::decay_t<Handler>>(allocator, std::forward<Handler>(handler));
+}
+
+namespace detail {
+
+/**
+ * Returns the allocator for the state of an operation with the handler. It is the
+ * handler associated allocator, or `ozo::recycling_allocator` if it is the default one.
+ */
+template <typename Handler>
+inline auto get_operation_allocator(const Handler& handler) noexcept {
+    using allocator_type = asio::associated_allocator_t<Handler>;
+    if constexpr (std::is_same_v<allocator_type, std::allocator<void>>) {
+        return recycling_allocator<char>{};
+    } else {
+        return asio::get_associated_allocator(handler);
+    }
+}
+
+/**
+ * Single memory block for the state of an operation. An operation allocates a few
+ * objects when it starts, e.g. the deadline context, the request context and the binary
+ * query, which have different lifetimes. The arena takes one block from the underlying
+ * allocator and hands out its parts, the block is returned when all the parts are
+ * deallocated and all the arena allocators are destroyed. The parts are never reused,
+ * an allocation which does not fit the rest of the block goes to the underlying allocator.
+ */
+template <typename Allocator>
+class operation_arena {
+public:
+    using allocator_type = typename std::allocator_traits<Allocator>::template rebind_alloc<char>;
+
+    static operation_arena* create(const Allocator& allocator, std::size_t capacity) {
+        allocator_type block_allocator(allocator);
+        const auto size = header_size() + capacity;
+        char* block = std::allocator_traits<allocator_type>::allocate(block_allocator, size);
+        return ::new (static_cast<void*>(block)) operation_arena(std::move(block_allocator), capacity);
+    }
+
+    /**
+     * Returns the part of the block or nullptr if it does not fit the rest of the block.
+     */
+    void* allocate(std::size_t size, std::size_t alignment) noexcept {
+        auto used = used_.load(std::memory_order_relaxed);
+        for (;;) {
+            const auto offset = (used + alignment - 1) / alignment * alignment;
+            if (offset + size > capacity_) {
+                return nullptr;
+            }
+            if (used_.compare_exchange_weak(used, offset + size, std::memory_order_relaxed)) {
+                acquire();
+                return data() + offset;
+            }
+        }
+    }
+
+    bool owns(const void* ptr) const noexcept {
+        const auto p = static_cast<const char*>(ptr);
+        return std::less_equal<const char*>{}(data(), p) && std::less<const char*>{}(p, data() + capacity_);
+    }
+
+    void acquire() noexcept {
+        refs_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void release() noexcept {
+        if (refs_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            auto block_allocator = std::move(allocator_);
+            const auto size = header_size() + capacity_;
+            this->~operation_arena();
+            std::allocator_traits<allocator_type>::deallocate(block_allocator, reinterpret_cast<char*>(this), size);
+        }
+    }
+
+    const allocator_type& get_allocator() const noexcept { return allocator_;}
+
+private:
+    static constexpr std::size_t header_size() noexcept {
+        constexpr auto alignment = alignof(std::max_align_t);
+        return (sizeof(operation_arena) + alignment - 1) / alignment * alignment;
+    }
+
+    operation_arena(allocator_type allocator, std::size_t capacity) noexcept
+    : allocator_(std::move(allocator)), capacity_(capacity) {}
+
+    char* data() noexcept { return reinterpret_cast<char*>(this) + header_size();}
+    const char* data() const noexcept { return reinterpret_cast<const char*>(this) + header_size();}
+
+    allocator_type allocator_;
+    std::size_t capacity_;
+    std::atomic<std::size_t> used_ {0};
+    std::atomic<std::size_t> refs_ {1};
+};
+
+/**
+ * Allocator which hands out parts of an `operation_arena`. Each copy of the allocator
+ * keeps the arena alive.
+ */
+template <typename T, typename Allocator>
+class operation_arena_allocator {
+public:
+    using value_type = T;
+    using arena_type = operation_arena<Allocator>;
+
+    template <typename U>
+    struct rebind {
+        using other = operation_arena_allocator<U, Allocator>;
+    };
+
+    explicit operation_arena_allocator(arena_type* arena) noexcept : arena_(arena) {}
+
+    operation_arena_allocator(const operation_arena_allocator& other) noexcept : arena_(other.arena_) {
+        arena_->acquire();
+    }
+
+    template <typename U>
+    operation_arena_allocator(const operation_arena_allocator<U, Allocator>& other) noexcept : arena_(other.arena()) {
+        arena_->acquire();
+    }
+
+    operation_arena_allocator& operator =(const operation_arena_allocator& other) noexcept {
+        other.arena_->acquire();
+        arena_->release();
+        arena_ = other.arena_;
+        return *this;
+    }
+
+    ~operation_arena_allocator() { arena_->release(); }
+
+    T* allocate(std::size_t n) {
+        if (void* ptr = arena_->allocate(sizeof(T) * n, alignof(T))) {
+            return static_cast<T*>(ptr);
+        }
+        return fallback().allocate(n);
+    }
+
+    void deallocate(T* ptr, std::size_t n) noexcept {
+        if (arena_->owns(ptr)) {
+            return arena_->release();
+        }
+        fallback().deallocate(ptr, n);
+    }
+
+    arena_type* arena() const noexcept { return arena_;}
+
+    template <typename U>
+    bool operator ==(const operation_arena_allocator<U, Allocator>& other) const noexcept {
+        return arena_ == other.arena();
+    }
+
+    template <typename U>
+    bool operator !=(const operation_arena_allocator<U, Allocator>& other) const noexcept {
+        return !(*this == other);
+    }
+
+private:
+    auto fallback() const {
+        return typename std::allocator_traits<Allocator>::template rebind_alloc<T>(arena_->get_allocator());
+    }
+
+    arena_type* arena_;
+};
+
+/**
+ * Capacity of the arena of an operation with the objects of the given types, e.g. the handler
+ * and the query. The objects are copied into the operation state, and the rest fits the deadline
+ * and the request contexts, and the binary query with its parameters buffer.
+ */
+template <typename ...Ts>
+constexpr std::size_t operation_arena_capacity = 768 + 2 * (sizeof(Ts) + ... + 0);
+
+/**
+ * Creates the arena for the state of the operation with the handler and returns
+ * the allocator of it. The arena block is taken from `get_operation_allocator(handler)`.
+ */
+template <typename Handler>
+inline auto make_operation_arena_allocator(const Handler& handler, std::size_t capacity) {
+    using allocator_type = std::decay_t<decltype(get_operation_allocator(handler))>;
+    using arena_type = operation_arena<allocator_type>;
+    return operation_arena_allocator<char, allocator_type>(arena_type::create(get_operation_allocator(handler), capacity));
+}
+
+} // namespace detail
+} // namespace ozo
@@ -0,0 +1,182 @@
+#pragma once
+
+#include <ozo/impl/async_request_stream.h>
+
+#include <vector>
+
+namespace ozo {
+
+/**
+ * @brief Rows handler which collects streamed rows into chunks of typed rows
+ *
+ * The handler converts streamed results into rows of type `Row` and passes them
+ * to the callback by chunks of `chunk_size` rows, the last chunk may be smaller.
+ * The rows container is reused between the callback calls, so the memory consumption
+ * is bounded by the chunk size. Use `ozo::stream_into()` to create the handler.
+ *
+ * @tparam Row --- type of a row, e.g. `ozo::typed_row<...>` or a reflected structure.
+ * @tparam Callback --- callback type with `void(std::vector<Row>& rows)` signature.
+ * @ingroup group-requests-types
+ */
+template <typename Row, typename Callback>
+struct stream_into_handler {
+    Callback callback; //!< callback to pass chunks of rows to
+    std::size_t chunk_size; //!< number of rows in a chunk
+    std::vector<Row> rows; //!< buffer for the chunk rows
+
+    template <typename Result, typename OidMap>
+    void operator() (Result&& result, const OidMap& oid_map) {
+        // The last streamed result contains no rows
+        const bool last = std::empty(result);
+        ozo::recv_result(result, oid_map, std::back_inserter(rows));
+        if (last ? !std::empty(rows) : std::size(rows) >= chunk_size) {
+            callback(rows);
+            rows.clear();
+        }
+    }
+};
+
+/**
+ * @brief Creates a rows handler for `ozo::request_stream()` with typed chunks of rows
+ *
+ * @tparam Row --- type of a row, e.g. `ozo::typed_row<...>` or a reflected structure.
+ * @param callback --- callback with `void(std::vector<Row>& rows)` signature.
+ * @param chunk_size --- maximum number of rows to pass to the callback at once.
+ * @return `ozo::stream_into_handler` object.
+ * @ingroup group-requests-functions
+ */
+template <typename Row, typename Callback>
+inline auto stream_into(Callback&& callback, std::size_t chunk_size = 1024) {
+    std::vector<Row> rows;
+    rows.reserve(chunk_size);
+    return stream_into_handler<Row, std::decay_t<Callback>>{
+        std::forward<Callback>(callback), chunk_size, std::move(rows)};
+}
+
+#ifdef OZO_DOCUMENTATION
+/**
+ * @brief Executes query and streams rows of the result from a database with time constraint
+ *
+ * The function sends request to a database and passes rows of the result to the rows handler
+ * as soon as they arrive, so the whole result is never materialized in memory and the first
+ * rows are available after a single round trip. libpq single row mode is used, or chunked rows
+ * mode if it is supported by libpq (PostgreSQL 17 or newer). The function can be called as any
+ * of Boost.Asio asynchronous function with #CompletionToken. The request would be cancelled
+ * if time constrain is reached while performing.
+ *
+ * The rows handler is called as `handler(result, oid_map)` for each received part of the result,
+ * where `result` is an `ozo::basic_result` with one or more rows and `oid_map` is the connection
+ * #OidMap to be passed to `ozo::recv_result()`. The last part contains no rows. Use
+ * `ozo::stream_into()` to get rows of the particular type by chunks of the specified size.
+ *
+ * If the rows handler throws an exception, the rest of the result is consumed without
+ * processing and the request completes with `ozo::error::bad_result_process` error.
+ *
+ * @note The function does not participate in ADL since could be implemented via functional object.
+ *
+ * @param provider --- connection provider object to get connection from.
+ * @param query --- query object to request from a database.
+ * @param time_constraint --- request #TimeConstraint; this time constrain <b>includes</b> time for getting connection from provider.
+ * @param handler --- rows handler.
+ * @param token --- operation #CompletionToken.
+ * @return deduced from #CompletionToken.
+ *
+ * ###Example
+ *
+ * @code
+#include <ozo/request_stream.h>
+#include <ozo/connection_info.h>
+#include <ozo/shortcuts.h>
+#include <boost/asio.hpp>
+
+int main() {
+    boost::asio::io_context io;
+    auto conn_info = ozo::connection_info("host=... port=...");
+
+    using namespace ozo::literals;
+    using row = ozo::typed_row<std::int64_t, std::string>;
+
+    auto on_rows = ozo::stream_into<row>([](std::vector<row>& rows) {
+        for (auto& [id, name] : rows) {
+            std::cout << id << '\t' << name << std::endl;
+        }
+    }, 1000);
+
+    ozo::request_stream(conn_info[io], "SELECT id, name FROM users_info"_SQL, ozo::none, std::move(on_rows),
+            [&](ozo::error_code ec, auto conn) {
+        if (ec) {
+            std::cerr << ec.message() << " | " << error_message(conn);
+            if (!is_null_recursive(conn)) {
+                std::cerr << " | " << get_error_context(conn);
+            }
+        }
+    });
+    io.run();
+}
+ * @endcode
+ * @ingroup group-requests-functions
+ */
+template <typename ConnectionProvider, typename BinaryQueryConvertible, typename TimeConstraint, typename RowsHandler, typename CompletionToken>
+decltype(auto) request_stream (ConnectionProvider&& provider, BinaryQueryConvertible&& query, TimeConstraint time_constraint, RowsHandler&& handler, CompletionToken&& token);
+
+/**
+ * @brief Executes query and streams rows of the result from a database
+ *
+ * This function is time constrain free shortcut to `ozo::request_stream()` function.
+ * Its call is equal to `ozo::request_stream(provider, query, ozo::none, handler, token)` call.
+ *
+ * @note The function does not participate in ADL since could be implemented via functional object.
+ *
+ * @param provider --- connection provider object to get connection from.
+ * @param query --- query object to request from a database.
+ * @param handler --- rows handler.
+ * @param token --- operation #CompletionToken.
+ * @return deduced from #CompletionToken.
+ * @ingroup group-requests-functions
+ */
+template <typename ConnectionProvider, typename BinaryQueryConvertible, typename RowsHandler, typename CompletionToken>
+decltype(auto) request_stream (ConnectionProvider&& provider, BinaryQueryConvertible&& query, RowsHandler&& handler, CompletionToken&& token);
+
+#else
+
+template <typename Initiator>
+struct request_stream_op : base_async_operation <request_stream_op<Initiator>, Initiator> {
+    using base = typename request_stream_op::base;
+    using base::base;
+
+    template <typename P, typename Q, typename TimeConstraint, typename RowsHandler, typename CompletionToken>
+    decltype(auto) operator() (P&& provider, Q&& query, TimeConstraint t, RowsHandler&& handler, CompletionToken&& token) const {
+        static_assert(ConnectionProvider<P>, "provider should be a ConnectionProvider");
+        static_assert(ozo::TimeConstraint<TimeConstraint>, "should model TimeConstraint concept");
+        return async_initiate<CompletionToken, handler_signature<P>>(
+            get_operation_initiator(*this), token, std::forward<P>(provider), t,
+            std::forward<Q>(query), std::forward<RowsHandler>(handler));
+    }
+
+    template <typename P, typename Q, typename RowsHandler, typename CompletionToken>
+    decltype(auto) operator() (P&& provider, Q&& query, RowsHandler&& handler, CompletionToken&& token) const {
+        return (*this)(std::forward<P>(provider), std::forward<Q>(query), none,
+            std::forward<RowsHandler>(handler), std::forward<CompletionToken>(token));
+    }
+
+    template <typename OtherInitiator>
+    constexpr static auto rebind_initiator(const OtherInitiator& other) {
+        return request_stream_op<OtherInitiator>{other};
+    }
+};
+
+namespace detail {
+struct initiate_async_request_stream {
+    template <typename Handler, typename P, typename TimeConstraint, typename Q, typename RowsHandler>
+    constexpr void operator()(Handler&& h, P&& p, TimeConstraint t, Q&& q, RowsHandler&& rows_handler) const {
+        impl::async_request_stream(std::forward<P>(p), std::forward<Q>(q), t,
+            std::forward<RowsHandler>(rows_handler), std::forward<Handler>(h));
+    }
+};
+} // namespace detail
+
+constexpr request_stream_op<detail::initiate_async_request_stream> request_stream;
+
+#endif
+
+} // namespace ozo
@@ -147,7 +147,7 @@ public:
         void decrement() noexcept { advance(-1); }
         void advance(int n) noexcept { v_.col += n; }
 
-        int distance_to(const const_iterator& z) noexcept { return z.col - v_.col; }
+        int distance_to(const const_iterator& z) const noexcept { return z.v_.col - v_.col; }
 
         coordinates v_ {nullptr, 0, 0};
 
@@ -301,7 +301,7 @@ public:
         void decrement() noexcept { advance(-1); }
         void advance(int n) noexcept { v_.row += n; }
 
-        int distance_to(const const_iterator& z) noexcept { return z.row - v_.row; }
+        int distance_to(const const_iterator& z) const noexcept { return z.v_.row - v_.row; }
 
         coordinates v_ {nullptr, 0, 0};
 
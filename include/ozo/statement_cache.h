@@ -0,0 +1,229 @@
+#pragma once
+
+#include <ozo/type_traits.h>
+
+#include <algorithm>
+#include <list>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace ozo {
+
+/**
+ * @brief Bounded LRU cache of server-side prepared statements
+ *
+ * The cache maps a query text with its parameters types to a name of a server-side
+ * prepared statement. It is used by the library to send queries via `PQsendQueryPrepared`
+ * instead of `PQsendQueryParams` and let PostgreSQL skip parsing and planning of
+ * frequently executed statements. The cache belongs to a connection (and to a pooled connection
+ * representation), so its content lives exactly as long as the prepared statements on the server.
+ *
+ * Statements evicted from the cache or invalidated due to an error are collected as obsolete
+ * and deallocated by the library in a batch during one of the next statement preparations.
+ *
+ * The cache with zero capacity is disabled, this is the default.
+ *
+ * @thread_safety{Safe,Unsafe}
+ * @ingroup group-connection-types
+ */
+class statement_cache {
+public:
+    /**
+     * @brief Query parameters types view
+     */
+    struct types_view {
+        const oid_t* data = nullptr; //!< pointer to the first type
+        std::size_t size = 0; //!< number of types
+
+        friend bool operator ==(const types_view& lhs, const types_view& rhs) noexcept {
+            return std::equal(lhs.data, lhs.data + lhs.size, rhs.data, rhs.data + rhs.size);
+        }
+    };
+
+    /**
+     * Construct a new cache object
+     *
+     * @param capacity --- maximum number of prepared statements, `0` disables the cache.
+     */
+    explicit statement_cache(std::size_t capacity = 0) : capacity_(capacity) {}
+
+    statement_cache(statement_cache&&) = default;
+    statement_cache& operator =(statement_cache&&) = default;
+
+    /**
+     * Determine whether the cache is enabled.
+     *
+     * @return true --- prepared statements should be used.
+     * @return false --- the cache is disabled.
+     */
+    bool enabled() const noexcept { return capacity_ != 0; }
+
+    /**
+     * Maximum number of prepared statements in the cache.
+     */
+    std::size_t capacity() const noexcept { return capacity_; }
+
+    /**
+     * Current number of prepared statements in the cache.
+     */
+    std::size_t size() const noexcept { return index_.size(); }
+
+    /**
+     * Find a prepared statement for the query and mark it as the most recently used one.
+     *
+     * @param text --- query text.
+     * @param types --- query parameters types.
+     * @return const std::string* --- pointer to the statement name, or `nullptr` if there is no such statement.
+     */
+    const std::string* find(std::string_view text, types_view types) {
+        const auto i = index_.find(key{text, types});
+        if (i == index_.end()) {
+            return nullptr;
+        }
+        entries_.splice(entries_.begin(), entries_, i->second);
+        return std::addressof(i->second->name);
+    }
+
+    /**
+     * Generate a unique name for a new prepared statement.
+     */
+    std::string make_name() {
+        return "ozo_stmt_" + std::to_string(++last_id_);
+    }
+
+    /**
+     * Add a prepared statement as the most recently used one. If the cache capacity is
+     * exceeded, the least recently used statement becomes obsolete.
+     *
+     * @param text --- query text.
+     * @param types --- query parameters types.
+     * @param name --- name of the server-side prepared statement.
+     */
+    void add(std::string_view text, types_view types, std::string name) {
+        if (const auto i = index_.find(key{text, types}); i != index_.end()) {
+            obsolete_.push_back(std::move(i->second->name));
+            erase(i->second);
+        }
+        entries_.push_front(entry{std::string(text), {types.data, types.data + types.size}, std::move(name)});
+        auto& e = entries_.front();
+        index_.emplace(key{e.text, {e.types.data(), e.types.size()}}, entries_.begin());
+        if (size() > capacity_) {
+            obsolete_.push_back(std::move(entries_.back().name));
+            erase(std::prev(entries_.end()));
+        }
+    }
+
+    /**
+     * Remove the statement from the cache and mark it as obsolete, so it would be deallocated.
+     * Should be used when the statement is unusable anymore, e.g. due to the
+     * "cached plan must not change result type" error.
+     *
+     * @param name --- name of the server-side prepared statement.
+     */
+    void invalidate(std::string_view name) {
+        if (const auto i = find_by_name(name); i != entries_.end()) {
+            obsolete_.push_back(std::move(i->name));
+            erase(i);
+        }
+    }
+
+    /**
+     * Remove the statement from the cache without the deallocation. Should be used
+     * when the statement does not exist on the server side anymore.
+     *
+     * @param name --- name of the server-side prepared statement.
+     */
+    void forget(std::string_view name) {
+        if (const auto i = find_by_name(name); i != entries_.end()) {
+            erase(i);
+        }
+    }
+
+    /**
+     * Statements which should be deallocated on the server side.
+     */
+    const std::vector<std::string>& obsolete() const noexcept { return obsolete_; }
+
+    /**
+     * Determine whether enough obsolete statements are collected to be deallocated in a batch.
+     * So at most twice the capacity of statements may be allocated on the server side.
+     */
+    bool should_deallocate() const noexcept {
+        return !obsolete_.empty() && obsolete_.size() >= capacity_;
+    }
+
+    /**
+     * Forget about obsolete statements, should be called when they are deallocated.
+     */
+    void clear_obsolete() noexcept { obsolete_.clear(); }
+
+private:
+    struct entry {
+        std::string text;
+        std::vector<oid_t> types;
+        std::string name;
+    };
+
+    using entries_type = std::list<entry>;
+
+    struct key {
+        std::string_view text;
+        types_view types;
+
+        friend bool operator ==(const key& lhs, const key& rhs) noexcept {
+            return lhs.text == rhs.text && lhs.types == rhs.types;
+        }
+    };
+
+    struct key_hash {
+        std::size_t operator ()(const key& v) const noexcept {
+            const std::string_view types(reinterpret_cast<const char*>(v.types.data),
+                v.types.size * sizeof(oid_t));
+            const auto h = std::hash<std::string_view>{}(v.text);
+            return h ^ (std::hash<std::string_view>{}(types) + 0x9e3779b9 + (h << 6) + (h >> 2));
+        }
+    };
+
+    entries_type::iterator find_by_name(std::string_view name) {
+        return std::find_if(entries_.begin(), entries_.end(),
+            [&](const entry& e) { return e.name == name; });
+    }
+
+    void erase(entries_type::iterator i) {
+        index_.erase(key{i->text, {i->types.data(), i->types.size()}});
+        entries_.erase(i);
+    }
+
+    std::size_t capacity_ = 0;
+    std::size_t last_id_ = 0;
+    entries_type entries_;
+    std::unordered_map<key, entries_type::iterator, key_hash> index_;
+    std::vector<std::string> obsolete_;
+};
+
+namespace detail {
+
+template <typename T, typename = std::void_t<>>
+struct has_statement_cache : std::false_type {};
+
+template <typename T>
+struct has_statement_cache<T, std::void_t<decltype(std::declval<T&>().statement_cache())>> : std::true_type {};
+
+/**
+ * Returns pointer to the enabled statement cache of the connection, or `nullptr` if
+ * the connection has no cache or it is disabled.
+ */
+template <typename Connection>
+inline statement_cache* get_statement_cache(Connection& conn) noexcept {
+    if constexpr (has_statement_cache<std::decay_t<Connection>>::value) {
+        auto& cache = conn.statement_cache();
+        return cache.enabled() ? std::addressof(cache) : nullptr;
+    } else {
+        return nullptr;
+    }
+}
+
+} // namespace detail
+} // namespace ozo
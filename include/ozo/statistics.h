@@ -0,0 +1,212 @@
+#pragma once
+
+#include <ozo/core/none.h>
+#include <ozo/time_traits.h>
+
+#include <boost/hana/type.hpp>
+
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+namespace ozo {
+
+namespace hana = boost::hana;
+
+/**
+ * @brief 'type enum' for keys of connection statistics
+ *
+ * Keys are used by the library operations to update statistics of a connection via
+ * `update_statistics(key, value)`. Counters are updated with `std::uint64_t` values,
+ * times are updated with `ozo::time_traits::duration` values.
+ *
+ * @ingroup group-connection-types
+ */
+struct statistics_key {
+    constexpr static hana::type<class requests_statistics_tag> requests{}; //!< Number of queries sent, including each query of a pipeline
+    constexpr static hana::type<class round_trips_statistics_tag> round_trips{}; //!< Number of round trips to the server: a query sent alone, a statement preparation or a whole pipeline
+    constexpr static hana::type<class bytes_sent_statistics_tag> bytes_sent{}; //!< Query text or statement name and parameters size
+    constexpr static hana::type<class result_memory_statistics_tag> result_memory{}; //!< Memory size of results received via PQresultMemorySize, not the wire size; not counted with libpq older than 12
+    constexpr static hana::type<class rows_decoded_statistics_tag> rows_decoded{}; //!< Number of result rows decoded
+    constexpr static hana::type<class errors_statistics_tag> errors{}; //!< Number of failed requests
+    constexpr static hana::type<class connects_statistics_tag> connects{}; //!< Number of established connections
+    constexpr static hana::type<class connect_errors_statistics_tag> connect_errors{}; //!< Number of failed connection attempts
+    constexpr static hana::type<class send_time_statistics_tag> send_time{}; //!< Time spent sending queries
+    constexpr static hana::type<class wait_time_statistics_tag> wait_time{}; //!< Time spent waiting for results after queries are sent
+    constexpr static hana::type<class decode_time_statistics_tag> decode_time{}; //!< Time spent decoding results
+    constexpr static hana::type<class connect_time_statistics_tag> connect_time{}; //!< Time spent establishing connections
+};
+
+/**
+ * @brief Basic statistics of a connection
+ *
+ * Plain counters which are updated by the request, execute and connect operations.
+ * A connection is used by a single operation at a time, so no synchronization is needed.
+ * Use it as the `Statistics` parameter of `ozo::connection_info` and get the values
+ * via `ozo::unwrap_connection(conn).statistics()`. Statistics of a pooled connection
+ * are kept while the connection is in the pool, also when it is reconnected. Statistics
+ * of all the connections of a pool are available via `ozo::connection_pool::statistics()`.
+ * Use `operator +=` to aggregate statistics of several connections or pools.
+ *
+ * ### Example
+ *
+ * @code{cpp}
+const auto conn_info = ozo::make_connection_info("host=localhost", ozo::register_types<>(), ozo::basic_statistics{});
+ * @endcode
+ *
+ * @ingroup group-connection-types
+ */
+struct basic_statistics {
+    std::uint64_t requests = 0; //!< number of queries sent, including each query of a pipeline
+    std::uint64_t round_trips = 0; //!< number of round trips to the server: a query sent alone, a statement preparation or a whole pipeline
+    std::uint64_t bytes_sent = 0; //!< query text or statement name and parameters size
+    std::uint64_t result_memory = 0; //!< memory size of results received via PQresultMemorySize, not the wire size; not counted with libpq older than 12
+    std::uint64_t rows_decoded = 0; //!< number of result rows decoded
+    std::uint64_t errors = 0; //!< number of failed requests
+    std::uint64_t connects = 0; //!< number of established connections
+    std::uint64_t connect_errors = 0; //!< number of failed connection attempts
+    time_traits::duration send_time {}; //!< time spent sending queries
+    time_traits::duration wait_time {}; //!< time spent waiting for results after queries are sent
+    time_traits::duration decode_time {}; //!< time spent decoding results
+    time_traits::duration connect_time {}; //!< time spent establishing connections
+
+    /**
+     * Add the value to the statistics item.
+     *
+     * @param key --- one of `ozo::statistics_key` items.
+     * @param value --- value to add.
+     */
+    template <typename Key, typename Value>
+    constexpr void update(const Key& key, const Value& value) noexcept {
+        item(key) += value;
+    }
+
+    /**
+     * Add all the items of other statistics.
+     *
+     * @param rhs --- statistics to add.
+     * @return basic_statistics& --- reference to this object.
+     */
+    constexpr basic_statistics& operator +=(const basic_statistics& rhs) noexcept {
+        requests += rhs.requests;
+        round_trips += rhs.round_trips;
+        bytes_sent += rhs.bytes_sent;
+        result_memory += rhs.result_memory;
+        rows_decoded += rhs.rows_decoded;
+        errors += rhs.errors;
+        connects += rhs.connects;
+        connect_errors += rhs.connect_errors;
+        send_time += rhs.send_time;
+        wait_time += rhs.wait_time;
+        decode_time += rhs.decode_time;
+        connect_time += rhs.connect_time;
+        return *this;
+    }
+
+private:
+    template <typename Key>
+    using key_t = std::decay_t<Key>;
+
+    constexpr auto& item(key_t<decltype(statistics_key::requests)>) noexcept { return requests; }
+    constexpr auto& item(key_t<decltype(statistics_key::round_trips)>) noexcept { return round_trips; }
+    constexpr auto& item(key_t<decltype(statistics_key::bytes_sent)>) noexcept { return bytes_sent; }
+    constexpr auto& item(key_t<decltype(statistics_key::result_memory)>) noexcept { return result_memory; }
+    constexpr auto& item(key_t<decltype(statistics_key::rows_decoded)>) noexcept { return rows_decoded; }
+    constexpr auto& item(key_t<decltype(statistics_key::errors)>) noexcept { return errors; }
+    constexpr auto& item(key_t<decltype(statistics_key::connects)>) noexcept { return connects; }
+    constexpr auto& item(key_t<decltype(statistics_key::connect_errors)>) noexcept { return connect_errors; }
+    constexpr auto& item(key_t<decltype(statistics_key::send_time)>) noexcept { return send_time; }
+    constexpr auto& item(key_t<decltype(statistics_key::wait_time)>) noexcept { return wait_time; }
+    constexpr auto& item(key_t<decltype(statistics_key::decode_time)>) noexcept { return decode_time; }
+    constexpr auto& item(key_t<decltype(statistics_key::connect_time)>) noexcept { return connect_time; }
+};
+
+/**
+ * @brief Sum of two statistics
+ * @ingroup group-connection-types
+ */
+constexpr basic_statistics operator +(basic_statistics lhs, const basic_statistics& rhs) noexcept {
+    return lhs += rhs;
+}
+
+namespace detail {
+
+template <typename T, typename = std::void_t<>>
+struct connection_statistics {
+    using type = none_t;
+};
+
+template <typename T>
+struct connection_statistics<T, std::void_t<decltype(std::declval<const T&>().statistics())>> {
+    using type = std::decay_t<decltype(std::declval<const T&>().statistics())>;
+};
+
+/**
+ * Statistics type of the unwrapped connection, `ozo::none_t` if the
+ * connection does not provide statistics.
+ */
+template <typename T>
+using connection_statistics_t = typename connection_statistics<std::decay_t<T>>::type;
+
+template <typename T>
+constexpr bool CollectsStatistics = !std::is_same_v<connection_statistics_t<T>, none_t>;
+
+/**
+ * Updates statistics of the unwrapped connection, does nothing
+ * if the connection does not collect statistics.
+ */
+template <typename Connection, typename Key, typename Value>
+inline void update_statistics([[maybe_unused]] Connection& conn,
+        [[maybe_unused]] const Key& key, [[maybe_unused]] const Value& value) noexcept {
+    if constexpr (CollectsStatistics<Connection>) {
+        conn.update_statistics(key, value);
+    }
+}
+
+template <typename Connection>
+inline decltype(auto) get_statistics([[maybe_unused]] const Connection& conn) noexcept {
+    if constexpr (CollectsStatistics<Connection>) {
+        return conn.statistics();
+    } else {
+        return none;
+    }
+}
+
+/**
+ * Adds statistics of a new connection to the statistics of the connection it replaces,
+ * e.g. within the same slot of a pool, so the counters are not lost on reconnect.
+ */
+template <typename Statistics>
+inline Statistics accumulate_statistics(Statistics previous, [[maybe_unused]] const Statistics& v) {
+    if constexpr (std::is_same_v<Statistics, none_t>) {
+        return previous;
+    } else {
+        previous += v;
+        return previous;
+    }
+}
+
+/**
+ * Measures operation phases durations. The clock is not read at all
+ * if the connection does not collect statistics.
+ */
+template <bool Enabled>
+struct statistics_stopwatch {
+    time_traits::time_point start = time_traits::now();
+
+    time_traits::duration lap() noexcept {
+        const auto previous = std::exchange(start, time_traits::now());
+        return start - previous;
+    }
+};
+
+template <>
+struct statistics_stopwatch<false> {
+    constexpr time_traits::duration lap() const noexcept { return {}; }
+};
+
+template <typename Connection>
+using statistics_stopwatch_t = statistics_stopwatch<CollectsStatistics<Connection>>;
+
+} // namespace detail
+} // namespace ozo
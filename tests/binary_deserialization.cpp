@@ -729,6 +729,46 @@ TEST_F(recv_result, send_convert_INT4OID_to_vector_via_iterator) {
     EXPECT_THAT(got, ElementsAre(7, 7));
 }
 
+TEST_F(recv_result, should_resolve_columns_and_check_oids_once_per_result) {
+    const char int32_bytes[] = { 0x00, 0x00, 0x00, 0x07 };
+    const char* string_bytes = "test";
+
+    EXPECT_CALL(mock, nfields()).WillRepeatedly(Return(2));
+    EXPECT_CALL(mock, ntuples()).WillRepeatedly(Return(3));
+
+    EXPECT_CALL(mock, field_number(Eq("digit"s))).WillOnce(Return(0));
+    EXPECT_CALL(mock, field_type(0)).WillOnce(Return(23));
+    EXPECT_CALL(mock, get_value(_, 0)).WillRepeatedly(Return(int32_bytes));
+    EXPECT_CALL(mock, get_length(_, 0)).WillRepeatedly(Return(4));
+    EXPECT_CALL(mock, get_isnull(_, 0)).WillRepeatedly(Return(false));
+
+    EXPECT_CALL(mock, field_number(Eq("text"s))).WillOnce(Return(1));
+    EXPECT_CALL(mock, field_type(1)).WillOnce(Return(25));
+    EXPECT_CALL(mock, get_value(_, 1)).WillRepeatedly(Return(string_bytes));
+    EXPECT_CALL(mock, get_length(_, 1)).WillRepeatedly(Return(4));
+    EXPECT_CALL(mock, get_isnull(_, 1)).WillRepeatedly(Return(false));
+
+    std::vector<hana_adapted_test_result> got;
+    ozo::recv_result(res, oid_map, std::back_inserter(got));
+    EXPECT_EQ(got.size(), 3u);
+    EXPECT_EQ(got[2].digit, 7);
+    EXPECT_EQ(got[2].text, "test");
+}
+
+TEST_F(recv_result, should_receive_nulls_from_column_with_not_accepted_type) {
+    EXPECT_CALL(mock, nfields()).WillRepeatedly(Return(1));
+    EXPECT_CALL(mock, ntuples()).WillRepeatedly(Return(2));
+
+    EXPECT_CALL(mock, field_type(0)).WillRepeatedly(Return(25));
+    EXPECT_CALL(mock, get_value(_, 0)).WillRepeatedly(Return(nullptr));
+    EXPECT_CALL(mock, get_length(_, 0)).WillRepeatedly(Return(0));
+    EXPECT_CALL(mock, get_isnull(_, 0)).WillRepeatedly(Return(true));
+
+    std::vector<std::optional<std::int32_t>> got;
+    ozo::recv_result(res, oid_map, std::back_inserter(got));
+    EXPECT_THAT(got, ElementsAre(std::nullopt, std::nullopt));
+}
+
 TEST_F(recv_result, send_returns_result_then_result_requested) {
     ozo::basic_result<pg_result_mock*> got;
     ozo::recv_result(res, oid_map, got);
@@ -0,0 +1,157 @@
+#include "connection_mock.h"
+
+#include <ozo/circuit_breaker.h>
+
+#include <boost/asio/io_context.hpp>
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+namespace {
+
+using namespace testing;
+using namespace std::chrono_literals;
+
+using ozo::tests::deferred_connection_source;
+
+using breaker_type = ozo::circuit_breaker<deferred_connection_source, ozo::thread_safety<false>>;
+
+struct circuit_breaker : Test {
+    boost::asio::io_context io;
+    std::vector<deferred_connection_source::handler_type> attempts;
+    std::vector<ozo::error_code> results;
+
+    auto make_breaker(ozo::circuit_breaker_config config) {
+        return breaker_type{deferred_connection_source{&attempts}, config};
+    }
+
+    static ozo::circuit_breaker_config config(std::size_t failure_threshold, ozo::time_traits::duration open_duration) {
+        ozo::circuit_breaker_config result;
+        result.failure_threshold = failure_threshold;
+        result.open_duration = open_duration;
+        return result;
+    }
+
+    void connect(const breaker_type& breaker) {
+        breaker(io, 1h, [this] (ozo::error_code ec, auto) { results.push_back(ec); });
+    }
+
+    void complete(std::size_t attempt, ozo::error_code ec = {}) {
+        auto handler = std::move(attempts.at(attempt));
+        handler(ec, nullptr);
+    }
+
+    void fail(const breaker_type& breaker, std::size_t n) {
+        for (std::size_t i = 0; i != n; ++i) {
+            connect(breaker);
+            complete(attempts.size() - 1, ozo::error::pq_connection_start_failed);
+        }
+    }
+};
+
+TEST_F(circuit_breaker, should_forward_attempts_to_source_while_circuit_is_closed) {
+    const auto breaker = make_breaker(config(2, 1h));
+    connect(breaker);
+    complete(0);
+    EXPECT_THAT(results, ElementsAre(ozo::error_code{}));
+    EXPECT_EQ(breaker.state(), ozo::circuit_state::closed);
+    EXPECT_FALSE(ozo::is_circuit_open(breaker));
+}
+
+TEST_F(circuit_breaker, should_open_circuit_after_consecutive_connection_failures) {
+    const auto breaker = make_breaker(config(2, 1h));
+    fail(breaker, 1);
+    EXPECT_EQ(breaker.state(), ozo::circuit_state::closed);
+    fail(breaker, 1);
+    EXPECT_EQ(breaker.state(), ozo::circuit_state::open);
+    EXPECT_TRUE(ozo::is_circuit_open(breaker));
+}
+
+TEST_F(circuit_breaker, should_reset_failures_after_successful_attempt) {
+    const auto breaker = make_breaker(config(2, 1h));
+    fail(breaker, 1);
+    connect(breaker);
+    complete(1);
+    fail(breaker, 1);
+    EXPECT_EQ(breaker.state(), ozo::circuit_state::closed);
+}
+
+TEST_F(circuit_breaker, should_not_count_errors_other_than_connection_errors) {
+    const auto breaker = make_breaker(config(1, 1h));
+    connect(breaker);
+    complete(0, ozo::error::pool_queue_overflow);
+    EXPECT_EQ(breaker.state(), ozo::circuit_state::closed);
+}
+
+TEST_F(circuit_breaker, should_not_count_cancelled_attempts_and_rejections_of_nested_breaker) {
+    const auto breaker = make_breaker(config(1, 1h));
+    connect(breaker);
+    complete(0, boost::asio::error::operation_aborted);
+    connect(breaker);
+    complete(1, ozo::error::circuit_breaker_open);
+    EXPECT_EQ(breaker.state(), ozo::circuit_state::closed);
+}
+
+TEST_F(circuit_breaker, should_keep_circuit_half_open_after_cancelled_probe) {
+    const auto breaker = make_breaker(config(1, 0s));
+    fail(breaker, 1);
+    connect(breaker);
+    complete(1, boost::asio::error::operation_aborted);
+    EXPECT_EQ(breaker.state(), ozo::circuit_state::half_open);
+    EXPECT_FALSE(ozo::is_circuit_open(breaker));
+}
+
+TEST_F(circuit_breaker, should_reject_attempt_with_circuit_breaker_open_while_circuit_is_open) {
+    const auto breaker = make_breaker(config(1, 1h));
+    fail(breaker, 1);
+    connect(breaker);
+    io.run();
+    EXPECT_EQ(attempts.size(), 1u);
+    EXPECT_THAT(results, ElementsAre(ozo::error_code{ozo::error::pq_connection_start_failed},
+        ozo::error_code{ozo::error::circuit_breaker_open}));
+    EXPECT_EQ(breaker.rejected(), 1u);
+}
+
+TEST_F(circuit_breaker, circuit_breaker_open_should_match_connection_error) {
+    EXPECT_EQ(ozo::error_code{ozo::error::circuit_breaker_open}, ozo::errc::connection_error);
+}
+
+TEST_F(circuit_breaker, should_pass_probe_and_reject_other_attempts_after_open_duration) {
+    const auto breaker = make_breaker(config(1, 0s));
+    fail(breaker, 1);
+    connect(breaker);
+    connect(breaker);
+    io.run();
+    EXPECT_EQ(attempts.size(), 2u);
+    EXPECT_EQ(breaker.state(), ozo::circuit_state::half_open);
+    EXPECT_TRUE(ozo::is_circuit_open(breaker));
+    EXPECT_THAT(results, ElementsAre(ozo::error_code{ozo::error::pq_connection_start_failed},
+        ozo::error_code{ozo::error::circuit_breaker_open}));
+}
+
+TEST_F(circuit_breaker, should_close_circuit_after_successful_probe) {
+    const auto breaker = make_breaker(config(1, 0s));
+    fail(breaker, 1);
+    connect(breaker);
+    complete(1);
+    EXPECT_EQ(breaker.state(), ozo::circuit_state::closed);
+    EXPECT_FALSE(ozo::is_circuit_open(breaker));
+}
+
+TEST_F(circuit_breaker, should_open_circuit_again_after_failed_probe) {
+    auto cfg = config(3, 0s);
+    const auto breaker = make_breaker(cfg);
+    fail(breaker, 3);
+    connect(breaker);
+    complete(3, ozo::error::pq_connection_start_failed);
+    EXPECT_EQ(breaker.state(), ozo::circuit_state::open);
+}
+
+TEST_F(circuit_breaker, copies_should_share_circuit) {
+    const auto breaker = make_breaker(config(1, 1h));
+    const auto copy = breaker;
+    fail(breaker, 1);
+    EXPECT_TRUE(ozo::is_circuit_open(copy));
+}
+
+} // namespace
@@ -0,0 +1,186 @@
+#include "connection_mock.h"
+
+#include <ozo/connect_limiter.h>
+
+#include <boost/asio/io_context.hpp>
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+namespace {
+
+using namespace testing;
+using namespace std::chrono_literals;
+
+using ozo::tests::deferred_connection_source;
+
+using limiter_type = ozo::connect_limiter<deferred_connection_source, ozo::thread_safety<false>>;
+
+struct connect_limiter : Test {
+    boost::asio::io_context io;
+    std::vector<deferred_connection_source::handler_type> attempts;
+    std::vector<ozo::error_code> results;
+
+    auto make_limiter(ozo::connect_limiter_config config) {
+        return limiter_type{deferred_connection_source{&attempts}, config};
+    }
+
+    static ozo::connect_limiter_config no_backoff() {
+        ozo::connect_limiter_config config;
+        config.backoff = ozo::time_traits::duration(0);
+        return config;
+    }
+
+    void connect(const limiter_type& limiter, ozo::time_traits::duration t = 1h) {
+        limiter(io, t, [this] (ozo::error_code ec, auto) { results.push_back(ec); });
+    }
+
+    void complete(std::size_t attempt, ozo::error_code ec = {}) {
+        auto handler = std::move(attempts.at(attempt));
+        handler(ec, nullptr);
+    }
+};
+
+TEST_F(connect_limiter, should_forward_attempt_to_source_while_limits_are_not_reached) {
+    const auto limiter = make_limiter(no_backoff());
+    connect(limiter);
+    connect(limiter);
+    EXPECT_EQ(attempts.size(), 2u);
+    EXPECT_EQ(limiter.in_flight(), 2u);
+    complete(0);
+    complete(1);
+    EXPECT_THAT(results, ElementsAre(ozo::error_code{}, ozo::error_code{}));
+    EXPECT_EQ(limiter.in_flight(), 0u);
+}
+
+TEST_F(connect_limiter, should_defer_attempt_until_in_flight_attempt_completes) {
+    auto config = no_backoff();
+    config.max_in_flight = 1;
+    const auto limiter = make_limiter(config);
+    connect(limiter);
+    connect(limiter);
+    EXPECT_EQ(attempts.size(), 1u);
+    EXPECT_EQ(limiter.queue_size(), 1u);
+    complete(0);
+    io.poll();
+    EXPECT_EQ(attempts.size(), 2u);
+    EXPECT_EQ(limiter.queue_size(), 0u);
+}
+
+TEST_F(connect_limiter, should_complete_queued_attempt_with_timed_out_after_time_constraint) {
+    auto config = no_backoff();
+    config.max_in_flight = 1;
+    const auto limiter = make_limiter(config);
+    connect(limiter);
+    connect(limiter, 1ms);
+    io.run();
+    EXPECT_THAT(results, ElementsAre(ozo::error_code{boost::asio::error::timed_out}));
+    EXPECT_EQ(attempts.size(), 1u);
+}
+
+TEST_F(connect_limiter, should_delay_attempts_by_rate_limit) {
+    auto config = no_backoff();
+    config.connects_per_second = 20;
+    const auto limiter = make_limiter(config);
+    connect(limiter);
+    connect(limiter);
+    io.poll();
+    EXPECT_EQ(attempts.size(), 1u);
+    io.run();
+    EXPECT_EQ(attempts.size(), 2u);
+}
+
+TEST_F(connect_limiter, should_not_take_rate_slot_by_attempt_rejected_with_timed_out) {
+    auto config = no_backoff();
+    config.connects_per_second = 1;
+    const auto limiter = make_limiter(config);
+    connect(limiter);
+    connect(limiter, 10ms);
+    connect(limiter, 10ms);
+    io.poll();
+    EXPECT_THAT(results, ElementsAre(ozo::error_code{boost::asio::error::timed_out},
+        ozo::error_code{boost::asio::error::timed_out}));
+
+    auto state = ozo::detail::connect_limiter_state<ozo::thread_safety<false>>(config);
+    const auto first = state.reserve(ozo::time_traits::time_point::max());
+    ASSERT_TRUE(first);
+    EXPECT_FALSE(state.reserve(*first + 10ms));
+    const auto second = state.reserve(ozo::time_traits::time_point::max());
+    ASSERT_TRUE(second);
+    EXPECT_EQ(*second - *first, ozo::time_traits::duration(1s));
+}
+
+TEST_F(connect_limiter, should_delay_attempt_after_failure_by_backoff) {
+    ozo::connect_limiter_config config;
+    config.backoff = 20ms;
+    const auto limiter = make_limiter(config);
+    connect(limiter);
+    complete(0, ozo::error::pq_connection_start_failed);
+    connect(limiter);
+    io.poll();
+    EXPECT_EQ(attempts.size(), 1u);
+    io.run();
+    EXPECT_EQ(attempts.size(), 2u);
+}
+
+TEST_F(connect_limiter, should_complete_attempt_with_timed_out_if_backoff_exceeds_time_constraint) {
+    ozo::connect_limiter_config config;
+    config.backoff = 1h;
+    const auto limiter = make_limiter(config);
+    connect(limiter);
+    complete(0, ozo::error::pq_connection_start_failed);
+    connect(limiter, 1s);
+    io.run();
+    EXPECT_THAT(results, ElementsAre(ozo::error_code{ozo::error::pq_connection_start_failed},
+        ozo::error_code{boost::asio::error::timed_out}));
+    EXPECT_EQ(attempts.size(), 1u);
+    EXPECT_EQ(limiter.in_flight(), 0u);
+}
+
+TEST_F(connect_limiter, should_reset_backoff_after_successful_attempt) {
+    ozo::connect_limiter_config config;
+    config.backoff = 1h;
+    const auto limiter = make_limiter(config);
+    connect(limiter);
+    connect(limiter);
+    complete(0, ozo::error::pq_connection_start_failed);
+    complete(1);
+    connect(limiter);
+    EXPECT_EQ(attempts.size(), 3u);
+}
+
+TEST_F(connect_limiter, should_escalate_backoff_once_for_attempts_failed_together) {
+    ozo::connect_limiter_config config;
+    config.backoff = 1h;
+    config.max_backoff = 8h;
+    auto state = ozo::detail::connect_limiter_state<ozo::thread_safety<false>>(config);
+    const auto started_at = ozo::time_traits::now();
+    state.complete(ozo::error::pq_connection_start_failed, started_at);
+    state.complete(ozo::error::pq_connection_start_failed, started_at);
+    state.complete(ozo::error::pq_connection_start_failed, started_at);
+    const auto start = state.reserve(ozo::time_traits::time_point::max());
+    ASSERT_TRUE(start);
+    EXPECT_LE(*start - ozo::time_traits::now(), ozo::time_traits::duration(1h));
+}
+
+TEST_F(connect_limiter, should_not_back_off_after_cancelled_attempt) {
+    ozo::connect_limiter_config config;
+    config.backoff = 1h;
+    const auto limiter = make_limiter(config);
+    connect(limiter);
+    complete(0, boost::asio::error::operation_aborted);
+    connect(limiter);
+    EXPECT_EQ(attempts.size(), 2u);
+}
+
+TEST_F(connect_limiter, should_not_back_off_after_attempt_out_of_time_constraint) {
+    ozo::connect_limiter_config config;
+    config.backoff = 1h;
+    const auto limiter = make_limiter(config);
+    connect(limiter);
+    complete(0, boost::asio::error::timed_out);
+    connect(limiter);
+    EXPECT_EQ(attempts.size(), 2u);
+}
+
+} // namespace
@@ -3,9 +3,13 @@
 #include "test_asio.h"
 
 #include <ozo/impl/io.h>
+#include <ozo/detail/make_copyable.h>
 #include <ozo/impl/transaction.h>
 #include <ozo/time_traits.h>
 
+#include <functional>
+#include <vector>
+
 namespace ozo::tests {
 
 struct pg_result {
@@ -85,11 +89,77 @@ struct PGconn_mock {
         );
     }
 
+    MOCK_METHOD4(PQsendPrepare, int(const char*, const char*, int, const Oid*));
+    friend int PQsendPrepare(PGconn_mock* self,
+                      const char *stmtName,
+                      const char *query,
+                      int nParams,
+                      const Oid *paramTypes) {
+        return mock(self).PQsendPrepare(stmtName, query, nParams, paramTypes);
+    }
+
+    MOCK_METHOD6(PQsendQueryPrepared, int(
+                      const char*, int,
+                      const char* const*, const int*,
+                      const int*, int));
+    friend int PQsendQueryPrepared(PGconn_mock* self,
+                      const char *stmtName,
+                      int nParams,
+                      const char * const *paramValues,
+                      const int *paramLengths,
+                      const int *paramFormats,
+                      int resultFormat) {
+        return mock(self).PQsendQueryPrepared(
+            stmtName, nParams, paramValues,
+            paramLengths, paramFormats, resultFormat
+        );
+    }
+
+    MOCK_METHOD1(PQsendQuery, int(const char*));
+    friend int PQsendQuery(PGconn_mock* self, const char *command) {
+        return mock(self).PQsendQuery(command);
+    }
+
+    MOCK_METHOD2(PQputCopyData, int(const char*, int));
+    friend int PQputCopyData(PGconn_mock* self, const char *buffer, int nbytes) {
+        return mock(self).PQputCopyData(buffer, nbytes);
+    }
+
+    MOCK_METHOD1(PQputCopyEnd, int(const char*));
+    friend int PQputCopyEnd(PGconn_mock* self, const char *errormsg) {
+        return mock(self).PQputCopyEnd(errormsg);
+    }
+
+    MOCK_METHOD2(PQgetCopyData, int(char**, int));
+    friend int PQgetCopyData(PGconn_mock* self, char **buffer, int async) {
+        return mock(self).PQgetCopyData(buffer, async);
+    }
+
+    MOCK_METHOD0(PQsetSingleRowMode, int());
+    friend int PQsetSingleRowMode(PGconn_mock* self) {
+        return mock(self).PQsetSingleRowMode();
+    }
+
     MOCK_METHOD0(PQgetResult, pg_result*());
     friend pg_result* PQgetResult(PGconn_mock* self) {
         return mock(self).PQgetResult();
     }
 
+    MOCK_METHOD0(PQenterPipelineMode, int());
+    friend int PQenterPipelineMode(PGconn_mock* self) {
+        return mock(self).PQenterPipelineMode();
+    }
+
+    MOCK_METHOD0(PQexitPipelineMode, int());
+    friend int PQexitPipelineMode(PGconn_mock* self) {
+        return mock(self).PQexitPipelineMode();
+    }
+
+    MOCK_METHOD0(PQpipelineSync, int());
+    friend int PQpipelineSync(PGconn_mock* self) {
+        return mock(self).PQpipelineSync();
+    }
+
 private:
     static PGconn_mock& mock(PGconn_mock* self) { return self ? *self : null_mock();}
     static PGconn_mock& null_mock() {
@@ -138,6 +208,10 @@ inline const char* PQresultErrorField(const pg_result* res, int) noexcept {
     return res->error;
 }
 
+inline int pq_ntuples(const pg_result&) noexcept {
+    return 0;
+}
+
 using ozo::empty_oid_map;
 
 struct cancel_handle_mock {
@@ -205,12 +279,15 @@ struct connection {
     using error_context_type = std::string;
     using oid_map_type = OidMap;
     using executor_type = io_context::executor_type;
+    using statement_cache_type = ozo::statement_cache;
 
     handle_type handle_;
     OidMap oid_map_;
     connection_mock* mock_ = nullptr;
     error_context_type error_context_;
     io_context* io_;
+    statement_cache_type statement_cache_;
+    std::shared_ptr<ozo::detail::oid_map_cache<OidMap>> oid_map_cache_;
 
     connection(handle_type handle, OidMap oid_map, connection_mock* mock, error_context_type error_context_type, io_context* io)
     : handle_(std::move(handle)), oid_map_(oid_map), mock_(mock), error_context_(error_context_type), io_(io) {}
@@ -223,6 +300,10 @@ struct connection {
 
     void set_error_context(error_context_type v = error_context_type{}) { error_context_ = std::move(v); }
 
+    statement_cache_type& statement_cache() noexcept { return statement_cache_;}
+
+    std::shared_ptr<ozo::detail::oid_map_cache<OidMap>>& oid_map_cache() noexcept { return oid_map_cache_;}
+
     oid_map_type& oid_map() noexcept { return oid_map_;}
 
     const oid_map_type& oid_map() const noexcept { return oid_map_;}
@@ -327,4 +408,18 @@ inline auto make_connection(connection_mock& mock, io_context& io,
         });
 }
 
+// Connection source which stores connect handlers into the attempts container
+// instead of connecting, so a test may complete each attempt later with any error.
+struct deferred_connection_source {
+    using connection_type = connection_ptr<>;
+    using handler_type = std::function<void(ozo::error_code, connection_type)>;
+
+    std::vector<handler_type>* attempts = nullptr;
+
+    template <typename TimeConstraint, typename Handler>
+    void operator()(ozo::io_context&, TimeConstraint, Handler&& h) const {
+        attempts->emplace_back(ozo::detail::make_copyable(std::forward<Handler>(h)));
+    }
+};
+
 } // namespace ozo::tests
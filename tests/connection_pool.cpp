@@ -7,6 +7,11 @@
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
 
+#include <optional>
+
+#include <fcntl.h>
+#include <unistd.h>
+
 namespace {
 
 TEST(make_connection_pool, should_not_throw) {
@@ -16,6 +21,61 @@ TEST(make_connection_pool, should_not_throw) {
     EXPECT_NO_THROW(ozo::make_connection_pool(conn_info, config));
 }
 
+struct pooled_connection_stream : testing::Test {
+    using stream_type = boost::asio::posix::stream_descriptor;
+
+    int fds[2] = {-1, -1};
+
+    pooled_connection_stream() {
+        EXPECT_EQ(::pipe(fds), 0);
+    }
+
+    ~pooled_connection_stream() {
+        ::close(fds[0]);
+        ::close(fds[1]);
+    }
+};
+
+TEST_F(pooled_connection_stream, should_return_same_socket_for_same_io_context) {
+    boost::asio::io_context io;
+    ozo::detail::pooled_connection_stream<stream_type> stream;
+    auto& first = stream.get(io.get_executor(), fds[0]);
+    auto& second = stream.get(io.get_executor(), fds[0]);
+    EXPECT_EQ(std::addressof(first), std::addressof(second));
+    EXPECT_EQ(second.native_handle(), fds[0]);
+}
+
+TEST_F(pooled_connection_stream, should_bind_socket_to_other_io_context) {
+    boost::asio::io_context io;
+    boost::asio::io_context other;
+    ozo::detail::pooled_connection_stream<stream_type> stream;
+    stream.get(io.get_executor(), fds[0]);
+    auto& socket = stream.get(other.get_executor(), fds[0]);
+    EXPECT_EQ(std::addressof(socket.get_executor().context()), std::addressof(other));
+    EXPECT_EQ(socket.native_handle(), fds[0]);
+}
+
+TEST_F(pooled_connection_stream, should_release_socket_when_io_context_is_destroyed_first) {
+    ozo::detail::pooled_connection_stream<stream_type> stream;
+    {
+        boost::asio::io_context io;
+        stream.get(io.get_executor(), fds[0]);
+        io.stop();
+    }
+    EXPECT_NE(::fcntl(fds[0], F_GETFD), -1);
+    boost::asio::io_context io;
+    EXPECT_EQ(stream.get(io.get_executor(), fds[0]).native_handle(), fds[0]);
+}
+
+TEST_F(pooled_connection_stream, should_not_close_descriptor_on_destruction) {
+    boost::asio::io_context io;
+    {
+        ozo::detail::pooled_connection_stream<stream_type> stream;
+        stream.get(io.get_executor(), fds[0]);
+    }
+    EXPECT_NE(::fcntl(fds[0], F_GETFD), -1);
+}
+
 } //namespace
 
 namespace ozo::tests {
@@ -26,16 +86,41 @@ struct pool_handle_mock {
         using oid_map_type = empty_oid_map;
         using error_context_type = std::string;
         using statistics_type = ozo::none_t;
+        using stream_type = stream_descriptor;
 
         native_conn_handle safe_handle_;
         ozo::empty_oid_map oid_map_;
         error_context_type error_context_;
+        std::size_t statement_cache_capacity_ = 0;
+        std::shared_ptr<ozo::statement_cache> statement_cache_ = std::make_shared<ozo::statement_cache>();
+        std::optional<stream_type> stream_;
+        ozo::time_traits::time_point created_at_ = ozo::time_traits::now();
+
+        value_type(native_conn_handle safe_handle, ozo::empty_oid_map oid_map,
+                error_context_type error_context, statistics_type = {},
+                const ozo::statement_cache& statement_cache = ozo::statement_cache{})
+        : safe_handle_(std::move(safe_handle)), oid_map_(oid_map), error_context_(std::move(error_context)),
+          statement_cache_capacity_(statement_cache.capacity()) {}
 
         const native_conn_handle& safe_native_handle() const & {return safe_handle_;}
         native_conn_handle& safe_native_handle() & {return safe_handle_;}
 
         const oid_map_type& oid_map() const & {return oid_map_;}
 
+        ozo::statement_cache& statement_cache() & {return *statement_cache_;}
+
+        template <typename Executor>
+        stream_type& stream(const Executor& ex) & {
+            if (!stream_) {
+                stream_.emplace(ex.context());
+                stream_->assign(PQsocket(safe_handle_.get()));
+            }
+            return *stream_;
+        }
+        void release_stream() noexcept { stream_->release();}
+
+        ozo::time_traits::time_point created_at() const noexcept { return created_at_;}
+
         const statistics_type& statistics() const & {return ozo::none;}
         template <typename Key, typename Value>
         void update_statistics(const Key&, Value&&) noexcept {
@@ -65,6 +150,7 @@ struct connection_pool {
         using oid_map_type = value_type::oid_map_type;
         using error_context_type = value_type::error_context_type;
         using statistics_type = value_type::statistics_type;
+        using stream_type = value_type::stream_type;
 
         handle(pool_handle_mock* mock)
             : mock_(mock)
@@ -162,7 +248,6 @@ TEST_F(pooled_connection, should_call_handle_waste_on_destruction_if_handle_is_n
     EXPECT_CALL(io.stream_service_, create()).WillRepeatedly(ReturnRef(socket));
     EXPECT_CALL(socket, assign(42));
     EXPECT_CALL(conn_handle, PQstatus()).WillOnce(Return(CONNECTION_BAD));
-    EXPECT_CALL(socket, release()).WillOnce(Return(42));
     EXPECT_CALL(handle_mock, waste()).WillOnce(Return());
 
     {
@@ -184,7 +269,6 @@ TEST_P(pooled_connection, should_call_handle_waste_on_destruction_if_connection_
     EXPECT_CALL(socket, assign(42));
     EXPECT_CALL(conn_handle, PQstatus()).WillOnce(Return(CONNECTION_OK));
     EXPECT_CALL(conn_handle, PQtransactionStatus()).WillOnce(Return(GetParam()));
-    EXPECT_CALL(socket, release()).WillOnce(Return(42));
     EXPECT_CALL(handle_mock, waste()).WillOnce(Return());
 
     {
@@ -213,7 +297,6 @@ TEST_F(pooled_connection, should_not_call_waste_on_destruction_if_handle_is_not_
     EXPECT_CALL(socket, assign(42));
     EXPECT_CALL(conn_handle, PQstatus()).WillOnce(Return(CONNECTION_OK));
     EXPECT_CALL(conn_handle, PQtransactionStatus()).WillOnce(Return(PQTRANS_IDLE));
-    EXPECT_CALL(socket, release()).WillOnce(Return(42));
 
     {
         impl p(io.get_executor(), connection_pool::handle{&handle_mock});
@@ -225,7 +308,6 @@ TEST_F(pooled_connection, should_not_check_connection_status_and_call_waste_on_d
     EXPECT_CALL(conn_handle, PQsocket()).WillOnce(Return(42));
     EXPECT_CALL(io.stream_service_, create()).WillRepeatedly(ReturnRef(socket));
     EXPECT_CALL(socket, assign(42));
-    EXPECT_CALL(socket, release()).WillOnce(Return(42));
     EXPECT_CALL(handle_mock, empty()).WillRepeatedly(Return(false));
 
     {
@@ -235,6 +317,229 @@ TEST_F(pooled_connection, should_not_check_connection_status_and_call_waste_on_d
     }
 }
 
+TEST_F(pooled_connection, should_count_wasted_bad_connection_in_metrics_on_destruction) {
+    EXPECT_CALL(handle_mock, value()).WillRepeatedly(ReturnRef(value));
+    EXPECT_CALL(handle_mock, empty()).WillRepeatedly(Return(false));
+    EXPECT_CALL(conn_handle, PQsocket()).WillOnce(Return(42));
+    EXPECT_CALL(io.stream_service_, create()).WillRepeatedly(ReturnRef(socket));
+    EXPECT_CALL(socket, assign(42));
+    EXPECT_CALL(conn_handle, PQstatus()).WillOnce(Return(CONNECTION_BAD));
+    EXPECT_CALL(handle_mock, waste()).WillOnce(Return());
+
+    const auto metrics = std::make_shared<ozo::connection_pool_metrics>();
+    {
+        impl p(io.get_executor(), connection_pool::handle{&handle_mock}, metrics);
+    }
+
+    EXPECT_EQ(metrics->snapshot().wasted_bad, 1u);
+    EXPECT_EQ(metrics->snapshot().wasted_not_idle, 0u);
+}
+
+TEST_F(pooled_connection, should_count_wasted_not_idle_connection_in_metrics_on_destruction) {
+    EXPECT_CALL(handle_mock, value()).WillRepeatedly(ReturnRef(value));
+    EXPECT_CALL(handle_mock, empty()).WillRepeatedly(Return(false));
+    EXPECT_CALL(conn_handle, PQsocket()).WillOnce(Return(42));
+    EXPECT_CALL(io.stream_service_, create()).WillRepeatedly(ReturnRef(socket));
+    EXPECT_CALL(socket, assign(42));
+    EXPECT_CALL(conn_handle, PQstatus()).WillOnce(Return(CONNECTION_OK));
+    EXPECT_CALL(conn_handle, PQtransactionStatus()).WillOnce(Return(PQTRANS_INTRANS));
+    EXPECT_CALL(handle_mock, waste()).WillOnce(Return());
+
+    std::vector<ozo::connection_waste_reason> reasons;
+    ozo::connection_pool_callbacks callbacks;
+    callbacks.on_waste = [&] (auto reason) { reasons.push_back(reason); };
+    const auto metrics = std::make_shared<ozo::connection_pool_metrics>(std::move(callbacks));
+    {
+        impl p(io.get_executor(), connection_pool::handle{&handle_mock}, metrics);
+    }
+
+    EXPECT_EQ(metrics->snapshot().wasted_bad, 0u);
+    EXPECT_EQ(metrics->snapshot().wasted_not_idle, 1u);
+    EXPECT_THAT(reasons, ElementsAre(ozo::connection_waste_reason::not_idle));
+}
+
+TEST_F(pooled_connection, should_keep_handle_in_idle_stack_on_destruction_if_connection_is_good_and_idle) {
+    EXPECT_CALL(handle_mock, value()).WillRepeatedly(ReturnRef(value));
+    EXPECT_CALL(handle_mock, empty()).WillRepeatedly(Return(false));
+    EXPECT_CALL(conn_handle, PQsocket()).WillOnce(Return(42));
+    EXPECT_CALL(io.stream_service_, create()).WillRepeatedly(ReturnRef(socket));
+    EXPECT_CALL(socket, assign(42));
+    EXPECT_CALL(conn_handle, PQstatus()).WillOnce(Return(CONNECTION_OK));
+    EXPECT_CALL(conn_handle, PQtransactionStatus()).WillOnce(Return(PQTRANS_IDLE));
+
+    const auto idle = std::make_shared<impl::idle_stack_type>(1, std::chrono::seconds(60), std::chrono::hours(1));
+    {
+        impl p(io.get_executor(), connection_pool::handle{&handle_mock}, nullptr, {}, nullptr, idle);
+    }
+
+    EXPECT_EQ(idle->size(), 1u);
+}
+
+TEST_F(pooled_connection, should_not_keep_handle_in_idle_stack_on_destruction_if_lifespan_is_expired) {
+    EXPECT_CALL(handle_mock, value()).WillRepeatedly(ReturnRef(value));
+    EXPECT_CALL(handle_mock, empty()).WillRepeatedly(Return(false));
+    EXPECT_CALL(conn_handle, PQsocket()).WillOnce(Return(42));
+    EXPECT_CALL(io.stream_service_, create()).WillRepeatedly(ReturnRef(socket));
+    EXPECT_CALL(socket, assign(42));
+    EXPECT_CALL(conn_handle, PQstatus()).WillOnce(Return(CONNECTION_OK));
+    EXPECT_CALL(conn_handle, PQtransactionStatus()).WillOnce(Return(PQTRANS_IDLE));
+
+    value.created_at_ -= std::chrono::hours(2);
+    const auto idle = std::make_shared<impl::idle_stack_type>(1, std::chrono::seconds(60), std::chrono::hours(1));
+    {
+        impl p(io.get_executor(), connection_pool::handle{&handle_mock}, nullptr, {}, nullptr, idle);
+    }
+
+    EXPECT_EQ(idle->size(), 0u);
+}
+
+struct pooled_connection_reset : pooled_connection {
+    StrictMock<steady_timer_mock> timer;
+    std::function<void(ozo::error_code)> on_timer_expired;
+
+    using impl = ozo::pooled_connection<ozo::tests::connection_pool::handle, ozo::tests::executor, ozo::thread_safety<false>>;
+
+    pooled_connection_reset() {
+        EXPECT_CALL(handle_mock, value()).WillRepeatedly(ReturnRef(value));
+        EXPECT_CALL(handle_mock, empty()).WillRepeatedly(Return(false));
+        EXPECT_CALL(conn_handle, PQsocket()).WillOnce(Return(42));
+        EXPECT_CALL(io.stream_service_, create()).WillOnce(ReturnRef(socket));
+        EXPECT_CALL(socket, assign(42));
+        EXPECT_CALL(conn_handle, PQstatus()).WillRepeatedly(Return(CONNECTION_OK));
+        EXPECT_CALL(io.executor_, post(_)).WillRepeatedly(InvokeArgument<0>());
+        EXPECT_CALL(io.executor_, dispatch(_)).WillRepeatedly(InvokeArgument<0>());
+        EXPECT_CALL(io.timer_service_, timer(An<boost::asio::steady_timer::time_point>())).WillOnce(ReturnRef(timer));
+        EXPECT_CALL(timer, async_wait(_)).WillOnce(SaveArg<0>(&on_timer_expired));
+    }
+
+    static ozo::connection_reset_options options(ozo::connection_reset_policy policy) {
+        return {policy, std::chrono::seconds(1)};
+    }
+};
+
+TEST_F(pooled_connection_reset, should_rollback_transaction_and_return_handle_to_pool_on_destruction) {
+    Sequence s;
+    EXPECT_CALL(conn_handle, PQtransactionStatus()).InSequence(s).WillOnce(Return(PQTRANS_INTRANS));
+    EXPECT_CALL(conn_handle, PQflush()).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(conn_handle, PQisBusy()).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(conn_handle, PQgetResult()).InSequence(s).WillOnce(Return(nullptr));
+    EXPECT_CALL(conn_handle, PQtransactionStatus()).InSequence(s).WillOnce(Return(PQTRANS_INTRANS));
+    EXPECT_CALL(conn_handle, PQsendQuery(StrEq("ROLLBACK"))).InSequence(s).WillOnce(Return(1));
+    EXPECT_CALL(conn_handle, PQflush()).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(conn_handle, PQisBusy()).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(conn_handle, PQgetResult()).InSequence(s).WillOnce(Return(nullptr));
+    EXPECT_CALL(timer, cancel()).InSequence(s).WillOnce(Return(1));
+    EXPECT_CALL(conn_handle, PQtransactionStatus()).InSequence(s).WillOnce(Return(PQTRANS_IDLE));
+
+    {
+        impl p(io.get_executor(), connection_pool::handle{&handle_mock}, nullptr,
+            options(ozo::connection_reset_policy::rollback));
+    }
+    on_timer_expired(boost::asio::error::operation_aborted);
+}
+
+TEST_F(pooled_connection_reset, should_send_discard_all_after_rollback_for_discard_all_policy) {
+    Sequence s;
+    EXPECT_CALL(conn_handle, PQtransactionStatus()).InSequence(s).WillOnce(Return(PQTRANS_INERROR));
+    EXPECT_CALL(conn_handle, PQflush()).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(conn_handle, PQisBusy()).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(conn_handle, PQgetResult()).InSequence(s).WillOnce(Return(nullptr));
+    EXPECT_CALL(conn_handle, PQtransactionStatus()).InSequence(s).WillOnce(Return(PQTRANS_INERROR));
+    EXPECT_CALL(conn_handle, PQsendQuery(StrEq("ROLLBACK"))).InSequence(s).WillOnce(Return(1));
+    EXPECT_CALL(conn_handle, PQflush()).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(conn_handle, PQisBusy()).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(conn_handle, PQgetResult()).InSequence(s).WillOnce(Return(nullptr));
+    EXPECT_CALL(conn_handle, PQtransactionStatus()).InSequence(s).WillOnce(Return(PQTRANS_IDLE));
+    EXPECT_CALL(conn_handle, PQsendQuery(StrEq("DISCARD ALL"))).InSequence(s).WillOnce(Return(1));
+    EXPECT_CALL(conn_handle, PQflush()).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(conn_handle, PQisBusy()).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(conn_handle, PQgetResult()).InSequence(s).WillOnce(Return(nullptr));
+    EXPECT_CALL(timer, cancel()).InSequence(s).WillOnce(Return(1));
+    EXPECT_CALL(conn_handle, PQtransactionStatus()).InSequence(s).WillOnce(Return(PQTRANS_IDLE));
+
+    {
+        impl p(io.get_executor(), connection_pool::handle{&handle_mock}, nullptr,
+            options(ozo::connection_reset_policy::discard_all));
+    }
+    on_timer_expired(boost::asio::error::operation_aborted);
+}
+
+TEST_F(pooled_connection_reset, should_waste_handle_if_reset_is_timed_out) {
+    std::function<void(ozo::error_code)> on_read;
+    bool wasted = false;
+    EXPECT_CALL(handle_mock, empty()).WillRepeatedly(ReturnPointee(&wasted));
+
+    Sequence s;
+    EXPECT_CALL(conn_handle, PQtransactionStatus()).InSequence(s).WillOnce(Return(PQTRANS_ACTIVE));
+    EXPECT_CALL(conn_handle, PQflush()).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(conn_handle, PQisBusy()).InSequence(s).WillOnce(Return(1));
+    EXPECT_CALL(socket, async_read_some(_)).InSequence(s).WillOnce(SaveArg<0>(&on_read));
+    EXPECT_CALL(socket, cancel(_)).InSequence(s).WillOnce(Return());
+    EXPECT_CALL(handle_mock, waste()).InSequence(s).WillOnce(Assign(&wasted, true));
+
+    {
+        impl p(io.get_executor(), connection_pool::handle{&handle_mock}, nullptr,
+            options(ozo::connection_reset_policy::rollback));
+    }
+    on_timer_expired(ozo::error_code{});
+    on_read(boost::asio::error::operation_aborted);
+}
+
+TEST_F(pooled_connection_reset, should_waste_handle_and_keep_statement_cache_if_discard_all_fails) {
+    ozo::tests::pg_result rollback_result{PGRES_COMMAND_OK, nullptr};
+    ozo::tests::pg_result discard_all_result{PGRES_FATAL_ERROR, "25001"};
+    value.statement_cache_ = std::make_shared<ozo::statement_cache>(4);
+    value.statement_cache_->add("SELECT 1", {}, value.statement_cache_->make_name());
+    bool wasted = false;
+    EXPECT_CALL(handle_mock, empty()).WillRepeatedly(ReturnPointee(&wasted));
+
+    Sequence s;
+    EXPECT_CALL(conn_handle, PQtransactionStatus()).InSequence(s).WillOnce(Return(PQTRANS_INERROR));
+    EXPECT_CALL(conn_handle, PQflush()).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(conn_handle, PQisBusy()).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(conn_handle, PQgetResult()).InSequence(s).WillOnce(Return(nullptr));
+    EXPECT_CALL(conn_handle, PQtransactionStatus()).InSequence(s).WillOnce(Return(PQTRANS_INERROR));
+    EXPECT_CALL(conn_handle, PQsendQuery(StrEq("ROLLBACK"))).InSequence(s).WillOnce(Return(1));
+    EXPECT_CALL(conn_handle, PQflush()).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(conn_handle, PQisBusy()).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(conn_handle, PQgetResult()).InSequence(s).WillOnce(Return(&rollback_result));
+    EXPECT_CALL(conn_handle, PQisBusy()).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(conn_handle, PQgetResult()).InSequence(s).WillOnce(Return(nullptr));
+    EXPECT_CALL(conn_handle, PQtransactionStatus()).InSequence(s).WillOnce(Return(PQTRANS_IDLE));
+    EXPECT_CALL(conn_handle, PQsendQuery(StrEq("DISCARD ALL"))).InSequence(s).WillOnce(Return(1));
+    EXPECT_CALL(conn_handle, PQflush()).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(conn_handle, PQisBusy()).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(conn_handle, PQgetResult()).InSequence(s).WillOnce(Return(&discard_all_result));
+    EXPECT_CALL(timer, cancel()).InSequence(s).WillOnce(Return(1));
+    EXPECT_CALL(handle_mock, waste()).InSequence(s).WillOnce(Assign(&wasted, true));
+
+    {
+        impl p(io.get_executor(), connection_pool::handle{&handle_mock}, nullptr,
+            options(ozo::connection_reset_policy::discard_all));
+    }
+    on_timer_expired(boost::asio::error::operation_aborted);
+
+    EXPECT_EQ(value.statement_cache_->size(), 1u);
+    EXPECT_EQ(value.statement_cache_->make_name(), "ozo_stmt_2");
+}
+
+TEST_F(pooled_connection, should_keep_socket_registered_between_usages_of_the_same_handle) {
+    EXPECT_CALL(handle_mock, value()).WillRepeatedly(ReturnRef(value));
+    EXPECT_CALL(handle_mock, empty()).WillRepeatedly(Return(false));
+    EXPECT_CALL(conn_handle, PQsocket()).WillOnce(Return(42));
+    EXPECT_CALL(io.stream_service_, create()).WillOnce(ReturnRef(socket));
+    EXPECT_CALL(socket, assign(42)).WillOnce(Return());
+    EXPECT_CALL(conn_handle, PQstatus()).Times(2).WillRepeatedly(Return(CONNECTION_OK));
+    EXPECT_CALL(conn_handle, PQtransactionStatus()).Times(2).WillRepeatedly(Return(PQTRANS_IDLE));
+
+    {
+        impl p(io.get_executor(), connection_pool::handle{&handle_mock});
+    }
+    {
+        impl p(io.get_executor(), connection_pool::handle{&handle_mock});
+    }
+}
+
 struct pooled_connection_wrapper : Test {
     using pooled_connection_ptr = std::shared_ptr<ozo::pooled_connection<ozo::tests::connection_pool::handle, ozo::tests::executor>>;
     StrictMock<connection_source_mock> provider_mock;
@@ -293,7 +598,6 @@ TEST_F(pooled_connection_wrapper, should_invoke_handler_if_passed_connection_is_
     EXPECT_CALL(handle_mock, empty()).WillRepeatedly(Return(false));
     EXPECT_CALL(io.stream_service_, create()).WillOnce(ReturnRef(stream));
     EXPECT_CALL(stream, assign(42));
-    EXPECT_CALL(stream, release());
     EXPECT_CALL(native_handle, PQsocket()).WillRepeatedly(Return(42));
     EXPECT_CALL(native_handle, PQstatus()).WillRepeatedly(Return(CONNECTION_OK));
     EXPECT_CALL(native_handle, PQtransactionStatus()).WillRepeatedly(Return(PQTRANS_IDLE));
@@ -324,7 +628,6 @@ TEST_F(pooled_connection_wrapper, should_call_async_get_connection_and_invoke_ha
         .InSequence(s)
         .WillOnce(Return());
 
-    EXPECT_CALL(stream, release()).InSequence(s);
     EXPECT_CALL(native_handle, PQstatus())
         .InSequence(s)
         .WillOnce(Return(CONNECTION_OK));
@@ -353,7 +656,41 @@ TEST_F(pooled_connection_wrapper, should_call_async_get_connection_and_invoke_ha
         .InSequence(s)
         .WillOnce(Return());
 
-    EXPECT_CALL(stream, release()).InSequence(s);
+    EXPECT_CALL(native_handle, PQstatus())
+        .InSequence(s)
+        .WillOnce(Return(CONNECTION_OK));
+    EXPECT_CALL(native_handle, PQtransactionStatus())
+        .InSequence(s)
+        .WillOnce(Return(PQTRANS_IDLE));
+
+    h({}, connection_pool::handle{&handle_mock});
+}
+
+TEST_F(pooled_connection_wrapper, should_reset_handle_with_statement_cache_of_configured_capacity) {
+    auto h = ozo::detail::wrap_pooled_connection_handler(
+        io.get_executor(),
+        connection_source{&provider_mock},
+        ozo::none,
+        wrap(callback_mock),
+        16
+    );
+
+    bool handle_empty = true;
+    Sequence s;
+    EXPECT_CALL(handle_mock, empty()).WillRepeatedly(Invoke([&]{ return handle_empty;}));
+    EXPECT_CALL(provider_mock, async_get_connection(_))
+        .InSequence(s)
+        .WillOnce(InvokeArgument<0>(error_code{}, make_connection()));
+    EXPECT_CALL(handle_mock, reset(Field(&pool_handle_mock::value_type::statement_cache_capacity_, 16u)))
+        .InSequence(s).WillOnce(Invoke([&](auto){ handle_empty = false;}));
+    EXPECT_CALL(io.stream_service_, create()).InSequence(s).WillOnce(ReturnRef(stream));
+    EXPECT_CALL(native_handle, PQsocket()).InSequence(s).WillOnce(Return(42));
+    EXPECT_CALL(stream, assign(42)).InSequence(s);
+
+    EXPECT_CALL(callback_mock, call(ozo::error_code{}, _))
+        .InSequence(s)
+        .WillOnce(Return());
+
     EXPECT_CALL(native_handle, PQstatus())
         .InSequence(s)
         .WillOnce(Return(CONNECTION_OK));
@@ -382,7 +719,6 @@ TEST_F(pooled_connection_wrapper, should_invoke_callback_with_error_and_provided
         .InSequence(s)
         .WillOnce(Return());
 
-    EXPECT_CALL(stream, release()).InSequence(s);
     EXPECT_CALL(native_handle, PQstatus())
         .InSequence(s)
         .WillOnce(Return(CONNECTION_OK));
@@ -410,4 +746,147 @@ TEST_F(pooled_connection_wrapper, should_invoke_callback_with_null_pointer_if_as
     h({}, connection_pool::handle{&handle_mock});
 }
 
+TEST_F(pooled_connection_wrapper, should_waste_handle_and_invoke_handler_with_pool_draining_if_pool_is_draining) {
+    const auto drain = std::make_shared<ozo::detail::connection_pool_drain<ozo::thread_safety<true>>>();
+    auto h = ozo::detail::wrap_pooled_connection_handler(
+        io.get_executor(),
+        connection_source{&provider_mock},
+        ozo::none,
+        wrap(callback_mock),
+        0,
+        nullptr,
+        {},
+        nullptr,
+        nullptr,
+        drain
+    );
+    drain->drain([] (error_code) {});
+
+    EXPECT_CALL(handle_mock, empty()).WillRepeatedly(Return(false));
+    EXPECT_CALL(handle_mock, waste());
+    EXPECT_CALL(callback_mock, call(error_code(ozo::error::pool_draining), _)).WillOnce(Return());
+
+    h({}, connection_pool::handle{&handle_mock});
+}
+
+TEST_F(pooled_connection_wrapper, should_count_failed_acquire_in_metrics_if_error_is_passed) {
+    const auto metrics = std::make_shared<ozo::connection_pool_metrics>();
+    auto h = ozo::detail::wrap_pooled_connection_handler(
+        io.get_executor(),
+        connection_source{&provider_mock},
+        ozo::none,
+        wrap(callback_mock),
+        0,
+        metrics
+    );
+
+    EXPECT_CALL(callback_mock, call(error_code(error::error), _)).WillOnce(Return());
+
+    h(error::error, connection_pool::handle{});
+
+    const auto snapshot = metrics->snapshot();
+    EXPECT_EQ(snapshot.acquired, 0u);
+    EXPECT_EQ(snapshot.acquire_failed, 1u);
+    EXPECT_EQ(snapshot.acquire_wait.count, 1u);
+    EXPECT_EQ(snapshot.connect_time.count, 0u);
+}
+
+TEST_F(pooled_connection_wrapper, should_count_acquire_reconnect_and_connect_in_metrics_if_passed_connection_is_bad) {
+    const auto metrics = std::make_shared<ozo::connection_pool_metrics>();
+    auto h = ozo::detail::wrap_pooled_connection_handler(
+        io.get_executor(),
+        connection_source{&provider_mock},
+        ozo::none,
+        wrap(callback_mock),
+        0,
+        metrics
+    );
+
+    EXPECT_CALL(handle_mock, empty()).WillRepeatedly(Return(false));
+    EXPECT_CALL(native_handle, PQstatus())
+        .WillOnce(Return(CONNECTION_BAD))
+        .WillRepeatedly(Return(CONNECTION_OK));
+    EXPECT_CALL(provider_mock, async_get_connection(_))
+        .WillOnce(InvokeArgument<0>(error_code{}, make_connection()));
+    EXPECT_CALL(handle_mock, reset(_));
+    EXPECT_CALL(io.stream_service_, create()).WillOnce(ReturnRef(stream));
+    EXPECT_CALL(native_handle, PQsocket()).WillOnce(Return(42));
+    EXPECT_CALL(stream, assign(42));
+    EXPECT_CALL(native_handle, PQtransactionStatus()).WillOnce(Return(PQTRANS_IDLE));
+    EXPECT_CALL(callback_mock, call(ozo::error_code{}, _)).WillOnce(Return());
+
+    h({}, connection_pool::handle{&handle_mock});
+
+    const auto snapshot = metrics->snapshot();
+    EXPECT_EQ(snapshot.acquired, 1u);
+    EXPECT_EQ(snapshot.reconnects, 1u);
+    EXPECT_EQ(snapshot.connects, 1u);
+    EXPECT_EQ(snapshot.connect_failed, 0u);
+    EXPECT_EQ(snapshot.connect_time.count, 1u);
+    EXPECT_EQ(snapshot.wasted_bad + snapshot.wasted_not_idle, 0u);
+}
+
+TEST(get_connection_acquire_failure, should_classify_errors_of_pool_queue_and_resource_pool) {
+    using ozo::connection_acquire_failure;
+    using ozo::detail::get_connection_acquire_failure;
+    EXPECT_EQ(get_connection_acquire_failure(ozo::error::pool_queue_overflow), connection_acquire_failure::queue_overflow);
+    EXPECT_EQ(get_connection_acquire_failure(yamail::resource_pool::error::request_queue_overflow),
+        connection_acquire_failure::queue_overflow);
+    EXPECT_EQ(get_connection_acquire_failure(boost::asio::error::timed_out), connection_acquire_failure::wait_timeout);
+    EXPECT_EQ(get_connection_acquire_failure(yamail::resource_pool::error::get_resource_timeout),
+        connection_acquire_failure::wait_timeout);
+    EXPECT_EQ(get_connection_acquire_failure(ozo::error::pool_deadline_too_close), connection_acquire_failure::deadline_too_close);
+    EXPECT_EQ(get_connection_acquire_failure(ozo::error::pool_draining), connection_acquire_failure::draining);
+    EXPECT_EQ(get_connection_acquire_failure(boost::asio::error::operation_aborted), connection_acquire_failure::other);
+}
+
+template <typename Handler>
+auto make_pool_connect_idle_handler(Handler handler, std::size_t count) {
+    return ozo::detail::pool_connect_idle_handler<Handler, ozo::thread_safety<true>>{
+        std::move(handler), count};
+}
+
+TEST(pool_connect_idle_handler, should_invoke_handler_once_when_all_connections_are_finished) {
+    std::vector<error_code> calls;
+    auto h = make_pool_connect_idle_handler([&] (error_code ec) { calls.push_back(ec); }, 3);
+
+    h(error_code{}, std::make_shared<int>());
+    h(error_code{}, std::make_shared<int>());
+    EXPECT_TRUE(calls.empty());
+
+    h(error_code{}, std::make_shared<int>());
+    EXPECT_THAT(calls, ElementsAre(error_code{}));
+}
+
+TEST(pool_connect_idle_handler, should_invoke_handler_with_the_first_error) {
+    std::vector<error_code> calls;
+    auto h = make_pool_connect_idle_handler([&] (error_code ec) { calls.push_back(ec); }, 3);
+
+    h(error_code{}, std::make_shared<int>());
+    h(error::error, std::shared_ptr<int>());
+    h(boost::asio::error::timed_out, std::shared_ptr<int>());
+
+    EXPECT_THAT(calls, ElementsAre(error_code{error::error}));
+}
+
+TEST(pool_connect_idle_handler, should_return_connection_to_pool_before_handler_invocation) {
+    auto conn = std::make_shared<int>();
+    std::weak_ptr<int> weak = conn;
+    bool returned = false;
+    auto h = make_pool_connect_idle_handler([&] (error_code) { returned = weak.expired(); }, 1);
+
+    h(error_code{}, std::move(conn));
+
+    EXPECT_TRUE(returned);
+}
+
+TEST(pool_connect_idle_handler, should_return_each_connection_to_pool_when_it_is_established) {
+    auto first = std::make_shared<int>();
+    std::weak_ptr<int> weak_first = first;
+    auto h = make_pool_connect_idle_handler([] (error_code) {}, 3);
+
+    h(error_code{}, std::move(first));
+    EXPECT_TRUE(weak_first.expired());
+}
+
 } // namespace
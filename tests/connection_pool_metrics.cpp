@@ -0,0 +1,129 @@
+#include "test_error.h"
+
+#include <ozo/connection_pool_metrics.h>
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+namespace {
+
+using namespace testing;
+using namespace std::chrono_literals;
+
+TEST(latency_histogram, should_count_duration_in_bucket_with_upper_bound_greater_than_duration) {
+    ozo::latency_histogram histogram;
+    histogram.record(0us);
+    histogram.record(1us);
+    histogram.record(3us);
+    histogram.record(4us);
+
+    const auto snapshot = histogram.snapshot();
+    EXPECT_EQ(snapshot.buckets[0], 1u);
+    EXPECT_EQ(snapshot.buckets[1], 1u);
+    EXPECT_EQ(snapshot.buckets[2], 1u);
+    EXPECT_EQ(snapshot.buckets[3], 1u);
+    EXPECT_EQ(snapshot.count, 4u);
+    EXPECT_EQ(snapshot.sum, ozo::time_traits::duration(8us));
+}
+
+TEST(latency_histogram, should_count_too_long_duration_in_the_last_bucket) {
+    ozo::latency_histogram histogram;
+    histogram.record(std::chrono::hours(24 * 365));
+
+    const auto snapshot = histogram.snapshot();
+    EXPECT_EQ(snapshot.buckets.back(), 1u);
+    EXPECT_EQ(ozo::latency_histogram_snapshot::upper_bound(snapshot.buckets.size() - 1),
+        ozo::time_traits::duration::max());
+}
+
+TEST(connection_pool_metrics, should_count_successful_and_failed_events_separately) {
+    ozo::connection_pool_metrics metrics;
+    metrics.on_acquire({}, 1ms);
+    metrics.on_acquire(ozo::tests::error::error, 2ms);
+    metrics.on_connect({}, 3ms);
+    metrics.on_connect(ozo::tests::error::error, 4ms);
+    metrics.on_reconnect();
+    metrics.on_waste(ozo::connection_waste_reason::bad_connection);
+    metrics.on_waste(ozo::connection_waste_reason::not_idle);
+
+    const auto snapshot = metrics.snapshot();
+    EXPECT_EQ(snapshot.acquired, 1u);
+    EXPECT_EQ(snapshot.acquire_failed, 1u);
+    EXPECT_EQ(snapshot.acquire_wait.count, 2u);
+    EXPECT_EQ(snapshot.connects, 1u);
+    EXPECT_EQ(snapshot.connect_failed, 1u);
+    EXPECT_EQ(snapshot.connect_time.sum, ozo::time_traits::duration(7ms));
+    EXPECT_EQ(snapshot.reconnects, 1u);
+    EXPECT_EQ(snapshot.wasted_bad, 1u);
+    EXPECT_EQ(snapshot.wasted_not_idle, 1u);
+}
+
+TEST(connection_pool_metrics, should_count_queue_overflow) {
+    ozo::connection_pool_metrics metrics;
+    metrics.on_acquire(ozo::error::pool_queue_overflow, 1ms, ozo::connection_acquire_failure::queue_overflow);
+
+    const auto snapshot = metrics.snapshot();
+    EXPECT_EQ(snapshot.acquire_failed, 1u);
+    EXPECT_EQ(snapshot.queue_overflow, 1u);
+    EXPECT_EQ(snapshot.wait_timeout + snapshot.deadline_too_close + snapshot.drain_rejected, 0u);
+}
+
+TEST(connection_pool_metrics, should_count_wait_timeout) {
+    ozo::connection_pool_metrics metrics;
+    metrics.on_acquire(boost::asio::error::timed_out, 1ms, ozo::connection_acquire_failure::wait_timeout);
+
+    const auto snapshot = metrics.snapshot();
+    EXPECT_EQ(snapshot.acquire_failed, 1u);
+    EXPECT_EQ(snapshot.wait_timeout, 1u);
+    EXPECT_EQ(snapshot.queue_overflow + snapshot.deadline_too_close + snapshot.drain_rejected, 0u);
+}
+
+TEST(connection_pool_metrics, should_count_deadline_too_close) {
+    ozo::connection_pool_metrics metrics;
+    metrics.on_acquire(ozo::error::pool_deadline_too_close, 1ms, ozo::connection_acquire_failure::deadline_too_close);
+
+    const auto snapshot = metrics.snapshot();
+    EXPECT_EQ(snapshot.acquire_failed, 1u);
+    EXPECT_EQ(snapshot.deadline_too_close, 1u);
+    EXPECT_EQ(snapshot.queue_overflow + snapshot.wait_timeout + snapshot.drain_rejected, 0u);
+}
+
+TEST(connection_pool_metrics, should_count_drain_rejected) {
+    ozo::connection_pool_metrics metrics;
+    metrics.on_acquire(ozo::error::pool_draining, 1ms, ozo::connection_acquire_failure::draining);
+
+    const auto snapshot = metrics.snapshot();
+    EXPECT_EQ(snapshot.acquire_failed, 1u);
+    EXPECT_EQ(snapshot.drain_rejected, 1u);
+    EXPECT_EQ(snapshot.queue_overflow + snapshot.wait_timeout + snapshot.deadline_too_close, 0u);
+}
+
+TEST(connection_pool_metrics, should_count_other_failure_only_as_acquire_failed) {
+    ozo::connection_pool_metrics metrics;
+    metrics.on_acquire(ozo::tests::error::error, 1ms);
+
+    const auto snapshot = metrics.snapshot();
+    EXPECT_EQ(snapshot.acquire_failed, 1u);
+    EXPECT_EQ(snapshot.queue_overflow + snapshot.wait_timeout + snapshot.deadline_too_close + snapshot.drain_rejected, 0u);
+}
+
+TEST(connection_pool_metrics, should_invoke_callbacks_with_event_details) {
+    StrictMock<MockFunction<void(ozo::error_code, ozo::time_traits::duration)>> on_acquire;
+    StrictMock<MockFunction<void(ozo::error_code, ozo::time_traits::duration)>> on_connect;
+    StrictMock<MockFunction<void(ozo::connection_waste_reason)>> on_waste;
+    ozo::connection_pool_metrics metrics({
+        on_acquire.AsStdFunction(),
+        on_connect.AsStdFunction(),
+        on_waste.AsStdFunction(),
+    });
+
+    EXPECT_CALL(on_acquire, Call(ozo::error_code(ozo::tests::error::error), ozo::time_traits::duration(1ms)));
+    EXPECT_CALL(on_connect, Call(ozo::error_code{}, ozo::time_traits::duration(2ms)));
+    EXPECT_CALL(on_waste, Call(ozo::connection_waste_reason::not_idle));
+
+    metrics.on_acquire(ozo::tests::error::error, 1ms);
+    metrics.on_connect({}, 2ms);
+    metrics.on_waste(ozo::connection_waste_reason::not_idle);
+}
+
+} // namespace
@@ -0,0 +1,73 @@
+#include <ozo/detail/connection_pool.h>
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <optional>
+
+namespace {
+
+using namespace testing;
+
+using drain_type = ozo::detail::connection_pool_drain<ozo::thread_safety<false>>;
+
+struct connection_pool_drain : Test {
+    std::shared_ptr<drain_type> drain = std::make_shared<drain_type>();
+    std::vector<ozo::error_code> calls;
+
+    auto handler() {
+        return [this] (ozo::error_code ec) { calls.push_back(ec); };
+    }
+};
+
+TEST_F(connection_pool_drain, borrow_should_be_counted_until_all_copies_are_destroyed) {
+    std::optional<drain_type::borrow_type> borrow = drain->borrow();
+    std::optional<drain_type::borrow_type> copy = *borrow;
+    EXPECT_EQ(drain->borrowed(), 2u);
+    borrow.reset();
+    EXPECT_EQ(drain->borrowed(), 1u);
+    copy.reset();
+    EXPECT_EQ(drain->borrowed(), 0u);
+}
+
+TEST_F(connection_pool_drain, moved_borrow_should_be_counted_once) {
+    std::optional<drain_type::borrow_type> borrow = drain->borrow();
+    auto moved = std::move(*borrow);
+    borrow.reset();
+    EXPECT_TRUE(moved);
+    EXPECT_EQ(drain->borrowed(), 1u);
+}
+
+TEST_F(connection_pool_drain, drain_should_call_handler_immediately_if_nothing_is_borrowed) {
+    drain->drain(handler());
+    EXPECT_THAT(calls, ElementsAre(ozo::error_code{}));
+    EXPECT_TRUE(drain->draining());
+}
+
+TEST_F(connection_pool_drain, drain_should_call_handler_when_all_borrows_are_returned) {
+    std::optional<drain_type::borrow_type> first = drain->borrow();
+    std::optional<drain_type::borrow_type> second = drain->borrow();
+    drain->drain(handler());
+    first.reset();
+    EXPECT_THAT(calls, IsEmpty());
+    second.reset();
+    EXPECT_THAT(calls, ElementsAre(ozo::error_code{}));
+}
+
+TEST_F(connection_pool_drain, borrow_should_be_empty_after_drain) {
+    const auto borrow = drain->borrow();
+    drain->drain(handler());
+    EXPECT_FALSE(drain->borrow());
+    EXPECT_EQ(drain->borrowed(), 1u);
+}
+
+TEST_F(connection_pool_drain, abort_should_call_pending_handlers_with_operation_aborted) {
+    std::optional<drain_type::borrow_type> borrow = drain->borrow();
+    drain->drain(handler());
+    drain->abort();
+    EXPECT_THAT(calls, ElementsAre(ozo::error_code{boost::asio::error::operation_aborted}));
+    borrow.reset();
+    EXPECT_EQ(calls.size(), 1u);
+}
+
+} // namespace
@@ -0,0 +1,130 @@
+#include <ozo/detail/connection_pool.h>
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <thread>
+
+namespace {
+
+using namespace testing;
+using namespace std::chrono_literals;
+
+struct handle_mock {
+    int id = 0;
+    ozo::time_traits::time_point created = ozo::time_traits::now();
+    std::vector<int>* wasted = nullptr;
+
+    handle_mock* operator ->() { return this; }
+    ozo::time_traits::time_point created_at() const { return created; }
+    void waste() { wasted->push_back(id); }
+};
+
+using idle_stack = ozo::detail::connection_pool_idle_stack<handle_mock, ozo::thread_safety<false>>;
+
+struct connection_pool_idle_stack : Test {
+    std::vector<int> wasted;
+
+    handle_mock make_handle(int id) {
+        return handle_mock {id, ozo::time_traits::now(), &wasted};
+    }
+};
+
+TEST_F(connection_pool_idle_stack, pop_should_return_nullopt_for_empty_stack) {
+    idle_stack stack(4, 1h, 1h);
+    EXPECT_FALSE(stack.pop());
+}
+
+TEST_F(connection_pool_idle_stack, pop_should_return_most_recently_pushed_handle) {
+    idle_stack stack(4, 1h, 1h);
+    for (int id : {1, 2, 3}) {
+        auto handle = make_handle(id);
+        stack.push(handle);
+    }
+    EXPECT_EQ(stack.size(), 3u);
+    EXPECT_EQ(stack.pop()->id, 3);
+    EXPECT_EQ(stack.pop()->id, 2);
+    EXPECT_EQ(stack.size(), 1u);
+}
+
+TEST_F(connection_pool_idle_stack, pop_should_return_least_recently_pushed_handle_in_fifo_order) {
+    idle_stack stack(4, 1h, 1h, false);
+    for (int id : {1, 2, 3}) {
+        auto handle = make_handle(id);
+        stack.push(handle);
+    }
+    EXPECT_EQ(stack.pop()->id, 1);
+    EXPECT_EQ(stack.pop()->id, 2);
+    EXPECT_EQ(stack.size(), 1u);
+}
+
+TEST_F(connection_pool_idle_stack, push_should_not_keep_handle_older_than_lifespan) {
+    idle_stack stack(4, 1h, 1h);
+    auto handle = make_handle(1);
+    handle.created -= 2h;
+    stack.push(handle);
+    EXPECT_EQ(stack.size(), 0u);
+}
+
+TEST_F(connection_pool_idle_stack, pop_should_waste_handles_idle_longer_than_idle_timeout) {
+    idle_stack stack(4, 1ms, 1h);
+    for (int id : {1, 2}) {
+        auto handle = make_handle(id);
+        stack.push(handle);
+    }
+    std::this_thread::sleep_for(2ms);
+    EXPECT_FALSE(stack.pop());
+    EXPECT_THAT(wasted, ElementsAre(1, 2));
+}
+
+TEST_F(connection_pool_idle_stack, push_should_not_keep_handle_after_close) {
+    idle_stack stack(4, 1h, 1h);
+    auto first = make_handle(1);
+    stack.push(first);
+    stack.close();
+    auto second = make_handle(2);
+    stack.push(second);
+    EXPECT_EQ(stack.size(), 0u);
+    EXPECT_TRUE(wasted.empty());
+}
+
+TEST_F(connection_pool_idle_stack, push_should_not_keep_handle_if_stack_is_full) {
+    idle_stack stack(1, 1h, 1h);
+    auto first = make_handle(1);
+    stack.push(first);
+    auto second = make_handle(2);
+    stack.push(second);
+    EXPECT_EQ(stack.size(), 1u);
+    EXPECT_EQ(stack.pop()->id, 1);
+    EXPECT_TRUE(wasted.empty());
+}
+
+TEST_F(connection_pool_idle_stack, push_should_be_noexcept) {
+    auto handle = make_handle(1);
+    static_assert(noexcept(std::declval<idle_stack&>().push(handle)));
+}
+
+TEST_F(connection_pool_idle_stack, close_expired_should_waste_handles_idle_longer_than_idle_timeout_without_push_or_pop) {
+    idle_stack stack(4, 1ms, 1h);
+    for (int id : {1, 2}) {
+        auto handle = make_handle(id);
+        stack.push(handle);
+    }
+    std::this_thread::sleep_for(2ms);
+    stack.close_expired(ozo::time_traits::now());
+    EXPECT_EQ(stack.size(), 0u);
+    EXPECT_THAT(wasted, ElementsAre(1, 2));
+}
+
+TEST_F(connection_pool_idle_stack, close_expired_should_return_time_point_of_the_next_expiration) {
+    idle_stack stack(4, 1h, 1h);
+    const auto now = ozo::time_traits::now();
+    EXPECT_EQ(stack.close_expired(now), now + 1h);
+    auto handle = make_handle(1);
+    stack.push(handle);
+    const auto expiry = stack.close_expired(now);
+    EXPECT_GE(expiry, now + 1h);
+    EXPECT_LE(expiry, ozo::time_traits::now() + 1h);
+}
+
+} // namespace
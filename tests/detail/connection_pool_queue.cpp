@@ -0,0 +1,266 @@
+#include <ozo/detail/connection_pool_queue.h>
+
+#include <boost/asio/io_context.hpp>
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <thread>
+
+namespace {
+
+using namespace testing;
+using namespace std::chrono_literals;
+
+using queue_type = ozo::detail::connection_pool_queue<ozo::thread_safety<false>>;
+using lease_type = queue_type::lease_type;
+
+struct connection_pool_queue : Test {
+    boost::asio::io_context io;
+    std::vector<std::pair<int, ozo::error_code>> calls;
+    std::vector<lease_type> leases;
+
+    auto waiter(int id) {
+        return [this, id] {
+            return [this, id] (ozo::error_code ec, lease_type lease) {
+                calls.emplace_back(id, ec);
+                if (lease) {
+                    leases.push_back(std::move(lease));
+                }
+            };
+        };
+    }
+
+    auto make_queue(std::size_t limit, std::size_t capacity = 16, bool earliest_deadline_first = true) {
+        return std::make_shared<queue_type>(limit, capacity, earliest_deadline_first);
+    }
+
+    // A released lease is given to the next waiter via the executor, the waiter stores it in the leases.
+    void release_leases(std::size_t count) {
+        for (std::size_t i = 0; i != count; ++i) {
+            io.restart();
+            io.poll();
+            const auto lease = std::move(leases.back());
+            leases.pop_back();
+        }
+        io.restart();
+    }
+
+    static auto after(ozo::time_traits::duration t) {
+        return ozo::time_traits::now() + t;
+    }
+};
+
+TEST_F(connection_pool_queue, acquire_should_return_lease_while_limit_is_not_reached) {
+    const auto queue = make_queue(2);
+    auto first = queue->acquire(io.get_executor(), after(1h), waiter(1));
+    auto second = queue->acquire(io.get_executor(), after(1h), waiter(2));
+    EXPECT_TRUE(first);
+    EXPECT_TRUE(second);
+    EXPECT_EQ(queue->in_use(), 2u);
+    EXPECT_TRUE(calls.empty());
+}
+
+TEST_F(connection_pool_queue, acquire_should_queue_waiter_when_limit_is_reached) {
+    const auto queue = make_queue(1);
+    auto lease = queue->acquire(io.get_executor(), after(1h), waiter(1));
+    EXPECT_FALSE(queue->acquire(io.get_executor(), after(1h), waiter(2)));
+    EXPECT_EQ(queue->size(), 1u);
+    EXPECT_TRUE(calls.empty());
+}
+
+TEST_F(connection_pool_queue, released_lease_should_be_given_to_waiter) {
+    const auto queue = make_queue(1);
+    auto lease = queue->acquire(io.get_executor(), after(1h), waiter(1));
+    queue->acquire(io.get_executor(), after(1h), waiter(2));
+    lease.reset();
+    io.run();
+    EXPECT_THAT(calls, ElementsAre(Pair(2, ozo::error_code{})));
+    EXPECT_EQ(leases.size(), 1u);
+    EXPECT_EQ(queue->in_use(), 1u);
+    EXPECT_EQ(queue->size(), 0u);
+}
+
+TEST_F(connection_pool_queue, released_lease_should_be_given_to_waiter_within_its_executor) {
+    const auto queue = make_queue(1);
+    auto lease = queue->acquire(io.get_executor(), after(1h), waiter(1));
+    queue->acquire(io.get_executor(), after(1h), waiter(2));
+    lease.reset();
+    EXPECT_TRUE(calls.empty());
+    EXPECT_EQ(queue->size(), 0u);
+    io.run();
+    EXPECT_THAT(calls, ElementsAre(Pair(2, ozo::error_code{})));
+}
+
+TEST_F(connection_pool_queue, lease_given_to_waiter_should_release_slot_when_destroyed) {
+    const auto queue = make_queue(1);
+    auto lease = queue->acquire(io.get_executor(), after(1h), waiter(1));
+    queue->acquire(io.get_executor(), after(1h), waiter(2));
+    lease.reset();
+    io.run();
+    ASSERT_EQ(leases.size(), 1u);
+    leases.clear();
+    EXPECT_EQ(queue->in_use(), 0u);
+}
+
+TEST_F(connection_pool_queue, should_serve_waiters_in_order_of_deadlines) {
+    const auto queue = make_queue(1);
+    auto lease = queue->acquire(io.get_executor(), after(1h), waiter(1));
+    queue->acquire(io.get_executor(), after(3h), waiter(3));
+    queue->acquire(io.get_executor(), ozo::time_traits::time_point::max(), waiter(4));
+    queue->acquire(io.get_executor(), after(2h), waiter(2));
+    lease.reset();
+    release_leases(2);
+    io.run();
+    EXPECT_THAT(calls, ElementsAre(Pair(2, _), Pair(3, _), Pair(4, _)));
+}
+
+TEST_F(connection_pool_queue, should_serve_waiters_in_order_of_arrival_without_deadline_order) {
+    const auto queue = make_queue(1, 16, false);
+    auto lease = queue->acquire(io.get_executor(), after(1h), waiter(1));
+    queue->acquire(io.get_executor(), after(3h), waiter(3));
+    queue->acquire(io.get_executor(), after(2h), waiter(2));
+    lease.reset();
+    release_leases(1);
+    io.run();
+    EXPECT_THAT(calls, ElementsAre(Pair(3, _), Pair(2, _)));
+}
+
+TEST_F(connection_pool_queue, acquire_should_reject_waiter_when_queue_is_full) {
+    const auto queue = make_queue(1, 1);
+    auto lease = queue->acquire(io.get_executor(), after(1h), waiter(1));
+    queue->acquire(io.get_executor(), after(1h), waiter(2));
+    queue->acquire(io.get_executor(), after(1h), waiter(3));
+    EXPECT_THAT(calls, ElementsAre(Pair(3, ozo::error_code{ozo::error::pool_queue_overflow})));
+    EXPECT_EQ(queue->size(), 1u);
+}
+
+TEST_F(connection_pool_queue, waiter_should_be_completed_with_timed_out_after_deadline) {
+    const auto queue = make_queue(1);
+    auto lease = queue->acquire(io.get_executor(), after(1h), waiter(1));
+    queue->acquire(io.get_executor(), after(1ms), waiter(2));
+    io.run();
+    EXPECT_THAT(calls, ElementsAre(Pair(2, ozo::error_code{boost::asio::error::timed_out})));
+    EXPECT_EQ(queue->size(), 0u);
+}
+
+TEST_F(connection_pool_queue, expired_waiter_should_not_take_slot) {
+    const auto queue = make_queue(1);
+    auto lease = queue->acquire(io.get_executor(), after(1h), waiter(1));
+    queue->acquire(io.get_executor(), after(1ms), waiter(2));
+    io.run();
+    EXPECT_EQ(queue->in_use(), 1u);
+    lease.reset();
+    EXPECT_EQ(queue->in_use(), 0u);
+    EXPECT_TRUE(queue->acquire(io.get_executor(), after(1h), waiter(3)));
+}
+
+TEST_F(connection_pool_queue, acquire_should_reject_waiter_with_less_time_left_than_usage_median) {
+    const auto queue = make_queue(16);
+    for (int i = 0; i != 16; ++i) {
+        leases.push_back(queue->acquire(io.get_executor(), after(1h), waiter(i)));
+    }
+    std::this_thread::sleep_for(10ms);
+    leases.clear();
+    EXPECT_GE(queue->usage_median(), 10ms);
+
+    for (int i = 0; i != 16; ++i) {
+        leases.push_back(queue->acquire(io.get_executor(), after(1h), waiter(i)));
+    }
+    queue->acquire(io.get_executor(), after(1ms), waiter(16));
+    EXPECT_THAT(calls, ElementsAre(Pair(16, ozo::error_code{ozo::error::pool_deadline_too_close})));
+    EXPECT_EQ(queue->size(), 0u);
+}
+
+TEST_F(connection_pool_queue, abort_should_complete_waiters_with_operation_aborted) {
+    const auto queue = make_queue(1);
+    auto lease = queue->acquire(io.get_executor(), after(1h), waiter(1));
+    queue->acquire(io.get_executor(), after(1h), waiter(2));
+    queue->abort();
+    lease.reset();
+    io.run();
+    EXPECT_THAT(calls, ElementsAre(Pair(2, ozo::error_code{boost::asio::error::operation_aborted})));
+    EXPECT_EQ(queue->in_use(), 0u);
+}
+
+TEST_F(connection_pool_queue, acquire_should_reject_request_with_abort_reason_after_abort) {
+    const auto queue = make_queue(1);
+    queue->abort(ozo::error::pool_draining);
+    EXPECT_FALSE(queue->acquire(io.get_executor(), after(1h), waiter(1)));
+    EXPECT_THAT(calls, ElementsAre(Pair(1, ozo::error_code{ozo::error::pool_draining})));
+    EXPECT_EQ(queue->in_use(), 0u);
+}
+
+TEST_F(connection_pool_queue, should_limit_admitted_requests_by_adaptive_limit) {
+    const auto queue = std::make_shared<queue_type>(10, 16, false,
+        ozo::detail::adaptive_concurrency_limit{2, 10, 2.0, 0.5});
+    EXPECT_EQ(queue->limit(), 2u);
+    auto first = queue->acquire(io.get_executor(), after(1h), waiter(1));
+    auto second = queue->acquire(io.get_executor(), after(1h), waiter(2));
+    EXPECT_FALSE(queue->acquire(io.get_executor(), after(1h), waiter(3)));
+    EXPECT_EQ(queue->in_use(), 2u);
+    EXPECT_EQ(queue->size(), 1u);
+}
+
+struct adaptive_concurrency_limit : Test {
+    ozo::detail::adaptive_concurrency_limit limit{2, 4, 2.0, 0.5};
+
+    void record_window(ozo::time_traits::duration usage, bool saturated) {
+        for (int i = 0; i != 16; ++i) {
+            limit.record(usage, saturated);
+        }
+    }
+};
+
+TEST_F(adaptive_concurrency_limit, should_start_from_min) {
+    EXPECT_EQ(limit.value(), 2u);
+}
+
+TEST_F(adaptive_concurrency_limit, should_increase_by_one_after_saturated_window) {
+    record_window(1ms, true);
+    EXPECT_EQ(limit.value(), 3u);
+    EXPECT_EQ(limit.baseline(), ozo::time_traits::duration(1ms));
+}
+
+TEST_F(adaptive_concurrency_limit, should_not_increase_after_not_saturated_window) {
+    record_window(1ms, false);
+    EXPECT_EQ(limit.value(), 2u);
+}
+
+TEST_F(adaptive_concurrency_limit, should_not_exceed_max) {
+    for (int i = 0; i != 4; ++i) {
+        record_window(1ms, true);
+    }
+    EXPECT_EQ(limit.value(), 4u);
+}
+
+TEST_F(adaptive_concurrency_limit, should_decrease_on_usage_time_growth_above_tolerance) {
+    record_window(1ms, true);
+    record_window(1ms, true);
+    record_window(10ms, true);
+    EXPECT_EQ(limit.value(), 2u);
+}
+
+TEST_F(adaptive_concurrency_limit, should_keep_increasing_on_usage_time_growth_within_tolerance) {
+    record_window(1ms, true);
+    record_window(1500us, true);
+    EXPECT_EQ(limit.value(), 4u);
+}
+
+TEST(connection_usage_median, should_be_zero_until_enough_samples) {
+    ozo::detail::connection_usage_median median;
+    for (int i = 0; i != 15; ++i) {
+        median.record(1s);
+    }
+    EXPECT_EQ(median.value(), ozo::time_traits::duration(0));
+}
+
+TEST(connection_usage_median, should_return_median_of_samples) {
+    ozo::detail::connection_usage_median median;
+    for (int i = 0; i != 16; ++i) {
+        median.record(std::chrono::milliseconds(i < 10 ? 1 : 100));
+    }
+    EXPECT_EQ(median.value(), ozo::time_traits::duration(1ms));
+}
+
+} // namespace
@@ -0,0 +1,262 @@
+#include <ozo/detail/connection_pool.h>
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <map>
+
+namespace {
+
+using namespace testing;
+
+struct pool_stats {
+    std::size_t size = 0;
+    std::size_t available = 0;
+    std::size_t used = 0;
+    std::size_t queue_size = 0;
+};
+
+struct pool_mock {
+    static std::vector<pool_mock*>& instances() {
+        static std::vector<pool_mock*> result;
+        return result;
+    }
+
+    std::size_t capacity_;
+    std::size_t queue_capacity_;
+    std::size_t size_ = 0;
+    std::size_t available_ = 0;
+    std::size_t get_calls_ = 0;
+
+    // Leases are kept out of the pool, since they keep the pool shards alive.
+    static std::map<const pool_mock*, std::vector<std::shared_ptr<void>>>& leases() {
+        static std::map<const pool_mock*, std::vector<std::shared_ptr<void>>> result;
+        return result;
+    }
+
+    pool_mock(std::size_t capacity, std::size_t queue_capacity, ozo::time_traits::duration, ozo::time_traits::duration)
+    : capacity_(capacity), queue_capacity_(queue_capacity) {
+        instances().push_back(this);
+    }
+
+    template <typename Handler>
+    void get_auto_recycle(ozo::io_context&, Handler&& handler, ozo::time_traits::duration) {
+        ++get_calls_;
+        leases()[this].push_back(std::move(handler.lease_));
+    }
+
+    std::size_t capacity() const { return capacity_; }
+    std::size_t size() const { return size_; }
+    std::size_t available() const { return available_; }
+    pool_stats stats() const { return {size_, available_, size_ - available_, 0}; }
+};
+
+struct handler_mock {
+    using handle_type = std::shared_ptr<void>;
+
+    std::shared_ptr<void> lease_;
+    std::vector<ozo::error_code>* errors_ = nullptr;
+
+    void operator() (ozo::error_code ec, handle_type) {
+        if (errors_) {
+            errors_->push_back(ec);
+        }
+    }
+};
+
+struct connection_pool_shards : Test {
+    ozo::io_context io;
+
+    connection_pool_shards() { pool_mock::instances().clear(); }
+
+    ~connection_pool_shards() {
+        const auto leases = std::move(pool_mock::leases());
+        pool_mock::leases().clear();
+    }
+
+    auto make_shards(std::size_t capacity, std::size_t queue_capacity, std::size_t shards) {
+        return std::make_unique<ozo::detail::connection_pool_shards<pool_mock>>(
+            capacity, queue_capacity, std::chrono::seconds(1), std::chrono::seconds(1), shards);
+    }
+
+    pool_mock& shard(std::size_t offset) {
+        const auto& v = pool_mock::instances();
+        return *v[(ozo::detail::shard_id(io) + offset) % v.size()];
+    }
+
+    void get(ozo::detail::connection_pool_shards<pool_mock>& pool,
+            std::vector<ozo::error_code>* errors = nullptr, ozo::time_traits::duration wait = std::chrono::seconds(1)) {
+        pool.get_auto_recycle(io, handler_mock{nullptr, errors}, wait);
+    }
+
+    void release(pool_mock& shard) {
+        pool_mock::leases()[&shard].pop_back();
+    }
+};
+
+TEST_F(connection_pool_shards, should_divide_capacity_between_shards_and_keep_queue_capacity_for_each_one) {
+    const auto pool = make_shards(10, 5, 3);
+    EXPECT_EQ(pool->shards(), 3u);
+    EXPECT_EQ(pool->capacity(), 10u);
+    std::vector<std::size_t> capacities, queue_capacities;
+    for (auto v : pool_mock::instances()) {
+        capacities.push_back(v->capacity_);
+        queue_capacities.push_back(v->queue_capacity_);
+    }
+    EXPECT_THAT(capacities, ElementsAre(4u, 3u, 3u));
+    EXPECT_THAT(queue_capacities, ElementsAre(5u, 5u, 5u));
+}
+
+TEST_F(connection_pool_shards, should_not_create_more_shards_than_capacity) {
+    EXPECT_EQ(make_shards(2, 0, 4)->shards(), 2u);
+    EXPECT_EQ(make_shards(0, 0, 4)->shards(), 1u);
+}
+
+TEST_F(connection_pool_shards, should_get_connection_from_local_shard_with_idle_connection) {
+    const auto pool = make_shards(4, 0, 2);
+    shard(0).size_ = shard(0).available_ = 1;
+    shard(1).size_ = shard(1).available_ = 1;
+    get(*pool);
+    EXPECT_EQ(shard(0).get_calls_, 1u);
+    EXPECT_EQ(shard(1).get_calls_, 0u);
+}
+
+TEST_F(connection_pool_shards, should_steal_idle_connection_from_another_shard_if_local_has_no_idle) {
+    const auto pool = make_shards(4, 0, 2);
+    shard(1).size_ = shard(1).available_ = 1;
+    get(*pool);
+    EXPECT_EQ(shard(0).get_calls_, 0u);
+    EXPECT_EQ(shard(1).get_calls_, 1u);
+}
+
+TEST_F(connection_pool_shards, should_use_local_shard_free_slot_if_there_is_no_idle_connection) {
+    const auto pool = make_shards(4, 0, 2);
+    shard(1).size_ = 1;
+    get(*pool);
+    EXPECT_EQ(shard(0).get_calls_, 1u);
+    EXPECT_EQ(shard(1).get_calls_, 0u);
+}
+
+TEST_F(connection_pool_shards, should_use_another_shard_free_slot_if_local_shard_is_reserved) {
+    const auto pool = make_shards(4, 0, 2);
+    get(*pool);
+    get(*pool);
+    get(*pool);
+    EXPECT_EQ(shard(0).get_calls_, 2u);
+    EXPECT_EQ(shard(1).get_calls_, 1u);
+}
+
+TEST_F(connection_pool_shards, should_not_steal_idle_connection_from_reserved_shard) {
+    const auto pool = make_shards(4, 0, 2);
+    shard(1).size_ = shard(1).available_ = 1;
+    get(*pool);
+    get(*pool);
+    get(*pool);
+    EXPECT_EQ(shard(0).get_calls_, 1u);
+    EXPECT_EQ(shard(1).get_calls_, 2u);
+}
+
+TEST_F(connection_pool_shards, should_free_shard_slot_when_lease_is_released) {
+    const auto pool = make_shards(4, 0, 2);
+    get(*pool);
+    get(*pool);
+    release(shard(0));
+    get(*pool);
+    EXPECT_EQ(shard(0).get_calls_, 3u);
+    EXPECT_EQ(shard(1).get_calls_, 0u);
+}
+
+TEST_F(connection_pool_shards, should_queue_request_if_all_shards_are_reserved) {
+    const auto pool = make_shards(2, 1, 2);
+    get(*pool);
+    get(*pool);
+    get(*pool);
+    io.poll();
+    EXPECT_EQ(shard(0).get_calls_, 1u);
+    EXPECT_EQ(shard(1).get_calls_, 1u);
+    EXPECT_EQ(pool->stats().queue_size, 1u);
+}
+
+TEST_F(connection_pool_shards, should_give_slot_released_in_any_shard_to_queued_request) {
+    const auto pool = make_shards(2, 1, 2);
+    get(*pool);
+    get(*pool);
+    get(*pool);
+    release(shard(1));
+    io.poll();
+    EXPECT_EQ(shard(0).get_calls_, 1u);
+    EXPECT_EQ(shard(1).get_calls_, 2u);
+    EXPECT_EQ(pool->stats().queue_size, 0u);
+}
+
+TEST_F(connection_pool_shards, should_complete_queued_request_with_timeout_if_no_slot_is_released) {
+    const auto pool = make_shards(2, 1, 2);
+    std::vector<ozo::error_code> errors;
+    get(*pool);
+    get(*pool);
+    get(*pool, &errors, std::chrono::milliseconds(0));
+    io.run();
+    EXPECT_THAT(errors, ElementsAre(ozo::error_code{yamail::resource_pool::error::get_resource_timeout}));
+    EXPECT_EQ(pool->stats().queue_size, 0u);
+}
+
+TEST_F(connection_pool_shards, should_reject_request_if_queue_is_full) {
+    const auto pool = make_shards(2, 0, 2);
+    std::vector<ozo::error_code> errors;
+    get(*pool);
+    get(*pool);
+    get(*pool, &errors);
+    io.run();
+    EXPECT_THAT(errors, ElementsAre(ozo::error_code{yamail::resource_pool::error::request_queue_overflow}));
+}
+
+TEST_F(connection_pool_shards, should_complete_queued_request_with_operation_aborted_when_destroyed) {
+    auto pool = make_shards(2, 1, 2);
+    std::vector<ozo::error_code> errors;
+    get(*pool);
+    get(*pool);
+    get(*pool, &errors);
+    pool.reset();
+    io.run();
+    EXPECT_THAT(errors, ElementsAre(ozo::error_code{boost::asio::error::operation_aborted}));
+}
+
+TEST_F(connection_pool_shards, should_keep_request_lease_within_reservation) {
+    const auto pool = make_shards(4, 0, 2);
+    const auto lease = std::make_shared<int>();
+    pool->get_auto_recycle(io, handler_mock{lease}, std::chrono::seconds(1));
+    EXPECT_EQ(lease.use_count(), 2);
+    release(shard(0));
+    EXPECT_EQ(lease.use_count(), 1);
+}
+
+TEST_F(connection_pool_shards, should_not_reserve_slot_of_single_shard) {
+    const auto pool = make_shards(4, 0, 1);
+    const auto lease = std::make_shared<int>();
+    pool->get_auto_recycle(io, handler_mock{lease}, std::chrono::seconds(1));
+    EXPECT_EQ(pool_mock::leases()[&shard(0)].back(), lease);
+}
+
+TEST_F(connection_pool_shards, should_bind_io_context_to_shard) {
+    const auto pool = make_shards(4, 0, 2);
+    ozo::io_context other;
+    get(*pool);
+    pool->get_auto_recycle(other, handler_mock{}, std::chrono::seconds(1));
+    EXPECT_EQ(shard(0).get_calls_, 1u);
+    EXPECT_EQ(shard(1).get_calls_, 1u);
+}
+
+TEST_F(connection_pool_shards, should_sum_shards_stats) {
+    const auto pool = make_shards(4, 0, 2);
+    shard(0).size_ = 2;
+    shard(0).available_ = 1;
+    shard(1).size_ = 1;
+    const auto stats = pool->stats();
+    EXPECT_EQ(stats.size, 3u);
+    EXPECT_EQ(stats.available, 1u);
+    EXPECT_EQ(stats.used, 2u);
+    EXPECT_EQ(pool->size(), 3u);
+    EXPECT_EQ(pool->available(), 1u);
+}
+
+} // namespace
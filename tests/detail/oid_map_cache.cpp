@@ -0,0 +1,89 @@
+#include <ozo/detail/oid_map_cache.h>
+#include <ozo/type_traits.h>
+
+#include <gtest/gtest.h>
+
+#include <memory>
+
+namespace ozo::tests {
+
+struct cached_type {};
+
+} // namespace ozo::tests
+
+OZO_PG_DEFINE_CUSTOM_TYPE(ozo::tests::cached_type, "cached_type")
+
+namespace {
+
+using oid_map = decltype(ozo::register_types<ozo::tests::cached_type>());
+
+auto make_oid_map(ozo::oid_t oid) {
+    oid_map result;
+    ozo::set_type_oid<ozo::tests::cached_type>(result, oid);
+    return result;
+}
+
+TEST(oid_map_cache, should_be_empty_by_default) {
+    ozo::detail::oid_map_cache<oid_map> cache;
+    EXPECT_FALSE(cache.get().first);
+}
+
+TEST(oid_map_cache, should_return_oid_map_after_update_with_actual_version) {
+    ozo::detail::oid_map_cache<oid_map> cache;
+    cache.update(make_oid_map(42), cache.get().second);
+    const auto cached = cache.get().first;
+    ASSERT_TRUE(cached);
+    EXPECT_EQ(ozo::type_oid<ozo::tests::cached_type>(*cached), 42u);
+}
+
+TEST(oid_map_cache, should_be_empty_after_invalidate) {
+    ozo::detail::oid_map_cache<oid_map> cache;
+    cache.update(make_oid_map(42), cache.get().second);
+    cache.invalidate();
+    EXPECT_FALSE(cache.get().first);
+}
+
+TEST(oid_map_cache, should_not_store_oid_map_requested_before_invalidate) {
+    ozo::detail::oid_map_cache<oid_map> cache;
+    const auto version = cache.get().second;
+    cache.invalidate();
+    cache.update(make_oid_map(42), version);
+    EXPECT_FALSE(cache.get().first);
+}
+
+struct connection_with_cache {
+    std::shared_ptr<ozo::detail::oid_map_cache<oid_map>> cache;
+    std::shared_ptr<ozo::detail::oid_map_cache<oid_map>>& oid_map_cache() { return cache;}
+};
+
+struct connection_without_cache {};
+
+TEST(set_oid_map_cache, should_bind_connection_to_cache) {
+    connection_with_cache conn;
+    const auto cache = std::make_shared<ozo::detail::oid_map_cache<oid_map>>();
+    ozo::detail::set_oid_map_cache(conn, cache);
+    EXPECT_EQ(conn.cache, cache);
+}
+
+TEST(invalidate_oid_map_cache_on_error, should_invalidate_cache_on_oid_type_mismatch) {
+    connection_with_cache conn {std::make_shared<ozo::detail::oid_map_cache<oid_map>>()};
+    conn.cache->update(make_oid_map(42), conn.cache->get().second);
+    ozo::detail::invalidate_oid_map_cache_on_error(conn, ozo::error::oid_type_mismatch);
+    EXPECT_FALSE(conn.cache->get().first);
+}
+
+TEST(invalidate_oid_map_cache_on_error, should_not_invalidate_cache_on_other_error) {
+    connection_with_cache conn {std::make_shared<ozo::detail::oid_map_cache<oid_map>>()};
+    conn.cache->update(make_oid_map(42), conn.cache->get().second);
+    ozo::detail::invalidate_oid_map_cache_on_error(conn, ozo::error::bad_result_process);
+    EXPECT_TRUE(conn.cache->get().first);
+}
+
+TEST(invalidate_oid_map_cache_on_error, should_do_nothing_for_connection_without_cache) {
+    connection_with_cache unbound;
+    connection_without_cache conn;
+    EXPECT_NO_THROW(ozo::detail::invalidate_oid_map_cache_on_error(unbound, ozo::error::oid_type_mismatch));
+    EXPECT_NO_THROW(ozo::detail::invalidate_oid_map_cache_on_error(conn, ozo::error::oid_type_mismatch));
+}
+
+} // namespace
@@ -0,0 +1,336 @@
+#include <ozo/failover/hedged.h>
+
+#include <ozo/shortcuts.h>
+
+#include "../test_error.h"
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+namespace {
+
+using namespace testing;
+using namespace std::chrono_literals;
+namespace hana = boost::hana;
+
+struct connection_mock {
+    MOCK_CONST_METHOD0(close_connection, void());
+    MOCK_CONST_METHOD0(cancel, void());
+    friend void close_connection(connection_mock* self) {
+        if(!self) {
+            throw std::invalid_argument("self should not be null");
+        }
+        self->close_connection();
+    };
+};
+
+using connect_handler = std::function<void(ozo::error_code, connection_mock*)>;
+
+struct connection_source {
+    using connection_type = connection_mock*;
+
+    std::vector<std::pair<int, connect_handler>>* connects_ = nullptr;
+    int id_ = 0;
+
+    template <typename IoContext, typename TimeConstraint, typename Handler>
+    void operator() (IoContext&, TimeConstraint, Handler&& h) const {
+        connects_->emplace_back(id_, std::forward<Handler>(h));
+    }
+};
+
+struct handler_mock {
+    struct wrapper {
+        handler_mock const* mock_ = nullptr;
+        void operator () (ozo::error_code ec, connection_mock* conn) const {
+            mock_->call(ec, conn);
+        };
+    };
+    MOCK_CONST_METHOD2(call, void(ozo::error_code, connection_mock*));
+    auto f() const { return wrapper{this}; }
+};
+
+struct query {
+    std::function<void(ozo::error_code)> complete;
+    connection_mock* conn;
+};
+
+// Operation which gets a connection and waits for the query completion by a test.
+// The query writes its connection to the output.
+struct operation {
+    std::vector<query>* queries = nullptr;
+
+    struct initiator_type {
+        std::vector<query>* queries = nullptr;
+
+        template <typename Handler, typename Provider, typename TimeConstraint, typename Out>
+        void operator() (Handler h, Provider p, TimeConstraint t, Out out) const {
+            ozo::async_get_connection(p, t, [queries = queries, h, out] (ozo::error_code ec, connection_mock* conn) mutable {
+                if (ec) {
+                    return h(ec, conn);
+                }
+                queries->push_back({[h, out, conn] (ozo::error_code ec) mutable {
+                    if (!ec) {
+                        *out++ = conn;
+                    }
+                    h(ec, conn);
+                }, conn});
+            });
+        }
+    };
+
+    initiator_type get_initiator() const { return {queries};}
+};
+
+} // namespace
+
+namespace ozo {
+// Some cheats about connection_mock which is not a connection
+// at all.
+template <>
+struct is_connection<connection_mock*> : std::true_type {};
+
+template <>
+struct is_nullable<connection_mock*> : std::true_type {};
+
+namespace failover {
+
+template <>
+struct get_hedged_canceller_impl<connection_mock*> {
+    static auto apply(connection_mock* conn) {
+        return [conn] (ozo::io_context&, ozo::time_traits::duration) { conn->cancel();};
+    }
+};
+
+} // namespace failover
+} // namespace ozo
+
+namespace {
+
+TEST(hedged_arg, should_pass_argument_as_is) {
+    ozo::failover::detail::hedged_arg<int> arg(42);
+    EXPECT_EQ(arg.get(), 42);
+}
+
+TEST(hedged_arg, should_buffer_container_output_until_commit) {
+    std::vector<int> out;
+    ozo::failover::detail::hedged_arg arg(ozo::into(out));
+    auto it = arg.get();
+    *it++ = 1;
+    *it++ = 2;
+    EXPECT_TRUE(out.empty());
+    arg.commit();
+    EXPECT_THAT(out, ElementsAre(1, 2));
+}
+
+TEST(hedged_arg, should_buffer_reference_output_until_commit) {
+    std::string out;
+    ozo::failover::detail::hedged_arg arg(std::ref(out));
+    arg.get().get() = "result";
+    EXPECT_TRUE(out.empty());
+    arg.commit();
+    EXPECT_EQ(out, "result");
+}
+
+struct hedged : Test {
+    std::vector<std::pair<int, connect_handler>> connects;
+    std::vector<query> queries;
+    std::array<connection_mock, 3> conns;
+    handler_mock handler;
+    boost::asio::io_context io;
+    std::vector<connection_mock*> out;
+
+    auto make_source(std::size_t hosts) {
+        std::vector<connection_source> result;
+        for (std::size_t i = 0; i != hosts; ++i) {
+            result.push_back(connection_source{std::addressof(connects), int(i)});
+        }
+        return ozo::failover::make_latency_aware_connection_source(std::move(result));
+    }
+
+    template <typename Strategy, typename Source>
+    void initiate(Strategy strategy, const Source& source) {
+        const operation op{std::addressof(queries)};
+        ozo::construct_initiator(strategy, op)(handler.f(), source[io], ozo::none, ozo::into(out));
+    }
+
+    void connect(std::size_t index) {
+        const auto host = connects.at(index).first;
+        connects.at(index).second({}, std::addressof(conns[host]));
+    }
+};
+
+TEST_F(hedged, get_first_try_should_bind_try_to_a_host) {
+    const auto source = make_source(2);
+    auto a_try = ozo::failover::hedged(1ms).get_first_try(operation{}, std::allocator<char>{}, source[io], ozo::none, ozo::into(out));
+    EXPECT_EQ(hana::at_c<0>(a_try.get_context()).host(), a_try.host());
+    EXPECT_EQ(source.stats(a_try.host()).in_flight, 1u);
+}
+
+TEST_F(hedged, get_hedge_should_return_try_bound_to_another_host) {
+    const auto source = make_source(2);
+    auto a_try = ozo::failover::hedged(1ms).get_first_try(operation{}, std::allocator<char>{}, source[io], ozo::none, ozo::into(out));
+    const auto hedge = a_try.get_hedge();
+    ASSERT_TRUE(hedge);
+    EXPECT_NE(hedge->host(), a_try.host());
+}
+
+TEST_F(hedged, get_hedge_should_return_nullopt_if_all_hosts_have_been_tried) {
+    const auto source = make_source(1);
+    auto a_try = ozo::failover::hedged(1ms).get_first_try(operation{}, std::allocator<char>{}, source[io], ozo::none, ozo::into(out));
+    EXPECT_FALSE(a_try.get_hedge());
+}
+
+TEST_F(hedged, delay_should_be_obtained_from_callable) {
+    const auto source = make_source(1);
+    auto a_try = ozo::failover::hedged([] { return 5ms;}).get_first_try(operation{}, std::allocator<char>{}, source[io], ozo::none, ozo::into(out));
+    EXPECT_EQ(a_try.delay(), 5ms);
+}
+
+TEST_F(hedged, cancel_timeout_should_be_one_second_by_default) {
+    const auto source = make_source(1);
+    auto a_try = ozo::failover::hedged(1ms).get_first_try(operation{}, std::allocator<char>{}, source[io], ozo::none, ozo::into(out));
+    EXPECT_EQ(a_try.cancel_timeout(), 1s);
+}
+
+TEST_F(hedged, cancel_timeout_should_be_obtained_from_option) {
+    const auto source = make_source(1);
+    auto a_try = ozo::failover::hedged(1ms).cancel_timeout(5ms).get_first_try(operation{}, std::allocator<char>{}, source[io], ozo::none, ozo::into(out));
+    EXPECT_EQ(a_try.cancel_timeout(), 5ms);
+}
+
+TEST_F(hedged, can_hedge_should_match_error_with_conditions) {
+    const auto source = make_source(1);
+    auto a_try = ozo::failover::hedged(1ms, ozo::tests::errc::error).get_first_try(operation{}, std::allocator<char>{}, source[io], ozo::none, ozo::into(out));
+    EXPECT_TRUE(a_try.can_hedge(ozo::tests::error::error));
+    EXPECT_FALSE(a_try.can_hedge(boost::asio::error::timed_out));
+}
+
+TEST_F(hedged, should_complete_operation_by_the_first_try_if_it_is_done_before_the_delay) {
+    const auto source = make_source(2);
+    initiate(ozo::failover::hedged(1h), source);
+    ASSERT_EQ(connects.size(), 1u);
+    connect(0);
+    ASSERT_EQ(queries.size(), 1u);
+
+    EXPECT_CALL(handler, call(ozo::error_code{}, queries[0].conn));
+    queries[0].complete({});
+    io.run();
+    EXPECT_EQ(connects.size(), 1u);
+    EXPECT_THAT(out, ElementsAre(queries[0].conn));
+}
+
+TEST_F(hedged, should_start_duplicate_try_on_another_host_after_the_delay) {
+    const auto source = make_source(2);
+    initiate(ozo::failover::hedged(0ms), source);
+    connect(0);
+    io.run();
+    ASSERT_EQ(connects.size(), 2u);
+    EXPECT_NE(connects[0].first, connects[1].first);
+}
+
+TEST_F(hedged, should_complete_operation_by_the_duplicate_try_and_cancel_the_first_one) {
+    const auto source = make_source(2);
+    initiate(ozo::failover::hedged(0ms), source);
+    connect(0);
+    io.run();
+    connect(1);
+    ASSERT_EQ(queries.size(), 2u);
+
+    EXPECT_CALL(*queries[0].conn, cancel());
+    EXPECT_CALL(handler, call(ozo::error_code{}, queries[1].conn));
+    queries[1].complete({});
+    EXPECT_THAT(out, ElementsAre(queries[1].conn));
+
+    EXPECT_CALL(*queries[0].conn, close_connection());
+    queries[0].complete(ozo::tests::error::error);
+    EXPECT_THAT(out, ElementsAre(queries[1].conn));
+    EXPECT_EQ(source.stats(connects[0].first).error_rate, 0.0);
+    EXPECT_EQ(source.stats(connects[0].first).in_flight, 0u);
+}
+
+TEST_F(hedged, should_not_write_output_of_the_loser) {
+    const auto source = make_source(2);
+    initiate(ozo::failover::hedged(0ms), source);
+    connect(0);
+    io.run();
+    connect(1);
+
+    EXPECT_CALL(*queries[1].conn, cancel());
+    EXPECT_CALL(handler, call(ozo::error_code{}, queries[0].conn));
+    queries[0].complete({});
+
+    EXPECT_CALL(*queries[1].conn, close_connection());
+    queries[1].complete({});
+    EXPECT_THAT(out, ElementsAre(queries[0].conn));
+}
+
+TEST_F(hedged, should_abort_try_which_gets_connection_after_the_race_is_over) {
+    const auto source = make_source(2);
+    initiate(ozo::failover::hedged(0ms), source);
+    connect(0);
+    io.run();
+
+    EXPECT_CALL(handler, call(ozo::error_code{}, queries[0].conn));
+    queries[0].complete({});
+
+    const auto loser = std::addressof(conns[connects[1].first]);
+    EXPECT_CALL(*loser, cancel()).Times(0);
+    EXPECT_CALL(*loser, close_connection()).Times(0);
+    connect(1);
+    EXPECT_TRUE(queries.size() == 1u);
+}
+
+TEST_F(hedged, should_wait_for_the_other_try_if_one_fails) {
+    const auto source = make_source(2);
+    initiate(ozo::failover::hedged(0ms), source);
+    connect(0);
+    io.run();
+    connect(1);
+
+    EXPECT_CALL(*queries[0].conn, close_connection());
+    queries[0].complete(ozo::tests::error::error);
+
+    EXPECT_CALL(handler, call(ozo::error_code{}, queries[1].conn));
+    queries[1].complete({});
+}
+
+TEST_F(hedged, should_complete_operation_with_error_if_both_tries_fail) {
+    const auto source = make_source(2);
+    initiate(ozo::failover::hedged(0ms), source);
+    connect(0);
+    io.run();
+    connect(1);
+
+    EXPECT_CALL(*queries[0].conn, close_connection());
+    queries[0].complete(ozo::tests::error::error);
+
+    EXPECT_CALL(handler, call(ozo::error_code{ozo::tests::error::another_error}, queries[1].conn));
+    queries[1].complete(ozo::tests::error::another_error);
+    EXPECT_TRUE(out.empty());
+}
+
+TEST_F(hedged, should_complete_operation_with_error_of_the_first_try_if_no_condition_matches) {
+    const auto source = make_source(2);
+    initiate(ozo::failover::hedged(1h), source);
+    connect(0);
+
+    EXPECT_CALL(handler, call(ozo::error_code{ozo::tests::error::error}, queries[0].conn));
+    queries[0].complete(ozo::tests::error::error);
+    EXPECT_EQ(connects.size(), 1u);
+}
+
+TEST_F(hedged, should_start_duplicate_try_immediately_on_error_which_matches_conditions) {
+    const auto source = make_source(2);
+    initiate(ozo::failover::hedged(1h, ozo::tests::errc::error), source);
+    connect(0);
+
+    EXPECT_CALL(*queries[0].conn, close_connection());
+    queries[0].complete(ozo::tests::error::error);
+    ASSERT_EQ(connects.size(), 2u);
+    connect(1);
+
+    EXPECT_CALL(handler, call(ozo::error_code{}, queries[1].conn));
+    queries[1].complete({});
+}
+
+} // namespace
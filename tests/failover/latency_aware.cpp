@@ -0,0 +1,234 @@
+#include <ozo/failover/latency_aware.h>
+
+#include "../test_error.h"
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+namespace {
+
+using namespace testing;
+using namespace std::chrono_literals;
+namespace hana = boost::hana;
+
+struct connection_mock {
+    MOCK_CONST_METHOD0(close_connection, void());
+    friend void close_connection(connection_mock* self) {
+        if(!self) {
+            throw std::invalid_argument("self should not be null");
+        }
+        self->close_connection();
+    };
+};
+
+struct connection_source_mock {
+    MOCK_CONST_METHOD1(call, void(int));
+};
+
+struct connection_source {
+    using connection_type = connection_mock*;
+
+    connection_source_mock* mock_ = nullptr;
+    int id_ = 0;
+    bool circuit_open_ = false;
+
+    bool is_circuit_open() const { return circuit_open_;}
+
+    template <typename IoContext, typename TimeConstraint, typename Handler>
+    void operator() (IoContext&, TimeConstraint, Handler&&) const {
+        mock_->call(id_);
+    }
+};
+
+} // namespace
+
+namespace ozo {
+// Some cheats about connection_mock which is not a connection
+// at all.
+template <>
+struct is_connection<connection_mock*> : std::true_type {};
+
+template <>
+struct is_nullable<connection_mock*> : std::true_type {};
+
+} // namespace ozo
+
+namespace {
+
+using host_latency_stats = ozo::failover::detail::host_latency_stats;
+
+TEST(host_latency_stats, select_should_return_nullopt_if_all_hosts_are_excluded) {
+    host_latency_stats stats(2, {});
+    EXPECT_FALSE(stats.select(0b11));
+}
+
+TEST(host_latency_stats, select_should_return_the_only_host_which_is_not_excluded) {
+    host_latency_stats stats(3, {});
+    EXPECT_EQ(stats.select(0b101), 1u);
+}
+
+TEST(host_latency_stats, select_should_return_host_with_less_latency) {
+    host_latency_stats stats(2, {});
+    stats.select(0b10);
+    stats.complete(0, 20ms, {});
+    stats.select(0b01);
+    stats.complete(1, 1ms, {});
+    for (int i = 0; i != 10; ++i) {
+        EXPECT_EQ(stats.select(0, false), 1u);
+    }
+}
+
+TEST(host_latency_stats, select_should_return_host_with_less_error_rate_for_the_same_latency) {
+    host_latency_stats stats(2, {});
+    stats.select(0b10);
+    stats.complete(0, 1ms, ozo::tests::error::error);
+    stats.select(0b01);
+    stats.complete(1, 1ms, {});
+    EXPECT_EQ(stats.select(0, false), 1u);
+}
+
+TEST(host_latency_stats, select_should_count_tries_in_progress_of_a_host) {
+    host_latency_stats stats(2, {});
+    stats.select(0b10);
+    stats.select(0b10, false);
+    EXPECT_EQ(stats.stats(0).in_flight, 1u);
+    stats.complete(0, 1ms, {});
+    EXPECT_EQ(stats.stats(0).in_flight, 0u);
+}
+
+TEST(host_latency_stats, complete_should_update_moving_averages) {
+    host_latency_stats stats(1, {0.5, 1s});
+    stats.select(0);
+    stats.complete(0, 10ms, {});
+    EXPECT_EQ(stats.stats(0).latency, 10ms);
+    EXPECT_EQ(stats.stats(0).error_rate, 0.0);
+    stats.select(0);
+    stats.complete(0, 20ms, {});
+    EXPECT_EQ(stats.stats(0).latency, 15ms);
+    stats.select(0);
+    stats.complete(0, 1s, ozo::tests::error::error);
+    EXPECT_EQ(stats.stats(0).latency, 15ms);
+    EXPECT_EQ(stats.stats(0).error_rate, 0.5);
+}
+
+struct latency_aware_try : Test {
+    connection_source_mock source_mock;
+    connection_mock conn;
+    boost::asio::io_context io;
+
+    auto make_source(std::size_t hosts) {
+        std::vector<connection_source> result;
+        for (std::size_t i = 0; i != hosts; ++i) {
+            result.push_back(connection_source{std::addressof(source_mock), int(i)});
+        }
+        return ozo::failover::make_latency_aware_connection_source(std::move(result));
+    }
+
+    template <typename Source, typename ...Errcs>
+    auto make_try(const Source& source, int tries, Errcs ...errcs) {
+        using op = ozo::failover::retry_options;
+        auto options = ozo::make_options(op::tries = tries, op::conditions = hana::make_tuple(errcs...));
+        return ozo::failover::latency_aware_try(std::move(options),
+            ozo::failover::basic_context(source[io], ozo::none));
+    }
+};
+
+TEST_F(latency_aware_try, get_context_should_return_provider_bound_to_the_host_of_the_try) {
+    const auto source = make_source(2);
+    auto a_try = make_try(source, 2);
+    EXPECT_EQ(hana::at_c<0>(a_try.get_context()).host(), a_try.host());
+}
+
+TEST_F(latency_aware_try, get_next_try_should_return_try_bound_to_another_host) {
+    const auto source = make_source(2);
+    auto a_try = make_try(source, 2);
+    const auto host = a_try.host();
+    a_try.complete(ozo::tests::error::error);
+    EXPECT_CALL(conn, close_connection());
+    auto next = a_try.get_next_try(ozo::tests::error::error, std::addressof(conn));
+    ASSERT_TRUE(next);
+    EXPECT_NE(next->host(), host);
+}
+
+TEST_F(latency_aware_try, get_next_try_should_return_nullopt_if_all_hosts_have_been_tried) {
+    const auto source = make_source(1);
+    auto a_try = make_try(source, 3);
+    a_try.complete(ozo::tests::error::error);
+    EXPECT_CALL(conn, close_connection());
+    EXPECT_FALSE(a_try.get_next_try(ozo::tests::error::error, std::addressof(conn)));
+}
+
+TEST_F(latency_aware_try, get_next_try_should_return_nullopt_for_error_which_does_not_match_conditions) {
+    const auto source = make_source(2);
+    auto a_try = make_try(source, 2, ozo::tests::errc::error);
+    a_try.complete(boost::asio::error::timed_out);
+    EXPECT_CALL(conn, close_connection());
+    EXPECT_FALSE(a_try.get_next_try(boost::asio::error::timed_out, std::addressof(conn)));
+}
+
+TEST_F(latency_aware_try, complete_should_record_try_to_host_stats) {
+    const auto source = make_source(1);
+    auto a_try = make_try(source, 1);
+    EXPECT_EQ(source.stats(0).in_flight, 1u);
+    a_try.complete(ozo::tests::error::error);
+    EXPECT_EQ(source.stats(0).in_flight, 0u);
+    EXPECT_GT(source.stats(0).error_rate, 0.0);
+}
+
+TEST_F(latency_aware_try, time_constraint_should_be_divided_between_hosts_which_remain) {
+    const auto source = make_source(2);
+    auto a_try = ozo::failover::latency_aware_try(
+        ozo::make_options(ozo::failover::retry_options::tries = 4),
+        ozo::failover::basic_context(source[io], ozo::time_traits::duration(2s)));
+    EXPECT_EQ(a_try.time_constraint(), 1s);
+}
+
+TEST_F(latency_aware_try, should_skip_host_with_open_circuit) {
+    const auto source = make_source(2);
+    source.host(0).circuit_open_ = true;
+    auto a_try = make_try(source, 2);
+    EXPECT_EQ(a_try.host(), 1u);
+}
+
+TEST_F(latency_aware_try, should_select_host_with_open_circuit_if_all_hosts_have_open_circuits) {
+    const auto source = make_source(1);
+    source.host(0).circuit_open_ = true;
+    auto a_try = make_try(source, 2);
+    EXPECT_EQ(a_try.host(), 0u);
+}
+
+TEST_F(latency_aware_try, get_next_try_should_return_nullopt_if_hosts_which_remain_have_open_circuits) {
+    const auto source = make_source(2);
+    auto a_try = make_try(source, 2);
+    source.host(1 - a_try.host()).circuit_open_ = true;
+    a_try.complete(ozo::tests::error::error);
+    EXPECT_CALL(conn, close_connection());
+    EXPECT_FALSE(a_try.get_next_try(ozo::tests::error::error, std::addressof(conn)));
+}
+
+TEST_F(latency_aware_try, time_constraint_should_not_be_divided_for_hosts_with_open_circuits) {
+    const auto source = make_source(2);
+    source.host(1).circuit_open_ = true;
+    auto a_try = ozo::failover::latency_aware_try(
+        ozo::make_options(ozo::failover::retry_options::tries = 4),
+        ozo::failover::basic_context(source[io], ozo::time_traits::duration(2s)));
+    EXPECT_EQ(a_try.time_constraint(), 2s);
+}
+
+TEST(latency_aware_connection_provider, should_get_connection_from_host_it_is_bound_to) {
+    connection_source_mock source_mock;
+    boost::asio::io_context io;
+    const auto source = ozo::failover::make_latency_aware_connection_source(std::vector{
+        connection_source{std::addressof(source_mock), 0},
+        connection_source{std::addressof(source_mock), 1},
+    });
+    EXPECT_CALL(source_mock, call(1));
+    source[io].rebind_host(1).async_get_connection(ozo::none, [] (ozo::error_code, connection_mock*) {});
+}
+
+TEST(make_latency_aware_connection_source, should_throw_for_no_hosts) {
+    EXPECT_THROW(ozo::failover::make_latency_aware_connection_source(std::vector<connection_source>{}),
+        std::invalid_argument);
+}
+
+} // namespace
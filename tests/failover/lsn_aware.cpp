@@ -0,0 +1,181 @@
+#include <ozo/failover/lsn_aware.h>
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+namespace {
+
+using namespace testing;
+
+struct connection_mock {};
+
+struct connection_source_mock {
+    MOCK_CONST_METHOD1(call, void(int));
+};
+
+struct connection_source {
+    using connection_type = connection_mock*;
+
+    connection_source_mock* mock_ = nullptr;
+    int id_ = 0;
+
+    template <typename IoContext, typename TimeConstraint, typename Handler>
+    void operator() (IoContext&, TimeConstraint, Handler&&) const {
+        mock_->call(id_);
+    }
+};
+
+} // namespace
+
+namespace ozo {
+// Some cheats about connection_mock which is not a connection
+// at all.
+template <>
+struct is_connection<connection_mock*> : std::true_type {};
+
+template <>
+struct is_nullable<connection_mock*> : std::true_type {};
+
+} // namespace ozo
+
+namespace {
+
+using replication_state = ozo::failover::detail::replication_state;
+
+TEST(replication_state, select_should_return_nullopt_before_first_poll) {
+    replication_state state(2);
+    EXPECT_FALSE(state.select(0));
+}
+
+TEST(replication_state, select_should_return_replica_which_has_replayed_lsn) {
+    replication_state state(3);
+    state.update(0, {}, 10);
+    state.update(1, {}, 30);
+    state.update(2, {}, 20);
+    for (int i = 0; i != 5; ++i) {
+        EXPECT_EQ(state.select(25), 1u);
+    }
+}
+
+TEST(replication_state, select_should_return_nullopt_if_all_replicas_lag_behind) {
+    replication_state state(2);
+    state.update(0, {}, 10);
+    state.update(1, {}, 20);
+    EXPECT_FALSE(state.select(21));
+}
+
+TEST(replication_state, select_should_round_robin_between_suitable_replicas) {
+    replication_state state(2);
+    state.update(0, {}, 10);
+    state.update(1, {}, 10);
+    const auto first = state.select(10);
+    const auto second = state.select(10);
+    ASSERT_TRUE(first);
+    ASSERT_TRUE(second);
+    EXPECT_NE(*first, *second);
+}
+
+TEST(replication_state, select_should_skip_replica_with_failed_poll) {
+    replication_state state(2);
+    state.update(0, {}, 10);
+    state.update(1, {}, 10);
+    state.update(0, ozo::error::pq_connection_start_failed, 0);
+    for (int i = 0; i != 5; ++i) {
+        EXPECT_EQ(state.select(10), 1u);
+    }
+}
+
+TEST(replication_state, update_should_keep_replay_lsn_of_failed_poll) {
+    replication_state state(1);
+    state.update(0, {}, 10);
+    state.update(0, ozo::error::pq_connection_start_failed, 0);
+    EXPECT_EQ(state.stats(0).replay_lsn, 10);
+    EXPECT_FALSE(state.stats(0).available);
+}
+
+TEST(replication_state, update_should_not_move_replay_lsn_back) {
+    replication_state state(1);
+    state.update(0, {}, 20);
+    state.update(0, {}, 10);
+    EXPECT_EQ(state.stats(0).replay_lsn, 20);
+}
+
+TEST(replication_state, stop_should_invoke_stop_handlers) {
+    replication_state state(1);
+    state.start();
+    int calls = 0;
+    state.on_stop([&] { ++calls; });
+    state.stop();
+    EXPECT_TRUE(state.stopped());
+    EXPECT_EQ(calls, 1);
+}
+
+TEST(replication_state, start_should_return_nullopt_while_polls_are_running) {
+    replication_state state(1);
+    EXPECT_TRUE(state.start());
+    EXPECT_FALSE(state.start());
+}
+
+TEST(replication_state, start_after_stop_should_start_new_generation_and_keep_previous_one_stopped) {
+    replication_state state(1);
+    const auto first = state.start();
+    ASSERT_TRUE(first);
+    state.stop();
+    const auto second = state.start();
+    ASSERT_TRUE(second);
+    EXPECT_FALSE(state.stopped());
+    EXPECT_TRUE(state.stopped(*first));
+    EXPECT_FALSE(state.stopped(*second));
+}
+
+struct lsn_aware_connection_source : Test {
+    StrictMock<connection_source_mock> mock;
+    ozo::io_context io;
+
+    auto make_source() {
+        return ozo::failover::make_lsn_aware_connection_source(
+            connection_source{&mock, 0},
+            std::vector{connection_source{&mock, 1}, connection_source{&mock, 2}}
+        );
+    }
+};
+
+TEST_F(lsn_aware_connection_source, should_route_to_primary_before_first_poll) {
+    const auto source = make_source();
+    EXPECT_CALL(mock, call(0));
+    source(io, ozo::none, [](ozo::error_code, auto){});
+}
+
+TEST_F(lsn_aware_connection_source, should_route_to_replica_which_has_replayed_lsn) {
+    const auto source = make_source();
+    source.replication_state().update(0, {}, 10);
+    source.replication_state().update(1, {}, 20);
+    EXPECT_CALL(mock, call(2));
+    source.rebind_lsn(15)(io, ozo::none, [](ozo::error_code, auto){});
+}
+
+TEST_F(lsn_aware_connection_source, should_route_to_primary_if_all_replicas_lag_behind) {
+    const auto source = make_source();
+    source.replication_state().update(0, {}, 10);
+    source.replication_state().update(1, {}, 20);
+    EXPECT_CALL(mock, call(0));
+    source.rebind_lsn(25)(io, ozo::none, [](ozo::error_code, auto){});
+}
+
+TEST_F(lsn_aware_connection_source, should_route_to_any_available_replica_without_lsn) {
+    const auto source = make_source();
+    source.replication_state().update(1, {}, 0);
+    EXPECT_CALL(mock, call(2));
+    source(io, ozo::none, [](ozo::error_code, auto){});
+}
+
+TEST_F(lsn_aware_connection_source, rebind_lsn_should_share_replication_state) {
+    const auto source = make_source();
+    const auto bound = source.rebind_lsn(10);
+    EXPECT_EQ(bound.lsn(), 10);
+    EXPECT_EQ(source.lsn(), 0);
+    source.replication_state().update(0, {}, 10);
+    EXPECT_TRUE(bound.stats(0).available);
+}
+
+} // namespace
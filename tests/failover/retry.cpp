@@ -259,4 +259,165 @@ TEST(basic_try__retry_conditions, should_return_retry_conditions) {
         << to_string(basic_try.get_conditions()) << "!=" << to_string(conditions);
 }
 
+TEST(retry_budget, withdraw_should_allow_min_retries_initially) {
+    ozo::failover::retry_budget budget({0.1, 2, 100});
+    EXPECT_TRUE(budget.withdraw());
+    EXPECT_TRUE(budget.withdraw());
+    EXPECT_FALSE(budget.withdraw());
+    EXPECT_EQ(budget.stats().retries, 2u);
+    EXPECT_EQ(budget.stats().rejected, 1u);
+}
+
+TEST(retry_budget, deposit_should_earn_retries_by_ratio) {
+    ozo::failover::retry_budget budget({0.5, 0, 100});
+    EXPECT_FALSE(budget.withdraw());
+    budget.deposit();
+    budget.deposit();
+    EXPECT_TRUE(budget.withdraw());
+    EXPECT_FALSE(budget.withdraw());
+    EXPECT_EQ(budget.stats().operations, 2u);
+}
+
+TEST(retry_budget, deposit_should_not_exceed_capacity) {
+    ozo::failover::retry_budget budget({1, 0, 1});
+    budget.deposit();
+    budget.deposit();
+    EXPECT_TRUE(budget.withdraw());
+    EXPECT_FALSE(budget.withdraw());
+}
+
+TEST(retry_budget, withdraw_should_count_backoff_delay) {
+    ozo::failover::retry_budget budget({0.1, 10, 100});
+    budget.withdraw(5ms);
+    budget.withdraw();
+    EXPECT_EQ(budget.stats().delayed, 1u);
+    EXPECT_EQ(budget.stats().backoff, 5ms);
+}
+
+TEST(get_backoff_delay, should_return_delay_limited_by_exponent_of_retry_number) {
+    const ozo::failover::retry_backoff backoff{10ms, 1s};
+    for (int i = 0; i != 100; ++i) {
+        EXPECT_LE(ozo::failover::detail::get_backoff_delay(backoff, 0), 10ms);
+        EXPECT_LE(ozo::failover::detail::get_backoff_delay(backoff, 2), 40ms);
+        EXPECT_LE(ozo::failover::detail::get_backoff_delay(backoff, 20), 1s);
+        EXPECT_GE(ozo::failover::detail::get_backoff_delay(backoff, 0), duration(0));
+    }
+}
+
+TEST(get_backoff_delay, should_return_zero_for_zero_base) {
+    EXPECT_EQ(ozo::failover::detail::get_backoff_delay({duration(0), 1s}, 3), duration(0));
+}
+
+struct basic_try__retry_budget : basic_try__get_next_try {};
+
+TEST_F(basic_try__retry_budget, get_next_try_should_return_null_state_if_budget_is_exhausted) {
+    using op = ozo::failover::retry_options;
+    const auto budget = std::make_shared<ozo::failover::retry_budget>(ozo::failover::retry_budget_config{0.1, 0, 100});
+    auto basic_try = ozo::failover::basic_try(ozo::make_options(op::tries = 3, op::budget = budget), ctx());
+    EXPECT_FALSE(basic_try.get_next_try(ozo::tests::error::error, null_conn));
+    EXPECT_EQ(budget->stats().rejected, 1u);
+}
+
+TEST_F(basic_try__retry_budget, get_next_try_should_withdraw_from_budget) {
+    using op = ozo::failover::retry_options;
+    const auto budget = std::make_shared<ozo::failover::retry_budget>(ozo::failover::retry_budget_config{0.1, 1, 100});
+    auto basic_try = ozo::failover::basic_try(ozo::make_options(op::tries = 3, op::budget = budget), ctx());
+    EXPECT_TRUE(basic_try.get_next_try(ozo::tests::error::error, null_conn));
+    EXPECT_EQ(budget->stats().retries, 1u);
+}
+
+TEST(retry_strategy, get_first_try_should_deposit_to_budget) {
+    const auto budget = std::make_shared<ozo::failover::retry_budget>();
+    const auto strategy = ozo::failover::retry().budget(budget)*2;
+    strategy.get_first_try(0, std::allocator<char>{}, fake_connection_provider{}, ozo::none);
+    EXPECT_EQ(budget->stats().operations, 1u);
+}
+
+struct basic_try__backoff : basic_try__get_next_try {
+    using op = ozo::failover::retry_options;
+};
+
+TEST_F(basic_try__backoff, first_try_should_have_no_delay) {
+    auto basic_try = ozo::failover::basic_try(ozo::make_options(op::tries = 3, op::backoff = ozo::failover::retry_backoff{1s, 1s}), ctx());
+    EXPECT_EQ(basic_try.delay(), duration(0));
+}
+
+TEST_F(basic_try__backoff, get_next_try_should_return_try_with_delay_limited_by_backoff) {
+    auto basic_try = ozo::failover::basic_try(ozo::make_options(op::tries = 3, op::backoff = ozo::failover::retry_backoff{10ms, 1s}), ctx());
+    auto next = basic_try.get_next_try(ozo::tests::error::error, null_conn);
+    ASSERT_TRUE(next);
+    EXPECT_LE(next->delay(), 10ms);
+}
+
+TEST_F(basic_try__backoff, time_constraint_should_be_delay_with_share_of_time_left_after_delay) {
+    auto basic_try = ozo::failover::basic_try(ozo::make_options(op::tries = 3, op::backoff = ozo::failover::retry_backoff{10ms, 1s}),
+        ozo::failover::basic_context(fake_connection_provider{}, duration(3s)));
+    auto next = basic_try.get_next_try(ozo::tests::error::error, null_conn);
+    ASSERT_TRUE(next);
+    EXPECT_EQ(next->time_constraint(), next->delay() + (3s - next->delay()) / 2);
+}
+
+TEST_F(basic_try__backoff, time_constraint_should_be_deadline_after_delay_with_share_of_time_left_after_delay) {
+    const auto deadline = ozo::time_traits::now() + 3s;
+    auto basic_try = ozo::failover::basic_try(ozo::make_options(op::tries = 3, op::backoff = ozo::failover::retry_backoff{10ms, 1s}),
+        ozo::failover::basic_context(fake_connection_provider{}, deadline));
+    auto next = basic_try.get_next_try(ozo::tests::error::error, null_conn);
+    ASSERT_TRUE(next);
+    const auto expected = [&] (ozo::time_traits::time_point now) {
+        return now + next->delay() + (deadline - now - next->delay()) / 2;
+    };
+    const auto before = ozo::time_traits::now();
+    const ozo::time_traits::time_point t = next->time_constraint();
+    const auto after = ozo::time_traits::now();
+    EXPECT_GE(t, expected(before));
+    EXPECT_LE(t, expected(after));
+}
+
+TEST_F(basic_try__backoff, get_next_try_should_return_try_with_delay_less_than_share_of_time_left) {
+    for (int i = 0; i != 100; ++i) {
+        auto basic_try = ozo::failover::basic_try(ozo::make_options(op::tries = 3, op::backoff = ozo::failover::retry_backoff{1s, 1s}),
+            ozo::failover::basic_context(fake_connection_provider{}, duration(1s)));
+        if (auto next = basic_try.get_next_try(ozo::tests::error::error, null_conn)) {
+            EXPECT_LT(next->delay(), 500ms);
+        }
+    }
+}
+
+TEST_F(basic_try__backoff, get_next_try_should_return_null_state_if_no_time_left_for_delay) {
+    auto basic_try = ozo::failover::basic_try(ozo::make_options(op::tries = 3, op::backoff = ozo::failover::retry_backoff{10ms, 1s}),
+        ozo::failover::basic_context(fake_connection_provider{}, duration(0)));
+    EXPECT_FALSE(basic_try.get_next_try(ozo::tests::error::error, null_conn));
+}
+
+struct io_connection_provider {
+    using connection_type = connection_mock*;
+
+    ozo::io_context* io_ = nullptr;
+
+    ozo::io_context& get_io_context() const { return *io_;}
+
+    template <typename TimeConstraint, typename Handler>
+    void async_get_connection(TimeConstraint, Handler&& h) const {
+        h(ozo::error_code{}, nullptr);
+    }
+};
+
+TEST(backoff_connection_provider, should_get_connection_after_delay) {
+    ozo::io_context io;
+    const ozo::failover::detail::backoff_connection_provider provider{io_connection_provider{&io}, duration(1ms)};
+    bool called = false;
+    provider.async_get_connection(ozo::none, [&] (ozo::error_code, connection_mock*) { called = true;});
+    EXPECT_FALSE(called);
+    io.run();
+    EXPECT_TRUE(called);
+}
+
+TEST(backoff_connection_provider, should_get_connection_immediately_for_zero_delay) {
+    ozo::io_context io;
+    const ozo::failover::detail::backoff_connection_provider provider{io_connection_provider{&io}, duration(0)};
+    bool called = false;
+    provider.async_get_connection(ozo::none, [&] (ozo::error_code, connection_mock*) { called = true;});
+    EXPECT_TRUE(called);
+}
+
 } // namespace
@@ -379,4 +379,52 @@ TEST_F(role_based_try__get_context, should_return_whole_time_out_for_two_single_
     EXPECT_EQ(role_based_try.get_context()[hana::size_c<1>], 4s);
 }
 
+struct circuit_breaker_source {
+    using connection_type = connection_mock*;
+
+    bool circuit_open_ = false;
+
+    bool is_circuit_open() const { return circuit_open_;}
+
+    template <typename IoContext, typename TimeConstraint, typename Handler>
+    void operator() (IoContext&, TimeConstraint, Handler&&) const {}
+};
+
+struct role_based_try__circuit_breaker : Test {
+    boost::asio::io_service io;
+    connection_mock* null_conn = nullptr;
+
+    auto source() {
+        return ozo::failover::make_role_based_connection_source(
+            ozo::failover::master=circuit_breaker_source{false},
+            ozo::failover::replica=circuit_breaker_source{true}
+        );
+    }
+
+    using opt = ozo::failover::role_based_options;
+};
+
+TEST_F(role_based_try__circuit_breaker, initiate_next_try_should_skip_fallback_with_open_circuit) {
+    auto role_based_try = ozo::failover::role_based_try(
+        ozo::make_options(
+            opt::roles=hana::make_tuple(ozo::failover::master, ozo::failover::replica, ozo::failover::master)
+        ),
+        ozo::failover::basic_context(source()[io], ozo::none)
+    );
+    std::size_t fallback_index = 0;
+    role_based_try.initiate_next_try(ozo::error::pq_connection_start_failed, null_conn,
+        [&] (auto fallback) { fallback_index = fallback.role_index(); });
+    EXPECT_EQ(fallback_index, 2u);
+}
+
+TEST_F(role_based_try__circuit_breaker, time_constraint_should_not_be_divided_for_roles_with_open_circuits) {
+    auto role_based_try = ozo::failover::role_based_try(
+        ozo::make_options(
+            opt::roles=hana::make_tuple(ozo::failover::master, ozo::failover::replica)
+        ),
+        ozo::failover::basic_context(source()[io], 4s)
+    );
+    EXPECT_EQ(role_based_try.time_constraint(), 4s);
+}
+
 } // namespace
@@ -14,6 +14,7 @@ struct try_mock {
     MOCK_CONST_METHOD2(get_next_try, try_mock*(ozo::error_code, connection_mock*));
     using context = boost::hana::tuple<provider_mock*, ozo::time_traits::duration, int, std::string>;
     MOCK_CONST_METHOD0(get_context, context());
+    MOCK_METHOD1(complete, void(ozo::error_code));
 };
 
 struct handler_mock {
@@ -103,7 +104,9 @@ struct continuation : Test {
     handler_mock handler;
     operation::initiator_mock initiator;
     operation op{std::addressof(initiator)};
-    try_mock a_try;
+    // Only the completion test expects the try to be completed.
+    NiceMock<try_mock> nice_try;
+    try_mock& a_try = nice_try;
     connection_mock conn;
     provider_mock provider;
 };
@@ -115,6 +118,17 @@ TEST_F(continuation, should_call_handler_if_called_with_no_error) {
     continuation(ozo::error_code{}, std::addressof(conn));
 }
 
+TEST_F(continuation, should_complete_try_before_next_try_request) {
+    InSequence s;
+    EXPECT_CALL(a_try, complete(ozo::error_code{ozo::tests::error::error}));
+    EXPECT_CALL(a_try, get_next_try(ozo::error_code{ozo::tests::error::error}, std::addressof(conn)))
+        .WillOnce(Return(nullptr));
+    EXPECT_CALL(handler, call(ozo::error_code{ozo::tests::error::error}, std::addressof(conn)));
+
+    auto continuation = ozo::failover::detail::continuation{op, std::addressof(a_try), handler.f()};
+    continuation(ozo::error_code{ozo::tests::error::error}, std::addressof(conn));
+}
+
 TEST_F(continuation, should_call_handler_if_called_with_error_and_no_next_try) {
     InSequence s;
     EXPECT_CALL(a_try, get_next_try(ozo::error_code{ozo::tests::error::error}, std::addressof(conn)))
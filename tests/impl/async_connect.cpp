@@ -328,4 +328,64 @@ TEST_F(async_connect, should_request_oid_map_when_oid_map_is_not_empty) {
     ozo::impl::async_connect("conninfo", time_traits::duration(42), conn, wrap(callback));
 }
 
+TEST_F(async_connect, should_request_oid_map_when_oid_map_cache_is_empty) {
+    auto conn = make_connection(f.connection, f.io, f.native_handle, ozo::register_types<custom_type>());
+    auto cache = std::make_shared<ozo::detail::oid_map_cache<std::decay_t<decltype(conn->oid_map())>>>();
+    StrictMock<callback_gmock<decltype(conn)>> callback {};
+
+    execution_context cb_io;
+    EXPECT_CALL(callback, get_executor()).WillRepeatedly(Return(cb_io.get_executor()));
+    EXPECT_CALL(f.io.strand_service_, get_executor()).WillRepeatedly(ReturnRef(f.strand));
+    EXPECT_CALL(f.io.timer_service_, timer(time_traits::duration(42))).WillRepeatedly(ReturnRef(f.timer));
+    EXPECT_CALL(f.timer, async_wait(_)).WillOnce(Return());
+
+    Sequence s;
+
+    EXPECT_CALL(f.connection, start_connection("conninfo")).InSequence(s).WillOnce(Return(std::addressof(f.handle)));
+    EXPECT_CALL(f.handle, PQstatus()).WillRepeatedly(Return(CONNECTION_OK));
+    EXPECT_CALL(f.connection, assign()).InSequence(s).WillOnce(Return(error_code{}));
+    EXPECT_CALL(f.connection, async_wait_write(_)).InSequence(s).WillOnce(InvokeArgument<0>(error_code{}));
+    EXPECT_CALL(f.strand, post(_)).InSequence(s).WillOnce(InvokeArgument<0>());
+    EXPECT_CALL(f.handle, PQconnectPoll()).InSequence(s).WillOnce(Return(PGRES_POLLING_OK));
+    EXPECT_CALL(f.connection, request_oid_map()).InSequence(s).WillOnce(Return());
+
+    ozo::impl::async_connect("conninfo", time_traits::duration(42), conn, cache, wrap(callback));
+}
+
+TEST_F(async_connect, should_assign_cached_oid_map_and_not_request_it_when_oid_map_cache_is_not_empty) {
+    auto conn = make_connection(f.connection, f.io, f.native_handle, ozo::register_types<custom_type>());
+    using oid_map_type = std::decay_t<decltype(conn->oid_map())>;
+    auto cache = std::make_shared<ozo::detail::oid_map_cache<oid_map_type>>();
+    oid_map_type cached;
+    ozo::set_type_oid<custom_type>(cached, 42);
+    cache->update(cached, cache->get().second);
+    StrictMock<callback_gmock<decltype(conn)>> callback {};
+
+    execution_context cb_io;
+    EXPECT_CALL(callback, get_executor()).WillRepeatedly(Return(cb_io.get_executor()));
+    EXPECT_CALL(f.io.strand_service_, get_executor()).WillRepeatedly(ReturnRef(f.strand));
+    EXPECT_CALL(f.io.timer_service_, timer(time_traits::duration(42))).WillRepeatedly(ReturnRef(f.timer));
+    std::function<void (ozo::error_code)> on_timer_expired;
+    EXPECT_CALL(f.timer, async_wait(_)).WillOnce(SaveArg<0>(&on_timer_expired));
+
+    Sequence s;
+
+    EXPECT_CALL(f.connection, start_connection("conninfo")).InSequence(s).WillOnce(Return(std::addressof(f.handle)));
+    EXPECT_CALL(f.handle, PQstatus()).WillRepeatedly(Return(CONNECTION_OK));
+    EXPECT_CALL(f.connection, assign()).InSequence(s).WillOnce(Return(error_code{}));
+    EXPECT_CALL(f.connection, async_wait_write(_)).InSequence(s).WillOnce(InvokeArgument<0>(error_code{}));
+    EXPECT_CALL(f.strand, post(_)).InSequence(s).WillOnce(InvokeArgument<0>());
+    EXPECT_CALL(f.handle, PQconnectPoll()).InSequence(s).WillOnce(Return(PGRES_POLLING_OK));
+    EXPECT_CALL(f.timer, cancel()).InSequence(s).WillOnce(Return(1));
+    EXPECT_CALL(f.strand, post(_)).InSequence(s).WillOnce(InvokeArgument<0>());
+    EXPECT_CALL(cb_io.executor_, dispatch(_)).InSequence(s).WillOnce(InvokeArgument<0>());
+    EXPECT_CALL(callback, call(error_code{}, conn)).InSequence(s).WillOnce(Return());
+
+    ozo::impl::async_connect("conninfo", time_traits::duration(42), conn, cache, wrap(callback));
+    on_timer_expired(boost::asio::error::operation_aborted);
+
+    EXPECT_EQ(ozo::type_oid<custom_type>(conn->oid_map()), 42u);
+    EXPECT_EQ(conn->oid_map_cache_, cache);
+}
+
 } // namespace
@@ -0,0 +1,280 @@
+#include <connection_mock.h>
+#include <test_error.h>
+
+#include <ozo/impl/async_copy.h>
+#include <ozo/copy.h>
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+namespace {
+
+using namespace testing;
+using namespace ozo::tests;
+
+using callback_mock = callback_gmock<connection_ptr<>>;
+
+using ozo::error_code;
+
+TEST(make_copy_query, should_return_copy_statement_with_columns) {
+    const std::vector<std::string> columns{"id", "name"};
+    EXPECT_EQ(ozo::impl::make_copy_query("users", columns, " FROM STDIN"),
+        "COPY users (id, name) FROM STDIN (FORMAT binary)");
+}
+
+TEST(make_copy_query, should_return_copy_out_statement_for_query) {
+    EXPECT_EQ(ozo::impl::make_copy_query("(SELECT 1)", std::vector<std::string>{}, " TO STDOUT"),
+        "COPY (SELECT 1) TO STDOUT (FORMAT binary)");
+}
+
+TEST(make_copy_query, should_return_copy_statement_without_columns_for_empty_columns) {
+    EXPECT_EQ(ozo::impl::make_copy_query("users", std::vector<std::string>{}, " FROM STDIN"),
+        "COPY users FROM STDIN (FORMAT binary)");
+}
+
+struct fixture {
+    StrictMock<connection_gmock> connection{};
+    StrictMock<PGconn_mock> native_handle{};
+    StrictMock<callback_mock> callback{};
+    io_context io;
+    execution_context cb_io;
+    connection_ptr<> conn = make_connection(connection, io, native_handle);
+
+    auto make_operation_context() {
+        EXPECT_CALL(callback, get_executor()).WillRepeatedly(Return(cb_io.get_executor()));
+        return ozo::impl::make_request_operation_context(conn, wrap(callback));
+    }
+
+    decltype(ozo::impl::make_request_operation_context(conn, wrap(callback))) ctx;
+
+    fixture() : ctx(make_operation_context()) {}
+};
+
+struct async_copy_in : Test {
+    fixture m;
+    ozo::tests::pg_result copy_in{PGRES_COPY_IN, nullptr};
+    ozo::tests::pg_result command_ok{PGRES_COMMAND_OK, nullptr};
+    ozo::tests::pg_result fatal_error{PGRES_FATAL_ERROR, "42P01"};
+    std::vector<std::tuple<std::int16_t>> rows{{1}, {2}};
+    // header + 2 rows + trailer
+    static constexpr int data_size = 19 + 2 * (2 + 4 + 2) + 2;
+
+    void expect_copy_started(Sequence& s) {
+        EXPECT_CALL(m.native_handle, PQsetnonblocking(1)).InSequence(s).WillOnce(Return(0));
+        EXPECT_CALL(m.native_handle, PQsendQuery(StrEq("COPY t FROM STDIN (FORMAT binary)"))).InSequence(s).WillOnce(Return(1));
+        EXPECT_CALL(m.native_handle, PQflush()).InSequence(s).WillOnce(Return(0));
+        EXPECT_CALL(m.native_handle, PQisBusy()).InSequence(s).WillOnce(Return(0));
+        EXPECT_CALL(m.native_handle, PQgetResult()).InSequence(s).WillOnce(Return(&copy_in));
+    }
+
+    void expect_copy_finished(Sequence& s) {
+        EXPECT_CALL(m.native_handle, PQisBusy()).InSequence(s).WillOnce(Return(0));
+        EXPECT_CALL(m.native_handle, PQgetResult()).InSequence(s).WillOnce(Return(&command_ok));
+        EXPECT_CALL(m.native_handle, PQisBusy()).InSequence(s).WillOnce(Return(0));
+        EXPECT_CALL(m.native_handle, PQgetResult()).InSequence(s).WillOnce(Return(nullptr));
+    }
+
+    void perform() {
+        ozo::impl::async_copy_in(m.ctx, "COPY t FROM STDIN (FORMAT binary)", rows);
+    }
+};
+
+TEST_F(async_copy_in, should_send_query_and_put_encoded_rows_and_end_copy_and_call_handler) {
+    Sequence s;
+
+    expect_copy_started(s);
+    EXPECT_CALL(m.native_handle, PQputCopyData(_, data_size)).InSequence(s).WillOnce(Return(1));
+    EXPECT_CALL(m.native_handle, PQflush()).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.native_handle, PQputCopyEnd(nullptr)).InSequence(s).WillOnce(Return(1));
+    EXPECT_CALL(m.native_handle, PQflush()).InSequence(s).WillOnce(Return(0));
+    expect_copy_finished(s);
+    EXPECT_CALL(m.callback, call(error_code{}, _)).InSequence(s).WillOnce(Return());
+
+    perform();
+}
+
+TEST_F(async_copy_in, should_wait_for_write_if_put_copy_data_would_block) {
+    Sequence s;
+
+    expect_copy_started(s);
+    EXPECT_CALL(m.native_handle, PQputCopyData(_, data_size)).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.connection, async_wait_write(_)).InSequence(s).WillOnce(InvokeArgument<0>(error_code{}));
+    EXPECT_CALL(m.cb_io.executor_, post(_)).InSequence(s).WillOnce(InvokeArgument<0>());
+    EXPECT_CALL(m.native_handle, PQputCopyData(_, data_size)).InSequence(s).WillOnce(Return(1));
+    EXPECT_CALL(m.native_handle, PQflush()).InSequence(s).WillOnce(Return(1));
+    EXPECT_CALL(m.connection, async_wait_write(_)).InSequence(s).WillOnce(Return());
+
+    perform();
+}
+
+TEST_F(async_copy_in, should_call_handler_with_error_if_put_copy_data_failed) {
+    Sequence s;
+
+    expect_copy_started(s);
+    EXPECT_CALL(m.native_handle, PQputCopyData(_, _)).InSequence(s).WillOnce(Return(-1));
+    EXPECT_CALL(m.connection, cancel()).InSequence(s).WillOnce(Return());
+    EXPECT_CALL(m.callback, call(error_code{ozo::error::pg_put_copy_data_failed}, _)).InSequence(s).WillOnce(Return());
+
+    perform();
+}
+
+TEST_F(async_copy_in, should_call_handler_with_database_error_if_copy_is_not_started) {
+    Sequence s;
+
+    EXPECT_CALL(m.native_handle, PQsetnonblocking(1)).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.native_handle, PQsendQuery(_)).InSequence(s).WillOnce(Return(1));
+    EXPECT_CALL(m.native_handle, PQflush()).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.native_handle, PQisBusy()).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.native_handle, PQgetResult()).InSequence(s).WillOnce(Return(&fatal_error));
+    EXPECT_CALL(m.native_handle, PQisBusy()).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.native_handle, PQgetResult()).InSequence(s).WillOnce(Return(nullptr));
+    EXPECT_CALL(m.connection, cancel()).InSequence(s).WillOnce(Return());
+    EXPECT_CALL(m.callback, call(ozo::sqlstate::make_error_code(ozo::sqlstate::undefined_table), _))
+        .InSequence(s).WillOnce(Return());
+
+    perform();
+}
+
+auto copy_data(std::vector<char> data) {
+    return Invoke([data = std::move(data)] (char** buffer, int) {
+        *buffer = static_cast<char*>(std::malloc(data.size()));
+        std::copy(data.begin(), data.end(), *buffer);
+        return int(data.size());
+    });
+}
+
+struct async_copy_out : Test {
+    fixture m;
+    ozo::tests::pg_result copy_out{PGRES_COPY_OUT, nullptr};
+    ozo::tests::pg_result command_ok{PGRES_COMMAND_OK, nullptr};
+    ozo::tests::pg_result fatal_error{PGRES_FATAL_ERROR, "42P01"};
+    ozo::empty_oid_map oid_map;
+    std::vector<std::tuple<std::int16_t>> rows;
+
+    std::vector<char> make_data(bool header, std::vector<std::tuple<std::int16_t>> values, bool trailer) const {
+        std::vector<char> buffer;
+        ozo::ostream os{buffer};
+        if (header) {
+            ozo::write_copy_header(os);
+        }
+        for (const auto& v : values) {
+            ozo::send_copy_row(os, oid_map, v);
+        }
+        if (trailer) {
+            ozo::write_copy_trailer(os);
+        }
+        return buffer;
+    }
+
+    void expect_copy_started(Sequence& s) {
+        EXPECT_CALL(m.native_handle, PQsetnonblocking(1)).InSequence(s).WillOnce(Return(0));
+        EXPECT_CALL(m.native_handle, PQsendQuery(StrEq("COPY t TO STDOUT (FORMAT binary)"))).InSequence(s).WillOnce(Return(1));
+        EXPECT_CALL(m.native_handle, PQflush()).InSequence(s).WillOnce(Return(0));
+        EXPECT_CALL(m.native_handle, PQisBusy()).InSequence(s).WillOnce(Return(0));
+        EXPECT_CALL(m.native_handle, PQgetResult()).InSequence(s).WillOnce(Return(&copy_out));
+    }
+
+    void expect_copy_finished(Sequence& s) {
+        EXPECT_CALL(m.native_handle, PQgetCopyData(_, 1)).InSequence(s).WillOnce(Return(-1));
+        EXPECT_CALL(m.native_handle, PQisBusy()).InSequence(s).WillOnce(Return(0));
+        EXPECT_CALL(m.native_handle, PQgetResult()).InSequence(s).WillOnce(Return(&command_ok));
+        EXPECT_CALL(m.native_handle, PQisBusy()).InSequence(s).WillOnce(Return(0));
+        EXPECT_CALL(m.native_handle, PQgetResult()).InSequence(s).WillOnce(Return(nullptr));
+    }
+
+    void perform() {
+        ozo::impl::async_copy_out(m.ctx, "COPY t TO STDOUT (FORMAT binary)", std::back_inserter(rows));
+    }
+};
+
+TEST_F(async_copy_out, should_send_query_and_decode_rows_and_call_handler) {
+    Sequence s;
+
+    expect_copy_started(s);
+    EXPECT_CALL(m.native_handle, PQgetCopyData(_, 1)).InSequence(s).WillOnce(copy_data(make_data(true, {{1}}, false)));
+    EXPECT_CALL(m.native_handle, PQgetCopyData(_, 1)).InSequence(s).WillOnce(copy_data(make_data(false, {{2}}, false)));
+    EXPECT_CALL(m.native_handle, PQgetCopyData(_, 1)).InSequence(s).WillOnce(copy_data(make_data(false, {}, true)));
+    expect_copy_finished(s);
+    EXPECT_CALL(m.callback, call(error_code{}, _)).InSequence(s).WillOnce(Return());
+
+    perform();
+
+    EXPECT_THAT(rows, ElementsAre(std::make_tuple(1), std::make_tuple(2)));
+}
+
+TEST_F(async_copy_out, should_wait_for_read_if_no_data_available) {
+    Sequence s;
+
+    expect_copy_started(s);
+    EXPECT_CALL(m.native_handle, PQgetCopyData(_, 1)).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.connection, async_wait_read(_)).InSequence(s).WillOnce(InvokeArgument<0>(error_code{}));
+    EXPECT_CALL(m.cb_io.executor_, post(_)).InSequence(s).WillOnce(InvokeArgument<0>());
+    EXPECT_CALL(m.native_handle, PQconsumeInput()).InSequence(s).WillOnce(Return(1));
+    EXPECT_CALL(m.native_handle, PQgetCopyData(_, 1)).InSequence(s).WillOnce(copy_data(make_data(true, {}, true)));
+    expect_copy_finished(s);
+    EXPECT_CALL(m.callback, call(error_code{}, _)).InSequence(s).WillOnce(Return());
+
+    perform();
+
+    EXPECT_THAT(rows, IsEmpty());
+}
+
+TEST_F(async_copy_out, should_consume_rest_of_data_and_call_handler_with_error_if_row_can_not_be_decoded) {
+    Sequence s;
+
+    expect_copy_started(s);
+    EXPECT_CALL(m.native_handle, PQgetCopyData(_, 1)).InSequence(s).WillOnce(copy_data({'P', 'G'}));
+    EXPECT_CALL(m.native_handle, PQgetCopyData(_, 1)).InSequence(s).WillOnce(copy_data(make_data(false, {{2}}, false)));
+    expect_copy_finished(s);
+    EXPECT_CALL(m.connection, cancel()).InSequence(s).WillOnce(Return());
+    EXPECT_CALL(m.callback, call(error_code{ozo::error::bad_copy_data}, _)).InSequence(s).WillOnce(Return());
+
+    perform();
+
+    EXPECT_THAT(rows, IsEmpty());
+}
+
+TEST_F(async_copy_out, should_call_handler_with_error_if_get_copy_data_failed) {
+    Sequence s;
+
+    expect_copy_started(s);
+    EXPECT_CALL(m.native_handle, PQgetCopyData(_, 1)).InSequence(s).WillOnce(Return(-2));
+    EXPECT_CALL(m.connection, cancel()).InSequence(s).WillOnce(Return());
+    EXPECT_CALL(m.callback, call(error_code{ozo::error::pg_get_copy_data_failed}, _)).InSequence(s).WillOnce(Return());
+
+    perform();
+}
+
+TEST_F(async_copy_out, should_call_handler_with_database_error_if_copy_is_not_started) {
+    Sequence s;
+
+    EXPECT_CALL(m.native_handle, PQsetnonblocking(1)).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.native_handle, PQsendQuery(_)).InSequence(s).WillOnce(Return(1));
+    EXPECT_CALL(m.native_handle, PQflush()).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.native_handle, PQisBusy()).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.native_handle, PQgetResult()).InSequence(s).WillOnce(Return(&fatal_error));
+    EXPECT_CALL(m.native_handle, PQisBusy()).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.native_handle, PQgetResult()).InSequence(s).WillOnce(Return(nullptr));
+    EXPECT_CALL(m.connection, cancel()).InSequence(s).WillOnce(Return());
+    EXPECT_CALL(m.callback, call(ozo::sqlstate::make_error_code(ozo::sqlstate::undefined_table), _))
+        .InSequence(s).WillOnce(Return());
+
+    perform();
+}
+
+TEST(for_each_row, should_pass_decoded_row_to_callback_and_return_false_on_trailer) {
+    std::vector<char> buffer;
+    ozo::ostream os{buffer};
+    ozo::empty_oid_map oid_map;
+    ozo::send_copy_row(os, oid_map, std::make_tuple(std::int16_t(7)));
+    ozo::write_copy_trailer(os);
+
+    std::vector<std::tuple<std::int16_t>> rows;
+    auto handler = ozo::for_each_row<std::tuple<std::int16_t>>([&] (auto&& row) { rows.push_back(row); });
+    ozo::istream is(buffer.data(), buffer.size());
+    EXPECT_TRUE(handler(is, oid_map));
+    EXPECT_FALSE(handler(is, oid_map));
+    EXPECT_THAT(rows, ElementsAre(std::make_tuple(7)));
+}
+
+} // namespace
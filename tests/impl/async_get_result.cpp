@@ -224,6 +224,24 @@ TEST_F(async_get_result, should_post_callback_with_error_and_consume_if_process_
     ozo::impl::async_get_result(m.ctx, process_f);
 }
 
+TEST_F(async_get_result, should_invalidate_oid_map_cache_if_process_data_throws_oid_type_mismatch) {
+    m.conn->oid_map_cache_ = std::make_shared<ozo::detail::oid_map_cache<ozo::empty_oid_map>>();
+    m.conn->oid_map_cache_->update(ozo::empty_oid_map{}, m.conn->oid_map_cache_->get().second);
+
+    ozo::tests::pg_result result{PGRES_TUPLES_OK, nullptr};
+    EXPECT_CALL(m.native_handle, PQisBusy()).WillRepeatedly(Return(0));
+    EXPECT_CALL(m.native_handle, PQgetResult()).WillOnce(Return(&result)).WillOnce(Return(nullptr));
+    EXPECT_CALL(process, call()).WillOnce(Invoke([] {
+        throw ozo::system_error(ozo::error::oid_type_mismatch);
+    }));
+    EXPECT_CALL(m.connection, cancel()).WillOnce(Return());
+    EXPECT_CALL(m.callback, call(error_code{ozo::error::bad_result_process}, _)).WillOnce(Return());
+
+    ozo::impl::async_get_result(m.ctx, process_f);
+
+    EXPECT_FALSE(m.conn->oid_map_cache_->get().first);
+}
+
 TEST_F(async_get_result, should_process_data_and_post_callback_and_consume_if_result_status_is_PGRES_TUPLES_OK) {
     Sequence s;
 
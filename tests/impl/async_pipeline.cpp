@@ -0,0 +1,354 @@
+#include <connection_mock.h>
+#include <test_error.h>
+
+#ifdef LIBPQ_HAS_PIPELINING
+
+#include <ozo/pipeline.h>
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <list>
+
+namespace {
+
+namespace hana = boost::hana;
+
+using namespace testing;
+using namespace ozo::tests;
+
+using callback_mock = callback_gmock<connection_ptr<>>;
+
+using ozo::impl::query_state;
+using ozo::error_code;
+
+struct fixture {
+    StrictMock<connection_gmock> connection{};
+    StrictMock<PGconn_mock> native_handle{};
+    StrictMock<callback_mock> callback{};
+    io_context io;
+    execution_context cb_io;
+    connection_ptr<> conn = make_connection(connection, io, native_handle);
+
+    auto make_operation_context() {
+        EXPECT_CALL(callback, get_executor()).WillRepeatedly(Return(cb_io.get_executor()));
+        return ozo::impl::make_request_operation_context(conn, wrap(callback));
+    }
+
+    decltype(ozo::impl::make_request_operation_context(conn, wrap(callback))) ctx;
+
+    fixture() : ctx(make_operation_context()) {}
+};
+
+const auto two_steps = hana::make_tuple(
+    ozo::pipeline_step{empty_query{}, ozo::none},
+    ozo::pipeline_step{empty_query{}, ozo::none}
+);
+
+struct async_send_pipeline : Test {
+    fixture m;
+};
+
+TEST_F(async_send_pipeline, should_enter_pipeline_mode_and_send_all_queries_and_sync_and_flush) {
+    Sequence s;
+
+    EXPECT_CALL(m.native_handle, PQsetnonblocking(1)).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.native_handle, PQenterPipelineMode()).InSequence(s).WillOnce(Return(1));
+    EXPECT_CALL(m.native_handle, PQsendQueryParams(_, _, _, _, _, _, _)).Times(2).InSequence(s).WillRepeatedly(Return(1));
+    EXPECT_CALL(m.native_handle, PQpipelineSync()).InSequence(s).WillOnce(Return(1));
+    EXPECT_CALL(m.native_handle, PQflush()).InSequence(s).WillOnce(Return(0));
+
+    ozo::impl::async_send_pipeline(m.ctx, two_steps);
+
+    EXPECT_EQ(m.ctx->state, query_state::send_finish);
+}
+
+TEST_F(async_send_pipeline, should_send_queries_from_iterable) {
+    std::vector<ozo::pipeline_step<empty_query, ozo::none_t>> steps(3);
+
+    Sequence s;
+
+    EXPECT_CALL(m.native_handle, PQsetnonblocking(1)).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.native_handle, PQenterPipelineMode()).InSequence(s).WillOnce(Return(1));
+    EXPECT_CALL(m.native_handle, PQsendQueryParams(_, _, _, _, _, _, _)).Times(3).InSequence(s).WillRepeatedly(Return(1));
+    EXPECT_CALL(m.native_handle, PQpipelineSync()).InSequence(s).WillOnce(Return(1));
+    EXPECT_CALL(m.native_handle, PQflush()).InSequence(s).WillOnce(Return(0));
+
+    ozo::impl::async_send_pipeline(m.ctx, steps);
+}
+
+TEST_F(async_send_pipeline, should_call_handler_with_error_if_enter_pipeline_mode_failed) {
+    Sequence s;
+
+    EXPECT_CALL(m.native_handle, PQsetnonblocking(1)).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.native_handle, PQenterPipelineMode()).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.connection, cancel()).InSequence(s).WillOnce(Return());
+    EXPECT_CALL(m.callback, call(error_code{ozo::error::pg_enter_pipeline_mode_failed}, _)).InSequence(s).WillOnce(Return());
+
+    ozo::impl::async_send_pipeline(m.ctx, two_steps);
+
+    EXPECT_EQ(m.ctx->state, query_state::error);
+}
+
+TEST_F(async_send_pipeline, should_stop_sending_and_exit_pipeline_mode_and_call_handler_with_error_if_send_query_params_failed) {
+    Sequence s;
+
+    EXPECT_CALL(m.native_handle, PQsetnonblocking(1)).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.native_handle, PQenterPipelineMode()).InSequence(s).WillOnce(Return(1));
+    EXPECT_CALL(m.native_handle, PQsendQueryParams(_, _, _, _, _, _, _)).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.native_handle, PQexitPipelineMode()).InSequence(s).WillOnce(Return(1));
+    EXPECT_CALL(m.connection, cancel()).InSequence(s).WillOnce(Return());
+    EXPECT_CALL(m.callback, call(error_code{ozo::error::pg_send_query_params_failed}, _)).InSequence(s).WillOnce(Return());
+
+    EXPECT_FALSE(ozo::impl::async_send_pipeline(m.ctx, two_steps));
+}
+
+TEST_F(async_send_pipeline, should_close_connection_and_call_handler_with_exit_error_if_send_query_params_failed_and_exit_pipeline_mode_failed) {
+    Sequence s;
+
+    EXPECT_CALL(m.native_handle, PQsetnonblocking(1)).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.native_handle, PQenterPipelineMode()).InSequence(s).WillOnce(Return(1));
+    EXPECT_CALL(m.native_handle, PQsendQueryParams(_, _, _, _, _, _, _)).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.native_handle, PQexitPipelineMode()).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.connection, close()).InSequence(s).WillOnce(Return(error_code{}));
+    EXPECT_CALL(m.connection, cancel()).InSequence(s).WillOnce(Return());
+    EXPECT_CALL(m.callback, call(error_code{ozo::error::pg_exit_pipeline_mode_failed}, _)).InSequence(s).WillOnce(Return());
+
+    ozo::impl::async_send_pipeline(m.ctx, two_steps);
+}
+
+TEST_F(async_send_pipeline, should_sync_and_flush_and_return_error_if_send_query_params_failed_after_some_queries_sent) {
+    Sequence s;
+
+    EXPECT_CALL(m.native_handle, PQsetnonblocking(1)).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.native_handle, PQenterPipelineMode()).InSequence(s).WillOnce(Return(1));
+    EXPECT_CALL(m.native_handle, PQsendQueryParams(_, _, _, _, _, _, _)).InSequence(s).WillOnce(Return(1));
+    EXPECT_CALL(m.native_handle, PQsendQueryParams(_, _, _, _, _, _, _)).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.native_handle, PQpipelineSync()).InSequence(s).WillOnce(Return(1));
+    EXPECT_CALL(m.native_handle, PQflush()).InSequence(s).WillOnce(Return(0));
+
+    EXPECT_EQ(ozo::impl::async_send_pipeline(m.ctx, two_steps), error_code{ozo::error::pg_send_query_params_failed});
+
+    EXPECT_EQ(m.ctx->state, query_state::send_finish);
+    EXPECT_EQ(m.conn->error_context_, "error while send pipeline query #1");
+}
+
+TEST_F(async_send_pipeline, should_close_connection_and_call_handler_with_error_if_pipeline_sync_failed) {
+    Sequence s;
+
+    EXPECT_CALL(m.native_handle, PQsetnonblocking(1)).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.native_handle, PQenterPipelineMode()).InSequence(s).WillOnce(Return(1));
+    EXPECT_CALL(m.native_handle, PQsendQueryParams(_, _, _, _, _, _, _)).Times(2).InSequence(s).WillRepeatedly(Return(1));
+    EXPECT_CALL(m.native_handle, PQpipelineSync()).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.connection, close()).InSequence(s).WillOnce(Return(error_code{}));
+    EXPECT_CALL(m.connection, cancel()).InSequence(s).WillOnce(Return());
+    EXPECT_CALL(m.callback, call(error_code{ozo::error::pg_pipeline_sync_failed}, _)).InSequence(s).WillOnce(Return());
+
+    ozo::impl::async_send_pipeline(m.ctx, two_steps);
+}
+
+TEST_F(async_send_pipeline, should_wait_for_write_while_flush_is_in_progress) {
+    Sequence s;
+
+    EXPECT_CALL(m.native_handle, PQsetnonblocking(1)).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.native_handle, PQenterPipelineMode()).InSequence(s).WillOnce(Return(1));
+    EXPECT_CALL(m.native_handle, PQsendQueryParams(_, _, _, _, _, _, _)).Times(2).InSequence(s).WillRepeatedly(Return(1));
+    EXPECT_CALL(m.native_handle, PQpipelineSync()).InSequence(s).WillOnce(Return(1));
+    EXPECT_CALL(m.native_handle, PQflush()).InSequence(s).WillOnce(Return(1));
+    EXPECT_CALL(m.connection, async_wait_write(_)).InSequence(s).WillOnce(InvokeArgument<0>(error_code{}));
+    EXPECT_CALL(m.cb_io.executor_, post(_)).InSequence(s).WillOnce(InvokeArgument<0>());
+    EXPECT_CALL(m.native_handle, PQflush()).InSequence(s).WillOnce(Return(0));
+
+    ozo::impl::async_send_pipeline(m.ctx, two_steps);
+
+    EXPECT_EQ(m.ctx->state, query_state::send_finish);
+}
+
+struct process_mock {
+    MOCK_CONST_METHOD1(call, void(std::size_t));
+};
+
+struct process_wrapper {
+    process_mock& mock;
+    template <typename Handle, typename Conn>
+    void operator() (std::size_t n, Handle&&, Conn&) const { mock.call(n); }
+};
+
+struct async_get_pipeline_result : Test {
+    fixture m;
+    StrictMock<process_mock> process;
+    process_wrapper process_f{process};
+    ozo::tests::pg_result tuples_ok{PGRES_TUPLES_OK, nullptr};
+    ozo::tests::pg_result command_ok{PGRES_COMMAND_OK, nullptr};
+    ozo::tests::pg_result fatal_error{PGRES_FATAL_ERROR, nullptr};
+    ozo::tests::pg_result aborted{PGRES_PIPELINE_ABORTED, nullptr};
+    ozo::tests::pg_result pipeline_sync{PGRES_PIPELINE_SYNC, nullptr};
+};
+
+TEST_F(async_get_pipeline_result, should_process_results_with_query_index_and_exit_pipeline_mode_on_sync) {
+    Sequence s;
+
+    EXPECT_CALL(m.native_handle, PQisBusy()).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.native_handle, PQgetResult()).InSequence(s).WillOnce(Return(&tuples_ok));
+    EXPECT_CALL(process, call(0)).InSequence(s).WillOnce(Return());
+    EXPECT_CALL(m.native_handle, PQisBusy()).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.native_handle, PQgetResult()).InSequence(s).WillOnce(Return(nullptr));
+
+    EXPECT_CALL(m.native_handle, PQisBusy()).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.native_handle, PQgetResult()).InSequence(s).WillOnce(Return(&command_ok));
+    EXPECT_CALL(process, call(1)).InSequence(s).WillOnce(Return());
+    EXPECT_CALL(m.native_handle, PQisBusy()).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.native_handle, PQgetResult()).InSequence(s).WillOnce(Return(nullptr));
+
+    EXPECT_CALL(m.native_handle, PQisBusy()).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.native_handle, PQgetResult()).InSequence(s).WillOnce(Return(&pipeline_sync));
+    EXPECT_CALL(m.native_handle, PQexitPipelineMode()).InSequence(s).WillOnce(Return(1));
+    EXPECT_CALL(m.callback, call(error_code{}, _)).InSequence(s).WillOnce(Return());
+
+    ozo::impl::async_get_pipeline_result(m.ctx, process_f);
+}
+
+TEST_F(async_get_pipeline_result, should_wait_for_read_and_consume_input_while_is_busy) {
+    Sequence s;
+
+    EXPECT_CALL(m.native_handle, PQisBusy()).InSequence(s).WillOnce(Return(1));
+    EXPECT_CALL(m.connection, async_wait_read(_)).InSequence(s).WillOnce(InvokeArgument<0>(error_code{}));
+    EXPECT_CALL(m.cb_io.executor_, post(_)).InSequence(s).WillOnce(InvokeArgument<0>());
+    EXPECT_CALL(m.native_handle, PQconsumeInput()).InSequence(s).WillOnce(Return(1));
+    EXPECT_CALL(m.native_handle, PQisBusy()).InSequence(s).WillOnce(Return(1));
+    EXPECT_CALL(m.connection, async_wait_read(_)).InSequence(s).WillOnce(Return());
+
+    ozo::impl::async_get_pipeline_result(m.ctx, process_f);
+}
+
+TEST_F(async_get_pipeline_result, should_skip_aborted_queries_and_report_first_error_after_sync) {
+    Sequence s;
+
+    EXPECT_CALL(m.native_handle, PQisBusy()).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.native_handle, PQgetResult()).InSequence(s).WillOnce(Return(&fatal_error));
+    EXPECT_CALL(m.native_handle, PQisBusy()).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.native_handle, PQgetResult()).InSequence(s).WillOnce(Return(nullptr));
+
+    EXPECT_CALL(m.native_handle, PQisBusy()).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.native_handle, PQgetResult()).InSequence(s).WillOnce(Return(&aborted));
+    EXPECT_CALL(m.native_handle, PQisBusy()).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.native_handle, PQgetResult()).InSequence(s).WillOnce(Return(nullptr));
+
+    EXPECT_CALL(m.native_handle, PQisBusy()).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.native_handle, PQgetResult()).InSequence(s).WillOnce(Return(&pipeline_sync));
+    EXPECT_CALL(m.native_handle, PQexitPipelineMode()).InSequence(s).WillOnce(Return(1));
+    EXPECT_CALL(m.connection, cancel()).InSequence(s).WillOnce(Return());
+    EXPECT_CALL(m.callback, call(error_code{ozo::error::no_sql_state_found}, _)).InSequence(s).WillOnce(Return());
+
+    ozo::impl::async_get_pipeline_result(m.ctx, process_f);
+
+    EXPECT_EQ(m.conn->error_context_, "error in pipeline query #0");
+}
+
+TEST_F(async_get_pipeline_result, should_not_process_results_after_process_error_and_report_it_after_sync) {
+    Sequence s;
+
+    EXPECT_CALL(m.native_handle, PQisBusy()).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.native_handle, PQgetResult()).InSequence(s).WillOnce(Return(&tuples_ok));
+    EXPECT_CALL(process, call(0)).InSequence(s).WillOnce(Invoke([](auto){ throw std::runtime_error("process error");}));
+    EXPECT_CALL(m.native_handle, PQisBusy()).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.native_handle, PQgetResult()).InSequence(s).WillOnce(Return(nullptr));
+
+    EXPECT_CALL(m.native_handle, PQisBusy()).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.native_handle, PQgetResult()).InSequence(s).WillOnce(Return(&tuples_ok));
+    EXPECT_CALL(m.native_handle, PQisBusy()).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.native_handle, PQgetResult()).InSequence(s).WillOnce(Return(nullptr));
+
+    EXPECT_CALL(m.native_handle, PQisBusy()).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.native_handle, PQgetResult()).InSequence(s).WillOnce(Return(&pipeline_sync));
+    EXPECT_CALL(m.native_handle, PQexitPipelineMode()).InSequence(s).WillOnce(Return(1));
+    EXPECT_CALL(m.connection, cancel()).InSequence(s).WillOnce(Return());
+    EXPECT_CALL(m.callback, call(error_code{ozo::error::bad_result_process}, _)).InSequence(s).WillOnce(Return());
+
+    ozo::impl::async_get_pipeline_result(m.ctx, process_f);
+
+    EXPECT_EQ(m.conn->error_context_, "process error");
+}
+
+TEST_F(async_get_pipeline_result, should_call_handler_with_error_if_exit_pipeline_mode_failed) {
+    Sequence s;
+
+    EXPECT_CALL(m.native_handle, PQisBusy()).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.native_handle, PQgetResult()).InSequence(s).WillOnce(Return(&pipeline_sync));
+    EXPECT_CALL(m.native_handle, PQexitPipelineMode()).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.connection, close()).InSequence(s).WillOnce(Return(error_code{}));
+    EXPECT_CALL(m.connection, cancel()).InSequence(s).WillOnce(Return());
+    EXPECT_CALL(m.callback, call(error_code{ozo::error::pg_exit_pipeline_mode_failed}, _)).InSequence(s).WillOnce(Return());
+
+    ozo::impl::async_get_pipeline_result(m.ctx, process_f);
+}
+
+TEST_F(async_get_pipeline_result, should_drain_results_without_processing_and_report_send_error_after_sync) {
+    Sequence s;
+
+    EXPECT_CALL(m.native_handle, PQisBusy()).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.native_handle, PQgetResult()).InSequence(s).WillOnce(Return(&tuples_ok));
+    EXPECT_CALL(m.native_handle, PQisBusy()).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.native_handle, PQgetResult()).InSequence(s).WillOnce(Return(nullptr));
+
+    EXPECT_CALL(m.native_handle, PQisBusy()).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.native_handle, PQgetResult()).InSequence(s).WillOnce(Return(&pipeline_sync));
+    EXPECT_CALL(m.native_handle, PQexitPipelineMode()).InSequence(s).WillOnce(Return(1));
+    EXPECT_CALL(m.connection, cancel()).InSequence(s).WillOnce(Return());
+    EXPECT_CALL(m.callback, call(error_code{ozo::error::pg_send_query_params_failed}, _)).InSequence(s).WillOnce(Return());
+
+    ozo::impl::async_get_pipeline_result(m.ctx, process_f, ozo::error::pg_send_query_params_failed);
+}
+
+TEST_F(async_get_pipeline_result, should_call_handler_with_error_if_consume_input_failed) {
+    Sequence s;
+
+    EXPECT_CALL(m.native_handle, PQisBusy()).InSequence(s).WillOnce(Return(1));
+    EXPECT_CALL(m.connection, async_wait_read(_)).InSequence(s).WillOnce(InvokeArgument<0>(error_code{}));
+    EXPECT_CALL(m.cb_io.executor_, post(_)).InSequence(s).WillOnce(InvokeArgument<0>());
+    EXPECT_CALL(m.native_handle, PQconsumeInput()).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.connection, cancel()).InSequence(s).WillOnce(Return());
+    EXPECT_CALL(m.callback, call(error_code{ozo::error::pg_consume_input_failed}, _)).InSequence(s).WillOnce(Return());
+
+    ozo::impl::async_get_pipeline_result(m.ctx, process_f);
+}
+
+template <typename Steps>
+std::vector<int> apply_to_steps(Steps& steps, std::vector<std::size_t> indices) {
+    ozo::impl::pipeline_steps_cursor<Steps> cursor;
+    std::vector<int> result;
+    for (const auto n : indices) {
+        cursor.apply(steps, n, [&] (const auto& v) { result.push_back(v); });
+    }
+    return result;
+}
+
+TEST(pipeline_steps_cursor, should_apply_function_to_steps_of_tuple_by_index) {
+    auto steps = hana::make_tuple(1, 2, 3);
+    EXPECT_THAT(apply_to_steps(steps, {0, 2}), ElementsAre(1, 3));
+}
+
+TEST(pipeline_steps_cursor, should_apply_function_to_steps_of_random_access_container_by_index) {
+    std::vector steps {1, 2, 3};
+    EXPECT_THAT(apply_to_steps(steps, {0, 1, 2}), ElementsAre(1, 2, 3));
+}
+
+TEST(pipeline_steps_cursor, should_apply_function_to_steps_of_forward_container_by_index) {
+    std::list steps {1, 2, 3, 4};
+    EXPECT_THAT(apply_to_steps(steps, {0, 1, 3}), ElementsAre(1, 2, 4));
+}
+
+TEST(pipeline_steps_cursor, should_keep_position_of_forward_container_valid_after_move) {
+    std::list steps {1, 2, 3};
+    ozo::impl::pipeline_steps_cursor<std::list<int>> cursor;
+    std::vector<int> result;
+    cursor.apply(steps, 1, [&] (int v) { result.push_back(v); });
+    auto moved_steps = std::move(steps);
+    auto moved_cursor = std::move(cursor);
+    moved_cursor.apply(moved_steps, 2, [&] (int v) { result.push_back(v); });
+    EXPECT_THAT(result, ElementsAre(2, 3));
+}
+
+} // namespace
+
+#endif // LIBPQ_HAS_PIPELINING
@@ -0,0 +1,178 @@
+#include <connection_mock.h>
+#include <test_error.h>
+
+#include <ozo/impl/async_request.h>
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+namespace {
+
+using namespace testing;
+using namespace ozo::tests;
+
+using callback_mock = callback_gmock<connection_ptr<>>;
+
+using ozo::error_code;
+
+struct fixture {
+    StrictMock<connection_gmock> connection{};
+    StrictMock<PGconn_mock> native_handle{};
+    StrictMock<callback_mock> callback{};
+    io_context io;
+    execution_context cb_io;
+    connection_ptr<> conn = make_connection(connection, io, native_handle);
+
+    auto make_operation_context() {
+        conn->statement_cache_ = ozo::statement_cache{2};
+        EXPECT_CALL(callback, get_executor()).WillRepeatedly(Return(cb_io.get_executor()));
+        return ozo::impl::make_request_operation_context(conn, wrap(callback));
+    }
+
+    decltype(ozo::impl::make_request_operation_context(conn, wrap(callback))) ctx;
+
+    fixture() : ctx(make_operation_context()) {}
+
+    ozo::statement_cache& cache() { return conn->statement_cache_; }
+};
+
+auto make_query() {
+    return ozo::to_binary_query(empty_query{}, ozo::empty_oid_map{}, std::allocator<char>{});
+}
+
+struct async_prepare : Test {
+    fixture m;
+    ozo::tests::pg_result command_ok{PGRES_COMMAND_OK, nullptr};
+    ozo::tests::pg_result undefined_statement{PGRES_FATAL_ERROR, "26000"};
+    ozo::tests::pg_result syntax_error{PGRES_FATAL_ERROR, "42601"};
+};
+
+TEST_F(async_prepare, should_prepare_statement_and_add_it_to_cache_and_call_handler) {
+    Sequence s;
+
+    EXPECT_CALL(m.native_handle, PQsetnonblocking(1)).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.native_handle, PQsendPrepare(StrEq("ozo_stmt_1"), StrEq(""), 0, _)).InSequence(s).WillOnce(Return(1));
+    EXPECT_CALL(m.native_handle, PQflush()).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.native_handle, PQisBusy()).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.native_handle, PQgetResult()).InSequence(s).WillOnce(Return(&command_ok));
+    EXPECT_CALL(m.native_handle, PQisBusy()).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.native_handle, PQgetResult()).InSequence(s).WillOnce(Return(nullptr));
+    EXPECT_CALL(m.callback, call(error_code{}, _)).InSequence(s).WillOnce(Return());
+
+    ozo::impl::async_prepare(m.ctx, make_query());
+
+    const auto name = m.cache().find("", {});
+    ASSERT_NE(name, nullptr);
+    EXPECT_EQ(*name, "ozo_stmt_1");
+}
+
+TEST_F(async_prepare, should_deallocate_obsolete_statements_before_prepare) {
+    m.cache().add("SELECT 1", {}, "first");
+    m.cache().add("SELECT 2", {}, "second");
+    m.cache().invalidate("first");
+    m.cache().invalidate("second");
+
+    Sequence s;
+
+    EXPECT_CALL(m.native_handle, PQsetnonblocking(1)).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.native_handle, PQsendQuery(StrEq("DEALLOCATE first;DEALLOCATE second;"))).InSequence(s).WillOnce(Return(1));
+    EXPECT_CALL(m.native_handle, PQflush()).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.native_handle, PQisBusy()).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.native_handle, PQgetResult()).InSequence(s).WillOnce(Return(&undefined_statement));
+    EXPECT_CALL(m.native_handle, PQisBusy()).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.native_handle, PQgetResult()).InSequence(s).WillOnce(Return(nullptr));
+
+    EXPECT_CALL(m.native_handle, PQsendPrepare(_, _, _, _)).InSequence(s).WillOnce(Return(1));
+    EXPECT_CALL(m.native_handle, PQflush()).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.native_handle, PQisBusy()).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.native_handle, PQgetResult()).InSequence(s).WillOnce(Return(&command_ok));
+    EXPECT_CALL(m.native_handle, PQisBusy()).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.native_handle, PQgetResult()).InSequence(s).WillOnce(Return(nullptr));
+    EXPECT_CALL(m.callback, call(error_code{}, _)).InSequence(s).WillOnce(Return());
+
+    ozo::impl::async_prepare(m.ctx, make_query());
+
+    EXPECT_THAT(m.cache().obsolete(), IsEmpty());
+}
+
+TEST_F(async_prepare, should_call_handler_with_error_and_not_add_statement_if_prepare_failed) {
+    Sequence s;
+
+    EXPECT_CALL(m.native_handle, PQsetnonblocking(1)).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.native_handle, PQsendPrepare(_, _, _, _)).InSequence(s).WillOnce(Return(1));
+    EXPECT_CALL(m.native_handle, PQflush()).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.native_handle, PQisBusy()).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.native_handle, PQgetResult()).InSequence(s).WillOnce(Return(&syntax_error));
+    EXPECT_CALL(m.native_handle, PQisBusy()).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.native_handle, PQgetResult()).InSequence(s).WillOnce(Return(nullptr));
+    EXPECT_CALL(m.connection, cancel()).InSequence(s).WillOnce(Return());
+    EXPECT_CALL(m.callback, call(ozo::sqlstate::make_error_code(ozo::sqlstate::syntax_error), _))
+        .InSequence(s).WillOnce(Return());
+
+    ozo::impl::async_prepare(m.ctx, make_query());
+
+    EXPECT_EQ(m.cache().size(), 0u);
+}
+
+TEST_F(async_prepare, should_call_handler_with_error_if_send_prepare_failed) {
+    Sequence s;
+
+    EXPECT_CALL(m.native_handle, PQsetnonblocking(1)).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.native_handle, PQsendPrepare(_, _, _, _)).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.connection, cancel()).InSequence(s).WillOnce(Return());
+    EXPECT_CALL(m.callback, call(error_code{ozo::error::pg_send_prepare_failed}, _)).InSequence(s).WillOnce(Return());
+
+    ozo::impl::async_prepare(m.ctx, make_query());
+}
+
+TEST_F(async_prepare, should_wait_for_write_while_flush_is_in_progress) {
+    Sequence s;
+
+    EXPECT_CALL(m.native_handle, PQsetnonblocking(1)).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.native_handle, PQsendPrepare(_, _, _, _)).InSequence(s).WillOnce(Return(1));
+    EXPECT_CALL(m.native_handle, PQflush()).InSequence(s).WillOnce(Return(1));
+    EXPECT_CALL(m.connection, async_wait_write(_)).InSequence(s).WillOnce(InvokeArgument<0>(error_code{}));
+    EXPECT_CALL(m.cb_io.executor_, post(_)).InSequence(s).WillOnce(InvokeArgument<0>());
+    EXPECT_CALL(m.native_handle, PQflush()).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.native_handle, PQisBusy()).InSequence(s).WillOnce(Return(1));
+    EXPECT_CALL(m.connection, async_wait_read(_)).InSequence(s).WillOnce(Return());
+
+    ozo::impl::async_prepare(m.ctx, make_query());
+}
+
+struct prepared_statement_handler : Test {
+    fixture m;
+};
+
+TEST_F(prepared_statement_handler, should_forget_statement_on_invalid_sql_statement_name_error) {
+    m.cache().add("SELECT 1", {}, "name");
+    EXPECT_CALL(m.callback, call(ozo::sqlstate::make_error_code(ozo::sqlstate::invalid_sql_statement_name), _)).WillOnce(Return());
+
+    ozo::impl::prepared_statement_handler{"name", wrap(m.callback)}(
+        ozo::sqlstate::make_error_code(ozo::sqlstate::invalid_sql_statement_name), m.conn);
+
+    EXPECT_EQ(m.cache().find("SELECT 1", {}), nullptr);
+    EXPECT_THAT(m.cache().obsolete(), IsEmpty());
+}
+
+TEST_F(prepared_statement_handler, should_invalidate_statement_on_feature_not_supported_error) {
+    m.cache().add("SELECT 1", {}, "name");
+    EXPECT_CALL(m.callback, call(ozo::sqlstate::make_error_code(ozo::sqlstate::feature_not_supported), _)).WillOnce(Return());
+
+    ozo::impl::prepared_statement_handler{"name", wrap(m.callback)}(
+        ozo::sqlstate::make_error_code(ozo::sqlstate::feature_not_supported), m.conn);
+
+    EXPECT_EQ(m.cache().find("SELECT 1", {}), nullptr);
+    EXPECT_THAT(m.cache().obsolete(), ElementsAre("name"));
+}
+
+TEST_F(prepared_statement_handler, should_keep_statement_on_other_errors) {
+    m.cache().add("SELECT 1", {}, "name");
+    EXPECT_CALL(m.callback, call(error_code{ozo::error::pg_flush_failed}, _)).WillOnce(Return());
+
+    ozo::impl::prepared_statement_handler{"name", wrap(m.callback)}(ozo::error::pg_flush_failed, m.conn);
+
+    EXPECT_NE(m.cache().find("SELECT 1", {}), nullptr);
+}
+
+} // namespace
@@ -2,11 +2,28 @@
 #include <test_error.h>
 
 #include <ozo/impl/async_request.h>
+#include <ozo/query.h>
 #include <ozo/time_traits.h>
 
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
 
+namespace ozo::tests {
+
+struct single_thread_connection : connection<> {
+    using thread_safety_type = ozo::thread_safety<false>;
+    using connection<>::connection;
+};
+
+} // namespace ozo::tests
+
+namespace ozo {
+
+template <>
+struct is_connection<tests::single_thread_connection> : std::true_type {};
+
+} // namespace ozo
+
 namespace {
 
 namespace hana = boost::hana;
@@ -91,6 +108,86 @@ TEST_F(async_request_op, should_send_query_params_and_get_result_and_call_handle
     ozo::impl::async_request_op{empty_query {}, ozo::none, ozo::none, wrap(callback)}(error_code {}, conn);
 }
 
+template <typename T>
+struct counting_allocator {
+    using value_type = T;
+
+    std::size_t* allocations;
+
+    explicit counting_allocator(std::size_t& allocations) : allocations(&allocations) {}
+
+    template <typename U>
+    counting_allocator(const counting_allocator<U>& other) : allocations(other.allocations) {}
+
+    T* allocate(std::size_t n) {
+        ++*allocations;
+        return std::allocator<T>{}.allocate(n);
+    }
+
+    void deallocate(T* ptr, std::size_t n) {
+        std::allocator<T>{}.deallocate(ptr, n);
+    }
+
+    template <typename U>
+    bool operator ==(const counting_allocator<U>& other) const { return allocations == other.allocations;}
+
+    template <typename U>
+    bool operator !=(const counting_allocator<U>& other) const { return !(*this == other);}
+};
+
+template <typename Handler>
+struct counting_allocator_handler {
+    Handler handler;
+    counting_allocator<void> allocator;
+
+    template <typename ...Args>
+    void operator ()(Args&& ...args) {
+        handler(std::forward<Args>(args)...);
+    }
+
+    using executor_type = typename Handler::executor_type;
+
+    auto get_executor() const noexcept { return handler.get_executor();}
+
+    using allocator_type = counting_allocator<void>;
+
+    allocator_type get_allocator() const noexcept { return allocator;}
+};
+
+TEST_F(async_request_op, should_allocate_operation_state_with_single_allocation_from_handler_allocator) {
+    EXPECT_CALL(io.strand_service_, get_executor()).WillOnce(ReturnRef(strand));
+    EXPECT_CALL(callback, get_executor()).WillRepeatedly(Return(cb_io.get_executor()));
+    EXPECT_CALL(io.timer_service_, timer(time_traits::duration(42))).WillRepeatedly(ReturnRef(timer));
+
+    std::function<void (error_code)> on_timer_expired;
+    EXPECT_CALL(timer, async_wait(_)).WillOnce(SaveArg<0>(&on_timer_expired));
+    EXPECT_CALL(native_handle, PQsetnonblocking(1)).WillOnce(Return(0));
+    EXPECT_CALL(native_handle, PQsendQueryParams(_, _, _, _, _, _, _)).WillOnce(Return(1));
+    EXPECT_CALL(native_handle, PQflush()).WillOnce(Return(0));
+    EXPECT_CALL(native_handle, PQisBusy()).WillOnce(Return(0));
+    EXPECT_CALL(native_handle, PQgetResult()).WillOnce(Return(nullptr));
+    EXPECT_CALL(timer, cancel()).WillOnce(Return(1));
+
+    std::size_t allocations = 0;
+    std::size_t operation_allocations = 0;
+
+    // Dispatching the completion to the handler executor is not a part of the operation state
+    EXPECT_CALL(strand, post(_)).WillOnce(DoAll(
+        Invoke([&] (auto&&) { operation_allocations = allocations; }),
+        InvokeArgument<0>()
+    ));
+    EXPECT_CALL(cb_io.executor_, dispatch(_)).WillOnce(InvokeArgument<0>());
+    EXPECT_CALL(callback, call(error_code {}, _)).WillOnce(Return());
+
+    const auto query = ozo::make_query("SELECT $1, $2", std::int64_t(42), std::string("text"));
+    ozo::impl::async_request_op{query, timeout, ozo::none,
+        counting_allocator_handler<decltype(wrap(callback))>{wrap(callback), counting_allocator<void>(allocations)}
+    }(error_code {}, conn);
+    on_timer_expired(boost::asio::error::operation_aborted);
+
+    EXPECT_EQ(operation_allocations, 1u);
+}
+
 TEST_F(async_request_op, should_cancel_connection_io_on_timeout) {
     Sequence s;
 
@@ -116,4 +213,38 @@ TEST_F(async_request_op, should_cancel_connection_io_on_timeout) {
     ozo::impl::async_request_op{empty_query {}, timeout, ozo::none, wrap(callback)}(error_code {}, conn);
 }
 
+TEST_F(async_request_op, should_not_use_strand_for_not_thread_safe_connection) {
+    auto single_thread_conn = std::make_shared<single_thread_connection>(
+        std::addressof(native_handle), ozo::empty_oid_map{}, std::addressof(connection), "", std::addressof(io));
+
+    EXPECT_CALL(callback, get_executor()).WillRepeatedly(Return(cb_io.get_executor()));
+
+    Sequence s;
+
+    EXPECT_CALL(native_handle, PQsetnonblocking(1)).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(native_handle, PQsendQueryParams(_, _, _, _, _, _, _)).InSequence(s).WillOnce(Return(1));
+    EXPECT_CALL(native_handle, PQflush()).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(native_handle, PQisBusy()).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(native_handle, PQgetResult()).InSequence(s).WillOnce(Return(nullptr));
+    EXPECT_CALL(cb_io.executor_, dispatch(_)).InSequence(s).WillOnce(InvokeArgument<0>());
+    EXPECT_CALL(callback, call(error_code {}, _)).InSequence(s).WillOnce(Return());
+
+    ozo::impl::async_request_op{empty_query {}, ozo::none, ozo::none, wrap(callback)}(error_code {}, single_thread_conn);
+}
+
+TEST(make_operation_executor, should_return_strand_for_thread_safe_connection) {
+    EXPECT_TRUE((std::is_same_v<ozo::connection_thread_safety<connection_ptr<>>, ozo::thread_safety<true>>));
+}
+
+TEST(make_operation_executor, should_return_connection_executor_for_not_thread_safe_connection) {
+    EXPECT_TRUE((std::is_same_v<ozo::connection_thread_safety<std::shared_ptr<single_thread_connection>>,
+        ozo::thread_safety<false>>));
+    io_context io;
+    StrictMock<connection_gmock> mock;
+    StrictMock<PGconn_mock> handle;
+    const single_thread_connection conn{
+        std::addressof(handle), ozo::empty_oid_map{}, std::addressof(mock), "", std::addressof(io)};
+    EXPECT_TRUE((std::is_same_v<decltype(ozo::detail::make_operation_executor(conn)), io_context::executor_type>));
+}
+
 } // namespace
@@ -0,0 +1,182 @@
+#include <connection_mock.h>
+#include <test_error.h>
+
+#include <ozo/request_stream.h>
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+namespace {
+
+using namespace testing;
+using namespace ozo::tests;
+
+using callback_mock = callback_gmock<connection_ptr<>>;
+
+using ozo::impl::query_state;
+using ozo::error_code;
+
+struct fixture {
+    StrictMock<connection_gmock> connection{};
+    StrictMock<PGconn_mock> native_handle{};
+    StrictMock<callback_mock> callback{};
+    io_context io;
+    execution_context cb_io;
+    connection_ptr<> conn = make_connection(connection, io, native_handle);
+
+    auto make_operation_context() {
+        EXPECT_CALL(callback, get_executor()).WillRepeatedly(Return(cb_io.get_executor()));
+        return ozo::impl::make_request_operation_context(conn, wrap(callback));
+    }
+
+    decltype(ozo::impl::make_request_operation_context(conn, wrap(callback))) ctx;
+
+    fixture() : ctx(make_operation_context()) {}
+};
+
+#ifndef LIBPQ_HAS_CHUNK_MODE
+
+struct async_send_streamed_query : Test {
+    fixture m;
+};
+
+TEST_F(async_send_streamed_query, should_send_query_params_and_set_single_row_mode_and_flush) {
+    Sequence s;
+
+    EXPECT_CALL(m.native_handle, PQsetnonblocking(1)).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.native_handle, PQsendQueryParams(_, _, _, _, _, _, _)).InSequence(s).WillOnce(Return(1));
+    EXPECT_CALL(m.native_handle, PQsetSingleRowMode()).InSequence(s).WillOnce(Return(1));
+    EXPECT_CALL(m.native_handle, PQflush()).InSequence(s).WillOnce(Return(0));
+
+    ozo::impl::async_send_streamed_query(m.ctx, empty_query{});
+
+    EXPECT_EQ(m.ctx->state, query_state::send_finish);
+}
+
+TEST_F(async_send_streamed_query, should_close_connection_and_call_handler_with_error_if_set_single_row_mode_failed) {
+    Sequence s;
+
+    EXPECT_CALL(m.native_handle, PQsetnonblocking(1)).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.native_handle, PQsendQueryParams(_, _, _, _, _, _, _)).InSequence(s).WillOnce(Return(1));
+    EXPECT_CALL(m.native_handle, PQsetSingleRowMode()).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.connection, close()).InSequence(s).WillOnce(Return(error_code{}));
+    EXPECT_CALL(m.connection, cancel()).InSequence(s).WillOnce(Return());
+    EXPECT_CALL(m.callback, call(error_code{ozo::error::pg_set_rows_mode_failed}, _)).InSequence(s).WillOnce(Return());
+
+    ozo::impl::async_send_streamed_query(m.ctx, empty_query{});
+}
+
+TEST_F(async_send_streamed_query, should_not_close_connection_if_send_query_params_failed) {
+    Sequence s;
+
+    EXPECT_CALL(m.native_handle, PQsetnonblocking(1)).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.native_handle, PQsendQueryParams(_, _, _, _, _, _, _)).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.connection, cancel()).InSequence(s).WillOnce(Return());
+    EXPECT_CALL(m.callback, call(error_code{ozo::error::pg_send_query_params_failed}, _)).InSequence(s).WillOnce(Return());
+
+    ozo::impl::async_send_streamed_query(m.ctx, empty_query{});
+}
+
+#endif
+
+struct process_mock {
+    MOCK_CONST_METHOD1(call, void(ExecStatusType));
+};
+
+struct process_wrapper {
+    process_mock& mock;
+    template <typename Handle, typename Conn>
+    void operator() (Handle&& h, Conn&) const { mock.call(h->status); }
+};
+
+struct async_get_stream_result : Test {
+    fixture m;
+    StrictMock<process_mock> process;
+    process_wrapper process_f{process};
+    ozo::tests::pg_result single_tuple{PGRES_SINGLE_TUPLE, nullptr};
+    ozo::tests::pg_result tuples_ok{PGRES_TUPLES_OK, nullptr};
+    ozo::tests::pg_result fatal_error{PGRES_FATAL_ERROR, nullptr};
+};
+
+TEST_F(async_get_stream_result, should_process_each_result_as_soon_as_it_received_and_call_handler) {
+    Sequence s;
+
+    EXPECT_CALL(m.native_handle, PQisBusy()).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.native_handle, PQgetResult()).InSequence(s).WillOnce(Return(&single_tuple));
+    EXPECT_CALL(process, call(PGRES_SINGLE_TUPLE)).InSequence(s).WillOnce(Return());
+    EXPECT_CALL(m.native_handle, PQisBusy()).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.native_handle, PQgetResult()).InSequence(s).WillOnce(Return(&single_tuple));
+    EXPECT_CALL(process, call(PGRES_SINGLE_TUPLE)).InSequence(s).WillOnce(Return());
+    EXPECT_CALL(m.native_handle, PQisBusy()).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.native_handle, PQgetResult()).InSequence(s).WillOnce(Return(&tuples_ok));
+    EXPECT_CALL(process, call(PGRES_TUPLES_OK)).InSequence(s).WillOnce(Return());
+    EXPECT_CALL(m.native_handle, PQisBusy()).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.native_handle, PQgetResult()).InSequence(s).WillOnce(Return(nullptr));
+    EXPECT_CALL(m.callback, call(error_code{}, _)).InSequence(s).WillOnce(Return());
+
+    ozo::impl::async_get_stream_result(m.ctx, process_f);
+}
+
+TEST_F(async_get_stream_result, should_wait_for_read_and_consume_input_while_is_busy) {
+    Sequence s;
+
+    EXPECT_CALL(m.native_handle, PQisBusy()).InSequence(s).WillOnce(Return(1));
+    EXPECT_CALL(m.connection, async_wait_read(_)).InSequence(s).WillOnce(InvokeArgument<0>(error_code{}));
+    EXPECT_CALL(m.cb_io.executor_, post(_)).InSequence(s).WillOnce(InvokeArgument<0>());
+    EXPECT_CALL(m.native_handle, PQconsumeInput()).InSequence(s).WillOnce(Return(1));
+    EXPECT_CALL(m.native_handle, PQisBusy()).InSequence(s).WillOnce(Return(1));
+    EXPECT_CALL(m.connection, async_wait_read(_)).InSequence(s).WillOnce(Return());
+
+    ozo::impl::async_get_stream_result(m.ctx, process_f);
+}
+
+TEST_F(async_get_stream_result, should_consume_rest_results_and_call_handler_with_error_on_error_result) {
+    Sequence s;
+
+    EXPECT_CALL(m.native_handle, PQisBusy()).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.native_handle, PQgetResult()).InSequence(s).WillOnce(Return(&single_tuple));
+    EXPECT_CALL(process, call(PGRES_SINGLE_TUPLE)).InSequence(s).WillOnce(Return());
+    EXPECT_CALL(m.native_handle, PQisBusy()).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.native_handle, PQgetResult()).InSequence(s).WillOnce(Return(&fatal_error));
+    EXPECT_CALL(m.native_handle, PQisBusy()).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.native_handle, PQgetResult()).InSequence(s).WillOnce(Return(nullptr));
+    EXPECT_CALL(m.connection, cancel()).InSequence(s).WillOnce(Return());
+    EXPECT_CALL(m.callback, call(error_code{ozo::error::no_sql_state_found}, _)).InSequence(s).WillOnce(Return());
+
+    ozo::impl::async_get_stream_result(m.ctx, process_f);
+}
+
+TEST_F(async_get_stream_result, should_not_process_results_after_process_error_and_call_handler_with_error) {
+    Sequence s;
+
+    EXPECT_CALL(m.native_handle, PQisBusy()).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.native_handle, PQgetResult()).InSequence(s).WillOnce(Return(&single_tuple));
+    EXPECT_CALL(process, call(PGRES_SINGLE_TUPLE)).InSequence(s).WillOnce(Throw(std::runtime_error("error")));
+    EXPECT_CALL(m.native_handle, PQisBusy()).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.native_handle, PQgetResult()).InSequence(s).WillOnce(Return(&single_tuple));
+    EXPECT_CALL(m.native_handle, PQisBusy()).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.native_handle, PQgetResult()).InSequence(s).WillOnce(Return(&tuples_ok));
+    EXPECT_CALL(m.native_handle, PQisBusy()).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.native_handle, PQgetResult()).InSequence(s).WillOnce(Return(nullptr));
+    EXPECT_CALL(m.connection, cancel()).InSequence(s).WillOnce(Return());
+    EXPECT_CALL(m.callback, call(error_code{ozo::error::bad_result_process}, _)).InSequence(s).WillOnce(Return());
+
+    ozo::impl::async_get_stream_result(m.ctx, process_f);
+
+    EXPECT_EQ(m.conn->get_error_context(), "error");
+}
+
+TEST_F(async_get_stream_result, should_call_handler_with_error_if_consume_input_failed) {
+    Sequence s;
+
+    EXPECT_CALL(m.native_handle, PQisBusy()).InSequence(s).WillOnce(Return(1));
+    EXPECT_CALL(m.connection, async_wait_read(_)).InSequence(s).WillOnce(InvokeArgument<0>(error_code{}));
+    EXPECT_CALL(m.cb_io.executor_, post(_)).InSequence(s).WillOnce(InvokeArgument<0>());
+    EXPECT_CALL(m.native_handle, PQconsumeInput()).InSequence(s).WillOnce(Return(0));
+    EXPECT_CALL(m.connection, cancel()).InSequence(s).WillOnce(Return());
+    EXPECT_CALL(m.callback, call(error_code{ozo::error::pg_consume_input_failed}, _)).InSequence(s).WillOnce(Return());
+
+    ozo::impl::async_get_stream_result(m.ctx, process_f);
+}
+
+} // namespace
@@ -3,11 +3,14 @@
 #include <ozo/query_builder.h>
 #include <ozo/request.h>
 #include <ozo/shortcuts.h>
+#include <ozo/transaction.h>
 
 #include <boost/asio/spawn.hpp>
 
 #include <algorithm>
 #include <future>
+#include <memory>
+#include <optional>
 
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
@@ -147,4 +150,403 @@ TEST(connection_pool_integration, should_serve_concurrent_requests) {
     EXPECT_THAT(results, Each(results.front()));
 }
 
+TEST(connection_pool_integration, warm_up_should_establish_idle_connections) {
+    using namespace std::chrono_literals;
+
+    ozo::io_context io;
+    ozo::connection_info conn_info(OZO_PG_TEST_CONNINFO);
+    ozo::connection_pool_config config;
+    config.capacity = 3;
+    config.warm_up = 2;
+    ozo::connection_pool pool(conn_info, config);
+
+    asio::spawn(io, [&] (asio::yield_context yield) {
+        ozo::error_code ec;
+        pool.warm_up(io, 1s, yield[ec]);
+        ASSERT_FALSE(ec) << ec.message();
+
+        const auto stats = pool.stats();
+        EXPECT_EQ(stats.size, 2u);
+        EXPECT_EQ(stats.available, 2u);
+    });
+
+    io.run();
+}
+
+TEST(connection_pool_integration, warm_up_should_establish_new_connections_when_pool_has_idle_ones) {
+    using namespace std::chrono_literals;
+
+    ozo::io_context io;
+    ozo::connection_info conn_info(OZO_PG_TEST_CONNINFO);
+    ozo::connection_pool_config config;
+    config.capacity = 4;
+    config.warm_up = 4;
+    ozo::connection_pool pool(conn_info, config);
+
+    asio::spawn(io, [&] (asio::yield_context yield) {
+        ozo::error_code ec;
+        auto first = ozo::get_connection(pool[io], 1s, yield[ec]);
+        ASSERT_FALSE(ec) << ec.message();
+        auto second = ozo::get_connection(pool[io], 1s, yield[ec]);
+        ASSERT_FALSE(ec) << ec.message();
+        first.reset();
+        second.reset();
+        ASSERT_EQ(pool.stats().available, 2u);
+
+        pool.warm_up(io, 1s, yield[ec]);
+        ASSERT_FALSE(ec) << ec.message();
+
+        const auto stats = pool.stats();
+        EXPECT_EQ(stats.size, 4u);
+        EXPECT_EQ(stats.available, 4u);
+    });
+
+    io.run();
+}
+
+TEST(connection_pool_integration, min_idle_should_establish_new_connections_when_pool_has_idle_ones) {
+    using namespace std::chrono_literals;
+
+    ozo::io_context io;
+    ozo::connection_info conn_info(OZO_PG_TEST_CONNINFO);
+    ozo::connection_pool_config config;
+    config.capacity = 4;
+    config.min_idle = 2;
+    config.min_idle_interval = 100ms;
+    ozo::connection_pool pool(conn_info, config);
+
+    asio::spawn(io, [&] (asio::yield_context yield) {
+        ozo::error_code ec;
+        asio::steady_timer timer(io);
+        auto first = ozo::get_connection(pool[io], 1s, yield[ec]);
+        ASSERT_FALSE(ec) << ec.message();
+        timer.expires_after(500ms);
+        timer.async_wait(yield[ec]);
+        ASSERT_EQ(pool.stats().available, 2u);
+
+        auto second = ozo::get_connection(pool[io], 1s, yield[ec]);
+        ASSERT_FALSE(ec) << ec.message();
+        timer.expires_after(500ms);
+        timer.async_wait(yield[ec]);
+
+        const auto stats = pool.stats();
+        EXPECT_EQ(stats.size, 4u);
+        EXPECT_EQ(stats.available, 2u);
+    });
+
+    io.run();
+}
+
+TEST(connection_pool_integration, sharded_pool_should_serve_queued_request_by_connection_returned_into_any_shard) {
+    using namespace std::chrono_literals;
+
+    ozo::io_context io;
+    ozo::connection_info conn_info(OZO_PG_TEST_CONNINFO);
+    ozo::connection_pool_config config;
+    config.capacity = 2;
+    config.shards = 2;
+    ozo::connection_pool pool(conn_info, config);
+
+    asio::spawn(io, [&] (asio::yield_context yield) {
+        ozo::error_code ec;
+        auto first = ozo::get_connection(pool[io], 1s, yield[ec]);
+        ASSERT_FALSE(ec) << ec.message();
+        auto second = ozo::get_connection(pool[io], 1s, yield[ec]);
+        ASSERT_FALSE(ec) << ec.message();
+        const auto second_handle = ozo::get_native_handle(second);
+
+        asio::post(io, [&] { second.reset(); });
+        auto third = ozo::get_connection(pool[io], 1s, yield[ec]);
+        ASSERT_FALSE(ec) << ec.message();
+        EXPECT_EQ(ozo::get_native_handle(third), second_handle);
+        EXPECT_EQ(pool.stats().size, 2u);
+    });
+
+    io.run();
+}
+
+TEST(connection_pool_integration, statistics_should_sum_statistics_of_returned_connections) {
+    using namespace ozo::literals;
+    using namespace std::chrono_literals;
+
+    ozo::io_context io;
+    const auto conn_info = ozo::make_connection_info(OZO_PG_TEST_CONNINFO, ozo::register_types<>(), ozo::basic_statistics{});
+    ozo::connection_pool_config config;
+    config.capacity = 1;
+    ozo::connection_pool pool(conn_info, config);
+
+    asio::spawn(io, [&] (asio::yield_context yield) {
+        ozo::error_code ec;
+        ozo::rows_of<std::int32_t> result;
+        ozo::request(pool[io], "SELECT 1"_SQL, 1s, ozo::into(result), yield[ec]);
+        ASSERT_FALSE(ec) << ec.message();
+        ozo::request(pool[io], "SELECT 1"_SQL, 1s, ozo::into(result), yield[ec]);
+        ASSERT_FALSE(ec) << ec.message();
+
+        const auto statistics = pool.statistics();
+        EXPECT_EQ(statistics.connects, 1u);
+        EXPECT_EQ(statistics.requests, 2u);
+        EXPECT_EQ(statistics.rows_decoded, 2u);
+    });
+
+    io.run();
+}
+
+TEST(connection_pool_integration, should_return_connection_with_open_transaction_to_pool_with_rollback_reset_policy) {
+    using namespace std::chrono_literals;
+
+    ozo::io_context io;
+    ozo::connection_info conn_info(OZO_PG_TEST_CONNINFO);
+    ozo::connection_pool_config config;
+    config.capacity = 1;
+    config.reset.policy = ozo::connection_reset_policy::rollback;
+    const auto metrics = std::make_shared<ozo::connection_pool_metrics>();
+    config.metrics = metrics;
+    ozo::connection_pool pool(conn_info, config);
+
+    asio::spawn(io, [&] (asio::yield_context yield) {
+        ozo::error_code ec;
+        {
+            auto transaction = ozo::begin(pool[io], 1s, yield[ec]);
+            ASSERT_FALSE(ec) << ec.message();
+        }
+
+        auto conn = ozo::get_connection(pool[io], 1s, yield[ec]);
+        ASSERT_FALSE(ec) << ec.message();
+        EXPECT_EQ(ozo::get_transaction_status(conn), ozo::transaction_status::idle);
+        EXPECT_EQ(metrics->snapshot().connects, 1u);
+        EXPECT_EQ(metrics->snapshot().wasted_not_idle, 0u);
+    });
+
+    io.run();
+}
+
+TEST(connection_pool_integration, should_serve_concurrent_requests_with_earliest_deadline_first_queue_policy) {
+    using namespace ozo::literals;
+    using namespace std::chrono_literals;
+
+    ozo::io_context io;
+    ozo::connection_info conn_info(OZO_PG_TEST_CONNINFO);
+    ozo::connection_pool_config config;
+    config.capacity = 1;
+    config.queue_policy = ozo::connection_pool_queue_policy::earliest_deadline_first;
+    ozo::connection_pool pool(conn_info, config);
+
+    std::size_t completed = 0;
+    for (int i = 0; i != 3; ++i) {
+        asio::spawn(io, [&] (asio::yield_context yield) {
+            ozo::rows_of<int> result;
+            ozo::error_code ec;
+            ozo::request(pool[io], "SELECT 1"_SQL, 1s, ozo::into(result), yield[ec]);
+            ASSERT_FALSE(ec) << ec.message();
+            ++completed;
+        });
+    }
+
+    io.run();
+    EXPECT_EQ(completed, 3u);
+}
+
+TEST(connection_pool_integration, should_hand_out_most_recently_used_connection_with_lifo_idle_order) {
+    using namespace ozo::literals;
+    using namespace std::chrono_literals;
+
+    ozo::io_context io;
+    ozo::connection_info conn_info(OZO_PG_TEST_CONNINFO);
+    ozo::connection_pool_config config;
+    config.capacity = 2;
+    config.idle_order = ozo::connection_pool_idle_order::lifo;
+    ozo::connection_pool pool(conn_info, config);
+
+    asio::spawn(io, [&] (asio::yield_context yield) {
+        ozo::error_code ec;
+        auto first = ozo::get_connection(pool[io], 1s, yield[ec]);
+        ASSERT_FALSE(ec) << ec.message();
+        auto second = ozo::get_connection(pool[io], 1s, yield[ec]);
+        ASSERT_FALSE(ec) << ec.message();
+        const auto first_handle = ozo::get_native_handle(first);
+        first.reset();
+        second.reset();
+        EXPECT_EQ(pool.stats().available, 2u);
+
+        auto conn = ozo::get_connection(pool[io], 1s, yield[ec]);
+        ASSERT_FALSE(ec) << ec.message();
+        EXPECT_NE(ozo::get_native_handle(conn), first_handle);
+    });
+
+    io.run();
+}
+
+TEST(connection_pool_integration, should_close_idle_connections_of_lifo_idle_order_without_traffic) {
+    using namespace std::chrono_literals;
+
+    ozo::io_context io;
+    ozo::connection_info conn_info(OZO_PG_TEST_CONNINFO);
+    ozo::connection_pool_config config;
+    config.capacity = 2;
+    config.idle_timeout = 100ms;
+    config.idle_order = ozo::connection_pool_idle_order::lifo;
+    ozo::connection_pool pool(conn_info, config);
+
+    asio::spawn(io, [&] (asio::yield_context yield) {
+        ozo::error_code ec;
+        auto conn = ozo::get_connection(pool[io], 1s, yield[ec]);
+        ASSERT_FALSE(ec) << ec.message();
+        conn.reset();
+        EXPECT_EQ(pool.stats().available, 1u);
+    });
+
+    io.run();
+    EXPECT_EQ(pool.stats().available, 0u);
+    EXPECT_EQ(pool.stats().size, 0u);
+}
+
+TEST(connection_pool_integration, drain_should_reject_requests_wait_for_borrowed_connection_and_close_idle_ones) {
+    using namespace std::chrono_literals;
+
+    ozo::io_context io;
+    ozo::connection_info conn_info(OZO_PG_TEST_CONNINFO);
+    ozo::connection_pool_config config;
+    config.capacity = 2;
+    config.warm_up = 2;
+    ozo::connection_pool pool(conn_info, config);
+
+    bool drained = false;
+    asio::spawn(io, [&] (asio::yield_context yield) {
+        ozo::error_code ec;
+        pool.warm_up(io, 1s, yield[ec]);
+        ASSERT_FALSE(ec) << ec.message();
+        auto conn = ozo::get_connection(pool[io], 1s, yield[ec]);
+        ASSERT_FALSE(ec) << ec.message();
+
+        pool.drain(io, 1s, [&] (ozo::error_code ec) {
+            EXPECT_FALSE(ec) << ec.message();
+            drained = true;
+        });
+        EXPECT_TRUE(pool.draining());
+
+        ozo::get_connection(pool[io], 1s, yield[ec]);
+        EXPECT_EQ(ec, ozo::error_code{ozo::error::pool_draining});
+        EXPECT_FALSE(drained);
+        conn.reset();
+    });
+
+    io.run();
+    EXPECT_TRUE(drained);
+    EXPECT_EQ(pool.stats().available, 0u);
+}
+
+TEST(connection_pool_integration, drain_should_reject_requests_wait_in_resource_pool_queue) {
+    using namespace std::chrono_literals;
+
+    ozo::io_context io;
+    ozo::connection_info conn_info(OZO_PG_TEST_CONNINFO);
+    ozo::connection_pool_config config;
+    config.capacity = 1;
+    config.queue_capacity = 1;
+    ozo::connection_pool pool(conn_info, config);
+
+    bool drained = false;
+    bool rejected = false;
+    asio::spawn(io, [&] (asio::yield_context yield) {
+        ozo::error_code ec;
+        auto conn = ozo::get_connection(pool[io], 1s, yield[ec]);
+        ASSERT_FALSE(ec) << ec.message();
+
+        asio::spawn(io, [&] (asio::yield_context yield) {
+            ozo::error_code ec;
+            ozo::get_connection(pool[io], 1s, yield[ec]);
+            EXPECT_EQ(ec, ozo::error_code{ozo::error::pool_draining});
+            rejected = true;
+        });
+        asio::post(io, yield);
+
+        pool.drain(io, 1s, [&] (ozo::error_code ec) {
+            EXPECT_FALSE(ec) << ec.message();
+            drained = true;
+        });
+        conn.reset();
+    });
+
+    io.run();
+    EXPECT_TRUE(rejected);
+    EXPECT_TRUE(drained);
+    EXPECT_EQ(pool.stats().size, 0u);
+}
+
+TEST(connection_pool_integration, drain_should_not_complete_within_the_call) {
+    using namespace std::chrono_literals;
+
+    ozo::io_context io;
+    ozo::connection_info conn_info(OZO_PG_TEST_CONNINFO);
+    ozo::connection_pool pool(conn_info, ozo::connection_pool_config{});
+
+    bool drained = false;
+    pool.drain(io, 1s, [&] (ozo::error_code ec) {
+        EXPECT_FALSE(ec) << ec.message();
+        drained = true;
+    });
+    EXPECT_FALSE(drained);
+
+    io.run();
+    EXPECT_TRUE(drained);
+}
+
+TEST(connection_pool_integration, pool_should_be_destroyed_after_io_context_is_stopped_and_destroyed) {
+    using namespace ozo::literals;
+    using namespace std::chrono_literals;
+
+    ozo::connection_info conn_info(OZO_PG_TEST_CONNINFO);
+    ozo::connection_pool_config config;
+    config.capacity = 1;
+    config.queue_capacity = 0;
+    std::optional<ozo::connection_pool<ozo::connection_info<>>> pool(std::in_place, conn_info, config);
+
+    for (int i = 0; i != 2; ++i) {
+        auto io = std::make_unique<ozo::io_context>();
+        ozo::rows_of<int> result;
+        ozo::error_code ec;
+        ozo::request((*pool)[*io], "SELECT 1"_SQL, ozo::deadline(1s), ozo::into(result),
+            [&] (ozo::error_code e, auto) { ec = e; });
+        io->run();
+        ASSERT_FALSE(ec) << ec.message();
+        EXPECT_EQ(pool->stats().available, 1u);
+        io->stop();
+        // The idle connection socket is registered within the io_context,
+        // the next iteration uses the same connection with a new io_context.
+        io.reset();
+    }
+
+    pool.reset();
+}
+
+TEST(connection_pool_integration, queued_request_should_be_served_after_pool_is_moved) {
+    using namespace std::chrono_literals;
+    using pool_type = ozo::connection_pool<ozo::connection_info<>>;
+
+    ozo::io_context io;
+    ozo::connection_info conn_info(OZO_PG_TEST_CONNINFO);
+    ozo::connection_pool_config config;
+    config.capacity = 1;
+    config.queue_capacity = 1;
+    config.queue_policy = ozo::connection_pool_queue_policy::earliest_deadline_first;
+    auto pool = std::make_unique<pool_type>(conn_info, config);
+
+    std::optional<ozo::error_code> second_ec;
+    ozo::get_connection((*pool)[io], 1s, [&] (ozo::error_code ec, auto first) {
+        ASSERT_FALSE(ec) << ec.message();
+        ozo::get_connection((*pool)[io], 1s, [&] (ozo::error_code ec, auto) {
+            second_ec = ec;
+        });
+        // The second request waits in the queue of the pool which is moved and destroyed then.
+        pool = std::make_unique<pool_type>(std::move(*pool));
+        first.reset();
+    });
+
+    io.run();
+
+    ASSERT_TRUE(second_ec);
+    EXPECT_FALSE(*second_ec) << second_ec->message();
+}
+
 } // namespace
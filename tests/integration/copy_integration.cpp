@@ -0,0 +1,144 @@
+#include <ozo/connection_info.h>
+#include <ozo/copy.h>
+#include <ozo/execute.h>
+#include <ozo/query_builder.h>
+#include <ozo/request.h>
+#include <ozo/shortcuts.h>
+#include <ozo/transaction_status.h>
+
+#include <boost/asio/spawn.hpp>
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#define ASSERT_REQUEST_OK(ec, conn)\
+    ASSERT_FALSE(ec) << ec.message() \
+        << "|" << ozo::error_message(conn) \
+        << "|" << ozo::get_error_context(conn) << std::endl
+
+namespace {
+
+namespace asio = boost::asio;
+
+using namespace testing;
+
+TEST(copy_in, should_insert_rows_into_table) {
+    using namespace ozo::literals;
+
+    ozo::io_context io;
+
+    asio::spawn(io, [&] (asio::yield_context yield) {
+        const ozo::connection_info conn_info(OZO_PG_TEST_CONNINFO);
+        ozo::error_code ec{};
+        auto conn = ozo::execute(conn_info[io],
+            "CREATE TEMPORARY TABLE copy_in_test (id int8, name text)"_SQL, yield[ec]);
+        ASSERT_REQUEST_OK(ec, conn);
+
+        ozo::rows_of<std::int64_t, std::optional<std::string>> rows;
+        for (std::int64_t i = 0; i < 10000; ++i) {
+            rows.emplace_back(i, i % 2 ? std::make_optional(std::to_string(i)) : std::nullopt);
+        }
+        const std::vector<std::string> columns{"id", "name"};
+
+        conn = ozo::copy_in(conn, "copy_in_test", columns, rows, yield[ec]);
+        ASSERT_REQUEST_OK(ec, conn);
+
+        ozo::rows_of<std::int64_t, std::int64_t> out;
+        conn = ozo::request(conn, "SELECT count(*), count(name) FROM copy_in_test"_SQL, ozo::into(out), yield[ec]);
+        ASSERT_REQUEST_OK(ec, conn);
+        EXPECT_THAT(out, ElementsAre(std::make_tuple(10000, 5000)));
+    });
+
+    io.run();
+}
+
+TEST(copy_in, should_return_error_for_rows_not_matching_columns_and_leave_connection_usable) {
+    using namespace ozo::literals;
+
+    ozo::io_context io;
+
+    asio::spawn(io, [&] (asio::yield_context yield) {
+        const ozo::connection_info conn_info(OZO_PG_TEST_CONNINFO);
+        ozo::error_code ec{};
+        auto conn = ozo::execute(conn_info[io],
+            "CREATE TEMPORARY TABLE copy_in_test (id int8, name text)"_SQL, yield[ec]);
+        ASSERT_REQUEST_OK(ec, conn);
+
+        const std::vector<std::tuple<std::int64_t>> rows{{1}};
+
+        conn = ozo::copy_in(conn, "copy_in_test", std::vector<std::string>{}, rows, yield[ec]);
+        EXPECT_EQ(ec, ozo::sqlstate::bad_copy_file_format);
+        EXPECT_FALSE(ozo::connection_bad(conn));
+        EXPECT_EQ(ozo::get_transaction_status(conn), ozo::transaction_status::idle);
+    });
+
+    io.run();
+}
+
+TEST(copy_out, should_decode_rows_from_table) {
+    using namespace ozo::literals;
+
+    ozo::io_context io;
+
+    asio::spawn(io, [&] (asio::yield_context yield) {
+        const ozo::connection_info conn_info(OZO_PG_TEST_CONNINFO);
+        ozo::error_code ec{};
+        auto conn = ozo::execute(conn_info[io],
+            "CREATE TEMPORARY TABLE copy_out_test AS "
+            "SELECT i::int8 AS id, CASE WHEN i % 2 = 1 THEN i::text END AS name "
+            "FROM generate_series(0, 9999) AS i"_SQL, yield[ec]);
+        ASSERT_REQUEST_OK(ec, conn);
+
+        std::vector<std::tuple<std::int64_t, std::optional<std::string>>> rows;
+        const std::vector<std::string> columns{"id", "name"};
+
+        conn = ozo::copy_out(conn, "copy_out_test", columns, std::back_inserter(rows), yield[ec]);
+        ASSERT_REQUEST_OK(ec, conn);
+        ASSERT_EQ(rows.size(), 10000u);
+        EXPECT_EQ(rows[0], std::make_tuple(std::int64_t(0), std::optional<std::string>{}));
+        EXPECT_EQ(rows[1], std::make_tuple(std::int64_t(1), std::make_optional(std::string("1"))));
+    });
+
+    io.run();
+}
+
+TEST(copy_out, should_pass_rows_of_query_to_callback) {
+    ozo::io_context io;
+
+    asio::spawn(io, [&] (asio::yield_context yield) {
+        const ozo::connection_info conn_info(OZO_PG_TEST_CONNINFO);
+        ozo::error_code ec{};
+        std::int64_t sum = 0;
+
+        auto on_row = ozo::for_each_row<std::tuple<std::int64_t>>([&] (auto&& row) {
+            sum += std::get<0>(row);
+        });
+
+        auto conn = ozo::copy_out(conn_info[io], "(SELECT i::int8 FROM generate_series(1, 100) AS i)",
+            std::vector<std::string>{}, std::move(on_row), yield[ec]);
+        ASSERT_REQUEST_OK(ec, conn);
+        EXPECT_EQ(sum, 5050);
+    });
+
+    io.run();
+}
+
+TEST(copy_out, should_return_error_for_rows_not_matching_columns_and_leave_connection_usable) {
+    ozo::io_context io;
+
+    asio::spawn(io, [&] (asio::yield_context yield) {
+        const ozo::connection_info conn_info(OZO_PG_TEST_CONNINFO);
+        ozo::error_code ec{};
+        std::vector<std::tuple<std::int64_t>> rows;
+
+        auto conn = ozo::copy_out(conn_info[io], "(SELECT 1::int8, 2::int8)",
+            std::vector<std::string>{}, std::back_inserter(rows), yield[ec]);
+        EXPECT_EQ(ec, ozo::error::bad_copy_data);
+        EXPECT_FALSE(ozo::connection_bad(conn));
+        EXPECT_EQ(ozo::get_transaction_status(conn), ozo::transaction_status::idle);
+    });
+
+    io.run();
+}
+
+} // namespace
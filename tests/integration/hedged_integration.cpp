@@ -0,0 +1,62 @@
+#include <ozo/connection_info.h>
+#include <ozo/query_builder.h>
+#include <ozo/request.h>
+#include <ozo/shortcuts.h>
+#include <ozo/failover/hedged.h>
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+namespace {
+
+#define ASSERT_REQUEST_OK(ec, conn)\
+    ASSERT_FALSE(ec) << ec.message() \
+        << "|" << ozo::error_message(conn) \
+        << "|" << (!ozo::is_null_recursive(conn) ? ozo::get_error_context(conn) : "") << std::endl
+
+using namespace testing;
+using namespace std::chrono_literals;
+
+TEST(request, should_return_result_of_one_try_only_for_both_tries_started) {
+    using namespace ozo::literals;
+
+    ozo::io_context io;
+    const auto source = ozo::failover::make_latency_aware_connection_source(std::vector{
+        ozo::connection_info(OZO_PG_TEST_CONNINFO),
+        ozo::connection_info(OZO_PG_TEST_CONNINFO),
+    });
+
+    std::vector<int> res;
+    ozo::request[ozo::failover::hedged(0ms)](source[io], "SELECT 1"_SQL + " + 1"_SQL, 1s, ozo::into(res),
+            [&](ozo::error_code ec, auto conn) {
+        ASSERT_REQUEST_OK(ec, conn);
+    });
+
+    io.run();
+    EXPECT_THAT(res, ElementsAre(2));
+}
+
+TEST(request, should_return_result_of_fast_try_and_cancel_slow_one) {
+    using namespace ozo::literals;
+
+    ozo::io_context io;
+    const auto source = ozo::failover::make_latency_aware_connection_source(std::vector{
+        ozo::connection_info(OZO_PG_TEST_CONNINFO),
+        ozo::connection_info(OZO_PG_TEST_CONNINFO),
+    });
+    // The try which takes the lock sleeps, so the other one wins.
+    const auto query = "SELECT 1 FROM pg_sleep(CASE WHEN pg_try_advisory_lock(42) THEN 10 ELSE 0 END)"_SQL;
+
+    std::vector<int> res;
+    const auto start = ozo::time_traits::now();
+    ozo::request[ozo::failover::hedged(100ms)](source[io], query, 5s, ozo::into(res),
+            [&](ozo::error_code ec, auto conn) {
+        ASSERT_REQUEST_OK(ec, conn);
+    });
+
+    io.run();
+    EXPECT_THAT(res, ElementsAre(1));
+    EXPECT_LT(ozo::time_traits::now() - start, 5s);
+}
+
+} // namespace
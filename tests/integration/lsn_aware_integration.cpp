@@ -0,0 +1,59 @@
+#include <ozo/connection_info.h>
+#include <ozo/query_builder.h>
+#include <ozo/request.h>
+#include <ozo/shortcuts.h>
+#include <ozo/failover/lsn_aware.h>
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+namespace {
+
+#define ASSERT_REQUEST_OK(ec, conn)\
+    ASSERT_FALSE(ec) << ec.message() \
+        << "|" << ozo::error_message(conn) \
+        << "|" << (!ozo::is_null_recursive(conn) ? ozo::get_error_context(conn) : "") << std::endl
+
+using namespace testing;
+using namespace std::chrono_literals;
+
+TEST(get_current_wal_lsn, should_return_positive_lsn) {
+    ozo::io_context io;
+    const ozo::connection_info conn_info(OZO_PG_TEST_CONNINFO);
+
+    ozo::failover::wal_lsn lsn = 0;
+    ozo::failover::get_current_wal_lsn(conn_info[io], 1s, lsn, [&](ozo::error_code ec, auto conn) {
+        ASSERT_REQUEST_OK(ec, conn);
+    });
+
+    io.run();
+    EXPECT_GT(lsn, 0);
+}
+
+TEST(request, should_return_result_for_lsn_captured_after_write_and_stop_polling) {
+    using namespace ozo::literals;
+
+    ozo::io_context io;
+    const auto source = ozo::failover::make_lsn_aware_connection_source(
+        ozo::connection_info(OZO_PG_TEST_CONNINFO),
+        std::vector{ozo::connection_info(OZO_PG_TEST_CONNINFO)}
+    );
+    source.start_polling(io);
+
+    std::vector<int> res;
+    ozo::failover::wal_lsn lsn = 0;
+    ozo::failover::get_current_wal_lsn(source.primary()[io], 1s, lsn, [&](ozo::error_code ec, auto conn) {
+        ASSERT_REQUEST_OK(ec, conn);
+        ozo::request(source.rebind_lsn(lsn)[io], "SELECT 1"_SQL, 1s, ozo::into(res),
+                [&](ozo::error_code ec, auto conn) {
+            source.stop_polling();
+            ASSERT_REQUEST_OK(ec, conn);
+        });
+    });
+
+    io.run();
+    EXPECT_THAT(res, ElementsAre(1));
+    EXPECT_TRUE(source.stats(0).available);
+}
+
+} // namespace
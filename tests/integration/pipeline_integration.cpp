@@ -0,0 +1,68 @@
+#include <ozo/connection_info.h>
+
+// Pipeline mode is available since libpq 14, the rest of the library supports older versions.
+#ifdef LIBPQ_HAS_PIPELINING
+
+#include <ozo/query_builder.h>
+#include <ozo/pipeline.h>
+#include <ozo/shortcuts.h>
+#include <ozo/transaction_status.h>
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+namespace {
+
+using namespace testing;
+
+TEST(pipeline, should_return_results_of_all_queries) {
+    using namespace ozo::literals;
+
+    ozo::io_context io;
+    ozo::connection_info conn_info(OZO_PG_TEST_CONNINFO);
+    ozo::rows_of<std::int32_t> first;
+    ozo::rows_of<std::string> second;
+
+    const auto steps = boost::hana::make_tuple(
+        ozo::pipeline_step{"SELECT 1"_SQL, ozo::into(first)},
+        ozo::pipeline_step{"SELECT 'two'::text"_SQL, ozo::into(second)}
+    );
+
+    ozo::pipeline(conn_info[io], steps,
+        [&](ozo::error_code ec, auto conn) {
+            ASSERT_FALSE(ec) << ec.message() << " | " << error_message(conn) << " | " << get_error_context(conn);
+            EXPECT_FALSE(ozo::connection_bad(conn));
+            EXPECT_THAT(first, ElementsAre(std::make_tuple(1)));
+            EXPECT_THAT(second, ElementsAre(std::make_tuple("two")));
+        });
+
+    io.run();
+}
+
+TEST(pipeline, should_return_error_of_failed_query_and_leave_connection_usable) {
+    using namespace ozo::literals;
+
+    ozo::io_context io;
+    ozo::connection_info conn_info(OZO_PG_TEST_CONNINFO);
+    ozo::rows_of<std::int32_t> first;
+    ozo::rows_of<std::int32_t> second;
+
+    const auto steps = boost::hana::make_tuple(
+        ozo::pipeline_step{"SELECT 1/0"_SQL, ozo::into(first)},
+        ozo::pipeline_step{"SELECT 2"_SQL, ozo::into(second)}
+    );
+
+    ozo::pipeline(conn_info[io], steps,
+        [&](ozo::error_code ec, auto conn) {
+            EXPECT_EQ(ec, ozo::sqlstate::division_by_zero);
+            EXPECT_FALSE(ozo::connection_bad(conn));
+            EXPECT_EQ(ozo::get_transaction_status(conn), ozo::transaction_status::idle);
+            EXPECT_TRUE(second.empty());
+        });
+
+    io.run();
+}
+
+} // namespace
+
+#endif // LIBPQ_HAS_PIPELINING
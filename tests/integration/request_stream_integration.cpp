@@ -0,0 +1,62 @@
+#include <ozo/connection_info.h>
+#include <ozo/query_builder.h>
+#include <ozo/request_stream.h>
+#include <ozo/shortcuts.h>
+#include <ozo/transaction_status.h>
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+namespace {
+
+using namespace testing;
+
+TEST(request_stream, should_pass_all_rows_to_handler_by_chunks) {
+    using namespace ozo::literals;
+    using row = ozo::typed_row<std::int32_t>;
+
+    ozo::io_context io;
+    ozo::connection_info conn_info(OZO_PG_TEST_CONNINFO);
+    std::vector<std::size_t> chunks;
+    std::int32_t sum = 0;
+
+    auto handler = ozo::stream_into<row>([&](std::vector<row>& rows) {
+        chunks.push_back(rows.size());
+        for (const auto& r : rows) {
+            sum += std::get<0>(r);
+        }
+    }, 4);
+
+    ozo::request_stream(conn_info[io], "SELECT generate_series(1, 10)"_SQL, std::move(handler),
+        [&](ozo::error_code ec, auto conn) {
+            ASSERT_FALSE(ec) << ec.message() << " | " << error_message(conn) << " | " << get_error_context(conn);
+            EXPECT_FALSE(ozo::connection_bad(conn));
+            EXPECT_THAT(chunks, ElementsAre(4, 4, 2));
+            EXPECT_EQ(sum, 55);
+        });
+
+    io.run();
+}
+
+TEST(request_stream, should_return_error_and_leave_connection_usable) {
+    using namespace ozo::literals;
+    using row = ozo::typed_row<std::int32_t>;
+
+    ozo::io_context io;
+    ozo::connection_info conn_info(OZO_PG_TEST_CONNINFO);
+    std::size_t received = 0;
+
+    auto handler = ozo::stream_into<row>([&](std::vector<row>& rows) { received += rows.size(); }, 1);
+
+    ozo::request_stream(conn_info[io], "SELECT 1/(3 - generate_series(1, 5))"_SQL, std::move(handler),
+        [&](ozo::error_code ec, auto conn) {
+            EXPECT_EQ(ec, ozo::sqlstate::division_by_zero);
+            EXPECT_FALSE(ozo::connection_bad(conn));
+            EXPECT_EQ(ozo::get_transaction_status(conn), ozo::transaction_status::idle);
+            EXPECT_EQ(received, 2u);
+        });
+
+    io.run();
+}
+
+} // namespace
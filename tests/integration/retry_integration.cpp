@@ -77,6 +77,28 @@ TEST(request, should_return_success_for_invalid_connection_info_retried_with_val
     EXPECT_EQ(conn_info.i_, conn_info.base_.end());
 }
 
+TEST(request, should_return_success_for_invalid_connection_info_retried_with_backoff_and_budget) {
+    using namespace ozo::literals;
+    using namespace std::chrono_literals;
+
+    ozo::io_context io;
+    connection_info_sequence<> conn_info({"invalid connection info", OZO_PG_TEST_CONNINFO});
+    const auto budget = std::make_shared<ozo::failover::retry_budget>();
+
+    std::vector<int> res;
+    const auto retry = ozo::failover::retry(ozo::errc::connection_error).backoff({10ms, 100ms}).budget(budget)*2;
+    ozo::request[retry](conn_info[io], "SELECT 1"_SQL + " + 1"_SQL, 1s, ozo::into(res),
+            [&](ozo::error_code ec, auto conn) {
+        ASSERT_REQUEST_OK(ec, conn);
+        EXPECT_EQ(res.front(), 2);
+    });
+
+    io.run();
+    EXPECT_EQ(conn_info.i_, conn_info.base_.end());
+    EXPECT_EQ(budget->stats().operations, 1u);
+    EXPECT_EQ(budget->stats().retries, 1u);
+}
+
 TEST(request, should_return_error_and_bad_connect_for_nonretryable_error) {
     using namespace ozo::literals;
     using namespace hana::literals;
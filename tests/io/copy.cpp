@@ -0,0 +1,133 @@
+#include <ozo/io/copy.h>
+#include <ozo/ext/std.h>
+#include <ozo/pg/types.h>
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+namespace ozo::tests {
+
+struct copy_row {
+    BOOST_HANA_DEFINE_STRUCT(copy_row,
+        (std::int16_t, id),
+        (std::optional<std::string>, name)
+    );
+};
+
+} // namespace ozo::tests
+
+namespace {
+
+using namespace testing;
+
+struct send_copy : Test {
+    std::vector<char> buffer;
+    ozo::ostream os{buffer};
+
+    ozo::empty_oid_map oid_map;
+};
+
+TEST_F(send_copy, write_copy_header_should_store_signature_and_zero_flags_and_extension_size) {
+    ozo::write_copy_header(os);
+    EXPECT_THAT(buffer, ElementsAre(
+        'P', 'G', 'C', 'O', 'P', 'Y', '\n', '\377', '\r', '\n', '\0',
+        0, 0, 0, 0,
+        0, 0, 0, 0
+    ));
+}
+
+TEST_F(send_copy, write_copy_trailer_should_store_minus_one_as_int16) {
+    ozo::write_copy_trailer(os);
+    EXPECT_THAT(buffer, ElementsAre(char(0xFF), char(0xFF)));
+}
+
+TEST_F(send_copy, send_copy_row_with_tuple_should_store_fields_number_and_data_frames) {
+    ozo::send_copy_row(os, oid_map, std::make_tuple(std::int16_t(42), std::string("ab")));
+    EXPECT_THAT(buffer, ElementsAre(
+        0, 2,
+        0, 0, 0, 2,
+        0, 42,
+        0, 0, 0, 2,
+        'a', 'b'
+    ));
+}
+
+TEST_F(send_copy, send_copy_row_with_hana_struct_should_store_null_as_minus_one_size) {
+    ozo::send_copy_row(os, oid_map, ozo::tests::copy_row{42, std::nullopt});
+    EXPECT_THAT(buffer, ElementsAre(
+        0, 2,
+        0, 0, 0, 2,
+        0, 42,
+        char(0xFF), char(0xFF), char(0xFF), char(0xFF)
+    ));
+}
+
+struct recv_copy : Test {
+    std::vector<char> buffer;
+    ozo::ostream os{buffer};
+
+    ozo::empty_oid_map oid_map;
+
+    ozo::istream make_istream() const {
+        return ozo::istream(buffer.data(), buffer.size());
+    }
+};
+
+TEST_F(recv_copy, read_copy_header_should_skip_header_extension) {
+    ozo::write(os, std::string_view("PGCOPY\n\377\r\n\0", 11));
+    ozo::write(os, std::int32_t(0));
+    ozo::write(os, std::int32_t(2));
+    ozo::write(os, std::int16_t(0x0102));
+    ozo::write_copy_trailer(os);
+    auto is = make_istream();
+    ozo::read_copy_header(is);
+    std::int16_t trailer = 0;
+    ozo::read(is, trailer);
+    EXPECT_EQ(trailer, -1);
+}
+
+TEST_F(recv_copy, read_copy_header_should_throw_on_bad_signature) {
+    ozo::write(os, std::string_view("PGCOPY\n\377\r\r\0", 11));
+    ozo::write(os, std::int32_t(0));
+    ozo::write(os, std::int32_t(0));
+    auto is = make_istream();
+    EXPECT_THROW(ozo::read_copy_header(is), ozo::system_error);
+}
+
+TEST_F(recv_copy, recv_copy_row_should_read_tuple_written_by_send_copy_row) {
+    ozo::send_copy_row(os, oid_map, std::make_tuple(std::int16_t(42), std::string("ab")));
+    auto is = make_istream();
+    std::tuple<std::int16_t, std::string> row;
+    EXPECT_TRUE(ozo::recv_copy_row(is, oid_map, row));
+    EXPECT_EQ(row, std::make_tuple(std::int16_t(42), std::string("ab")));
+}
+
+TEST_F(recv_copy, recv_copy_row_should_read_hana_struct_with_null) {
+    ozo::send_copy_row(os, oid_map, ozo::tests::copy_row{42, std::nullopt});
+    auto is = make_istream();
+    ozo::tests::copy_row row{0, "text"};
+    EXPECT_TRUE(ozo::recv_copy_row(is, oid_map, row));
+    EXPECT_EQ(row.id, 42);
+    EXPECT_EQ(row.name, std::nullopt);
+}
+
+TEST_F(recv_copy, recv_copy_row_should_return_false_on_trailer) {
+    ozo::write_copy_trailer(os);
+    auto is = make_istream();
+    std::tuple<std::int16_t> row;
+    EXPECT_FALSE(ozo::recv_copy_row(is, oid_map, row));
+}
+
+TEST_F(recv_copy, recv_copy_row_should_throw_on_fields_number_mismatch) {
+    ozo::send_copy_row(os, oid_map, std::make_tuple(std::int16_t(42), std::string("ab")));
+    auto is = make_istream();
+    std::tuple<std::int16_t> row;
+    try {
+        ozo::recv_copy_row(is, oid_map, row);
+        FAIL() << "exception expected";
+    } catch (const ozo::system_error& e) {
+        EXPECT_EQ(e.code(), ozo::error::bad_copy_data);
+    }
+}
+
+} // namespace
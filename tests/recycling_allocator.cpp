@@ -0,0 +1,173 @@
+#include <ozo/recycling_allocator.h>
+
+#include <boost/asio/bind_executor.hpp>
+#include <boost/asio/io_context.hpp>
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <vector>
+
+namespace {
+
+using namespace testing;
+
+struct block {
+    char data[100];
+};
+
+TEST(recycling_allocator, should_reuse_deallocated_block_of_the_same_size) {
+    ozo::recycling_allocator<block> allocator;
+    block* first = allocator.allocate(1);
+    allocator.deallocate(first, 1);
+    block* second = allocator.allocate(1);
+    EXPECT_EQ(first, second);
+    allocator.deallocate(second, 1);
+}
+
+TEST(recycling_allocator, should_reuse_deallocated_block_for_rebound_type_of_similar_size) {
+    ozo::recycling_allocator<block> allocator;
+    block* first = allocator.allocate(1);
+    allocator.deallocate(first, 1);
+    ozo::recycling_allocator<char> other(allocator);
+    char* second = other.allocate(sizeof(block) + 1);
+    EXPECT_EQ(static_cast<void*>(first), static_cast<void*>(second));
+    other.deallocate(second, sizeof(block) + 1);
+}
+
+TEST(recycling_allocator, should_not_reuse_deallocated_block_of_other_size) {
+    ozo::recycling_allocator<block> allocator;
+    block* first = allocator.allocate(1);
+    block* kept = allocator.allocate(4);
+    allocator.deallocate(first, 1);
+    block* second = allocator.allocate(4);
+    EXPECT_NE(kept, second);
+    EXPECT_NE(static_cast<void*>(first), static_cast<void*>(second));
+    allocator.deallocate(second, 4);
+    allocator.deallocate(kept, 4);
+}
+
+TEST(recycling_allocator, should_be_usable_with_standard_containers) {
+    std::vector<int, ozo::recycling_allocator<int>> v;
+    for (int i = 0; i < 10000; ++i) {
+        v.push_back(i);
+    }
+    EXPECT_EQ(v.size(), 10000u);
+    EXPECT_EQ(v.back(), 9999);
+}
+
+TEST(recycling_allocator, should_be_equal_to_any_recycling_allocator) {
+    EXPECT_TRUE(ozo::recycling_allocator<int>{} == ozo::recycling_allocator<char>{});
+    EXPECT_FALSE(ozo::recycling_allocator<int>{} != ozo::recycling_allocator<char>{});
+}
+
+struct handler_with_allocator {
+    using allocator_type = std::allocator<int>;
+    allocator_type get_allocator() const { return {}; }
+    void operator() () const {}
+};
+
+TEST(get_operation_allocator, should_return_recycling_allocator_for_handler_with_default_allocator) {
+    const auto handler = [] {};
+    EXPECT_TRUE((std::is_same_v<decltype(ozo::detail::get_operation_allocator(handler)),
+        ozo::recycling_allocator<char>>));
+}
+
+TEST(get_operation_allocator, should_return_handler_associated_allocator_for_handler_with_allocator) {
+    EXPECT_TRUE((std::is_same_v<decltype(ozo::detail::get_operation_allocator(handler_with_allocator{})),
+        std::allocator<int>>));
+}
+
+TEST(get_operation_allocator, should_return_allocator_bound_to_handler) {
+    const auto handler = ozo::bind_allocator(std::allocator<char>{}, [] {});
+    EXPECT_TRUE((std::is_same_v<decltype(ozo::detail::get_operation_allocator(handler)),
+        std::allocator<char>>));
+}
+
+TEST(bind_allocator, should_call_handler_with_arguments) {
+    int value = 0;
+    auto handler = ozo::bind_allocator(std::allocator<char>{}, [&] (int v) { value = v; });
+    handler(42);
+    EXPECT_EQ(value, 42);
+}
+
+TEST(bind_allocator, should_keep_handler_associated_executor) {
+    boost::asio::io_context io;
+    const auto handler = ozo::bind_allocator(std::allocator<char>{},
+        boost::asio::bind_executor(io.get_executor(), [] {}));
+    EXPECT_EQ(boost::asio::get_associated_executor(handler), io.get_executor());
+}
+
+template <typename T>
+struct counting_allocator {
+    using value_type = T;
+
+    std::size_t* allocations;
+
+    explicit counting_allocator(std::size_t& allocations) : allocations(&allocations) {}
+
+    template <typename U>
+    counting_allocator(const counting_allocator<U>& other) : allocations(other.allocations) {}
+
+    T* allocate(std::size_t n) {
+        ++*allocations;
+        return std::allocator<T>{}.allocate(n);
+    }
+
+    void deallocate(T* ptr, std::size_t n) {
+        --*allocations;
+        std::allocator<T>{}.deallocate(ptr, n);
+    }
+
+    template <typename U>
+    bool operator ==(const counting_allocator<U>& other) const { return allocations == other.allocations;}
+
+    template <typename U>
+    bool operator !=(const counting_allocator<U>& other) const { return !(*this == other);}
+};
+
+struct handler_with_counting_allocator {
+    using allocator_type = counting_allocator<void>;
+    std::size_t* allocations;
+    allocator_type get_allocator() const { return allocator_type(*allocations); }
+    void operator() () const {}
+};
+
+TEST(operation_arena_allocator, should_take_single_block_for_objects_which_fit_the_capacity) {
+    std::size_t allocations = 0;
+    {
+        const auto allocator = ozo::detail::make_operation_arena_allocator(
+            handler_with_counting_allocator{&allocations}, 256);
+        const auto first = std::allocate_shared<block>(allocator);
+        const auto second = std::allocate_shared<int>(allocator, 42);
+        std::vector<char, std::decay_t<decltype(allocator)>> buffer(16, 'a', allocator);
+        EXPECT_EQ(allocations, 1u);
+    }
+    EXPECT_EQ(allocations, 0u);
+}
+
+TEST(operation_arena_allocator, should_keep_block_until_all_parts_are_deallocated) {
+    std::size_t allocations = 0;
+    std::shared_ptr<block> part;
+    {
+        const auto allocator = ozo::detail::make_operation_arena_allocator(
+            handler_with_counting_allocator{&allocations}, 256);
+        part = std::allocate_shared<block>(allocator);
+    }
+    EXPECT_EQ(allocations, 1u);
+    part.reset();
+    EXPECT_EQ(allocations, 0u);
+}
+
+TEST(operation_arena_allocator, should_use_underlying_allocator_for_objects_which_do_not_fit_the_capacity) {
+    std::size_t allocations = 0;
+    {
+        const auto allocator = ozo::detail::make_operation_arena_allocator(
+            handler_with_counting_allocator{&allocations}, 16);
+        const auto first = std::allocate_shared<block>(allocator);
+        EXPECT_EQ(allocations, 2u);
+    }
+    EXPECT_EQ(allocations, 0u);
+}
+
+} // namespace
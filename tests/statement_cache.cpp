@@ -0,0 +1,106 @@
+#include <ozo/statement_cache.h>
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+namespace {
+
+using namespace testing;
+
+using types_view = ozo::statement_cache::types_view;
+
+const ozo::oid_t int_types[] = {23, 23};
+const ozo::oid_t text_types[] = {25, 25};
+
+TEST(statement_cache, should_be_disabled_by_default) {
+    ozo::statement_cache cache;
+    EXPECT_FALSE(cache.enabled());
+}
+
+TEST(statement_cache, should_be_enabled_with_non_zero_capacity) {
+    ozo::statement_cache cache{1};
+    EXPECT_TRUE(cache.enabled());
+}
+
+TEST(statement_cache, make_name_should_return_unique_names) {
+    ozo::statement_cache cache{1};
+    EXPECT_NE(cache.make_name(), cache.make_name());
+}
+
+TEST(statement_cache, find_should_return_nullptr_for_unknown_query) {
+    ozo::statement_cache cache{1};
+    EXPECT_EQ(cache.find("SELECT 1", {}), nullptr);
+}
+
+TEST(statement_cache, find_should_return_name_of_added_statement) {
+    ozo::statement_cache cache{1};
+    cache.add("SELECT $1 + $2", {int_types, 2}, "name");
+    const auto name = cache.find("SELECT $1 + $2", {int_types, 2});
+    ASSERT_NE(name, nullptr);
+    EXPECT_EQ(*name, "name");
+}
+
+TEST(statement_cache, find_should_distinguish_statements_by_parameters_types) {
+    ozo::statement_cache cache{2};
+    cache.add("SELECT $1 || $2", {int_types, 2}, "int");
+    cache.add("SELECT $1 || $2", {text_types, 2}, "text");
+    EXPECT_EQ(*cache.find("SELECT $1 || $2", {int_types, 2}), "int");
+    EXPECT_EQ(*cache.find("SELECT $1 || $2", {text_types, 2}), "text");
+    EXPECT_EQ(cache.find("SELECT $1 || $2", {text_types, 1}), nullptr);
+}
+
+TEST(statement_cache, add_should_evict_least_recently_used_statement_as_obsolete) {
+    ozo::statement_cache cache{2};
+    cache.add("SELECT 1", {}, "first");
+    cache.add("SELECT 2", {}, "second");
+    cache.find("SELECT 1", {});
+    cache.add("SELECT 3", {}, "third");
+
+    EXPECT_EQ(cache.size(), 2u);
+    EXPECT_EQ(cache.find("SELECT 2", {}), nullptr);
+    EXPECT_NE(cache.find("SELECT 1", {}), nullptr);
+    EXPECT_NE(cache.find("SELECT 3", {}), nullptr);
+    EXPECT_THAT(cache.obsolete(), ElementsAre("second"));
+}
+
+TEST(statement_cache, add_should_replace_existing_statement_and_make_it_obsolete) {
+    ozo::statement_cache cache{2};
+    cache.add("SELECT 1", {}, "first");
+    cache.add("SELECT 1", {}, "second");
+
+    EXPECT_EQ(cache.size(), 1u);
+    EXPECT_EQ(*cache.find("SELECT 1", {}), "second");
+    EXPECT_THAT(cache.obsolete(), ElementsAre("first"));
+}
+
+TEST(statement_cache, invalidate_should_remove_statement_and_make_it_obsolete) {
+    ozo::statement_cache cache{2};
+    cache.add("SELECT 1", {}, "first");
+    cache.invalidate("first");
+
+    EXPECT_EQ(cache.find("SELECT 1", {}), nullptr);
+    EXPECT_THAT(cache.obsolete(), ElementsAre("first"));
+}
+
+TEST(statement_cache, forget_should_remove_statement_without_making_it_obsolete) {
+    ozo::statement_cache cache{2};
+    cache.add("SELECT 1", {}, "first");
+    cache.forget("first");
+
+    EXPECT_EQ(cache.find("SELECT 1", {}), nullptr);
+    EXPECT_THAT(cache.obsolete(), IsEmpty());
+}
+
+TEST(statement_cache, should_deallocate_should_return_true_when_obsolete_statements_reach_capacity) {
+    ozo::statement_cache cache{2};
+    cache.add("SELECT 1", {}, "first");
+    cache.add("SELECT 2", {}, "second");
+    cache.invalidate("first");
+    EXPECT_FALSE(cache.should_deallocate());
+    cache.invalidate("second");
+    EXPECT_TRUE(cache.should_deallocate());
+    cache.clear_obsolete();
+    EXPECT_FALSE(cache.should_deallocate());
+}
+
+} // namespace
@@ -0,0 +1,284 @@
+#include <connection_mock.h>
+
+#include <ozo/connection.h>
+#include <ozo/statistics.h>
+#include <ozo/detail/connection_pool.h>
+#include <ozo/impl/result.h>
+#include <ozo/impl/async_connect.h>
+#include <ozo/impl/async_request.h>
+#include <ozo/request_stream.h>
+#ifdef LIBPQ_HAS_PIPELINING
+#include <ozo/pipeline.h>
+#endif
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+namespace ozo::tests {
+
+struct statistics_connection : connection<> {
+    using connection<>::connection;
+
+    ozo::basic_statistics statistics_;
+
+    const ozo::basic_statistics& statistics() const noexcept { return statistics_;}
+
+    template <typename Key, typename Value>
+    void update_statistics(const Key& key, const Value& value) noexcept {
+        statistics_.update(key, value);
+    }
+};
+
+} // namespace ozo::tests
+
+namespace ozo {
+
+template <>
+struct is_connection<tests::statistics_connection> : std::true_type {};
+
+} // namespace ozo
+
+namespace {
+
+namespace hana = boost::hana;
+
+using namespace testing;
+using namespace std::chrono_literals;
+
+TEST(basic_statistics, update_should_add_value_to_item_with_key) {
+    ozo::basic_statistics statistics;
+    statistics.update(ozo::statistics_key::requests, std::uint64_t(1));
+    statistics.update(ozo::statistics_key::requests, std::uint64_t(2));
+    statistics.update(ozo::statistics_key::result_memory, std::uint64_t(42));
+    statistics.update(ozo::statistics_key::wait_time, ozo::time_traits::duration(1ms));
+
+    EXPECT_EQ(statistics.requests, 3u);
+    EXPECT_EQ(statistics.result_memory, 42u);
+    EXPECT_EQ(statistics.wait_time, ozo::time_traits::duration(1ms));
+    EXPECT_EQ(statistics.errors, 0u);
+}
+
+TEST(basic_statistics, operator_plus_should_sum_all_items) {
+    ozo::basic_statistics lhs;
+    lhs.rows_decoded = 1;
+    lhs.connect_time = 1ms;
+    ozo::basic_statistics rhs;
+    rhs.rows_decoded = 2;
+    rhs.errors = 3;
+    rhs.connect_time = 2ms;
+
+    const auto sum = lhs + rhs;
+
+    EXPECT_EQ(sum.rows_decoded, 3u);
+    EXPECT_EQ(sum.errors, 3u);
+    EXPECT_EQ(sum.connect_time, ozo::time_traits::duration(3ms));
+}
+
+TEST(update_statistics, should_update_statistics_of_connection_with_basic_statistics) {
+    using connection = ozo::connection<ozo::empty_oid_map, ozo::basic_statistics>;
+    static_assert(ozo::detail::CollectsStatistics<connection>);
+
+    ozo::io_context io;
+    connection conn(io, ozo::basic_statistics{});
+    ozo::detail::update_statistics(conn, ozo::statistics_key::connects, std::uint64_t(1));
+
+    EXPECT_EQ(conn.statistics().connects, 1u);
+}
+
+TEST(update_statistics, should_do_nothing_for_connection_without_statistics) {
+    using connection = ozo::connection<ozo::empty_oid_map, ozo::no_statistics>;
+    static_assert(!ozo::detail::CollectsStatistics<connection>);
+    static_assert(std::is_same_v<ozo::detail::statistics_stopwatch_t<connection>, ozo::detail::statistics_stopwatch<false>>);
+
+    ozo::io_context io;
+    connection conn(io, ozo::no_statistics{});
+    ozo::detail::update_statistics(conn, ozo::statistics_key::connects, std::uint64_t(1));
+
+    static_assert(std::is_same_v<std::decay_t<decltype(ozo::detail::get_statistics(conn))>, ozo::none_t>);
+}
+
+TEST(accumulate_statistics, should_add_statistics_of_new_connection_to_previous_ones) {
+    ozo::basic_statistics previous;
+    previous.requests = 2;
+    previous.connects = 1;
+    ozo::basic_statistics v;
+    v.connects = 1;
+
+    const auto result = ozo::detail::accumulate_statistics(previous, v);
+
+    EXPECT_EQ(result.requests, 2u);
+    EXPECT_EQ(result.connects, 2u);
+}
+
+TEST(accumulate_statistics, should_return_none_for_none) {
+    static_assert(std::is_same_v<decltype(ozo::detail::accumulate_statistics(ozo::none, ozo::none)), ozo::none_t>);
+}
+
+TEST(connection_pool_statistics, should_sum_added_statistics) {
+    ozo::detail::connection_pool_statistics<ozo::basic_statistics, ozo::thread_safety<true>> statistics;
+    ozo::basic_statistics v;
+    v.requests = 1;
+    v.wait_time = 1ms;
+    statistics.add(v);
+    statistics.add(v);
+
+    const auto result = statistics.get();
+
+    EXPECT_EQ(result.requests, 2u);
+    EXPECT_EQ(result.wait_time, ozo::time_traits::duration(2ms));
+}
+
+TEST(connection_pool_statistics, should_sum_all_items_of_added_statistics) {
+    ozo::detail::connection_pool_statistics<ozo::basic_statistics, ozo::thread_safety<true>> statistics;
+    ozo::basic_statistics v;
+    v.requests = 1;
+    v.round_trips = 2;
+    v.bytes_sent = 3;
+    v.result_memory = 4;
+    v.rows_decoded = 5;
+    v.errors = 6;
+    v.connects = 7;
+    v.connect_errors = 8;
+    v.send_time = 9ms;
+    v.wait_time = 10ms;
+    v.decode_time = 11ms;
+    v.connect_time = 12ms;
+    statistics.add(v);
+
+    const auto expected = v + ozo::basic_statistics{};
+    const auto result = statistics.get();
+
+    EXPECT_EQ(result.requests, expected.requests);
+    EXPECT_EQ(result.round_trips, expected.round_trips);
+    EXPECT_EQ(result.bytes_sent, expected.bytes_sent);
+    EXPECT_EQ(result.result_memory, expected.result_memory);
+    EXPECT_EQ(result.rows_decoded, expected.rows_decoded);
+    EXPECT_EQ(result.errors, expected.errors);
+    EXPECT_EQ(result.connects, expected.connects);
+    EXPECT_EQ(result.connect_errors, expected.connect_errors);
+    EXPECT_EQ(result.send_time, expected.send_time);
+    EXPECT_EQ(result.wait_time, expected.wait_time);
+    EXPECT_EQ(result.decode_time, expected.decode_time);
+    EXPECT_EQ(result.connect_time, expected.connect_time);
+}
+
+TEST(connection_pool_statistics, should_sum_statistics_of_not_thread_safe_pool) {
+    ozo::detail::connection_pool_statistics<ozo::basic_statistics, ozo::thread_safety<false>> statistics;
+    ozo::basic_statistics v;
+    v.errors = 1;
+    v.send_time = 1ms;
+    statistics.add(v);
+    statistics.add(v);
+
+    const auto result = statistics.get();
+
+    EXPECT_EQ(result.errors, 2u);
+    EXPECT_EQ(result.send_time, ozo::time_traits::duration(2ms));
+}
+
+TEST(connection_pool_statistics, should_return_none_for_none) {
+    ozo::detail::connection_pool_statistics<ozo::none_t, ozo::thread_safety<true>> statistics;
+    statistics.add(ozo::none);
+    static_assert(std::is_same_v<decltype(statistics.get()), ozo::none_t>);
+}
+
+TEST(result_size, should_return_memory_size_of_result) {
+    const std::unique_ptr<PGresult, decltype(&PQclear)> res(PQmakeEmptyPGresult(nullptr, PGRES_TUPLES_OK), &PQclear);
+    ASSERT_NE(res, nullptr);
+    EXPECT_GT(ozo::impl::result_size(*res), 0u);
+}
+
+struct operation_statistics : Test {
+    using connection_ptr = std::shared_ptr<ozo::tests::statistics_connection>;
+
+    StrictMock<ozo::tests::connection_gmock> connection{};
+    NiceMock<ozo::tests::PGconn_mock> native_handle{};
+    StrictMock<ozo::tests::callback_gmock<connection_ptr>> callback{};
+    StrictMock<ozo::tests::executor_mock> strand{};
+    ozo::tests::io_context io;
+    ozo::tests::execution_context cb_io;
+    connection_ptr conn = std::make_shared<ozo::tests::statistics_connection>(
+        std::addressof(native_handle), ozo::empty_oid_map{}, std::addressof(connection), "", std::addressof(io));
+    // 9 bytes of the text and 4 bytes of the integer parameter.
+    const decltype(ozo::make_query("SELECT $1", 42)) query = ozo::make_query("SELECT $1", 42);
+    const std::uint64_t query_size = 13;
+
+    auto make_operation_context() {
+        EXPECT_CALL(callback, get_executor()).WillRepeatedly(Return(cb_io.get_executor()));
+        return ozo::impl::make_request_operation_context(conn, ozo::tests::wrap(callback));
+    }
+};
+
+TEST_F(operation_statistics, request_should_count_request_round_trip_and_bytes_sent) {
+    EXPECT_CALL(io.strand_service_, get_executor()).WillOnce(ReturnRef(strand));
+    EXPECT_CALL(callback, get_executor()).WillRepeatedly(Return(cb_io.get_executor()));
+    EXPECT_CALL(native_handle, PQsetnonblocking(1)).WillOnce(Return(0));
+    EXPECT_CALL(native_handle, PQsendQueryParams(_, _, _, _, _, _, _)).WillOnce(Return(1));
+    EXPECT_CALL(native_handle, PQflush()).WillOnce(Return(0));
+    EXPECT_CALL(native_handle, PQisBusy()).WillOnce(Return(0));
+    EXPECT_CALL(native_handle, PQgetResult()).WillOnce(Return(nullptr));
+    EXPECT_CALL(cb_io.executor_, dispatch(_)).WillOnce(InvokeArgument<0>());
+    EXPECT_CALL(callback, call(ozo::error_code{}, _)).WillOnce(Return());
+
+    ozo::impl::async_request_op{query, ozo::none, ozo::none, ozo::tests::wrap(callback)}(ozo::error_code{}, conn);
+
+    EXPECT_EQ(conn->statistics().requests, 1u);
+    EXPECT_EQ(conn->statistics().round_trips, 1u);
+    EXPECT_EQ(conn->statistics().bytes_sent, query_size);
+}
+
+#ifndef LIBPQ_HAS_CHUNK_MODE
+
+TEST_F(operation_statistics, request_stream_should_count_request_round_trip_and_bytes_sent) {
+    const auto ctx = make_operation_context();
+    EXPECT_CALL(native_handle, PQsetnonblocking(1)).WillOnce(Return(0));
+    EXPECT_CALL(native_handle, PQsendQueryParams(_, _, _, _, _, _, _)).WillOnce(Return(1));
+    EXPECT_CALL(native_handle, PQsetSingleRowMode()).WillOnce(Return(1));
+    EXPECT_CALL(native_handle, PQflush()).WillOnce(Return(0));
+
+    ozo::impl::async_send_streamed_query(ctx, query);
+
+    EXPECT_EQ(conn->statistics().requests, 1u);
+    EXPECT_EQ(conn->statistics().round_trips, 1u);
+    EXPECT_EQ(conn->statistics().bytes_sent, query_size);
+}
+
+#endif
+
+#ifdef LIBPQ_HAS_PIPELINING
+
+TEST_F(operation_statistics, pipeline_should_count_requests_and_bytes_sent_of_all_queries_and_one_round_trip) {
+    const auto ctx = make_operation_context();
+    EXPECT_CALL(native_handle, PQsetnonblocking(1)).WillOnce(Return(0));
+    EXPECT_CALL(native_handle, PQenterPipelineMode()).WillOnce(Return(1));
+    EXPECT_CALL(native_handle, PQsendQueryParams(_, _, _, _, _, _, _)).Times(2).WillRepeatedly(Return(1));
+    EXPECT_CALL(native_handle, PQpipelineSync()).WillOnce(Return(1));
+    EXPECT_CALL(native_handle, PQflush()).WillOnce(Return(0));
+
+    ozo::impl::async_send_pipeline(ctx, hana::make_tuple(
+        ozo::pipeline_step{query, ozo::none},
+        ozo::pipeline_step{query, ozo::none}
+    ));
+
+    EXPECT_EQ(conn->statistics().requests, 2u);
+    EXPECT_EQ(conn->statistics().round_trips, 1u);
+    EXPECT_EQ(conn->statistics().bytes_sent, 2 * query_size);
+}
+
+#endif
+
+TEST_F(operation_statistics, connect_should_count_connect) {
+    EXPECT_CALL(native_handle, PQconnectPoll()).WillOnce(Return(PGRES_POLLING_OK));
+    bool called = false;
+
+    ozo::impl::async_connect_op(conn, [&] (ozo::error_code ec, connection_ptr) {
+        EXPECT_FALSE(ec);
+        called = true;
+    })(ozo::error_code{});
+
+    EXPECT_TRUE(called);
+    EXPECT_EQ(conn->statistics().connects, 1u);
+    EXPECT_EQ(conn->statistics().connect_errors, 0u);
+}
+
+} // namespace